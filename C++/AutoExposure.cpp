@@ -0,0 +1,285 @@
+﻿/********************************************************************************/
+/*
+* File name: AutoExposure.cpp
+*
+* Synopsis:  Implementation of the host-side auto-exposure. See AutoExposure.h.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. */
+#include "AutoExposure.h"
+#include <math.h>
+#include "FeatureAccess.h"
+
+using namespace std;
+
+/* States of the write request. */
+#define AE_IDLE                     0
+#define AE_WRITE_REQUESTED          1
+#define AE_WAITING_FOR_EFFECT       2
+
+/* Largest correction applied in one step, as a factor of the current exposure. */
+#define AE_MAX_STEP                 4.0
+
+/* A setting is considered applied once the mean moved by this fraction of the */
+/* expected change, or after this many frames without a visible change.        */
+#define AE_EFFECT_FRACTION          0.5
+#define AE_EFFECT_TIMEOUT_FRAMES    10
+
+/* Pixels at full scale beyond this fraction make the frame count as overexposed. */
+#define AE_SATURATION_FRACTION      0.02
+
+static MIL_DOUBLE Clamp(MIL_DOUBLE Value, MIL_DOUBLE Min, MIL_DOUBLE Max)
+   {
+   return (Value < Min) ? Min : ((Value > Max) ? Max : Value);
+   }
+
+/* Control thread: writes the requested settings to the camera. */
+static MIL_UINT32 MFTYPE ControlThread(void* ThreadContext)
+   {
+   AutoExposureStruct* Ae = (AutoExposureStruct*)ThreadContext;
+
+   for (;;)
+      {
+      MthrWait(Ae->MilEvent, M_EVENT_WAIT, M_NULL);
+      if (Ae->StopRequested.load())
+         break;
+      if (Ae->State.load(memory_order_acquire) != AE_WRITE_REQUESTED)
+         continue;
+
+      MIL_DOUBLE StartTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+
+      MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+      if (Ae->RequestedExposure != Ae->Exposure)
+         {
+         FeatureAccessControl(Ae->MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("ExposureTime"), M_TYPE_MIL_DOUBLE, &Ae->RequestedExposure);
+         Ae->Exposure = Ae->RequestedExposure;
+         Ae->WriteCount++;
+         }
+      if (Ae->GainAvailable && Ae->RequestedGain != Ae->Gain)
+         {
+         FeatureAccessControl(Ae->MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("Gain"), M_TYPE_MIL_DOUBLE, &Ae->RequestedGain);
+         Ae->Gain = Ae->RequestedGain;
+         Ae->WriteCount++;
+         }
+      MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+
+      Ae->WriteTime += MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) - StartTime;
+
+      /* Frames processed up to now were exposed, at least in part, before the write. */
+      Ae->CompletionFrame = Ae->LastFrame.load();
+      Ae->State.store(AE_WAITING_FOR_EFFECT, memory_order_release);
+      }
+
+   return 0;
+   }
+
+/* Puts back the auto modes that were turned off by the start. */
+static void RestoreAutoModes(AutoExposureStruct* Ae)
+   {
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+   if (!Ae->PreviousExposureAuto.empty())
+      FeatureAccessControl(Ae->MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("ExposureAuto"), M_TYPE_STRING, Ae->PreviousExposureAuto.c_str());
+   if (!Ae->PreviousGainAuto.empty())
+      FeatureAccessControl(Ae->MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GainAuto"), M_TYPE_STRING, Ae->PreviousGainAuto.c_str());
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+   Ae->PreviousExposureAuto.clear();
+   Ae->PreviousGainAuto.clear();
+   }
+
+/* Reads the exposure and gain ranges, turns off the camera's own auto modes */
+/* and starts the control thread.                                           */
+bool AutoExposureStart(MIL_ID MilSystem, MIL_ID MilDigitizer, MIL_DOUBLE Target, MIL_DOUBLE Deadband,
+                       AutoExposureStruct* AutoExposure)
+   {
+   AutoExposureStruct* Ae = AutoExposure;
+
+   Ae->MilDigitizer = MilDigitizer;
+   Ae->MilThread = M_NULL;
+   Ae->MilEvent = M_NULL;
+   Ae->StopRequested.store(false);
+   Ae->Target = Target;
+   Ae->Deadband = Deadband;
+   Ae->ExposureMin = Ae->ExposureMax = Ae->Exposure = 0.0;
+   Ae->GainMin = Ae->GainMax = Ae->Gain = 0.0;
+   Ae->State.store(AE_IDLE);
+   Ae->LastFrame.store(0);
+   Ae->RequestFrame = Ae->CompletionFrame = 0;
+   Ae->Converged = false;
+   Ae->StartTime = Ae->DisturbanceTime = Ae->LastFrameTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+   Ae->FirstConvergenceTime = -1.0;
+   Ae->ChangeCount = Ae->WriteCount = 0;
+   Ae->WriteTime = 0.0;
+   Ae->LatencyFrames = Ae->LatencyCount = 0;
+   Ae->ConvergenceCount = 0;
+   Ae->ConvergenceTime = 0.0;
+
+   Ae->PreviousExposureAuto.clear();
+   Ae->PreviousGainAuto.clear();
+
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("ExposureAuto"), M_TYPE_STRING, Ae->PreviousExposureAuto);
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GainAuto"), M_TYPE_STRING, Ae->PreviousGainAuto);
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("ExposureAuto"), M_TYPE_STRING, MIL_TEXT("Off"));
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GainAuto"), M_TYPE_STRING, MIL_TEXT("Off"));
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("ExposureTime"), M_TYPE_MIL_DOUBLE, &Ae->Exposure);
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_MIN, MIL_TEXT("ExposureTime"), M_TYPE_MIL_DOUBLE, &Ae->ExposureMin);
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_MAX, MIL_TEXT("ExposureTime"), M_TYPE_MIL_DOUBLE, &Ae->ExposureMax);
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("Gain"), M_TYPE_MIL_DOUBLE, &Ae->Gain);
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_MIN, MIL_TEXT("Gain"), M_TYPE_MIL_DOUBLE, &Ae->GainMin);
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_MAX, MIL_TEXT("Gain"), M_TYPE_MIL_DOUBLE, &Ae->GainMax);
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+
+   if (Ae->Exposure <= 0.0 || Ae->ExposureMax <= Ae->ExposureMin)
+      return false;
+   Ae->GainAvailable = (Ae->GainMax > Ae->GainMin);
+
+   MthrAlloc(MilSystem, M_EVENT, M_NOT_SIGNALED + M_AUTO_RESET, M_NULL, M_NULL, &Ae->MilEvent);
+   MthrAlloc(MilSystem, M_THREAD, M_DEFAULT, &ControlThread, Ae, &Ae->MilThread);
+   return (Ae->MilThread != M_NULL);
+   }
+
+/* Called with the statistics of every frame. Never blocks. */
+void AutoExposureUpdate(AutoExposureStruct* AutoExposure, const FrameStatsStruct* Stats, MIL_UINT64 FrameNumber,
+                        MIL_DOUBLE FrameTime)
+   {
+   AutoExposureStruct* Ae = AutoExposure;
+   MIL_DOUBLE FullScale, Mean, Error;
+
+   if (Ae->MilThread == M_NULL || Stats->PixelCount == 0)
+      return;
+
+   Ae->LastFrame.store(FrameNumber);
+   Ae->LastFrameTime = FrameTime;
+
+   FullScale = (MIL_DOUBLE)((1ULL << Stats->SizeBit) - 1);
+   Mean = Stats->Mean/FullScale;
+   if (Mean < 0.001)
+      Mean = 0.001;
+
+   /* A clipped mean underestimates the exposure; push down harder. */
+   if ((MIL_DOUBLE)Stats->SaturatedCount/Stats->PixelCount > AE_SATURATION_FRACTION && Mean < 1.5*Ae->Target)
+      Mean = 1.5*Ae->Target;
+
+   switch (Ae->State.load(memory_order_acquire))
+      {
+      case AE_WRITE_REQUESTED:
+         return;
+
+      case AE_WAITING_FOR_EFFECT:
+         {
+         /* Only frames processed after the write can show the new setting. */
+         if (FrameNumber <= Ae->CompletionFrame)
+            return;
+
+         MIL_DOUBLE Expected = log(Ae->ExpectedRatio);
+         MIL_DOUBLE Observed = log(Mean/Ae->MeanAtRequest);
+         bool Visible = (fabs(Expected) < 1e-6) || (Observed/Expected >= AE_EFFECT_FRACTION);
+         if (!Visible && FrameNumber - Ae->CompletionFrame < AE_EFFECT_TIMEOUT_FRAMES)
+            return;
+
+         /* The new setting takes effect on this frame. */
+         Ae->LatencyFrames += FrameNumber - Ae->RequestFrame;
+         Ae->LatencyCount++;
+         Ae->State.store(AE_IDLE, memory_order_relaxed);
+         }
+         break;
+
+      default:
+         break;
+      }
+
+   Error = Ae->Target/Mean;
+   if (fabs(Error - 1.0) <= Ae->Deadband)
+      {
+      if (!Ae->Converged)
+         {
+         Ae->Converged = true;
+         Ae->ConvergenceTime += FrameTime - Ae->DisturbanceTime;
+         Ae->ConvergenceCount++;
+         if (Ae->FirstConvergenceTime < 0.0)
+            Ae->FirstConvergenceTime = FrameTime - Ae->StartTime;
+         }
+      return;
+      }
+
+   if (Ae->Converged)
+      {
+      Ae->Converged = false;
+      Ae->DisturbanceTime = FrameTime;
+      }
+
+   /* Distribute the correction: exposure first, then gain for what remains. */
+   MIL_DOUBLE Step = Clamp(Error, 1.0/AE_MAX_STEP, AE_MAX_STEP);
+   MIL_DOUBLE CurrentGainFactor = Ae->GainAvailable ? pow(10.0, Ae->Gain/20.0) : 1.0;
+   MIL_DOUBLE MinGainFactor = Ae->GainAvailable ? pow(10.0, Ae->GainMin/20.0) : 1.0;
+   MIL_DOUBLE Total = Ae->Exposure*CurrentGainFactor*Step;
+   MIL_DOUBLE NewExposure = Clamp(Total/MinGainFactor, Ae->ExposureMin, Ae->ExposureMax);
+   MIL_DOUBLE NewGain = Ae->GainAvailable ? Clamp(20.0*log10(Total/NewExposure), Ae->GainMin, Ae->GainMax) : Ae->Gain;
+
+   if (NewExposure == Ae->Exposure && NewGain == Ae->Gain)
+      return;
+
+   Ae->RequestedExposure = NewExposure;
+   Ae->RequestedGain = NewGain;
+   Ae->ExpectedRatio = (NewExposure*(Ae->GainAvailable ? pow(10.0, NewGain/20.0) : 1.0))/(Ae->Exposure*CurrentGainFactor);
+   Ae->MeanAtRequest = Mean;
+   Ae->RequestFrame = FrameNumber;
+   Ae->ChangeCount++;
+   Ae->State.store(AE_WRITE_REQUESTED, memory_order_release);
+   MthrControl(Ae->MilEvent, M_EVENT_SET, M_SIGNALED);
+   }
+
+/* Stops the control thread, restores the camera's auto modes and prints */
+/* the behavior of the loop.                                             */
+void AutoExposureStop(AutoExposureStruct* AutoExposure)
+   {
+   AutoExposureStruct* Ae = AutoExposure;
+   MIL_DOUBLE Duration;
+
+   if (Ae->MilThread == M_NULL)
+      {
+      RestoreAutoModes(Ae);
+      if (Ae->MilEvent)
+         MthrFree(Ae->MilEvent);
+      Ae->MilEvent = M_NULL;
+      return;
+      }
+
+   Ae->StopRequested.store(true);
+   MthrControl(Ae->MilEvent, M_EVENT_SET, M_SIGNALED);
+   MthrWait(Ae->MilThread, M_THREAD_END_WAIT, M_NULL);
+   MthrFree(Ae->MilThread);
+   MthrFree(Ae->MilEvent);
+   Ae->MilThread = M_NULL;
+   Ae->MilEvent = M_NULL;
+   RestoreAutoModes(Ae);
+
+   Duration = Ae->LastFrameTime - Ae->StartTime;
+
+   MosPrintf(MIL_TEXT("\n------------------ Software auto-exposure -------------------\n\n"));
+   MosPrintf(MIL_TEXT("%30s %.0f%% of full scale (+/- %.0f%%)\n"), MIL_TEXT("Target mean:"), 100.0*Ae->Target, 100.0*Ae->Deadband);
+   MosPrintf(MIL_TEXT("%30s %.1f us\n"), MIL_TEXT("Exposure time:"), Ae->Exposure);
+   if (Ae->GainAvailable)
+      MosPrintf(MIL_TEXT("%30s %.2f dB\n"), MIL_TEXT("Gain:"), Ae->Gain);
+   else
+      MosPrintf(MIL_TEXT("%30s %s\n"), MIL_TEXT("Gain:"), MIL_TEXT("N/A"));
+   MosPrintf(MIL_TEXT("%30s %llu\n"), MIL_TEXT("Setting changes:"), (unsigned long long)Ae->ChangeCount);
+   MosPrintf(MIL_TEXT("%30s %llu (%.2f per second)\n"), MIL_TEXT("Control writes:"), (unsigned long long)Ae->WriteCount,
+             (Duration > 0.0) ? Ae->WriteCount/Duration : 0.0);
+   if (Ae->WriteCount)
+      MosPrintf(MIL_TEXT("%30s %.2f ms\n"), MIL_TEXT("Average write time:"), 1000.0*Ae->WriteTime/Ae->WriteCount);
+   if (Ae->LatencyCount)
+      MosPrintf(MIL_TEXT("%30s %.1f frames\n"), MIL_TEXT("Setting takes effect after:"), (MIL_DOUBLE)Ae->LatencyFrames/Ae->LatencyCount);
+
+   if (Ae->FirstConvergenceTime < 0.0)
+      MosPrintf(MIL_TEXT("%30s %s\n"), MIL_TEXT("Convergence time:"), MIL_TEXT("not converged"));
+   else
+      {
+      MosPrintf(MIL_TEXT("%30s %.3f s\n"), MIL_TEXT("Initial convergence time:"), Ae->FirstConvergenceTime);
+      MosPrintf(MIL_TEXT("%30s %.3f s over %llu convergence(s)\n"), MIL_TEXT("Average convergence time:"),
+                Ae->ConvergenceTime/Ae->ConvergenceCount, (unsigned long long)Ae->ConvergenceCount);
+      }
+   }
@@ -0,0 +1,84 @@
+﻿/********************************************************************************/
+/*
+* File name: AutoExposure.h
+*
+* Synopsis:  Host-side exposure and gain control loop driven by the statistics
+*            of the grabbed frames.
+*
+*            AutoExposureUpdate() is called from the processing function with the
+*            statistics of every frame. When the mean intensity leaves the
+*            deadband around the target, it computes new ExposureTime and Gain
+*            values and hands them to a control thread that writes them to the
+*            camera, so the processing function never waits on the control
+*            channel. Only one write is in flight at a time; after it completes,
+*            the loop watches the following frames to find the first one that
+*            shows the new setting, and only then decides on the next change.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+#ifndef AUTO_EXPOSURE_H
+#define AUTO_EXPOSURE_H
+
+#include <mil.h>
+#include <atomic>
+#include "FrameStats.h"
+
+typedef struct
+   {
+   MIL_ID                   MilDigitizer;
+   MIL_ID                   MilThread;
+   MIL_ID                   MilEvent;
+   std::atomic<bool>        StopRequested;
+
+   /* Settings. */
+   MIL_DOUBLE               Target;          /* Mean intensity, fraction of full scale.  */
+   MIL_DOUBLE               Deadband;        /* Relative tolerance around the target.    */
+   MIL_DOUBLE               ExposureMin;
+   MIL_DOUBLE               ExposureMax;
+   MIL_DOUBLE               GainMin;
+   MIL_DOUBLE               GainMax;
+   bool                     GainAvailable;
+
+   /* Auto modes of the camera before the start, restored by the stop. */
+   MIL_STRING               PreviousExposureAuto;
+   MIL_STRING               PreviousGainAuto;
+
+   /* Camera settings currently applied; written by the control thread. */
+   MIL_DOUBLE               Exposure;
+   MIL_DOUBLE               Gain;
+
+   /* Write request handed to the control thread. */
+   std::atomic<MIL_INT>     State;
+   MIL_DOUBLE               RequestedExposure;
+   MIL_DOUBLE               RequestedGain;
+   MIL_DOUBLE               ExpectedRatio;
+   MIL_DOUBLE               MeanAtRequest;
+   MIL_UINT64               RequestFrame;
+   MIL_UINT64               CompletionFrame;
+   std::atomic<MIL_UINT64>  LastFrame;
+
+   /* Convergence tracking. */
+   bool                     Converged;
+   MIL_DOUBLE               StartTime;
+   MIL_DOUBLE               DisturbanceTime;
+   MIL_DOUBLE               LastFrameTime;
+   MIL_DOUBLE               FirstConvergenceTime;
+
+   /* Statistics. */
+   MIL_UINT64               ChangeCount;
+   MIL_UINT64               WriteCount;
+   MIL_DOUBLE               WriteTime;
+   MIL_UINT64               LatencyFrames;
+   MIL_UINT64               LatencyCount;
+   MIL_UINT64               ConvergenceCount;
+   MIL_DOUBLE               ConvergenceTime;
+   } AutoExposureStruct;
+
+bool AutoExposureStart(MIL_ID MilSystem, MIL_ID MilDigitizer, MIL_DOUBLE Target, MIL_DOUBLE Deadband,
+                       AutoExposureStruct* AutoExposure);
+void AutoExposureUpdate(AutoExposureStruct* AutoExposure, const FrameStatsStruct* Stats, MIL_UINT64 FrameNumber,
+                        MIL_DOUBLE FrameTime);
+void AutoExposureStop(AutoExposureStruct* AutoExposure);
+
+#endif
@@ -0,0 +1,244 @@
+﻿/********************************************************************************/
+/*
+* File name: ChangeDetect.cpp
+*
+* Synopsis:  Implementation of the change detection. See ChangeDetect.h.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. */
+#include "ChangeDetect.h"
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CHANGE_DETECT_USE_SSE2  1
+#include <emmintrin.h>
+#else
+#define CHANGE_DETECT_USE_SSE2  0
+#endif
+
+using namespace std;
+
+void ChangeDetectInit(MIL_INT GridSize, MIL_INT RowStep, MIL_DOUBLE Threshold, MIL_INT MaxSkip,
+                      ChangeDetectStruct* Detect)
+   {
+   Detect->GridSize = (GridSize > 0) ? GridSize : 1;
+   Detect->RowStep = (RowStep > 0) ? RowStep : 1;
+   Detect->Threshold = Threshold;
+   Detect->MaxSkip = MaxSkip;
+   Detect->SizeX = 0;
+   Detect->SizeY = 0;
+   Detect->SizeBit = 0;
+   Detect->HasReference = false;
+   Detect->SkippedInRow = 0;
+   Detect->LastDifference = 0.0;
+   Detect->FrameCount = 0;
+   Detect->SkippedCount = 0;
+   Detect->ForcedCount = 0;
+   Detect->ProcessedTimedCount = 0;
+   Detect->SignatureTime = 0.0;
+   Detect->ProcessTime = 0.0;
+   }
+
+/* Kernels.                                                                 */
+/* -----------------------------------------------------------------------*/
+
+static MIL_UINT64 RowSum8(const MIL_UINT8* Row, MIL_INT Count)
+   {
+   MIL_UINT64 Sum = 0;
+   MIL_INT x = 0;
+
+#if CHANGE_DETECT_USE_SSE2
+   const __m128i Zero = _mm_setzero_si128();
+   __m128i VSum = Zero;
+   for (; x + 16 <= Count; x += 16)
+      VSum = _mm_add_epi64(VSum, _mm_sad_epu8(_mm_loadu_si128((const __m128i*)(Row + x)), Zero));
+   Sum = (MIL_UINT64)_mm_cvtsi128_si32(VSum) + (MIL_UINT64)_mm_cvtsi128_si32(_mm_srli_si128(VSum, 8));
+#endif
+   for (; x < Count; x++)
+      Sum += Row[x];
+   return Sum;
+   }
+
+static MIL_UINT64 RowSum16(const MIL_UINT16* Row, MIL_INT Count)
+   {
+   MIL_UINT64 Sum = 0;
+   MIL_INT x = 0;
+
+#if CHANGE_DETECT_USE_SSE2
+   /* 32-bit lanes hold at least 65536 pixels of 16 bits before overflowing. */
+   const __m128i Zero = _mm_setzero_si128();
+   MIL_UINT32 Lanes[4];
+   while (x + 8 <= Count)
+      {
+      __m128i VSum = Zero;
+      MIL_INT End = (Count - x > 65536) ? x + 65536 : Count;
+      for (; x + 8 <= End; x += 8)
+         {
+         __m128i Pixels = _mm_loadu_si128((const __m128i*)(Row + x));
+         VSum = _mm_add_epi32(VSum, _mm_unpacklo_epi16(Pixels, Zero));
+         VSum = _mm_add_epi32(VSum, _mm_unpackhi_epi16(Pixels, Zero));
+         }
+      _mm_storeu_si128((__m128i*)Lanes, VSum);
+      Sum += (MIL_UINT64)Lanes[0] + Lanes[1] + Lanes[2] + Lanes[3];
+      }
+#endif
+   for (; x < Count; x++)
+      Sum += Row[x];
+   return Sum;
+   }
+
+void ChangeDetectSignature8(const MIL_UINT8* Data, MIL_INT SizeX, MIL_INT SizeY, MIL_INT PitchByte,
+                            MIL_INT GridSize, MIL_INT RowStep, MIL_UINT64* Sums)
+   {
+   memset(Sums, 0, (size_t)(GridSize*GridSize)*sizeof(MIL_UINT64));
+   for (MIL_INT y = 0; y < SizeY; y += RowStep)
+      {
+      const MIL_UINT8* Row = Data + y*PitchByte;
+      MIL_UINT64* CellSums = Sums + (y*GridSize/SizeY)*GridSize;
+      for (MIL_INT Cell = 0; Cell < GridSize; Cell++)
+         {
+         MIL_INT X0 = Cell*SizeX/GridSize, X1 = (Cell + 1)*SizeX/GridSize;
+         CellSums[Cell] += RowSum8(Row + X0, X1 - X0);
+         }
+      }
+   }
+
+void ChangeDetectSignature16(const MIL_UINT16* Data, MIL_INT SizeX, MIL_INT SizeY, MIL_INT PitchByte,
+                             MIL_INT GridSize, MIL_INT RowStep, MIL_UINT64* Sums)
+   {
+   memset(Sums, 0, (size_t)(GridSize*GridSize)*sizeof(MIL_UINT64));
+   for (MIL_INT y = 0; y < SizeY; y += RowStep)
+      {
+      const MIL_UINT16* Row = (const MIL_UINT16*)((const MIL_UINT8*)Data + y*PitchByte);
+      MIL_UINT64* CellSums = Sums + (y*GridSize/SizeY)*GridSize;
+      for (MIL_INT Cell = 0; Cell < GridSize; Cell++)
+         {
+         MIL_INT X0 = Cell*SizeX/GridSize, X1 = (Cell + 1)*SizeX/GridSize;
+         CellSums[Cell] += RowSum16(Row + X0, X1 - X0);
+         }
+      }
+   }
+
+/* Detection.                                                               */
+/* -----------------------------------------------------------------------*/
+
+/* Number of sampled pixels of each cell, for the frame geometry. */
+static void ComputeCellPixels(ChangeDetectStruct* Detect)
+   {
+   MIL_INT GridSize = Detect->GridSize;
+
+   Detect->CellPixels.assign((size_t)(GridSize*GridSize), 0);
+   for (MIL_INT y = 0; y < Detect->SizeY; y += Detect->RowStep)
+      for (MIL_INT Cell = 0; Cell < GridSize; Cell++)
+         Detect->CellPixels[(size_t)((y*GridSize/Detect->SizeY)*GridSize + Cell)] +=
+            (Cell + 1)*Detect->SizeX/GridSize - Cell*Detect->SizeX/GridSize;
+   }
+
+/* Largest difference of the cell means, as a fraction of full scale. */
+static MIL_DOUBLE SignatureDifference(const ChangeDetectStruct* Detect)
+   {
+   MIL_DOUBLE Largest = 0.0;
+   MIL_DOUBLE FullScale = (MIL_DOUBLE)((1ULL << Detect->SizeBit) - 1);
+
+   for (size_t i = 0; i < Detect->Current.size(); i++)
+      {
+      MIL_DOUBLE Difference;
+      if (Detect->CellPixels[i] == 0)
+         continue;
+      Difference = ((MIL_DOUBLE)Detect->Current[i] - (MIL_DOUBLE)Detect->Reference[i])/Detect->CellPixels[i];
+      if (Difference < 0.0)
+         Difference = -Difference;
+      if (Difference > Largest)
+         Largest = Difference;
+      }
+   return Largest/FullScale;
+   }
+
+bool ChangeDetectFrame(ChangeDetectStruct* Detect, MIL_ID MilBuffer)
+   {
+   MIL_DOUBLE Start = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+   void* HostAddress = M_NULL;
+   MIL_INT SizeX = MbufInquire(MilBuffer, M_SIZE_X, M_NULL);
+   MIL_INT SizeY = MbufInquire(MilBuffer, M_SIZE_Y, M_NULL);
+   MIL_INT SizeBit = MbufInquire(MilBuffer, M_SIZE_BIT, M_NULL);
+   MIL_INT PitchByte = MbufInquire(MilBuffer, M_PITCH_BYTE, M_NULL);
+   bool Process;
+
+   MbufInquire(MilBuffer, M_HOST_ADDRESS, &HostAddress);
+   Detect->FrameCount++;
+   if (HostAddress == M_NULL || SizeX <= 0 || SizeY <= 0)
+      return true;
+
+   /* A new geometry starts over without reference. */
+   if (SizeX != Detect->SizeX || SizeY != Detect->SizeY || SizeBit != Detect->SizeBit)
+      {
+      Detect->SizeX = SizeX;
+      Detect->SizeY = SizeY;
+      Detect->SizeBit = SizeBit;
+      Detect->Current.assign((size_t)(Detect->GridSize*Detect->GridSize), 0);
+      Detect->Reference.assign(Detect->Current.size(), 0);
+      ComputeCellPixels(Detect);
+      Detect->HasReference = false;
+      }
+
+   if (SizeBit <= 8)
+      ChangeDetectSignature8((const MIL_UINT8*)HostAddress, SizeX, SizeY, PitchByte, Detect->GridSize,
+                             Detect->RowStep, &Detect->Current[0]);
+   else
+      ChangeDetectSignature16((const MIL_UINT16*)HostAddress, SizeX, SizeY, PitchByte, Detect->GridSize,
+                              Detect->RowStep, &Detect->Current[0]);
+
+   Detect->LastDifference = Detect->HasReference ? SignatureDifference(Detect) : 1.0;
+   Process = (Detect->LastDifference >= Detect->Threshold);
+   if (!Process && Detect->MaxSkip >= 0 && Detect->SkippedInRow >= Detect->MaxSkip)
+      {
+      Process = true;
+      Detect->ForcedCount++;
+      }
+
+   if (Process)
+      {
+      Detect->Reference.swap(Detect->Current);
+      Detect->HasReference = true;
+      Detect->SkippedInRow = 0;
+      }
+   else
+      {
+      Detect->SkippedInRow++;
+      Detect->SkippedCount++;
+      }
+   Detect->SignatureTime += MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) - Start;
+   return Process;
+   }
+
+void ChangeDetectProcessed(ChangeDetectStruct* Detect, MIL_DOUBLE ProcessTime)
+   {
+   Detect->ProcessTime += ProcessTime;
+   Detect->ProcessedTimedCount++;
+   }
+
+/* Prints the skip ratio and the processing time saved, estimated from the */
+/* mean time of the processed frames.                                      */
+void ChangeDetectPrintStatistics(ChangeDetectStruct* Detect)
+   {
+   MIL_DOUBLE ProcessMean, Saved;
+
+   MosPrintf(MIL_TEXT("\n--------------------- Change detection ---------------------\n\n"));
+   MosPrintf(MIL_TEXT("%30s %llu of %llu (%.1f%%), %llu processed after %lld skips\n"), MIL_TEXT("Frames skipped:"),
+             (unsigned long long)Detect->SkippedCount, (unsigned long long)Detect->FrameCount,
+             Detect->FrameCount ? 100.0*Detect->SkippedCount/Detect->FrameCount : 0.0,
+             (unsigned long long)Detect->ForcedCount, (long long)Detect->MaxSkip);
+   if (Detect->FrameCount == 0 || Detect->ProcessedTimedCount == 0)
+      return;
+
+   ProcessMean = Detect->ProcessTime/Detect->ProcessedTimedCount;
+   Saved = Detect->SkippedCount*ProcessMean - Detect->SignatureTime;
+   MosPrintf(MIL_TEXT("%30s %.1f us per frame\n"), MIL_TEXT("Signature cost:"),
+             1e6*Detect->SignatureTime/Detect->FrameCount);
+   MosPrintf(MIL_TEXT("%30s %.2f ms per frame\n"), MIL_TEXT("Processing cost:"), 1e3*ProcessMean);
+   MosPrintf(MIL_TEXT("%30s %.1f ms (%.1f%% of the processing time)\n"), MIL_TEXT("CPU time saved:"),
+             1e3*Saved, 100.0*Saved/(Detect->FrameCount*ProcessMean));
+   }
@@ -0,0 +1,75 @@
+﻿/********************************************************************************/
+/*
+* File name: ChangeDetect.h
+*
+* Synopsis:  Change detection ahead of the frame processing, to skip frames
+*            of a still scene.
+*
+*            The signature of a frame is the mean intensity of each cell of a
+*            grid, computed on one row out of RowStep. A frame is processed
+*            when the mean of at least one cell differs from the signature of
+*            the last processed frame by Threshold (fraction of full scale) or
+*            more, or when MaxSkip frames in a row have been skipped; it then
+*            becomes the reference. The per-cell means keep sensor noise well
+*            below the threshold while a part entering a single cell is seen.
+*
+*            On x86-64 the row sums use SSE2 (sums of absolute differences to
+*            zero for 8-bit pixels), so a signature costs a small fraction of
+*            a read of the frame.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+#ifndef CHANGE_DETECT_H
+#define CHANGE_DETECT_H
+
+#include <mil.h>
+#include <vector>
+
+typedef struct
+   {
+   /* Settings. */
+   MIL_INT                  GridSize;
+   MIL_INT                  RowStep;
+   MIL_DOUBLE               Threshold;
+   MIL_INT                  MaxSkip;
+
+   /* Signatures: sum of the sampled pixels of each cell. */
+   MIL_INT                  SizeX;
+   MIL_INT                  SizeY;
+   MIL_INT                  SizeBit;
+   std::vector<MIL_UINT64>  Reference;
+   std::vector<MIL_UINT64>  Current;
+   std::vector<MIL_UINT64>  CellPixels;
+   bool                     HasReference;
+   MIL_INT                  SkippedInRow;
+   MIL_DOUBLE               LastDifference;
+
+   /* Statistics. */
+   MIL_UINT64               FrameCount;
+   MIL_UINT64               SkippedCount;
+   MIL_UINT64               ForcedCount;   /* Processed after MaxSkip skips. */
+   MIL_UINT64               ProcessedTimedCount;
+   MIL_DOUBLE               SignatureTime;
+   MIL_DOUBLE               ProcessTime;
+   } ChangeDetectStruct;
+
+void ChangeDetectInit(MIL_INT GridSize, MIL_INT RowStep, MIL_DOUBLE Threshold, MIL_INT MaxSkip,
+                      ChangeDetectStruct* Detect);
+
+/* Kernels on raw pixel data; Sums receives GridSize*GridSize cell sums. */
+void ChangeDetectSignature8(const MIL_UINT8* Data, MIL_INT SizeX, MIL_INT SizeY, MIL_INT PitchByte,
+                            MIL_INT GridSize, MIL_INT RowStep, MIL_UINT64* Sums);
+void ChangeDetectSignature16(const MIL_UINT16* Data, MIL_INT SizeX, MIL_INT SizeY, MIL_INT PitchByte,
+                             MIL_INT GridSize, MIL_INT RowStep, MIL_UINT64* Sums);
+
+/* Returns true if the frame must be processed. Frames of buffers that are */
+/* not accessible from the host are always processed.                      */
+bool ChangeDetectFrame(ChangeDetectStruct* Detect, MIL_ID MilBuffer);
+
+/* Time spent processing a frame let through, to estimate the time saved. */
+void ChangeDetectProcessed(ChangeDetectStruct* Detect, MIL_DOUBLE ProcessTime);
+
+void ChangeDetectPrintStatistics(ChangeDetectStruct* Detect);
+
+#endif
@@ -0,0 +1,266 @@
+﻿/********************************************************************************/
+/*
+* File name: CompressedStream.cpp
+*
+* Synopsis:  Implementation of the compressed payload acquisition.
+*            See CompressedStream.h.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. */
+#include "CompressedStream.h"
+#include "FeatureAccess.h"
+#include "Placement.h"
+
+using namespace std;
+
+/* Decoder threads, shared by the streams. A job decodes one slot. */
+static WorkerPoolStruct Pool;
+
+/* Camera set-up.                                                           */
+/* -----------------------------------------------------------------------*/
+
+bool CompressedStreamEnable(MIL_ID MilDigitizer)
+   {
+   MIL_INT Count = 0;
+   bool HasJpeg = false;
+
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_ENUM_ENTRY_COUNT, MIL_TEXT("ImageCompressionMode"), M_TYPE_MIL_INT, &Count);
+   if (!FeatureAccessSucceeded() || Count == 0)
+      return false;
+
+   for (MIL_INT i = 0; i < Count; i++)
+      {
+      MIL_STRING Mode;
+      FeatureAccessInquire(MilDigitizer, M_FEATURE_ENUM_ENTRY_NAME+i, MIL_TEXT("ImageCompressionMode"), M_TYPE_STRING, Mode);
+      if (Mode == MIL_TEXT("JPEG"))
+         HasJpeg = true;
+      else if (Mode != MIL_TEXT("Off"))
+         MosPrintf(MIL_TEXT("%s payloads cannot be decoded and are not used.\n"), Mode.c_str());
+      }
+   if (!HasJpeg)
+      return false;
+
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("ImageCompressionMode"), M_TYPE_STRING, MIL_TEXT("JPEG"));
+   return FeatureAccessSucceeded();
+   }
+
+void CompressedStreamDisable(MIL_ID MilDigitizer)
+   {
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("ImageCompressionMode"), M_TYPE_STRING, MIL_TEXT("Off"));
+   }
+
+/* Decoding and delivery.                                                   */
+/* -----------------------------------------------------------------------*/
+
+/* Updates the statistics with a frame about to be delivered. */
+static void CountFrame(CompressedStreamStruct* Stream, CompressedStreamSlotStruct* Slot)
+   {
+   MIL_DOUBLE Now = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+
+   if (Slot->Failed)
+      {
+      Stream->ErrorCount++;
+      return;
+      }
+
+   WorkerLatencyAdd(&Stream->Latency, Now - Slot->QueueTime);
+   Stream->PayloadBytes += (MIL_UINT64)Slot->PayloadByte;
+   Stream->DecodedBytes += (MIL_UINT64)Stream->FrameSizeByte;
+   Stream->DecodeTime += Slot->DecodeTime;
+   Stream->LastDeliverTime = Now;
+   }
+
+/* Whether the frame next in queue order is decoded. */
+static bool NextFrameDecoded(CompressedStreamStruct* Stream)
+   {
+   MIL_UINT64 Next;
+
+   return WorkerQueueFront(&Stream->Queue, &Next) && Stream->Slots[Next % Stream->SlotCount].Decoded.load();
+   }
+
+/* Delivers the decoded frames that are next in queue order. One decoder at */
+/* a time delivers; the others go back to decoding, leaving their frame to  */
+/* it. It checks again after letting go of the lock, for a frame decoded    */
+/* while it was letting go.                                                 */
+static void DeliverDecodedFrames(CompressedStreamStruct* Stream)
+   {
+   MIL_UINT64 Next;
+
+   do
+      {
+      unique_lock<mutex> DeliverGuard(Stream->DeliverLock, try_to_lock);
+      if (!DeliverGuard.owns_lock())
+         return;
+
+      while (WorkerQueueFront(&Stream->Queue, &Next))
+         {
+         CompressedStreamSlotStruct* Slot = &Stream->Slots[Next % Stream->SlotCount];
+         if (!Slot->Decoded.load())
+            break;
+         CountFrame(Stream, Slot);
+         if (!Slot->Failed)
+            Stream->DeliverFunction(Slot->MilDecoded, Slot->FrameNumber, Stream->DeliverDataPtr);
+         Slot->Decoded.store(false);
+         WorkerQueuePop(&Stream->Queue);
+         }
+      }
+   while (NextFrameDecoded(Stream));
+   }
+
+static void DecodeSlot(void* DataPtr, MIL_INT SlotIndex)
+   {
+   CompressedStreamStruct* Stream = (CompressedStreamStruct*)DataPtr;
+   CompressedStreamSlotStruct* Slot = &Stream->Slots[SlotIndex];
+
+   /* Follow the placement of the acquisition, if any. */
+   PlacementWorkerThread();
+
+   /* Decompress into the image buffer of the slot. */
+   MIL_DOUBLE Start = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+   MbufCopy(Slot->MilCompressed, Slot->MilDecoded);
+   Slot->Failed = (MappGetError(M_DEFAULT, M_CURRENT, M_NULL) != M_NULL_ERROR);
+   Slot->DecodeTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) - Start;
+   Slot->Decoded.store(true);
+
+   DeliverDecodedFrames(Stream);
+   }
+
+bool CompressedStreamStart(MIL_ID MilSystem, MIL_INT ThreadCount)
+   {
+   return WorkerPoolStart(&Pool, MilSystem, ThreadCount);
+   }
+
+/* Decodes the frames still queued, then ends the threads. */
+void CompressedStreamStop()
+   {
+   WorkerPoolStop(&Pool);
+   }
+
+/* Stream.                                                                  */
+/* -----------------------------------------------------------------------*/
+
+bool CompressedStreamOpen(MIL_ID MilSystem, MIL_ID MilGrabBuffer, MIL_INT SlotCount,
+                          CompressedStreamDeliverFunction DeliverFunction, void* DeliverDataPtr,
+                          CompressedStreamStruct* Stream)
+   {
+   MIL_INT SizeBand = MbufInquire(MilGrabBuffer, M_SIZE_BAND, M_NULL);
+   MIL_INT SizeX = MbufInquire(MilGrabBuffer, M_SIZE_X, M_NULL);
+   MIL_INT SizeY = MbufInquire(MilGrabBuffer, M_SIZE_Y, M_NULL);
+
+   Stream->Slots = NULL;
+   Stream->SlotCount = 0;
+   WorkerQueueInit(&Stream->Queue, 0);
+   if (SlotCount <= 0 || DeliverFunction == NULL)
+      return false;
+
+   Stream->Slots = new CompressedStreamSlotStruct[SlotCount];
+   for (MIL_INT i = 0; i < SlotCount; i++)
+      {
+      CompressedStreamSlotStruct* Slot = &Stream->Slots[i];
+      Slot->MilDecoded = M_NULL;
+      MbufAllocColor(MilSystem, SizeBand, SizeX, SizeY, 8+M_UNSIGNED, M_IMAGE+M_PROC+COMPRESSED_STREAM_ATTRIBUTE,
+                     &Slot->MilCompressed);
+      if (Slot->MilCompressed != M_NULL)
+         MbufAllocColor(MilSystem, SizeBand, SizeX, SizeY, 8+M_UNSIGNED, M_IMAGE+M_PROC, &Slot->MilDecoded);
+      Slot->Decoded.store(false);
+      Slot->Failed = false;
+      if (Slot->MilDecoded == M_NULL)
+         {
+         if (Slot->MilCompressed != M_NULL)
+            MbufFree(Slot->MilCompressed);
+         Stream->SlotCount = i;
+         CompressedStreamClose(Stream);
+         return false;
+         }
+      }
+
+   Stream->SlotCount = SlotCount;
+   WorkerQueueInit(&Stream->Queue, SlotCount);
+   Stream->FrameSizeByte = (MIL_INT64)SizeBand*SizeX*SizeY;
+   Stream->DeliverFunction = DeliverFunction;
+   Stream->DeliverDataPtr = DeliverDataPtr;
+   Stream->ErrorCount = 0;
+   Stream->PayloadBytes = 0;
+   Stream->DecodedBytes = 0;
+   Stream->DecodeTime = 0.0;
+   Stream->FirstQueueTime = 0.0;
+   Stream->LastDeliverTime = 0.0;
+   WorkerLatencyInit(&Stream->Latency);
+   return true;
+   }
+
+/* Copies the compressed frame into a free slot and queues it. Returns false */
+/* if the frame was dropped.                                                 */
+bool CompressedStreamFrame(CompressedStreamStruct* Stream, MIL_ID MilGrabBuffer, MIL_UINT64 FrameNumber)
+   {
+   CompressedStreamSlotStruct* Slot;
+   MIL_UINT64 Index;
+
+   if (Stream->SlotCount == 0 || Pool.MilThreads.empty() || !WorkerQueueReserve(&Stream->Queue, &Index))
+      return false;
+
+   /* Copying between compressed buffers copies the payload as is. */
+   Slot = &Stream->Slots[Index % Stream->SlotCount];
+   MbufCopy(MilGrabBuffer, Slot->MilCompressed);
+   Slot->PayloadByte = MbufInquire(Slot->MilCompressed, M_COMPRESSED_DATA_SIZE_BYTE, M_NULL);
+   Slot->FrameNumber = FrameNumber;
+   Slot->QueueTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+   if (Index == 0)
+      Stream->FirstQueueTime = Slot->QueueTime;
+
+   WorkerQueuePush(&Stream->Queue);
+   WorkerPoolPost(&Pool, &DecodeSlot, Stream, (MIL_INT)(Index % Stream->SlotCount), 1);
+   return true;
+   }
+
+/* Prints the compression ratio, the decoding throughput and the added */
+/* latency. Call after CompressedStreamClose().                         */
+void CompressedStreamPrintStatistics(CompressedStreamStruct* Stream)
+   {
+   MIL_UINT64 Frames = Stream->Queue.DoneCount - Stream->ErrorCount;
+   MIL_DOUBLE Duration = Stream->LastDeliverTime - Stream->FirstQueueTime;
+
+   MosPrintf(MIL_TEXT("\n--------------------- Compressed stream (JPEG) ---------------------\n\n"));
+   MosPrintf(MIL_TEXT("%30s %llu (%llu dropped, %llu not decoded)\n"), MIL_TEXT("Frames decoded:"),
+             (unsigned long long)Frames, (unsigned long long)Stream->Queue.DroppedCount,
+             (unsigned long long)Stream->ErrorCount);
+   if (Frames == 0 || Stream->PayloadBytes == 0)
+      return;
+
+   MosPrintf(MIL_TEXT("%30s %.1f kB (%.2f:1, %.0f%% of the link bandwidth saved)\n"), MIL_TEXT("Average payload:"),
+             Stream->PayloadBytes/1e3/Frames, (MIL_DOUBLE)Stream->DecodedBytes/(MIL_DOUBLE)Stream->PayloadBytes,
+             100.0*(1.0 - (MIL_DOUBLE)Stream->PayloadBytes/(MIL_DOUBLE)Stream->DecodedBytes));
+   if (Duration > 0.0)
+      MosPrintf(MIL_TEXT("%30s %.1f MB/s (%.1f frames/s)\n"), MIL_TEXT("Throughput:"),
+                Stream->DecodedBytes/1e6/Duration, Frames/Duration);
+   if (Stream->DecodeTime > 0.0)
+      MosPrintf(MIL_TEXT("%30s %.1f MB/s per thread (%.2f ms per frame), %lld threads\n"), MIL_TEXT("Decoding speed:"),
+                Stream->DecodedBytes/1e6/Stream->DecodeTime, 1e3*Stream->DecodeTime/Frames,
+                (long long)Pool.MilThreads.size());
+   WorkerLatencyPrint(&Stream->Latency);
+   }
+
+/* Waits for the queued frames to be delivered and frees the slots. */
+void CompressedStreamClose(CompressedStreamStruct* Stream)
+   {
+   if (Stream->Slots == NULL)
+      return;
+
+   while (!WorkerQueueEmpty(&Stream->Queue) && !Pool.MilThreads.empty())
+      MosSleep(1);
+
+   /* The thread that delivered the last frame may still hold the stream. */
+   WorkerPoolCancel(&Pool, Stream);
+
+   for (MIL_INT i = 0; i < Stream->SlotCount; i++)
+      {
+      MbufFree(Stream->Slots[i].MilDecoded);
+      MbufFree(Stream->Slots[i].MilCompressed);
+      }
+   delete [] Stream->Slots;
+   Stream->Slots = NULL;
+   Stream->SlotCount = 0;
+   }
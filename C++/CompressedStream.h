@@ -0,0 +1,95 @@
+﻿/********************************************************************************/
+/*
+* File name: CompressedStream.h
+*
+* Synopsis:  Acquisition of compressed payloads (GigE Vision 2.x JPEG), decoded
+*            on a pool of MIL threads shared by all the cameras and delivered
+*            in order to the processing.
+*
+*            The camera is switched to JPEG with the SFNC ImageCompressionMode
+*            feature and grabs into MIL compressed buffers (M_COMPRESS +
+*            M_JPEG_LOSSY), which hold payloads of any size up to the frame
+*            size. The processing function only copies the compressed data of
+*            the grab buffer into a free slot and queues it; it never waits
+*            for the decoder. A decoder thread decompresses the slot into its
+*            own image buffer with MbufCopy(). Decoded frames are passed to
+*            the delivery function one at a time and in the order in which
+*            they were queued, by one decoder thread at a time; the other
+*            decoders keep decoding meanwhile. When all the slots are in use, the frame is dropped and counted;
+*            frames that cannot be decoded are counted and skipped.
+*
+*            Other ImageCompressionMode values (JPEG2000, H264, JPEG XS) have
+*            no MIL decoder and are reported as not supported.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+#ifndef COMPRESSED_STREAM_H
+#define COMPRESSED_STREAM_H
+
+#include <mil.h>
+#include <atomic>
+#include <mutex>
+#include "WorkerPool.h"
+
+/* Buffer attribute of the compressed grab and queue buffers. */
+#define COMPRESSED_STREAM_ATTRIBUTE     (M_COMPRESS+M_JPEG_LOSSY)
+
+/* Called with each decoded frame, in queue order. The buffer is reused once */
+/* the function returns.                                                     */
+typedef void (*CompressedStreamDeliverFunction)(MIL_ID MilDecodedBuffer, MIL_UINT64 FrameNumber, void* UserDataPtr);
+
+/* Frame queued for decoding. */
+typedef struct
+   {
+   MIL_ID                   MilCompressed;
+   MIL_ID                   MilDecoded;
+   MIL_UINT64               FrameNumber;
+   MIL_DOUBLE               QueueTime;
+   MIL_DOUBLE               DecodeTime;
+   MIL_INT64                PayloadByte;
+   std::atomic<bool>        Decoded;
+   bool                     Failed;
+   } CompressedStreamSlotStruct;
+
+/* Stream of one camera. */
+typedef struct
+   {
+   CompressedStreamSlotStruct*      Slots;
+   MIL_INT                          SlotCount;
+   MIL_INT64                        FrameSizeByte;
+   CompressedStreamDeliverFunction  DeliverFunction;
+   void*                            DeliverDataPtr;
+
+   WorkerQueueStruct        Queue;        /* Frames queued and delivered.   */
+   std::mutex               DeliverLock;  /* Held by the delivering thread. */
+
+   /* Statistics, updated by the delivering thread. */
+   MIL_UINT64               ErrorCount;
+   MIL_UINT64               PayloadBytes;
+   MIL_UINT64               DecodedBytes;
+   MIL_DOUBLE               DecodeTime;
+   MIL_DOUBLE               FirstQueueTime;
+   MIL_DOUBLE               LastDeliverTime;
+   WorkerLatencyStruct      Latency;
+   } CompressedStreamStruct;
+
+/* Switches the camera to JPEG payloads, if it can. Call with the error */
+/* prints disabled.                                                     */
+bool CompressedStreamEnable(MIL_ID MilDigitizer);
+void CompressedStreamDisable(MIL_ID MilDigitizer);
+
+/* Decoder threads. ThreadCount 0 uses one thread per core but one. */
+bool CompressedStreamStart(MIL_ID MilSystem, MIL_INT ThreadCount);
+void CompressedStreamStop();
+
+/* Stream of the frames of the size of MilGrabBuffer, with SlotCount frames */
+/* queued at most.                                                          */
+bool CompressedStreamOpen(MIL_ID MilSystem, MIL_ID MilGrabBuffer, MIL_INT SlotCount,
+                          CompressedStreamDeliverFunction DeliverFunction, void* DeliverDataPtr,
+                          CompressedStreamStruct* Stream);
+bool CompressedStreamFrame(CompressedStreamStruct* Stream, MIL_ID MilGrabBuffer, MIL_UINT64 FrameNumber);
+void CompressedStreamPrintStatistics(CompressedStreamStruct* Stream);
+void CompressedStreamClose(CompressedStreamStruct* Stream);
+
+#endif
@@ -0,0 +1,272 @@
+﻿/********************************************************************************/
+/*
+* File name: FeatureAccess.cpp
+*
+* Synopsis:  Recording of the feature accesses made through the interposition
+*            layer. See FeatureAccess.h.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. */
+#include "FeatureAccess.h"
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
+
+using namespace std;
+
+/* Number of entries whose latency histogram is printed in the report. */
+#define HISTOGRAMS_PRINTED          5
+
+typedef struct
+   {
+   MIL_INT     Kind;
+   MIL_STRING  Feature;
+   MIL_STRING  Caller;
+   MIL_UINT64  Count;
+   MIL_UINT64  ErrorCount;
+   MIL_DOUBLE  TotalTime;      /* Microseconds. */
+   MIL_DOUBLE  MinTime;
+   MIL_DOUBLE  MaxTime;
+   MIL_UINT64  Histogram[FEATURE_ACCESS_HISTOGRAM_SIZE];
+   } FeatureAccessStatsStruct;
+
+typedef struct
+   {
+   atomic<bool>                              Active;
+   mutex                                     Lock;
+   map<MIL_STRING, FeatureAccessStatsStruct> Entries;
+   } FeatureAccessProfileStruct;
+
+static FeatureAccessProfileStruct Profile;
+
+/* Process-wide counters. */
+static atomic<bool>       Counting(false);
+static atomic<MIL_UINT64> AccessCount(0);
+static atomic<MIL_UINT64> ErrorCount(0);
+
+/* Transaction recorder. The lock is held while it is called, so removing */
+/* it waits for the calls in progress.                                    */
+static atomic<bool>                     TransactionRecording(false);
+static mutex                            TransactionLock;
+static FeatureAccessTransactionFunction TransactionFunction = M_NULL;
+static void*                            TransactionDataPtr = M_NULL;
+
+static const MIL_TEXT_CHAR* KindNames[] = {MIL_TEXT("Inquire"), MIL_TEXT("Control"), MIL_TEXT("MdigInquire")};
+
+static MIL_STRING ToMilString(const char* Text)
+   {
+   MIL_STRING Result;
+   for (const char* Ptr = Text; Ptr && *Ptr; Ptr++)
+      Result += (MIL_TEXT_CHAR)*Ptr;
+   return Result;
+   }
+
+static MIL_INT HistogramBin(MIL_DOUBLE Latency)
+   {
+   MIL_INT Bin = 0;
+   while (Latency >= 1.0 && Bin < FEATURE_ACCESS_HISTOGRAM_SIZE - 1)
+      {
+      Latency /= 2.0;
+      Bin++;
+      }
+   return Bin;
+   }
+
+/* Upper bound, in microseconds, of the bin that holds the given fraction of the accesses. */
+static MIL_DOUBLE HistogramPercentile(const FeatureAccessStatsStruct& Stats, MIL_DOUBLE Fraction)
+   {
+   MIL_UINT64 Rank = (MIL_UINT64)(Fraction*(MIL_DOUBLE)(Stats.Count - 1)) + 1;
+   MIL_UINT64 Sum = 0;
+   for (MIL_INT Bin = 0; Bin < FEATURE_ACCESS_HISTOGRAM_SIZE; Bin++)
+      {
+      Sum += Stats.Histogram[Bin];
+      if (Sum >= Rank)
+         return min((MIL_DOUBLE)(1ULL << Bin), Stats.MaxTime);
+      }
+   return Stats.MaxTime;
+   }
+
+static bool ByTotalTime(const FeatureAccessStatsStruct* A, const FeatureAccessStatsStruct* B)
+   {
+   return A->TotalTime > B->TotalTime;
+   }
+
+void FeatureAccessProfileStart()
+   {
+   lock_guard<mutex> Guard(Profile.Lock);
+   Profile.Entries.clear();
+   Profile.Active.store(true);
+   }
+
+void FeatureAccessCountStart()
+   {
+   Counting.store(true);
+   }
+
+void FeatureAccessGetCounts(MIL_UINT64* Accesses, MIL_UINT64* Errors)
+   {
+   *Accesses = AccessCount.load(memory_order_relaxed);
+   *Errors = ErrorCount.load(memory_order_relaxed);
+   }
+
+void FeatureAccessSetTransactionRecorder(FeatureAccessTransactionFunction Function, void* DataPtr)
+   {
+   lock_guard<mutex> Guard(TransactionLock);
+   TransactionFunction = Function;
+   TransactionDataPtr = DataPtr;
+   TransactionRecording.store(Function != M_NULL);
+   }
+
+bool FeatureAccessIsRecordingTransactions()
+   {
+   return TransactionRecording.load(memory_order_relaxed);
+   }
+
+/* Called when an access completes, on the thread that made it; makes no */
+/* MIL call, so the error state of the access is kept.                  */
+void FeatureAccessRecordTransaction(MIL_TEXT_CHAR Type, const MIL_TEXT_CHAR* FeatureName, const MIL_TEXT_CHAR* Value,
+                                    MIL_DOUBLE TimeStamp)
+   {
+   lock_guard<mutex> Guard(TransactionLock);
+   if (TransactionFunction)
+      TransactionFunction(TransactionDataPtr, Type, FeatureName, Value, TimeStamp);
+   }
+
+MIL_STRING FeatureAccessIntegerText(long long Value)
+   {
+   char Text[32];
+   snprintf(Text, sizeof(Text), "%lld", Value);
+   return ToMilString(Text);
+   }
+
+MIL_STRING FeatureAccessFloatText(double Value)
+   {
+   char Text[32];
+   snprintf(Text, sizeof(Text), "%.9g", Value);
+   return ToMilString(Text);
+   }
+
+bool FeatureAccessIsRecording()
+   {
+   return Profile.Active.load(memory_order_relaxed) || Counting.load(memory_order_relaxed) || StartupTraceIsActive();
+   }
+
+/* Called when an access completes, on the thread that made it. */
+void FeatureAccessRecord(MIL_INT Kind, const char* Caller, const MIL_TEXT_CHAR* FeatureName,
+                         const char* InquireTypeName, MIL_DOUBLE StartTime)
+   {
+   MIL_DOUBLE EndTime = StartupTraceTime();
+   MIL_STRING Feature = FeatureName ? MIL_STRING(FeatureName) : ToMilString(InquireTypeName);
+
+   if (StartupTraceIsActive())
+      StartupTraceSpan(Feature.c_str(), FEATURE_ACCESS_TRACE_CATEGORY, StartTime, EndTime, Caller);
+
+   if (!Profile.Active.load(memory_order_relaxed) && !Counting.load(memory_order_relaxed))
+      return;
+
+   /* The error, if any, was raised by the access just made on this thread. */
+   bool Failed = !FeatureAccessSucceeded();
+   AccessCount.fetch_add(1, memory_order_relaxed);
+   if (Failed)
+      ErrorCount.fetch_add(1, memory_order_relaxed);
+   if (!Profile.Active.load(memory_order_relaxed))
+      return;
+
+   MIL_DOUBLE Latency = EndTime - StartTime;
+   MIL_STRING CallerName = ToMilString(Caller);
+   MIL_STRING Key = KindNames[Kind] + MIL_STRING(MIL_TEXT("|")) + Feature + MIL_TEXT("|") + CallerName;
+
+   lock_guard<mutex> Guard(Profile.Lock);
+   map<MIL_STRING, FeatureAccessStatsStruct>::iterator It = Profile.Entries.find(Key);
+   if (It == Profile.Entries.end())
+      {
+      FeatureAccessStatsStruct Stats;
+      Stats.Kind = Kind;
+      Stats.Feature = Feature;
+      Stats.Caller = CallerName;
+      Stats.Count = Stats.ErrorCount = 0;
+      Stats.TotalTime = Stats.MaxTime = 0.0;
+      Stats.MinTime = Latency;
+      fill(Stats.Histogram, Stats.Histogram + FEATURE_ACCESS_HISTOGRAM_SIZE, 0);
+      It = Profile.Entries.insert(make_pair(Key, Stats)).first;
+      }
+
+   FeatureAccessStatsStruct& Stats = It->second;
+   Stats.Count++;
+   if (Failed)
+      Stats.ErrorCount++;
+   Stats.TotalTime += Latency;
+   Stats.MinTime = min(Stats.MinTime, Latency);
+   Stats.MaxTime = max(Stats.MaxTime, Latency);
+   Stats.Histogram[HistogramBin(Latency)]++;
+   }
+
+/* Stops the profiler and prints the accesses sorted by total time, followed */
+/* by the latency histograms of the most expensive ones.                     */
+void FeatureAccessProfileReport()
+   {
+   vector<const FeatureAccessStatsStruct*> Sorted;
+   set<MIL_STRING> Features;
+   MIL_UINT64 TotalCount = 0, TotalErrors = 0;
+   MIL_DOUBLE TotalTime = 0.0;
+
+   if (!Profile.Active.load())
+      return;
+   Profile.Active.store(false);
+
+   lock_guard<mutex> Guard(Profile.Lock);
+   for (map<MIL_STRING, FeatureAccessStatsStruct>::const_iterator It = Profile.Entries.begin();
+        It != Profile.Entries.end(); ++It)
+      {
+      Sorted.push_back(&It->second);
+      Features.insert(It->second.Feature);
+      TotalCount += It->second.Count;
+      TotalErrors += It->second.ErrorCount;
+      TotalTime += It->second.TotalTime;
+      }
+   sort(Sorted.begin(), Sorted.end(), ByTotalTime);
+
+   MosPrintf(MIL_TEXT("\n------------------- Feature access profile -------------------\n\n"));
+   MosPrintf(MIL_TEXT("%llu accesses to %llu features in %.1f ms, %llu failed.\n")
+             MIL_TEXT("Latencies in ms; p50 and p99 are histogram bin upper bounds.\n\n"),
+             (unsigned long long)TotalCount, (unsigned long long)Features.size(), TotalTime/1000.0,
+             (unsigned long long)TotalErrors);
+   MosPrintf(MIL_TEXT("%-34s %-11s %-34s %6s %5s %8s %7s %7s %7s %7s %8s\n"), MIL_TEXT("Feature"), MIL_TEXT("Access"),
+             MIL_TEXT("Caller"), MIL_TEXT("Calls"), MIL_TEXT("Err%"), MIL_TEXT("Total"), MIL_TEXT("Mean"),
+             MIL_TEXT("Min"), MIL_TEXT("p50"), MIL_TEXT("p99"), MIL_TEXT("Max"));
+   for (size_t i = 0; i < Sorted.size(); i++)
+      {
+      const FeatureAccessStatsStruct& Stats = *Sorted[i];
+      MosPrintf(MIL_TEXT("%-34.34s %-11s %-34.34s %6llu %5.1f %8.2f %7.3f %7.3f %7.3f %7.3f %8.3f\n"), Stats.Feature.c_str(),
+                KindNames[Stats.Kind], Stats.Caller.c_str(), (unsigned long long)Stats.Count,
+                100.0*Stats.ErrorCount/Stats.Count, Stats.TotalTime/1000.0, Stats.TotalTime/Stats.Count/1000.0,
+                Stats.MinTime/1000.0, HistogramPercentile(Stats, 0.5)/1000.0, HistogramPercentile(Stats, 0.99)/1000.0, Stats.MaxTime/1000.0);
+      }
+
+   for (size_t i = 0; i < Sorted.size() && i < HISTOGRAMS_PRINTED; i++)
+      {
+      const FeatureAccessStatsStruct& Stats = *Sorted[i];
+      MIL_UINT64 MaxBinCount = *max_element(Stats.Histogram, Stats.Histogram + FEATURE_ACCESS_HISTOGRAM_SIZE);
+
+      MosPrintf(MIL_TEXT("\n%s (%s, %s):\n"), Stats.Feature.c_str(), KindNames[Stats.Kind], Stats.Caller.c_str());
+      for (MIL_INT Bin = 0; Bin < FEATURE_ACCESS_HISTOGRAM_SIZE; Bin++)
+         {
+         if (Stats.Histogram[Bin] == 0)
+            continue;
+         MIL_INT BarLength = (MIL_INT)((40*Stats.Histogram[Bin] + MaxBinCount - 1)/MaxBinCount);
+         MosPrintf(MIL_TEXT("   %s %10.3f ms %6llu "), (Bin < FEATURE_ACCESS_HISTOGRAM_SIZE - 1) ? MIL_TEXT("< ") : MIL_TEXT(">="),
+                   (MIL_DOUBLE)(1ULL << (Bin < FEATURE_ACCESS_HISTOGRAM_SIZE - 1 ? Bin : Bin - 1))/1000.0,
+                   (unsigned long long)Stats.Histogram[Bin]);
+         for (MIL_INT j = 0; j < BarLength; j++)
+            MosPrintf(MIL_TEXT("#"));
+         MosPrintf(MIL_TEXT("\n"));
+         }
+      }
+   }
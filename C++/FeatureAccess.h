@@ -0,0 +1,250 @@
+﻿/********************************************************************************/
+/*
+* File name: FeatureAccess.h
+*
+* Synopsis:  Timed wrappers of the GenICam feature access functions.
+*
+*            FeatureAccessInquire(), FeatureAccessControl() and
+*            FeatureAccessMdigInquire() take the arguments of
+*            MdigInquireFeature(), MdigControlFeature() and MdigInquire(),
+*            call the MIL function with them unchanged and time the access.
+*            The accesses are recorded, with the feature name (or the inquire
+*            type) and the calling function:
+*
+*            - in the start-up trace while it is active (see StartupTrace.h);
+*            - in the feature access profiler while it is active, which keeps
+*              per feature and caller the call count, the error count and a
+*              latency histogram, and prints them sorted by total time;
+*            - in process-wide access and error counters while counting is on,
+*              for the metrics export (see Metrics.h);
+*            - as control transactions, to the transaction recorder while one
+*              is set, such as the stream capture (see StreamCapture.h): every
+*              read (M_FEATURE_VALUE inquire), write (M_FEATURE_VALUE control)
+*              and execute, with the value read or written as text. The
+*              recorder is called after the access, without any MIL call in
+*              between, so FeatureAccessSucceeded() still reports the access.
+*
+*            Each argument is evaluated once. Code that reads features on
+*            behalf of another function, such as the feature catalog, passes
+*            that function's name to the FeatureAccessXxxFrom() forms. When
+*            neither recorder is active, an access costs one extra test.
+*            Calls made directly to the MIL functions are not recorded.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+#ifndef FEATURE_ACCESS_H
+#define FEATURE_ACCESS_H
+
+#include <mil.h>
+#include <type_traits>
+#include <utility>
+#include "StartupTrace.h"
+
+/* Category of the feature access spans in the start-up trace. */
+#define FEATURE_ACCESS_TRACE_CATEGORY  "feature"
+
+/* Access kinds. */
+#define FEATURE_ACCESS_INQUIRE_FEATURE 0
+#define FEATURE_ACCESS_CONTROL_FEATURE 1
+#define FEATURE_ACCESS_INQUIRE         2
+
+/* Control transaction types. */
+#define FEATURE_ACCESS_READ            MIL_TEXT('R')
+#define FEATURE_ACCESS_WRITE           MIL_TEXT('W')
+#define FEATURE_ACCESS_EXECUTE         MIL_TEXT('X')
+
+/* Transaction recorder: called with the type, the feature name, the value */
+/* as text and the MappTimer() time at which the access started.          */
+typedef void (*FeatureAccessTransactionFunction)(void* DataPtr, MIL_TEXT_CHAR Type, const MIL_TEXT_CHAR* FeatureName,
+                                                 const MIL_TEXT_CHAR* Value, MIL_DOUBLE TimeStamp);
+
+/* Latency histogram: bin 0 counts accesses under 1 us, bin n those from */
+/* 2^(n-1) to 2^n us; the last bin also counts the longer ones.          */
+#define FEATURE_ACCESS_HISTOGRAM_SIZE  24
+
+/* True if the last MIL call of the thread, such as a feature access, */
+/* succeeded.                                                          */
+inline bool FeatureAccessSucceeded()
+   {
+   return (MappGetError(M_DEFAULT, M_CURRENT, M_NULL) == M_NULL_ERROR);
+   }
+
+/* Profiler. */
+void FeatureAccessProfileStart();
+void FeatureAccessProfileReport();
+
+/* Process-wide counters. */
+void FeatureAccessCountStart();
+void FeatureAccessGetCounts(MIL_UINT64* AccessCount, MIL_UINT64* ErrorCount);
+
+/* Transaction recorder; M_NULL removes it. Once removed, it is no longer */
+/* called by any thread.                                                  */
+void FeatureAccessSetTransactionRecorder(FeatureAccessTransactionFunction Function, void* DataPtr);
+
+/* Used by the wrappers. */
+bool FeatureAccessIsRecording();
+void FeatureAccessRecord(MIL_INT Kind, const char* Caller, const MIL_TEXT_CHAR* FeatureName,
+                         const char* InquireTypeName, MIL_DOUBLE StartTime);
+bool FeatureAccessIsRecordingTransactions();
+void FeatureAccessRecordTransaction(MIL_TEXT_CHAR Type, const MIL_TEXT_CHAR* FeatureName, const MIL_TEXT_CHAR* Value,
+                                    MIL_DOUBLE TimeStamp);
+MIL_STRING FeatureAccessIntegerText(long long Value);
+MIL_STRING FeatureAccessFloatText(double Value);
+
+/* Times one access, from its construction to the end of the full expression */
+/* that contains it.                                                         */
+class FeatureAccessScope
+   {
+   public:
+      FeatureAccessScope(MIL_INT AccessKind, const char* Caller, const MIL_TEXT_CHAR* FeatureName)
+         : Kind(AccessKind), CallerName(Caller), Feature(FeatureName), InquireType(M_NULL),
+           StartTime(FeatureAccessIsRecording() ? StartupTraceTime() : -1.0)
+         {
+         }
+      FeatureAccessScope(MIL_INT AccessKind, const char* Caller, const MIL_STRING& FeatureName)
+         : Kind(AccessKind), CallerName(Caller), Feature(FeatureName.c_str()), InquireType(M_NULL),
+           StartTime(FeatureAccessIsRecording() ? StartupTraceTime() : -1.0)
+         {
+         }
+      FeatureAccessScope(const char* Caller, const char* InquireTypeName)
+         : Kind(FEATURE_ACCESS_INQUIRE), CallerName(Caller), Feature(M_NULL), InquireType(InquireTypeName),
+           StartTime(FeatureAccessIsRecording() ? StartupTraceTime() : -1.0)
+         {
+         }
+      ~FeatureAccessScope()
+         {
+         if (StartTime >= 0.0)
+            FeatureAccessRecord(Kind, CallerName, Feature, InquireType, StartTime);
+         }
+
+   private:
+      MIL_INT                Kind;
+      const char*            CallerName;
+      const MIL_TEXT_CHAR*   Feature;
+      const char*            InquireType;
+      MIL_DOUBLE             StartTime;
+   };
+
+/* Value of a user variable as text, for the transaction recorder: a string, */
+/* or a pointer to a number; empty for M_NULL.                               */
+inline MIL_STRING FeatureAccessValueText(const MIL_STRING& Value)
+   {
+   return Value;
+   }
+
+inline MIL_STRING FeatureAccessValueText(const MIL_TEXT_CHAR* Value)
+   {
+   return Value ? MIL_STRING(Value) : MIL_STRING();
+   }
+
+inline MIL_STRING FeatureAccessValueText(int)
+   {
+   return MIL_STRING();
+   }
+
+inline MIL_STRING FeatureAccessValueText(const void*)
+   {
+   return MIL_STRING();
+   }
+
+template <typename ValueT>
+inline MIL_STRING FeatureAccessValueText(const ValueT* Value)
+   {
+   if (Value == M_NULL)
+      return MIL_STRING();
+   return std::is_floating_point<ValueT>::value ? FeatureAccessFloatText((double)*Value) :
+                                                   FeatureAccessIntegerText((long long)*Value);
+   }
+
+inline const MIL_TEXT_CHAR* FeatureAccessNameText(const MIL_TEXT_CHAR* FeatureName)
+   {
+   return FeatureName;
+   }
+
+inline const MIL_TEXT_CHAR* FeatureAccessNameText(const MIL_STRING& FeatureName)
+   {
+   return FeatureName.c_str();
+   }
+
+/* Records one control transaction with the value of UserVar at the end of */
+/* the full expression that contains it, if Type is not 0 and a recorder   */
+/* is set.                                                                 */
+template <typename UserVarT>
+class FeatureAccessTransaction
+   {
+   public:
+      FeatureAccessTransaction(MIL_TEXT_CHAR TransactionType, const MIL_TEXT_CHAR* FeatureName, const UserVarT& Var)
+         : Type((TransactionType && FeatureAccessIsRecordingTransactions()) ? TransactionType : 0),
+           Feature(FeatureName), UserVar(Var),
+           TimeStamp(Type ? MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) : 0.0)
+         {
+         }
+      ~FeatureAccessTransaction()
+         {
+         if (Type)
+            FeatureAccessRecordTransaction(Type, Feature, FeatureAccessValueText(UserVar).c_str(), TimeStamp);
+         }
+
+   private:
+      MIL_TEXT_CHAR          Type;
+      const MIL_TEXT_CHAR*   Feature;
+      const UserVarT&        UserVar;
+      MIL_DOUBLE             TimeStamp;
+   };
+
+/* User variable of a wrapper, passed on as is; M_NULL, an int once forwarded, */
+/* passed on as a null pointer.                                                */
+template <typename UserVarT>
+inline UserVarT&& FeatureAccessUserVar(UserVarT&& UserVar)
+   {
+   return std::forward<UserVarT>(UserVar);
+   }
+
+inline void* FeatureAccessUserVar(int)
+   {
+   return M_NULL;
+   }
+
+/* Wrappers, with the name of the function the access is recorded under. */
+template <typename NameT, typename UserVarT>
+inline auto FeatureAccessInquireFrom(const char* Caller, MIL_ID MilDigitizer, MIL_INT64 InquireType,
+                                     const NameT& FeatureName, MIL_INT64 UserVarType, UserVarT&& UserVar)
+   -> decltype(MdigInquireFeature(MilDigitizer, InquireType, FeatureName, UserVarType, FeatureAccessUserVar(std::forward<UserVarT>(UserVar))))
+   {
+   FeatureAccessScope Scope(FEATURE_ACCESS_INQUIRE_FEATURE, Caller, FeatureName);
+   FeatureAccessTransaction<typename std::remove_reference<UserVarT>::type>
+      Transaction((InquireType == M_FEATURE_VALUE) ? FEATURE_ACCESS_READ : 0, FeatureAccessNameText(FeatureName), UserVar);
+   return MdigInquireFeature(MilDigitizer, InquireType, FeatureName, UserVarType, FeatureAccessUserVar(std::forward<UserVarT>(UserVar)));
+   }
+
+template <typename NameT, typename UserVarT>
+inline auto FeatureAccessControlFrom(const char* Caller, MIL_ID MilDigitizer, MIL_INT64 ControlType,
+                                     const NameT& FeatureName, MIL_INT64 UserVarType, UserVarT&& UserVar)
+   -> decltype(MdigControlFeature(MilDigitizer, ControlType, FeatureName, UserVarType, FeatureAccessUserVar(std::forward<UserVarT>(UserVar))))
+   {
+   FeatureAccessScope Scope(FEATURE_ACCESS_CONTROL_FEATURE, Caller, FeatureName);
+   FeatureAccessTransaction<typename std::remove_reference<UserVarT>::type>
+      Transaction((ControlType == M_FEATURE_VALUE) ? FEATURE_ACCESS_WRITE :
+                  ((ControlType == M_FEATURE_EXECUTE) ? FEATURE_ACCESS_EXECUTE : 0), FeatureAccessNameText(FeatureName), UserVar);
+   return MdigControlFeature(MilDigitizer, ControlType, FeatureName, UserVarType, FeatureAccessUserVar(std::forward<UserVarT>(UserVar)));
+   }
+
+template <typename UserVarT>
+inline auto FeatureAccessMdigInquireFrom(const char* Caller, const char* InquireTypeName, MIL_ID MilDigitizer,
+                                         MIL_INT64 InquireType, UserVarT&& UserVar)
+   -> decltype(MdigInquire(MilDigitizer, InquireType, FeatureAccessUserVar(std::forward<UserVarT>(UserVar))))
+   {
+   FeatureAccessScope Scope(Caller, InquireTypeName);
+   return MdigInquire(MilDigitizer, InquireType, FeatureAccessUserVar(std::forward<UserVarT>(UserVar)));
+   }
+
+/* Wrappers recording the access under the calling function. */
+#define FeatureAccessInquire(MilDigitizer, InquireType, FeatureName, UserVarType, UserVar)                \
+   FeatureAccessInquireFrom(__FUNCTION__, MilDigitizer, InquireType, FeatureName, UserVarType, UserVar)
+#define FeatureAccessControl(MilDigitizer, ControlType, FeatureName, UserVarType, UserVar)                \
+   FeatureAccessControlFrom(__FUNCTION__, MilDigitizer, ControlType, FeatureName, UserVarType, UserVar)
+#define FeatureAccessMdigInquire(MilDigitizer, InquireType, UserVar)                                       \
+   FeatureAccessMdigInquireFrom(__FUNCTION__, #InquireType, MilDigitizer, InquireType, UserVar)
+
+#endif
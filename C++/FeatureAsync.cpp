@@ -0,0 +1,213 @@
+﻿/********************************************************************************/
+/*
+* File name: FeatureAsync.cpp
+*
+* Synopsis:  Implementation of the asynchronous feature access.
+*            See FeatureAsync.h.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. */
+#include "FeatureAsync.h"
+#include <deque>
+#include <map>
+#include <mutex>
+#include "FeatureAccess.h"
+#include "WorkerPool.h"
+
+using namespace std;
+
+/* Operations posted for one digitizer. A strand with operations has one */
+/* job posted to the I/O threads, which runs its first operation and then */
+/* posts the strand again if it has more, so that only one thread runs    */
+/* the strand at a time.                                                  */
+typedef struct
+   {
+   deque< function<void()> > Work;
+   } StrandStruct;
+
+/* I/O threads, and the strands with operations. */
+static WorkerPoolStruct Pool;
+static mutex StrandLock;
+static map<MIL_ID, StrandStruct> Strands;
+
+/* Error printing is a setting of the thread, so it is disabled by the  */
+/* access itself, in whichever thread runs it, and then put back as it  */
+/* was: without I/O threads, that thread is the caller's.               */
+static MIL_INT BeginAccess()
+   {
+   MIL_INT PrintState = MappInquire(M_DEFAULT, M_ERROR, M_NULL);
+
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+   return PrintState;
+   }
+
+static bool EndAccess(MIL_INT PrintState)
+   {
+   bool Ok = FeatureAccessSucceeded();
+
+   MappControl(M_DEFAULT, M_ERROR, PrintState);
+   return Ok;
+   }
+
+/* Runs the first operation of the strand, and posts the strand again, at */
+/* the end of the pool's queue, if it has more.                           */
+static void RunStrand(void* DataPtr, MIL_INT MilDigitizer)
+   {
+   function<void()> Work;
+
+   unique_lock<mutex> Guard(StrandLock);
+   Work.swap(Strands[MilDigitizer].Work.front());
+   Guard.unlock();
+
+   Work();
+
+   Guard.lock();
+   StrandStruct& Strand = Strands[MilDigitizer];
+   Strand.Work.pop_front();
+   if (Strand.Work.empty())
+      Strands.erase(MilDigitizer);
+   else
+      WorkerPoolPost(&Pool, &RunStrand, NULL, MilDigitizer, 1);
+   }
+
+bool FeatureAsyncStart(MIL_ID MilSystem, MIL_INT ThreadCount)
+   {
+   if (ThreadCount <= 0)
+      ThreadCount = FEATURE_ASYNC_DEFAULT_THREADS;
+   return WorkerPoolStart(&Pool, MilSystem, ThreadCount);
+   }
+
+/* Runs the operations still posted, then ends the threads. */
+void FeatureAsyncStop()
+   {
+   WorkerPoolStop(&Pool);
+   }
+
+void FeatureAsyncPostWork(MIL_ID MilDigitizer, const function<void()>& Work)
+   {
+   if (Pool.MilThreads.empty())
+      {
+      Work();
+      return;
+      }
+
+   lock_guard<mutex> Guard(StrandLock);
+   StrandStruct& Strand = Strands[MilDigitizer];
+   Strand.Work.push_back(Work);
+   if (Strand.Work.size() == 1)
+      WorkerPoolPost(&Pool, &RunStrand, NULL, MilDigitizer, 1);
+   }
+
+/* Accesses, run on the strand of the digitizer.                            */
+/* -----------------------------------------------------------------------*/
+
+static bool ControlString(MIL_ID MilDigitizer, const MIL_STRING& FeatureName, const MIL_STRING& Value)
+   {
+   MIL_INT PrintState = BeginAccess();
+
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, FeatureName, M_TYPE_STRING, Value.c_str());
+   return EndAccess(PrintState);
+   }
+
+static bool ControlInt64(MIL_ID MilDigitizer, const MIL_STRING& FeatureName, MIL_INT64 Value)
+   {
+   MIL_INT PrintState = BeginAccess();
+
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, FeatureName, M_TYPE_INT64, &Value);
+   return EndAccess(PrintState);
+   }
+
+static bool ControlDouble(MIL_ID MilDigitizer, const MIL_STRING& FeatureName, MIL_DOUBLE Value)
+   {
+   MIL_INT PrintState = BeginAccess();
+
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, FeatureName, M_TYPE_MIL_DOUBLE, &Value);
+   return EndAccess(PrintState);
+   }
+
+static bool ControlExecute(MIL_ID MilDigitizer, const MIL_STRING& FeatureName)
+   {
+   MIL_INT PrintState = BeginAccess();
+
+   FeatureAccessControl(MilDigitizer, M_FEATURE_EXECUTE, FeatureName, M_DEFAULT, M_NULL);
+   return EndAccess(PrintState);
+   }
+
+static bool InquireString(MIL_ID MilDigitizer, MIL_INT64 InquireType, const MIL_STRING& FeatureName, MIL_STRING* Value)
+   {
+   MIL_INT PrintState = BeginAccess();
+
+   FeatureAccessInquire(MilDigitizer, InquireType, FeatureName, M_TYPE_STRING, *Value);
+   return EndAccess(PrintState);
+   }
+
+static bool InquireInt64(MIL_ID MilDigitizer, MIL_INT64 InquireType, const MIL_STRING& FeatureName, MIL_INT64* Value)
+   {
+   MIL_INT PrintState = BeginAccess();
+
+   FeatureAccessInquire(MilDigitizer, InquireType, FeatureName, M_TYPE_INT64, Value);
+   return EndAccess(PrintState);
+   }
+
+static bool InquireDouble(MIL_ID MilDigitizer, MIL_INT64 InquireType, const MIL_STRING& FeatureName, MIL_DOUBLE* Value)
+   {
+   MIL_INT PrintState = BeginAccess();
+
+   FeatureAccessInquire(MilDigitizer, InquireType, FeatureName, M_TYPE_MIL_DOUBLE, Value);
+   return EndAccess(PrintState);
+   }
+
+/* Posting.                                                                 */
+/* -----------------------------------------------------------------------*/
+
+future<bool> FeatureAsyncSetString(MIL_ID MilDigitizer, const MIL_STRING& FeatureName, const MIL_STRING& Value)
+   {
+   return FeatureAsyncPost<bool>(MilDigitizer, bind(&ControlString, MilDigitizer, FeatureName, Value));
+   }
+
+future<bool> FeatureAsyncSetInt64(MIL_ID MilDigitizer, const MIL_STRING& FeatureName, MIL_INT64 Value)
+   {
+   return FeatureAsyncPost<bool>(MilDigitizer, bind(&ControlInt64, MilDigitizer, FeatureName, Value));
+   }
+
+future<bool> FeatureAsyncSetDouble(MIL_ID MilDigitizer, const MIL_STRING& FeatureName, MIL_DOUBLE Value)
+   {
+   return FeatureAsyncPost<bool>(MilDigitizer, bind(&ControlDouble, MilDigitizer, FeatureName, Value));
+   }
+
+future<bool> FeatureAsyncExecute(MIL_ID MilDigitizer, const MIL_STRING& FeatureName)
+   {
+   return FeatureAsyncPost<bool>(MilDigitizer, bind(&ControlExecute, MilDigitizer, FeatureName));
+   }
+
+future<bool> FeatureAsyncGetString(MIL_ID MilDigitizer, MIL_INT64 InquireType, const MIL_STRING& FeatureName,
+                                   MIL_STRING* Value)
+   {
+   return FeatureAsyncPost<bool>(MilDigitizer, bind(&InquireString, MilDigitizer, InquireType, FeatureName, Value));
+   }
+
+future<bool> FeatureAsyncGetInt64(MIL_ID MilDigitizer, MIL_INT64 InquireType, const MIL_STRING& FeatureName,
+                                  MIL_INT64* Value)
+   {
+   return FeatureAsyncPost<bool>(MilDigitizer, bind(&InquireInt64, MilDigitizer, InquireType, FeatureName, Value));
+   }
+
+future<bool> FeatureAsyncGetDouble(MIL_ID MilDigitizer, MIL_INT64 InquireType, const MIL_STRING& FeatureName,
+                                   MIL_DOUBLE* Value)
+   {
+   return FeatureAsyncPost<bool>(MilDigitizer, bind(&InquireDouble, MilDigitizer, InquireType, FeatureName, Value));
+   }
+
+bool FeatureAsyncWaitAll(vector< future<bool> >& Operations)
+   {
+   bool Ok = true;
+
+   for (size_t i = 0; i < Operations.size(); i++)
+      if (Operations[i].valid())
+         Ok = Operations[i].get() && Ok;
+   Operations.clear();
+   return Ok;
+   }
@@ -0,0 +1,77 @@
+﻿/********************************************************************************/
+/*
+* File name: FeatureAsync.h
+*
+* Synopsis:  Asynchronous GenICam feature access, for configuring many cameras
+*            at once.
+*
+*            Feature reads, writes and commands are posted to a small pool of
+*            I/O threads and return a std::future. Each digitizer has its own
+*            strand: the operations posted for one digitizer run one at a time
+*            and in the order they were posted, while the strands of different
+*            digitizers run in parallel on the pool. Configuring N cameras
+*            then takes about as long as configuring the slowest one, instead
+*            of the sum of their round trips.
+*
+*            The future of a read or write holds true if the access succeeded.
+*            A read stores its value in the variable given when it was posted,
+*            which must stay valid until the future is ready. Any other work
+*            can be ordered with the accesses of a digitizer with
+*            FeatureAsyncPost().
+*
+*            The accesses run with error printing disabled, the camera may
+*            not implement the feature; their failures are reported by their
+*            futures only. Work posted with FeatureAsyncPost() runs with the
+*            error printing of the thread that runs it.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+#ifndef FEATURE_ASYNC_H
+#define FEATURE_ASYNC_H
+
+#include <mil.h>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
+/* I/O threads. ThreadCount 0 uses FEATURE_ASYNC_DEFAULT_THREADS threads. */
+#define FEATURE_ASYNC_DEFAULT_THREADS  4
+
+bool FeatureAsyncStart(MIL_ID MilSystem, MIL_INT ThreadCount);
+void FeatureAsyncStop();
+
+/* Runs Work on the strand of MilDigitizer. Without I/O threads, Work runs */
+/* in the calling thread.                                                  */
+void FeatureAsyncPostWork(MIL_ID MilDigitizer, const std::function<void()>& Work);
+
+template <typename ResultType>
+std::future<ResultType> FeatureAsyncPost(MIL_ID MilDigitizer, const std::function<ResultType()>& Function)
+   {
+   std::shared_ptr< std::packaged_task<ResultType()> > Task =
+      std::make_shared< std::packaged_task<ResultType()> >(Function);
+   std::future<ResultType> Result = Task->get_future();
+
+   FeatureAsyncPostWork(MilDigitizer, [Task]() { (*Task)(); });
+   return Result;
+   }
+
+/* Writes. */
+std::future<bool> FeatureAsyncSetString(MIL_ID MilDigitizer, const MIL_STRING& FeatureName, const MIL_STRING& Value);
+std::future<bool> FeatureAsyncSetInt64(MIL_ID MilDigitizer, const MIL_STRING& FeatureName, MIL_INT64 Value);
+std::future<bool> FeatureAsyncSetDouble(MIL_ID MilDigitizer, const MIL_STRING& FeatureName, MIL_DOUBLE Value);
+std::future<bool> FeatureAsyncExecute(MIL_ID MilDigitizer, const MIL_STRING& FeatureName);
+
+/* Reads of the M_FEATURE_VALUE, M_FEATURE_MIN, M_FEATURE_MAX... of a feature. */
+std::future<bool> FeatureAsyncGetString(MIL_ID MilDigitizer, MIL_INT64 InquireType, const MIL_STRING& FeatureName,
+                                        MIL_STRING* Value);
+std::future<bool> FeatureAsyncGetInt64(MIL_ID MilDigitizer, MIL_INT64 InquireType, const MIL_STRING& FeatureName,
+                                       MIL_INT64* Value);
+std::future<bool> FeatureAsyncGetDouble(MIL_ID MilDigitizer, MIL_INT64 InquireType, const MIL_STRING& FeatureName,
+                                        MIL_DOUBLE* Value);
+
+/* Waits for all the operations and returns true if they all succeeded. */
+bool FeatureAsyncWaitAll(std::vector< std::future<bool> >& Operations);
+
+#endif
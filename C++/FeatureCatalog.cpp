@@ -0,0 +1,247 @@
+﻿/********************************************************************************/
+/*
+* File name: FeatureCatalog.cpp
+*
+* Synopsis:  Implementation of the feature catalog engine. See FeatureCatalog.h.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. */
+#include "FeatureCatalog.h"
+#include "FeatureAccess.h"
+
+using namespace std;
+
+static void ClearValue(FeatureCatalogValueStruct* Value)
+   {
+   Value->Valid = true;
+   Value->String.clear();
+   Value->Int64 = 0;
+   Value->Double = 0.0;
+   Value->Boolean = M_FALSE;
+   Value->Min = 0;
+   Value->Max = 0;
+   Value->Entries.clear();
+   }
+
+/* Reads one instance of a feature, with the selector already set. Returns */
+/* the number of accesses.                                                 */
+static MIL_INT ReadInstance(const char* Caller, MIL_ID MilDigitizer, const FeatureCatalogEntryStruct& Entry, FeatureCatalogValueStruct* Value)
+   {
+   MIL_INT Accesses = 0;
+
+   ClearValue(Value);
+   if (Entry.Reads & FEATURE_CATALOG_VALUE)
+      {
+      switch (Entry.Type)
+         {
+         case FEATURE_CATALOG_STRING:
+            FeatureAccessInquireFrom(Caller, MilDigitizer, M_FEATURE_VALUE, Entry.Name, M_TYPE_STRING, Value->String);
+            break;
+         case FEATURE_CATALOG_INT64:
+            FeatureAccessInquireFrom(Caller, MilDigitizer, M_FEATURE_VALUE, Entry.Name, M_TYPE_INT64, &Value->Int64);
+            break;
+         case FEATURE_CATALOG_DOUBLE:
+            FeatureAccessInquireFrom(Caller, MilDigitizer, M_FEATURE_VALUE, Entry.Name, M_TYPE_MIL_DOUBLE, &Value->Double);
+            break;
+         case FEATURE_CATALOG_BOOLEAN:
+            FeatureAccessInquireFrom(Caller, MilDigitizer, M_FEATURE_VALUE, Entry.Name, M_TYPE_BOOLEAN, &Value->Boolean);
+            break;
+         }
+      Value->Valid = Value->Valid && FeatureAccessSucceeded();
+      Accesses++;
+      }
+   if (Entry.Reads & FEATURE_CATALOG_MIN)
+      {
+      FeatureAccessInquireFrom(Caller, MilDigitizer, M_FEATURE_MIN, Entry.Name, M_TYPE_INT64, &Value->Min);
+      Value->Valid = Value->Valid && FeatureAccessSucceeded();
+      Accesses++;
+      }
+   if (Entry.Reads & FEATURE_CATALOG_MAX)
+      {
+      FeatureAccessInquireFrom(Caller, MilDigitizer, M_FEATURE_MAX, Entry.Name, M_TYPE_INT64, &Value->Max);
+      Value->Valid = Value->Valid && FeatureAccessSucceeded();
+      Accesses++;
+      }
+   if (Entry.Reads & FEATURE_CATALOG_ENTRIES)
+      {
+      MIL_INT EntryCount = 0;
+
+      FeatureAccessInquireFrom(Caller, MilDigitizer, M_FEATURE_ENUM_ENTRY_COUNT, Entry.Name, M_TYPE_MIL_INT, &EntryCount);
+      Accesses++;
+      if (!FeatureAccessSucceeded())
+         EntryCount = 0;
+      Value->Entries.assign((size_t)EntryCount, MIL_TEXT(""));
+      for (size_t i = 0; i < Value->Entries.size(); i++)
+         {
+         FeatureAccessInquireFrom(Caller, MilDigitizer, M_FEATURE_ENUM_ENTRY_NAME + i, Entry.Name, M_TYPE_STRING, Value->Entries[i]);
+         Accesses++;
+         }
+      Value->Valid = Value->Valid && (EntryCount > 0);
+      }
+   return Accesses;
+   }
+
+MIL_INT FeatureCatalogRead(const char* Caller, MIL_ID MilDigitizer, const FeatureCatalogEntryStruct* Catalog, size_t Count,
+                           MIL_INT Categories, vector<FeatureCatalogSlotStruct>& Slots)
+   {
+   vector<bool> Needed(Count, false);
+   vector<size_t> Selectors(Count, Count);
+   MIL_INT Accesses = 0;
+
+   /* The features of the categories and the selectors they depend on. */
+   for (size_t i = 0; i < Count; i++)
+      {
+      if (!(Catalog[i].Category & Categories))
+         continue;
+      Needed[i] = true;
+      if (Catalog[i].Selector != M_NULL)
+         {
+         Selectors[i] = FeatureCatalogFind(Catalog, Count, Catalog[i].Selector);
+         Needed[Selectors[i]] = true;
+         }
+      }
+
+   /* First, the features without selector, selectors included. */
+   for (size_t i = 0; i < Count; i++)
+      {
+      if (!Needed[i] || Catalog[i].Selector != M_NULL)
+         continue;
+      Slots[i].Instances.resize(1);
+      Accesses += ReadInstance(Caller, MilDigitizer, Catalog[i], &Slots[i].Instances[0]);
+      }
+
+   /* Then, for each entry of each selector, the features it selects. */
+   for (size_t s = 0; s < Count; s++)
+      {
+      const vector<MIL_STRING>* Entries = M_NULL;
+      bool Selects = false;
+
+      for (size_t i = s + 1; i < Count && !Selects; i++)
+         Selects = Needed[i] && Selectors[i] == s;
+      if (!Selects)
+         continue;
+
+      Entries = &FeatureCatalogInstance(Slots[s], 0).Entries;
+      for (size_t i = s + 1; i < Count; i++)
+         if (Needed[i] && Selectors[i] == s)
+            Slots[i].Instances.resize(Entries->size());
+
+      for (size_t e = 0; e < Entries->size(); e++)
+         {
+         FeatureAccessControlFrom(Caller, MilDigitizer, M_FEATURE_VALUE, Catalog[s].Name, M_TYPE_STRING, (*Entries)[e]);
+         Accesses++;
+         for (size_t i = s + 1; i < Count; i++)
+            if (Needed[i] && Selectors[i] == s)
+               Accesses += ReadInstance(Caller, MilDigitizer, Catalog[i], &Slots[i].Instances[e]);
+         }
+      }
+
+   return Accesses;
+   }
+
+const FeatureCatalogValueStruct& FeatureCatalogInstance(const FeatureCatalogSlotStruct& Slot, size_t Instance)
+   {
+   static FeatureCatalogValueStruct Invalid = { false, MIL_TEXT(""), 0, 0.0, M_FALSE, 0, 0, vector<MIL_STRING>() };
+
+   return (Instance < Slot.Instances.size()) ? Slot.Instances[Instance] : Invalid;
+   }
+
+/* Printer.                                                                  */
+/* -----------------------------------------------------------------------*/
+
+/* Value as printed, N/A if it could not be read. */
+static MIL_STRING FormatValue(const FeatureCatalogEntryStruct& Entry, const FeatureCatalogValueStruct& Value)
+   {
+   MIL_TEXT_CHAR Text[64] = MIL_TEXT("N/A");
+
+   if (!Value.Valid)
+      return Text;
+
+   switch (Entry.Format)
+      {
+      case FEATURE_CATALOG_RANGE:
+         MosSprintf(Text, 64, MIL_TEXT("%lld (%lld to %lld)"), (long long)Value.Int64, (long long)Value.Min, (long long)Value.Max);
+         break;
+      case FEATURE_CATALOG_MICROSECONDS:
+         MosSprintf(Text, 64, MIL_TEXT("%.1f us"), Value.Double);
+         break;
+      case FEATURE_CATALOG_IP_ADDRESS:
+         MosSprintf(Text, 64, MIL_TEXT("%d.%d.%d.%d"), (int)((Value.Int64 >> 24) & 0xFF), (int)((Value.Int64 >> 16) & 0xFF),
+                    (int)((Value.Int64 >> 8) & 0xFF), (int)(Value.Int64 & 0xFF));
+         break;
+      case FEATURE_CATALOG_MAC_ADDRESS:
+         MosSprintf(Text, 64, MIL_TEXT("%.2X-%.2X-%.2X-%.2X-%.2X-%.2X"), (int)((Value.Int64 >> 40) & 0xFF), (int)((Value.Int64 >> 32) & 0xFF),
+                    (int)((Value.Int64 >> 24) & 0xFF), (int)((Value.Int64 >> 16) & 0xFF), (int)((Value.Int64 >> 8) & 0xFF),
+                    (int)(Value.Int64 & 0xFF));
+         break;
+      default:
+         switch (Entry.Type)
+            {
+            case FEATURE_CATALOG_STRING:
+               return Value.String.empty() ? MIL_STRING(Text) : Value.String;
+            case FEATURE_CATALOG_INT64:
+               MosSprintf(Text, 64, MIL_TEXT("%lld"), (long long)Value.Int64);
+               break;
+            case FEATURE_CATALOG_DOUBLE:
+               MosSprintf(Text, 64, MIL_TEXT("%g"), Value.Double);
+               break;
+            case FEATURE_CATALOG_BOOLEAN:
+               return Value.Boolean ? MIL_TEXT("true") : MIL_TEXT("false");
+            }
+         break;
+      }
+   return Text;
+   }
+
+void FeatureCatalogPrint(const FeatureCatalogEntryStruct* Catalog, size_t Count, MIL_INT Category,
+                         const MIL_TEXT_CHAR* Title, const vector<FeatureCatalogSlotStruct>& Slots)
+   {
+   MIL_STRING Rule((MosStrlen(Title) + 2 < 60) ? (60 - MosStrlen(Title) - 2)/2 : 0, MIL_TEXT('-'));
+
+   MosPrintf(MIL_TEXT("\n%s %s %s\n\n"), Rule.c_str(), Title, Rule.c_str());
+
+   for (size_t s = 0; s < Count; s++)
+      {
+      const FeatureCatalogValueStruct& Value = FeatureCatalogInstance(Slots[s], 0);
+      vector<size_t> Columns;
+
+      if (!(Catalog[s].Category & Category) || Catalog[s].Selector != M_NULL)
+         continue;
+
+      if (!(Catalog[s].Reads & FEATURE_CATALOG_ENTRIES))
+         {
+         MosPrintf(MIL_TEXT("%30s %s\n"), Catalog[s].Label, FormatValue(Catalog[s], Value).c_str());
+         continue;
+         }
+
+      /* An enumeration: its entries, one per line. */
+      for (size_t i = s + 1; i < Count; i++)
+         if (Catalog[i].Selector != M_NULL && FeatureCatalogFind(Catalog, Count, Catalog[i].Selector) == s)
+            Columns.push_back(i);
+      if (Columns.empty())
+         {
+         MosPrintf(MIL_TEXT("\n%30s %s\n"), Catalog[s].Label, Value.Valid ? Value.Entries[0].c_str() : MIL_TEXT("N/A"));
+         for (size_t e = 1; e < Value.Entries.size(); e++)
+            MosPrintf(MIL_TEXT("%30s %s\n"), MIL_TEXT(""), Value.Entries[e].c_str());
+         continue;
+         }
+
+      /* With features it selects: a table with one column per feature. */
+      MosPrintf(MIL_TEXT("\n%30s"), Catalog[s].Label);
+      for (size_t c = 0; c < Columns.size(); c++)
+         MosPrintf(MIL_TEXT(" %-20s"), Catalog[Columns[c]].Label);
+      MosPrintf(MIL_TEXT("\n"));
+      if (!Value.Valid)
+         MosPrintf(MIL_TEXT("%30s N/A\n"), MIL_TEXT(""));
+      for (size_t e = 0; e < Value.Entries.size(); e++)
+         {
+         MosPrintf(MIL_TEXT("%30s"), Value.Entries[e].c_str());
+         for (size_t c = 0; c < Columns.size(); c++)
+            MosPrintf(MIL_TEXT(" %-20s"), FormatValue(Catalog[Columns[c]], FeatureCatalogInstance(Slots[Columns[c]], e)).c_str());
+         MosPrintf(MIL_TEXT("\n"));
+         }
+      }
+   }
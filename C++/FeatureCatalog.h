@@ -0,0 +1,259 @@
+﻿/********************************************************************************/
+/*
+* File name: FeatureCatalog.h
+*
+* Synopsis:  Compile-time catalog of the SFNC features read by the camera
+*            feature summary, and the table-driven engine that reads them.
+*
+*            Each row of FeatureCatalog gives the name, type, reads (value,
+*            minimum, maximum, enumeration entries), summary category, the
+*            selector the feature depends on, and the label and format it is
+*            printed with. Adding a feature to the summary is adding a row;
+*            the catalog is checked at compile time (unique names, selectors
+*            listed before the features they select and read for their
+*            entries), and the features are looked up by name at compile time,
+*            so a name that is not in the catalog does not build.
+*
+*            The engine plans the reads of the requested categories from the
+*            catalog: every feature is read once per pass, and the selected
+*            features are grouped by selector, so a selector is written once
+*            per entry whatever the number of features it selects. The
+*            selectors are left on their last entry.
+*
+*            The printer prints a category in catalog order, one labeled value
+*            per feature. An enumeration read for its entries prints them one
+*            per line, or, if it selects features, a table with one row per
+*            entry and one column per selected feature. A value that could
+*            not be read prints as N/A.
+*
+*            A read that fails leaves its value invalid; call with the error
+*            prints disabled.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+#ifndef FEATURE_CATALOG_H
+#define FEATURE_CATALOG_H
+
+#include <mil.h>
+#include <vector>
+
+/* Feature types. */
+#define FEATURE_CATALOG_STRING            0
+#define FEATURE_CATALOG_INT64             1
+#define FEATURE_CATALOG_DOUBLE            2
+#define FEATURE_CATALOG_BOOLEAN           3
+
+/* Reads. The minimum and maximum are those of integer features. */
+#define FEATURE_CATALOG_VALUE             0x1
+#define FEATURE_CATALOG_MIN               0x2
+#define FEATURE_CATALOG_MAX               0x4
+#define FEATURE_CATALOG_ENTRIES           0x8
+
+/* Categories, one per section of the feature summary. */
+#define FEATURE_CATALOG_DEVICE            0x01
+#define FEATURE_CATALOG_TRANSPORT_LAYER   0x02
+#define FEATURE_CATALOG_IMAGE_FORMAT      0x04
+#define FEATURE_CATALOG_ACQUISITION       0x08
+#define FEATURE_CATALOG_EVENT             0x10
+#define FEATURE_CATALOG_IO                0x20
+#define FEATURE_CATALOG_COUNTER_AND_TIMER 0x40
+#define FEATURE_CATALOG_ALL               0x7F
+
+/* Print formats. */
+#define FEATURE_CATALOG_PLAIN             0   /* As its type: text, integer, number or true/false. */
+#define FEATURE_CATALOG_RANGE             1   /* Integer, with its minimum and maximum.            */
+#define FEATURE_CATALOG_MICROSECONDS      2
+#define FEATURE_CATALOG_IP_ADDRESS        3
+#define FEATURE_CATALOG_MAC_ADDRESS       4
+
+typedef struct
+   {
+   const MIL_TEXT_CHAR*     Name;
+   MIL_INT                  Type;
+   MIL_INT                  Reads;
+   MIL_INT                  Category;
+   const MIL_TEXT_CHAR*     Selector;   /* Feature whose entries select the instances read, M_NULL if none. */
+   const MIL_TEXT_CHAR*     Label;      /* Printed before the value, or as the column title of a selected feature. */
+   MIL_INT                  Format;
+   } FeatureCatalogEntryStruct;
+
+/* Section of the summary. */
+typedef struct
+   {
+   MIL_INT                  Category;
+   const MIL_TEXT_CHAR*     Title;
+   } FeatureCatalogCategoryStruct;
+
+/* Value of one instance of a feature. */
+typedef struct
+   {
+   bool                     Valid;      /* All the reads of the instance succeeded. */
+   MIL_STRING               String;
+   MIL_INT64                Int64;
+   MIL_DOUBLE               Double;
+   MIL_BOOL                 Boolean;
+   MIL_INT64                Min;
+   MIL_INT64                Max;
+   std::vector<MIL_STRING>  Entries;
+   } FeatureCatalogValueStruct;
+
+typedef struct
+   {
+   std::vector<FeatureCatalogValueStruct>   Instances;   /* One per entry of the selector, or one; none if not read. */
+   } FeatureCatalogSlotStruct;
+
+/* The SFNC features of the summary. */
+constexpr FeatureCatalogEntryStruct FeatureCatalog[] =
+   {
+   /* Name                                Type                       Reads                                                      Category                            Selector                       Label                                      Format */
+   { MIL_TEXT("DeviceVendorName"),        FEATURE_CATALOG_STRING,    FEATURE_CATALOG_VALUE,                                     FEATURE_CATALOG_DEVICE,             M_NULL,                        MIL_TEXT("Vendor:"),                       FEATURE_CATALOG_PLAIN        },
+   { MIL_TEXT("DeviceModelName"),         FEATURE_CATALOG_STRING,    FEATURE_CATALOG_VALUE,                                     FEATURE_CATALOG_DEVICE,             M_NULL,                        MIL_TEXT("Model:"),                        FEATURE_CATALOG_PLAIN        },
+   { MIL_TEXT("DeviceID"),                FEATURE_CATALOG_STRING,    FEATURE_CATALOG_VALUE,                                     FEATURE_CATALOG_DEVICE,             M_NULL,                        MIL_TEXT("Serial number:"),                FEATURE_CATALOG_PLAIN        },
+   { MIL_TEXT("DeviceUserID"),            FEATURE_CATALOG_STRING,    FEATURE_CATALOG_VALUE,                                     FEATURE_CATALOG_DEVICE,             M_NULL,                        MIL_TEXT("User-defined name:"),            FEATURE_CATALOG_PLAIN        },
+   { MIL_TEXT("DeviceScanType"),          FEATURE_CATALOG_STRING,    FEATURE_CATALOG_VALUE,                                     FEATURE_CATALOG_DEVICE,             M_NULL,                        MIL_TEXT("Device scan type:"),             FEATURE_CATALOG_PLAIN        },
+
+   { MIL_TEXT("GevVersionMajor"),         FEATURE_CATALOG_INT64,     FEATURE_CATALOG_VALUE,                                     FEATURE_CATALOG_TRANSPORT_LAYER,    M_NULL,                        MIL_TEXT("GigE Vision major version:"),    FEATURE_CATALOG_PLAIN        },
+   { MIL_TEXT("GevVersionMinor"),         FEATURE_CATALOG_INT64,     FEATURE_CATALOG_VALUE,                                     FEATURE_CATALOG_TRANSPORT_LAYER,    M_NULL,                        MIL_TEXT("GigE Vision minor version:"),    FEATURE_CATALOG_PLAIN        },
+   { MIL_TEXT("GevMACAddress"),           FEATURE_CATALOG_INT64,     FEATURE_CATALOG_VALUE,                                     FEATURE_CATALOG_TRANSPORT_LAYER,    M_NULL,                        MIL_TEXT("MAC Address:"),                  FEATURE_CATALOG_MAC_ADDRESS  },
+   { MIL_TEXT("GevCurrentIPAddress"),     FEATURE_CATALOG_INT64,     FEATURE_CATALOG_VALUE,                                     FEATURE_CATALOG_TRANSPORT_LAYER,    M_NULL,                        MIL_TEXT("Current IP Address:"),           FEATURE_CATALOG_IP_ADDRESS   },
+   { MIL_TEXT("GevSCPSPacketSize"),       FEATURE_CATALOG_INT64,     FEATURE_CATALOG_VALUE,                                     FEATURE_CATALOG_TRANSPORT_LAYER,    M_NULL,                        MIL_TEXT("Packet size:"),                  FEATURE_CATALOG_PLAIN        },
+
+   { MIL_TEXT("SensorWidth"),             FEATURE_CATALOG_INT64,     FEATURE_CATALOG_VALUE,                                     FEATURE_CATALOG_IMAGE_FORMAT,       M_NULL,                        MIL_TEXT("Sensor width:"),                 FEATURE_CATALOG_PLAIN        },
+   { MIL_TEXT("SensorHeight"),            FEATURE_CATALOG_INT64,     FEATURE_CATALOG_VALUE,                                     FEATURE_CATALOG_IMAGE_FORMAT,       M_NULL,                        MIL_TEXT("Sensor height:"),                FEATURE_CATALOG_PLAIN        },
+   { MIL_TEXT("Width"),                   FEATURE_CATALOG_INT64,     FEATURE_CATALOG_VALUE|FEATURE_CATALOG_MIN|FEATURE_CATALOG_MAX, FEATURE_CATALOG_IMAGE_FORMAT,   M_NULL,                        MIL_TEXT("ROI width (min to max):"),       FEATURE_CATALOG_RANGE        },
+   { MIL_TEXT("Height"),                  FEATURE_CATALOG_INT64,     FEATURE_CATALOG_VALUE|FEATURE_CATALOG_MIN|FEATURE_CATALOG_MAX, FEATURE_CATALOG_IMAGE_FORMAT,   M_NULL,                        MIL_TEXT("ROI height (min to max):"),      FEATURE_CATALOG_RANGE        },
+   { MIL_TEXT("ReverseX"),                FEATURE_CATALOG_BOOLEAN,   FEATURE_CATALOG_VALUE,                                     FEATURE_CATALOG_IMAGE_FORMAT,       M_NULL,                        MIL_TEXT("Image Reverse X:"),              FEATURE_CATALOG_PLAIN        },
+   { MIL_TEXT("ReverseY"),                FEATURE_CATALOG_BOOLEAN,   FEATURE_CATALOG_VALUE,                                     FEATURE_CATALOG_IMAGE_FORMAT,       M_NULL,                        MIL_TEXT("Image Reverse Y:"),              FEATURE_CATALOG_PLAIN        },
+   { MIL_TEXT("PixelFormat"),             FEATURE_CATALOG_STRING,    FEATURE_CATALOG_ENTRIES,                                   FEATURE_CATALOG_IMAGE_FORMAT,       M_NULL,                        MIL_TEXT("Supported pixel formats:"),      FEATURE_CATALOG_PLAIN        },
+
+   { MIL_TEXT("AcquisitionMode"),         FEATURE_CATALOG_STRING,    FEATURE_CATALOG_ENTRIES,                                   FEATURE_CATALOG_ACQUISITION,        M_NULL,                        MIL_TEXT("Supported acquisition modes:"),  FEATURE_CATALOG_PLAIN        },
+   { MIL_TEXT("TriggerSelector"),         FEATURE_CATALOG_STRING,    FEATURE_CATALOG_ENTRIES,                                   FEATURE_CATALOG_ACQUISITION,        M_NULL,                        MIL_TEXT("Supported trigger selectors:"),  FEATURE_CATALOG_PLAIN        },
+   { MIL_TEXT("ExposureMode"),            FEATURE_CATALOG_STRING,    FEATURE_CATALOG_ENTRIES,                                   FEATURE_CATALOG_ACQUISITION,        M_NULL,                        MIL_TEXT("Supported exposure modes:"),     FEATURE_CATALOG_PLAIN        },
+   { MIL_TEXT("ExposureTime"),            FEATURE_CATALOG_DOUBLE,    FEATURE_CATALOG_VALUE,                                     FEATURE_CATALOG_ACQUISITION,        M_NULL,                        MIL_TEXT("Exposure time:"),                FEATURE_CATALOG_MICROSECONDS },
+
+   { MIL_TEXT("EventSelector"),           FEATURE_CATALOG_STRING,    FEATURE_CATALOG_ENTRIES,                                   FEATURE_CATALOG_EVENT,              M_NULL,                        MIL_TEXT("Supported events:"),             FEATURE_CATALOG_PLAIN        },
+
+   { MIL_TEXT("LineSelector"),            FEATURE_CATALOG_STRING,    FEATURE_CATALOG_ENTRIES,                                   FEATURE_CATALOG_IO,                 M_NULL,                        MIL_TEXT("Lines:"),                        FEATURE_CATALOG_PLAIN        },
+   { MIL_TEXT("LineMode"),                FEATURE_CATALOG_STRING,    FEATURE_CATALOG_VALUE,                                     FEATURE_CATALOG_IO,                 MIL_TEXT("LineSelector"),      MIL_TEXT("Mode"),                          FEATURE_CATALOG_PLAIN        },
+   { MIL_TEXT("LineFormat"),              FEATURE_CATALOG_STRING,    FEATURE_CATALOG_VALUE,                                     FEATURE_CATALOG_IO,                 MIL_TEXT("LineSelector"),      MIL_TEXT("Format"),                        FEATURE_CATALOG_PLAIN        },
+
+   { MIL_TEXT("CounterSelector"),         FEATURE_CATALOG_STRING,    FEATURE_CATALOG_ENTRIES,                                   FEATURE_CATALOG_COUNTER_AND_TIMER,  M_NULL,                        MIL_TEXT("Counters:"),                     FEATURE_CATALOG_PLAIN        },
+   { MIL_TEXT("CounterStatus"),           FEATURE_CATALOG_STRING,    FEATURE_CATALOG_VALUE,                                     FEATURE_CATALOG_COUNTER_AND_TIMER,  MIL_TEXT("CounterSelector"),   MIL_TEXT("Status"),                        FEATURE_CATALOG_PLAIN        },
+   { MIL_TEXT("TimerSelector"),           FEATURE_CATALOG_STRING,    FEATURE_CATALOG_ENTRIES,                                   FEATURE_CATALOG_COUNTER_AND_TIMER,  M_NULL,                        MIL_TEXT("Timers:"),                       FEATURE_CATALOG_PLAIN        },
+   { MIL_TEXT("TimerStatus"),             FEATURE_CATALOG_STRING,    FEATURE_CATALOG_VALUE,                                     FEATURE_CATALOG_COUNTER_AND_TIMER,  MIL_TEXT("TimerSelector"),     MIL_TEXT("Status"),                        FEATURE_CATALOG_PLAIN        },
+   };
+
+/* The sections of the summary, in print order. */
+constexpr FeatureCatalogCategoryStruct FeatureCatalogCategories[] =
+   {
+   { FEATURE_CATALOG_DEVICE,             MIL_TEXT("Camera Device Controls") },
+   { FEATURE_CATALOG_TRANSPORT_LAYER,    MIL_TEXT("Camera Transport Layer Controls") },
+   { FEATURE_CATALOG_IMAGE_FORMAT,       MIL_TEXT("Image Format Controls") },
+   { FEATURE_CATALOG_ACQUISITION,        MIL_TEXT("Acquisition Controls") },
+   { FEATURE_CATALOG_EVENT,              MIL_TEXT("Event Controls") },
+   { FEATURE_CATALOG_IO,                 MIL_TEXT("Digital I/O Controls") },
+   { FEATURE_CATALOG_COUNTER_AND_TIMER,  MIL_TEXT("Counter and Timer Controls") },
+   };
+
+#define FEATURE_CATALOG_CATEGORY_COUNT  (sizeof(FeatureCatalogCategories)/sizeof(FeatureCatalogCategories[0]))
+
+#define FEATURE_CATALOG_SIZE  (sizeof(FeatureCatalog)/sizeof(FeatureCatalog[0]))
+
+/* Compile-time lookup and checks of a catalog.                             */
+/* -----------------------------------------------------------------------*/
+
+constexpr bool FeatureCatalogNameEqual(const MIL_TEXT_CHAR* Name1, const MIL_TEXT_CHAR* Name2)
+   {
+   return (*Name1 == *Name2) && (*Name1 == 0 || FeatureCatalogNameEqual(Name1 + 1, Name2 + 1));
+   }
+
+/* Index of Name in the catalog, Count if it is not in the catalog. */
+constexpr size_t FeatureCatalogFind(const FeatureCatalogEntryStruct* Catalog, size_t Count, const MIL_TEXT_CHAR* Name,
+                                    size_t Index = 0)
+   {
+   return (Index == Count) ? Count :
+          FeatureCatalogNameEqual(Catalog[Index].Name, Name) ? Index :
+          FeatureCatalogFind(Catalog, Count, Name, Index + 1);
+   }
+
+/* A selector is listed before the features it selects, has its entries */
+/* read and is not selected itself.                                     */
+constexpr bool FeatureCatalogSelectorValid(const FeatureCatalogEntryStruct* Catalog, size_t Selector, size_t Index)
+   {
+   return (Selector < Index) && (Catalog[Selector].Reads & FEATURE_CATALOG_ENTRIES) && (Catalog[Selector].Selector == M_NULL);
+   }
+
+constexpr bool FeatureCatalogValid(const FeatureCatalogEntryStruct* Catalog, size_t Count, size_t Index = 0)
+   {
+   return (Index == Count) ||
+          ((FeatureCatalogFind(Catalog, Count, Catalog[Index].Name) == Index) &&
+           (Catalog[Index].Selector == M_NULL ||
+            FeatureCatalogSelectorValid(Catalog, FeatureCatalogFind(Catalog, Count, Catalog[Index].Selector), Index)) &&
+           FeatureCatalogValid(Catalog, Count, Index + 1));
+   }
+
+static_assert(FeatureCatalogValid(FeatureCatalog, FEATURE_CATALOG_SIZE),
+              "FeatureCatalog has a duplicate name or a selector that is missing, listed after the features it selects or not read for its entries.");
+
+/* Index of a feature of FeatureCatalog, for FeatureCatalogReader::Value(). */
+#define FEATURE_CATALOG_INDEX(Name)  FeatureCatalogFind(FeatureCatalog, FEATURE_CATALOG_SIZE, MIL_TEXT(Name))
+
+/* Engine.                                                                   */
+/* -----------------------------------------------------------------------*/
+
+/* Reads the features of Categories from MilDigitizer into Slots, one per */
+/* row of the catalog. The accesses are recorded under Caller (see        */
+/* FeatureAccess.h). Returns the number of feature accesses.              */
+MIL_INT FeatureCatalogRead(const char* Caller, MIL_ID MilDigitizer, const FeatureCatalogEntryStruct* Catalog, size_t Count,
+                           MIL_INT Categories, std::vector<FeatureCatalogSlotStruct>& Slots);
+
+/* Instance of a slot, an invalid value if it was not read. */
+const FeatureCatalogValueStruct& FeatureCatalogInstance(const FeatureCatalogSlotStruct& Slot, size_t Instance);
+
+/* Prints the features of Category under Title. */
+void FeatureCatalogPrint(const FeatureCatalogEntryStruct* Catalog, size_t Count, MIL_INT Category,
+                         const MIL_TEXT_CHAR* Title, const std::vector<FeatureCatalogSlotStruct>& Slots);
+
+/* Values of the features of a catalog, read with one planned pass per call */
+/* to Read(), and printed by category.                                       */
+template <const FeatureCatalogEntryStruct* Catalog, size_t Count>
+class FeatureCatalogReader
+   {
+   public:
+      FeatureCatalogReader() : Slots(Count), AccessCount(0)
+         {
+         }
+
+      /* Caller is the name the accesses are recorded under, usually __FUNCTION__. */
+      void Read(const char* Caller, MIL_ID MilDigitizer, MIL_INT Categories)
+         {
+         AccessCount += FeatureCatalogRead(Caller, MilDigitizer, Catalog, Count, Categories, Slots);
+         }
+
+      /* Value of the feature at Index, for the Instance-th entry of its selector. */
+      template <size_t Index>
+      const FeatureCatalogValueStruct& Value(size_t Instance = 0) const
+         {
+         static_assert(Index < Count, "The feature is not in the catalog.");
+         return FeatureCatalogInstance(Slots[Index], Instance);
+         }
+
+      void Print(MIL_INT Category, const MIL_TEXT_CHAR* Title) const
+         {
+         FeatureCatalogPrint(Catalog, Count, Category, Title, Slots);
+         }
+
+      MIL_INT Accesses() const
+         {
+         return AccessCount;
+         }
+
+   private:
+      std::vector<FeatureCatalogSlotStruct> Slots;
+      MIL_INT                               AccessCount;
+   };
+
+typedef FeatureCatalogReader<FeatureCatalog, FEATURE_CATALOG_SIZE> CameraFeatureCatalog;
+
+#endif
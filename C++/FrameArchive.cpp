@@ -0,0 +1,739 @@
+﻿/********************************************************************************/
+/*
+* File name: FrameArchive.cpp
+*
+* Synopsis:  Implementation of the frame archive. See FrameArchive.h.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. */
+#include "FrameArchive.h"
+#include <string.h>
+#include <algorithm>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include "Placement.h"
+
+using namespace std;
+
+/* LZ4 block format parameters. */
+#define LZ_HASH_BITS             12
+#define LZ_HASH_EMPTY            0xFFFFFFFFU
+#define LZ_MIN_MATCH             4
+#define LZ_LAST_LITERALS         5
+#define LZ_MATCH_FIND_LIMIT      12
+#define LZ_MAX_OFFSET            65535
+
+#define FILE_HEADER_SIZE         32
+#define FRAME_HEADER_SIZE        16
+static const MIL_UINT8 FileMagic[4] = {'M', 'G', 'F', 'A'};
+
+/* Compression threads, shared by the archives, whose jobs each compress */
+/* one tile (job index: slot index * tile count + tile); the writer thread */
+/* writes the frames of an archive with a frame compressed.                */
+static WorkerPoolStruct Pool;
+static WorkerPoolStruct Writer;
+
+/* Little-endian helpers. */
+static void PutLE32(MIL_UINT8* Ptr, MIL_UINT32 Value)
+   {
+   for (MIL_INT i = 0; i < 4; i++)
+      Ptr[i] = (MIL_UINT8)(Value >> (8*i));
+   }
+
+static void PutLE64(MIL_UINT8* Ptr, MIL_UINT64 Value)
+   {
+   for (MIL_INT i = 0; i < 8; i++)
+      Ptr[i] = (MIL_UINT8)(Value >> (8*i));
+   }
+
+static MIL_UINT32 GetLE32(const MIL_UINT8* Ptr)
+   {
+   return (MIL_UINT32)Ptr[0] | ((MIL_UINT32)Ptr[1] << 8) | ((MIL_UINT32)Ptr[2] << 16) | ((MIL_UINT32)Ptr[3] << 24);
+   }
+
+static MIL_UINT64 GetLE64(const MIL_UINT8* Ptr)
+   {
+   return (MIL_UINT64)GetLE32(Ptr) | ((MIL_UINT64)GetLE32(Ptr + 4) << 32);
+   }
+
+static FILE* OpenFile(const MIL_TEXT_CHAR* FileName, bool Write)
+   {
+   FILE* File = NULL;
+#if M_MIL_USE_WINDOWS
+   _wfopen_s(&File, FileName, Write ? L"wb" : L"rb");
+#else
+   File = fopen(FileName, Write ? "wb" : "rb");
+#endif
+   return File;
+   }
+
+/* Prediction filter.                                                       */
+/* -----------------------------------------------------------------------*/
+
+/* Replaces each sample by its difference with the mean of its left and upper */
+/* neighbors (only one of them on the first row and column of the tile).      */
+/* Byte n of the residuals goes to plane n.                                   */
+template <typename T>
+static inline void PutResidual(MIL_UINT8* Out, MIL_INT PlaneSize, T Residual)
+   {
+   for (size_t b = 0; b < sizeof(T); b++)
+      Out[b*PlaneSize] = (MIL_UINT8)(Residual >> (8*b));
+   }
+
+template <typename T>
+static void FilterTile(const T* Src, MIL_INT Rows, MIL_INT RowSamples, MIL_INT Stride, MIL_UINT8* Dst)
+   {
+   MIL_INT PlaneSize = Rows*RowSamples;
+   MIL_INT x;
+
+   for (x = 0; x < Stride && x < RowSamples; x++)
+      PutResidual(Dst + x, PlaneSize, Src[x]);
+   for (; x < RowSamples; x++)
+      PutResidual(Dst + x, PlaneSize, (T)(Src[x] - Src[x - Stride]));
+
+   for (MIL_INT y = 1; y < Rows; y++)
+      {
+      const T* Row = Src + y*RowSamples;
+      const T* Up = Row - RowSamples;
+      MIL_UINT8* Out = Dst + y*RowSamples;
+
+      for (x = 0; x < Stride && x < RowSamples; x++)
+         PutResidual(Out + x, PlaneSize, (T)(Row[x] - Up[x]));
+      for (; x < RowSamples; x++)
+         PutResidual(Out + x, PlaneSize, (T)(Row[x] - (((MIL_UINT32)Row[x - Stride] + Up[x]) >> 1)));
+      }
+   }
+
+/* Inverse of FilterTile(). */
+template <typename T>
+static void UnfilterTile(const MIL_UINT8* Src, MIL_INT Rows, MIL_INT RowSamples, MIL_INT Stride, T* Dst)
+   {
+   MIL_INT PlaneSize = Rows*RowSamples;
+
+   for (MIL_INT y = 0; y < Rows; y++)
+      {
+      T* Row = Dst + y*RowSamples;
+      const T* Up = Row - RowSamples;
+      const MIL_UINT8* In = Src + y*RowSamples;
+
+      for (MIL_INT x = 0; x < RowSamples; x++)
+         {
+         T Predicted;
+         if (y == 0)
+            Predicted = (x >= Stride) ? Row[x - Stride] : 0;
+         else if (x < Stride)
+            Predicted = Up[x];
+         else
+            Predicted = (T)(((MIL_UINT32)Row[x - Stride] + Up[x]) >> 1);
+
+         T Residual = 0;
+         for (size_t b = 0; b < sizeof(T); b++)
+            Residual = (T)(Residual | ((T)In[b*PlaneSize + x] << (8*b)));
+         Row[x] = (T)(Predicted + Residual);
+         }
+      }
+   }
+
+/* MbufGet() gives the bands one after the other, so a frame is a stack of */
+/* SizeBand planes of SizeY rows of SizeX samples, which the tiles split   */
+/* in rows. The part of a tile in each plane is filtered on its own, so    */
+/* that no sample is predicted from another band.                          */
+template <typename T>
+static void FilterPlanes(const T* Src, MIL_INT FirstRow, MIL_INT Rows, MIL_INT SizeX, MIL_INT SizeY, MIL_UINT8* Dst)
+   {
+   for (MIL_INT Row = FirstRow; Row < FirstRow + Rows; )
+      {
+      MIL_INT PartRows = min(FirstRow + Rows, (Row/SizeY + 1)*SizeY) - Row;
+      MIL_INT Offset = (Row - FirstRow)*SizeX;
+
+      FilterTile(Src + Offset, PartRows, SizeX, 1, Dst + Offset*(MIL_INT)sizeof(T));
+      Row += PartRows;
+      }
+   }
+
+/* Inverse of FilterPlanes(). */
+template <typename T>
+static void UnfilterPlanes(const MIL_UINT8* Src, MIL_INT FirstRow, MIL_INT Rows, MIL_INT SizeX, MIL_INT SizeY, T* Dst)
+   {
+   for (MIL_INT Row = FirstRow; Row < FirstRow + Rows; )
+      {
+      MIL_INT PartRows = min(FirstRow + Rows, (Row/SizeY + 1)*SizeY) - Row;
+      MIL_INT Offset = (Row - FirstRow)*SizeX;
+
+      UnfilterTile(Src + Offset*(MIL_INT)sizeof(T), PartRows, SizeX, 1, Dst + Offset);
+      Row += PartRows;
+      }
+   }
+
+/* LZ4 block coding.                                                        */
+/* -----------------------------------------------------------------------*/
+
+static inline MIL_UINT32 Read32(const MIL_UINT8* Ptr)
+   {
+   MIL_UINT32 Value;
+   memcpy(&Value, Ptr, sizeof(Value));
+   return Value;
+   }
+
+static inline MIL_UINT64 Read64(const MIL_UINT8* Ptr)
+   {
+   MIL_UINT64 Value;
+   memcpy(&Value, Ptr, sizeof(Value));
+   return Value;
+   }
+
+/* Index of the first differing byte times 8, on a little-endian host. */
+static inline MIL_INT LowestSetBit(MIL_UINT64 Value)
+   {
+#if defined(_MSC_VER)
+   unsigned long Index;
+   _BitScanForward64(&Index, Value);
+   return (MIL_INT)Index;
+#else
+   return __builtin_ctzll(Value);
+#endif
+   }
+
+static inline MIL_UINT32 Hash(MIL_UINT32 Sequence)
+   {
+   return (Sequence*2654435761U) >> (32 - LZ_HASH_BITS);
+   }
+
+static MIL_UINT8* PutLength(MIL_UINT8* Op, MIL_INT Length)
+   {
+   for (; Length >= 255; Length -= 255)
+      *Op++ = 255;
+   *Op++ = (MIL_UINT8)Length;
+   return Op;
+   }
+
+/* Greedy single-probe compressor. Returns the compressed size, or 0 if it */
+/* would not be smaller than Capacity.                                     */
+static MIL_INT LzCompress(const MIL_UINT8* Src, MIL_INT SrcSize, MIL_UINT8* Dst, MIL_INT Capacity, MIL_UINT32* Table)
+   {
+   const MIL_UINT8* Ip = Src;
+   const MIL_UINT8* Anchor = Src;
+   const MIL_UINT8* End = Src + SrcSize;
+   const MIL_UINT8* MatchLimit = End - LZ_LAST_LITERALS;
+   const MIL_UINT8* FindLimit = End - LZ_MATCH_FIND_LIMIT;
+   MIL_UINT8* Op = Dst;
+   MIL_UINT8* OpEnd = Dst + Capacity;
+   MIL_INT LiteralLength;
+
+   for (MIL_INT i = 0; i < (1 << LZ_HASH_BITS); i++)
+      Table[i] = LZ_HASH_EMPTY;
+
+   while (SrcSize > LZ_MATCH_FIND_LIMIT && Ip < FindLimit)
+      {
+      MIL_UINT32 Sequence = Read32(Ip);
+      MIL_UINT32 Position = (MIL_UINT32)(Ip - Src);
+      MIL_UINT32* Entry = &Table[Hash(Sequence)];
+      MIL_UINT32 Candidate = *Entry;
+
+      *Entry = Position;
+      if (Candidate == LZ_HASH_EMPTY || Position - Candidate > LZ_MAX_OFFSET || Read32(Src + Candidate) != Sequence)
+         {
+         /* Skip faster through data that does not match. */
+         Ip += 1 + ((Ip - Anchor) >> 6);
+         continue;
+         }
+
+      const MIL_UINT8* Match = Src + Candidate;
+      while (Ip > Anchor && Match > Src && Ip[-1] == Match[-1])
+         {
+         Ip--;
+         Match--;
+         }
+      const MIL_UINT8* MatchEnd = Ip + LZ_MIN_MATCH;
+      const MIL_UINT8* Ref = Match + LZ_MIN_MATCH;
+      while (MatchEnd + sizeof(MIL_UINT64) <= MatchLimit)
+         {
+         MIL_UINT64 Difference = Read64(MatchEnd) ^ Read64(Ref);
+         if (Difference)
+            {
+            MatchEnd += LowestSetBit(Difference)/8;
+            Ref += LowestSetBit(Difference)/8;
+            break;
+            }
+         MatchEnd += sizeof(MIL_UINT64);
+         Ref += sizeof(MIL_UINT64);
+         }
+      if (MatchEnd + sizeof(MIL_UINT64) > MatchLimit)
+         {
+         while (MatchEnd < MatchLimit && *MatchEnd == *Ref)
+            {
+            MatchEnd++;
+            Ref++;
+            }
+         }
+
+      LiteralLength = Ip - Anchor;
+      MIL_INT MatchLength = MatchEnd - Ip - LZ_MIN_MATCH;
+      if (Op + 1 + LiteralLength + LiteralLength/255 + 2 + MatchLength/255 + 1 >= OpEnd)
+         return 0;
+
+      MIL_UINT8* Token = Op++;
+      *Token = (MIL_UINT8)(((LiteralLength < 15) ? LiteralLength : 15) << 4);
+      if (LiteralLength >= 15)
+         Op = PutLength(Op, LiteralLength - 15);
+      memcpy(Op, Anchor, (size_t)LiteralLength);
+      Op += LiteralLength;
+      Op[0] = (MIL_UINT8)(Ip - Match);
+      Op[1] = (MIL_UINT8)((Ip - Match) >> 8);
+      Op += 2;
+      *Token |= (MIL_UINT8)((MatchLength < 15) ? MatchLength : 15);
+      if (MatchLength >= 15)
+         Op = PutLength(Op, MatchLength - 15);
+
+      Ip = MatchEnd;
+      Anchor = Ip;
+      }
+
+   /* The block ends with literals. */
+   LiteralLength = End - Anchor;
+   if (Op + 1 + LiteralLength + LiteralLength/255 + 1 >= OpEnd)
+      return 0;
+   *Op++ = (MIL_UINT8)(((LiteralLength < 15) ? LiteralLength : 15) << 4);
+   if (LiteralLength >= 15)
+      Op = PutLength(Op, LiteralLength - 15);
+   memcpy(Op, Anchor, (size_t)LiteralLength);
+   Op += LiteralLength;
+   return Op - Dst;
+   }
+
+static bool GetLength(const MIL_UINT8** Ip, const MIL_UINT8* End, MIL_INT* Length)
+   {
+   MIL_UINT8 Byte;
+   do
+      {
+      if (*Ip >= End)
+         return false;
+      Byte = *(*Ip)++;
+      *Length += Byte;
+      } while (Byte == 255);
+   return true;
+   }
+
+/* Decodes exactly DstSize bytes; returns false on malformed input. */
+static bool LzDecompress(const MIL_UINT8* Src, MIL_INT SrcSize, MIL_UINT8* Dst, MIL_INT DstSize)
+   {
+   const MIL_UINT8* Ip = Src;
+   const MIL_UINT8* End = Src + SrcSize;
+   MIL_UINT8* Op = Dst;
+   MIL_UINT8* OpEnd = Dst + DstSize;
+
+   while (Ip < End)
+      {
+      MIL_UINT32 Token = *Ip++;
+      MIL_INT Length = Token >> 4;
+      if (Length == 15 && !GetLength(&Ip, End, &Length))
+         return false;
+      if (Length > End - Ip || Length > OpEnd - Op)
+         return false;
+      memcpy(Op, Ip, (size_t)Length);
+      Op += Length;
+      Ip += Length;
+      if (Ip == End)
+         break;
+
+      if (End - Ip < 2)
+         return false;
+      MIL_INT Offset = Ip[0] | (Ip[1] << 8);
+      Ip += 2;
+      if (Offset == 0 || Offset > Op - Dst)
+         return false;
+      Length = Token & 15;
+      if (Length == 15 && !GetLength(&Ip, End, &Length))
+         return false;
+      Length += LZ_MIN_MATCH;
+      if (Length > OpEnd - Op)
+         return false;
+
+      /* The match may overlap the bytes being written. */
+      const MIL_UINT8* Match = Op - Offset;
+      for (MIL_INT i = 0; i < Length; i++)
+         Op[i] = Match[i];
+      Op += Length;
+      }
+   return Op == OpEnd;
+   }
+
+/* Compression threads.                                                     */
+/* -----------------------------------------------------------------------*/
+
+static MIL_INT TileRowCount(const FrameArchiveStruct* Archive, MIL_INT Tile)
+   {
+   MIL_INT Rows = Archive->SizeY - Tile*Archive->TileRows;
+   return (Rows < Archive->TileRows) ? Rows : Archive->TileRows;
+   }
+
+static void CompressTile(FrameArchiveStruct* Archive, FrameArchiveSlotStruct* Slot, MIL_INT Tile,
+                         vector<MIL_UINT8>& Residual, vector<MIL_UINT32>& Table)
+   {
+   MIL_DOUBLE StartTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+   MIL_INT RowSamples = Archive->SizeX*Archive->SizeBand;
+   MIL_INT Rows = TileRowCount(Archive, Tile);
+   MIL_INT RawSize = Rows*RowSamples*Archive->SampleByte;
+   const MIL_UINT8* Raw = &Slot->Raw[Tile*Archive->TileSizeByte];
+   MIL_UINT8* Packed = &Slot->Packed[Tile*Archive->TileSizeByte];
+   MIL_INT PackedSize;
+
+   /* The tile holds Rows*SizeBand rows of the stack of band planes. */
+   Residual.resize(Archive->TileSizeByte);
+   if (Archive->SampleByte == 1)
+      FilterPlanes(Raw, Tile*Archive->TileRows*Archive->SizeBand, Rows*Archive->SizeBand, Archive->SizeX, Archive->SizeY,
+                   &Residual[0]);
+   else
+      FilterPlanes((const MIL_UINT16*)Raw, Tile*Archive->TileRows*Archive->SizeBand, Rows*Archive->SizeBand,
+                   Archive->SizeX, Archive->SizeY, &Residual[0]);
+
+   PackedSize = LzCompress(&Residual[0], RawSize, Packed, RawSize, &Table[0]);
+   if (PackedSize == 0)
+      {
+      memcpy(Packed, Raw, (size_t)RawSize);
+      Slot->TileSize[Tile] = (MIL_UINT32)RawSize | FRAME_ARCHIVE_STORED;
+      }
+   else
+      Slot->TileSize[Tile] = (MIL_UINT32)PackedSize;
+
+   Slot->TileTime[Tile] = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) - StartTime;
+   }
+
+static void WriteFrame(FrameArchiveStruct* Archive, FrameArchiveSlotStruct* Slot)
+   {
+   MIL_UINT8 Header[FRAME_HEADER_SIZE];
+   MIL_UINT64 StoredBytes = FRAME_HEADER_SIZE;
+   MIL_DOUBLE Now;
+
+   PutLE64(Header, Slot->FrameNumber);
+   PutLE64(Header + 8, (MIL_UINT64)(MIL_INT64)(Slot->TimeStamp*1e6));
+   if (fwrite(Header, FRAME_HEADER_SIZE, 1, Archive->File) != 1)
+      Archive->WriteError = true;
+
+   for (MIL_INT i = 0; i < Archive->TileCount; i++)
+      {
+      MIL_UINT8 Size[4];
+      PutLE32(Size, Slot->TileSize[i]);
+      if (fwrite(Size, sizeof(Size), 1, Archive->File) != 1)
+         Archive->WriteError = true;
+      }
+   for (MIL_INT i = 0; i < Archive->TileCount; i++)
+      {
+      size_t Size = Slot->TileSize[i] & ~FRAME_ARCHIVE_STORED;
+      if (fwrite(&Slot->Packed[i*Archive->TileSizeByte], 1, Size, Archive->File) != Size)
+         Archive->WriteError = true;
+      StoredBytes += 4 + Size;
+      if (Slot->TileSize[i] & FRAME_ARCHIVE_STORED)
+         Archive->StoredTiles++;
+      Archive->CompressTime += Slot->TileTime[i];
+      }
+
+   Now = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+   Archive->RawBytes += Archive->FrameSizeByte;
+   Archive->StoredBytes += StoredBytes;
+   Archive->LastWriteTime = Now;
+   WorkerLatencyAdd(&Archive->Latency, Now - Slot->QueueTime);
+   }
+
+/* Writes the compressed frames of the archive that are next in queue */
+/* order. Only run by the writer thread.                                */
+static void WriteCompressedFrames(void* DataPtr, MIL_INT Index)
+   {
+   FrameArchiveStruct* Archive = (FrameArchiveStruct*)DataPtr;
+   MIL_UINT64 Next;
+
+   while (WorkerQueueFront(&Archive->Queue, &Next))
+      {
+      FrameArchiveSlotStruct* Slot = &Archive->Slots[Next % Archive->SlotCount];
+      if (!Slot->Compressed.load())
+         break;
+      WriteFrame(Archive, Slot);
+      Slot->Compressed.store(false);
+      WorkerQueuePop(&Archive->Queue);
+      }
+   }
+
+static void CompressSlotTile(void* DataPtr, MIL_INT Index)
+   {
+   static thread_local vector<MIL_UINT8> Residual;
+   static thread_local vector<MIL_UINT32> Table(1 << LZ_HASH_BITS);
+   FrameArchiveStruct* Archive = (FrameArchiveStruct*)DataPtr;
+   FrameArchiveSlotStruct* Slot = &Archive->Slots[Index / Archive->TileCount];
+
+   /* Follow the placement of the acquisition, if any. */
+   PlacementWorkerThread();
+   CompressTile(Archive, Slot, Index % Archive->TileCount, Residual, Table);
+
+   /* The thread completing the frame hands the archive to the writer, so */
+   /* that the compression threads never wait for the file.               */
+   if (Slot->TilesLeft.fetch_sub(1) == 1)
+      {
+      Slot->Compressed.store(true);
+      WorkerPoolPost(&Writer, &WriteCompressedFrames, Archive, 0, 1);
+      }
+   }
+
+bool FrameArchiveStart(MIL_ID MilSystem, MIL_INT ThreadCount)
+   {
+   if (!Pool.MilThreads.empty())
+      return true;
+
+   if (!WorkerPoolStart(&Writer, MilSystem, 1))
+      return false;
+   if (!WorkerPoolStart(&Pool, MilSystem, ThreadCount))
+      {
+      FrameArchiveStop();
+      return false;
+      }
+   return true;
+   }
+
+/* Compresses the tiles still queued and writes the frames, then ends the */
+/* threads.                                                               */
+void FrameArchiveStop()
+   {
+   WorkerPoolStop(&Pool);
+   WorkerPoolStop(&Writer);
+   }
+
+/* Archive.                                                                 */
+/* -----------------------------------------------------------------------*/
+
+bool FrameArchiveOpen(const MIL_TEXT_CHAR* FileName, MIL_ID MilBuffer, MIL_INT SlotCount, MIL_INT TileSizeByte,
+                      FrameArchiveStruct* Archive)
+   {
+   MIL_UINT8 Header[FILE_HEADER_SIZE];
+   MIL_INT SizeBit = MbufInquire(MilBuffer, M_SIZE_BIT, M_NULL);
+   MIL_INT RowByte;
+
+   Archive->File = NULL;
+   Archive->Slots = NULL;
+   Archive->SlotCount = 0;
+   if (SizeBit > 16 || SlotCount <= 0)
+      return false;
+
+   Archive->SizeX = MbufInquire(MilBuffer, M_SIZE_X, M_NULL);
+   Archive->SizeY = MbufInquire(MilBuffer, M_SIZE_Y, M_NULL);
+   Archive->SizeBand = MbufInquire(MilBuffer, M_SIZE_BAND, M_NULL);
+   Archive->SampleByte = (SizeBit + 7)/8;
+   RowByte = Archive->SizeX*Archive->SizeBand*Archive->SampleByte;
+   Archive->FrameSizeByte = RowByte*Archive->SizeY;
+   Archive->TileRows = (TileSizeByte > RowByte) ? TileSizeByte/RowByte : 1;
+   if (Archive->TileRows > Archive->SizeY)
+      Archive->TileRows = Archive->SizeY;
+   Archive->TileCount = (Archive->SizeY + Archive->TileRows - 1)/Archive->TileRows;
+   Archive->TileSizeByte = Archive->TileRows*RowByte;
+
+   Archive->File = OpenFile(FileName, true);
+   if (Archive->File == NULL)
+      return false;
+
+   memcpy(Header, FileMagic, sizeof(FileMagic));
+   PutLE32(Header + 4, FRAME_ARCHIVE_VERSION);
+   PutLE32(Header + 8, (MIL_UINT32)Archive->SizeX);
+   PutLE32(Header + 12, (MIL_UINT32)Archive->SizeY);
+   PutLE32(Header + 16, (MIL_UINT32)Archive->SampleByte);
+   PutLE32(Header + 20, (MIL_UINT32)Archive->SizeBand);
+   PutLE32(Header + 24, (MIL_UINT32)Archive->TileRows);
+   PutLE32(Header + 28, (MIL_UINT32)Archive->TileCount);
+   Archive->WriteError = (fwrite(Header, FILE_HEADER_SIZE, 1, Archive->File) != 1);
+
+   Archive->Slots = new FrameArchiveSlotStruct[SlotCount];
+   Archive->SlotCount = SlotCount;
+   for (MIL_INT i = 0; i < SlotCount; i++)
+      {
+      FrameArchiveSlotStruct* Slot = &Archive->Slots[i];
+      Slot->Raw.resize(Archive->TileSizeByte*Archive->TileCount);
+      Slot->Packed.resize(Archive->TileSizeByte*Archive->TileCount);
+      Slot->TileSize.resize(Archive->TileCount);
+      Slot->TileTime.resize(Archive->TileCount);
+      Slot->TilesLeft.store(0);
+      Slot->Compressed.store(false);
+      }
+
+   WorkerQueueInit(&Archive->Queue, SlotCount);
+   Archive->RawBytes = 0;
+   Archive->StoredBytes = FILE_HEADER_SIZE;
+   Archive->StoredTiles = 0;
+   Archive->CompressTime = 0.0;
+   Archive->FirstQueueTime = 0.0;
+   Archive->LastWriteTime = 0.0;
+   WorkerLatencyInit(&Archive->Latency);
+   return true;
+   }
+
+/* Copies the frame into a free slot and queues its tiles. Returns false if */
+/* the frame was dropped.                                                   */
+bool FrameArchiveFrame(FrameArchiveStruct* Archive, MIL_ID MilBuffer, MIL_UINT64 FrameNumber, MIL_DOUBLE TimeStamp)
+   {
+   FrameArchiveSlotStruct* Slot;
+   MIL_UINT64 Index;
+
+   if (Archive->File == NULL || Pool.MilThreads.empty() ||
+       MbufInquire(MilBuffer, M_SIZE_X, M_NULL) != Archive->SizeX ||
+       MbufInquire(MilBuffer, M_SIZE_Y, M_NULL) != Archive->SizeY ||
+       !WorkerQueueReserve(&Archive->Queue, &Index))
+      return false;
+
+   /* The slot is only used by the caller until its tiles are queued. */
+   Slot = &Archive->Slots[Index % Archive->SlotCount];
+   MbufGet(MilBuffer, &Slot->Raw[0]);
+   Slot->FrameNumber = FrameNumber;
+   Slot->TimeStamp = TimeStamp;
+   Slot->QueueTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+   Slot->TilesLeft.store(Archive->TileCount);
+   if (Index == 0)
+      Archive->FirstQueueTime = Slot->QueueTime;
+
+   /* Count the frame before its tiles can complete. */
+   WorkerQueuePush(&Archive->Queue);
+   WorkerPoolPost(&Pool, &CompressSlotTile, Archive, (MIL_INT)(Index % Archive->SlotCount)*Archive->TileCount,
+                  Archive->TileCount);
+   return true;
+   }
+
+/* Prints the compression ratio, throughput and added latency. Call after */
+/* FrameArchiveClose().                                                   */
+void FrameArchivePrintStatistics(FrameArchiveStruct* Archive, const MIL_TEXT_CHAR* Name)
+   {
+   MIL_UINT64 Frames = Archive->Queue.DoneCount;
+   MIL_DOUBLE Duration = Archive->LastWriteTime - Archive->FirstQueueTime;
+
+   MosPrintf(MIL_TEXT("\n--------------------- Frame archive (%s) ---------------------\n\n"), Name);
+   MosPrintf(MIL_TEXT("%30s %llu (%llu dropped)\n"), MIL_TEXT("Frames written:"), (unsigned long long)Frames,
+             (unsigned long long)Archive->Queue.DroppedCount);
+   MosPrintf(MIL_TEXT("%30s %lld tiles of %lld rows, %llu stored uncompressed\n"), MIL_TEXT("Tiling:"),
+             (long long)Archive->TileCount, (long long)Archive->TileRows, (unsigned long long)Archive->StoredTiles);
+   if (Frames == 0)
+      return;
+
+   MosPrintf(MIL_TEXT("%30s %.2f:1 (%.1f MB to %.1f MB)\n"), MIL_TEXT("Compression ratio:"),
+             (MIL_DOUBLE)Archive->RawBytes/(MIL_DOUBLE)Archive->StoredBytes,
+             Archive->RawBytes/1e6, Archive->StoredBytes/1e6);
+   if (Duration > 0.0)
+      MosPrintf(MIL_TEXT("%30s %.1f MB/s (%.1f frames/s)\n"), MIL_TEXT("Throughput:"),
+                Archive->RawBytes/1e6/Duration, Frames/Duration);
+   if (Archive->CompressTime > 0.0)
+      MosPrintf(MIL_TEXT("%30s %.1f MB/s per thread, %lld threads\n"), MIL_TEXT("Compression speed:"),
+                Archive->RawBytes/1e6/Archive->CompressTime, (long long)Pool.MilThreads.size());
+   WorkerLatencyPrint(&Archive->Latency);
+   if (Archive->WriteError)
+      MosPrintf(MIL_TEXT("%30s %s\n"), MIL_TEXT("Write errors:"), MIL_TEXT("Yes"));
+   }
+
+/* Waits for the queued frames to be written and closes the file. */
+void FrameArchiveClose(FrameArchiveStruct* Archive)
+   {
+   if (Archive->File == NULL)
+      return;
+
+   while (!WorkerQueueEmpty(&Archive->Queue) && !Pool.MilThreads.empty())
+      MosSleep(1);
+
+   /* The writer may still hold the archive, and hand-offs of frames it */
+   /* already wrote may still be posted.                                */
+   WorkerPoolCancel(&Writer, Archive);
+
+   fclose(Archive->File);
+   Archive->File = NULL;
+   delete [] Archive->Slots;
+   Archive->Slots = NULL;
+   }
+
+/* Reading.                                                                 */
+/* -----------------------------------------------------------------------*/
+
+bool FrameArchiveReadOpen(const MIL_TEXT_CHAR* FileName, FrameArchiveReaderStruct* Reader)
+   {
+   MIL_UINT8 Header[FILE_HEADER_SIZE];
+
+   Reader->File = OpenFile(FileName, false);
+   if (Reader->File == NULL)
+      return false;
+
+   if (fread(Header, FILE_HEADER_SIZE, 1, Reader->File) != 1 || memcmp(Header, FileMagic, sizeof(FileMagic)) != 0 ||
+       GetLE32(Header + 4) != FRAME_ARCHIVE_VERSION)
+      {
+      FrameArchiveReadClose(Reader);
+      return false;
+      }
+
+   Reader->SizeX = GetLE32(Header + 8);
+   Reader->SizeY = GetLE32(Header + 12);
+   Reader->SampleByte = GetLE32(Header + 16);
+   Reader->SizeBand = GetLE32(Header + 20);
+   Reader->TileRows = GetLE32(Header + 24);
+   Reader->TileCount = GetLE32(Header + 28);
+   if (Reader->SizeX <= 0 || Reader->SizeY <= 0 || Reader->SizeBand <= 0 || Reader->TileRows <= 0 ||
+       (Reader->SampleByte != 1 && Reader->SampleByte != 2) ||
+       Reader->TileCount != (Reader->SizeY + Reader->TileRows - 1)/Reader->TileRows)
+      {
+      FrameArchiveReadClose(Reader);
+      return false;
+      }
+   Reader->TileSize.resize(Reader->TileCount);
+   return true;
+   }
+
+bool FrameArchiveReadFrame(FrameArchiveReaderStruct* Reader, MIL_UINT64* FrameNumber, MIL_DOUBLE* TimeStamp,
+                           vector<MIL_UINT8>& Data)
+   {
+   MIL_UINT8 Header[FRAME_HEADER_SIZE];
+   MIL_INT RowSamples = Reader->SizeX*Reader->SizeBand;
+   MIL_INT TileSizeByte = Reader->TileRows*RowSamples*Reader->SampleByte;
+
+   if (Reader->File == NULL || fread(Header, FRAME_HEADER_SIZE, 1, Reader->File) != 1)
+      return false;
+   *FrameNumber = GetLE64(Header);
+   *TimeStamp = (MIL_INT64)GetLE64(Header + 8)/1e6;
+
+   for (MIL_INT i = 0; i < Reader->TileCount; i++)
+      {
+      MIL_UINT8 Size[4];
+      if (fread(Size, sizeof(Size), 1, Reader->File) != 1)
+         return false;
+      Reader->TileSize[i] = GetLE32(Size);
+      }
+
+   Data.resize(Reader->SizeY*RowSamples*Reader->SampleByte);
+   Reader->Packed.resize(TileSizeByte);
+   Reader->Residual.resize(TileSizeByte);
+   for (MIL_INT i = 0; i < Reader->TileCount; i++)
+      {
+      MIL_INT FirstRow = i*Reader->TileRows;
+      MIL_INT Rows = (Reader->SizeY - FirstRow < Reader->TileRows) ? Reader->SizeY - FirstRow : Reader->TileRows;
+      MIL_INT RawSize = Rows*RowSamples*Reader->SampleByte;
+      MIL_INT Size = Reader->TileSize[i] & ~FRAME_ARCHIVE_STORED;
+      MIL_UINT8* Tile = &Data[FirstRow*RowSamples*Reader->SampleByte];
+
+      if (Size > TileSizeByte || fread(&Reader->Packed[0], 1, (size_t)Size, Reader->File) != (size_t)Size)
+         return false;
+
+      if (Reader->TileSize[i] & FRAME_ARCHIVE_STORED)
+         {
+         if (Size != RawSize)
+            return false;
+         memcpy(Tile, &Reader->Packed[0], (size_t)Size);
+         }
+      else if (!LzDecompress(&Reader->Packed[0], Size, &Reader->Residual[0], RawSize))
+         return false;
+      else if (Reader->SampleByte == 1)
+         UnfilterPlanes(&Reader->Residual[0], FirstRow*Reader->SizeBand, Rows*Reader->SizeBand, Reader->SizeX,
+                        Reader->SizeY, Tile);
+      else
+         UnfilterPlanes(&Reader->Residual[0], FirstRow*Reader->SizeBand, Rows*Reader->SizeBand, Reader->SizeX,
+                        Reader->SizeY, (MIL_UINT16*)Tile);
+      }
+   return true;
+   }
+
+void FrameArchiveReadClose(FrameArchiveReaderStruct* Reader)
+   {
+   if (Reader->File)
+      fclose(Reader->File);
+   Reader->File = NULL;
+   }
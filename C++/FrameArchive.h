@@ -0,0 +1,124 @@
+﻿/********************************************************************************/
+/*
+* File name: FrameArchive.h
+*
+* Synopsis:  Lossless compression of the grabbed frames to an archive file,
+*            on a pool of MIL threads shared by all the cameras.
+*
+*            The processing function only copies the frame into a free slot
+*            of the camera's archive and queues it; it never waits for the
+*            compression. Each frame is split into tiles of whole rows which
+*            are compressed independently, so that one large frame uses
+*            several cores. A tile is first filtered with the PNG "average"
+*            predictor, band plane by band plane (16-bit residuals are split
+*            in low and high byte planes), then coded in the LZ4 block format. Tiles that do not
+*            shrink are stored as is. The thread completing a frame hands it
+*            to a single writer thread, so that no compression thread waits
+*            for the file. The frames are written in the order in which they
+*            were queued; when all the slots are in use, the frame is dropped
+*            and counted.
+*
+*            File layout, little-endian:
+*            - header: "MGFA", version, SizeX, SizeY, bytes per sample, bands,
+*              rows per tile, tiles per frame (32-bit each);
+*            - per frame: frame number (64-bit), time stamp in microseconds
+*              (64-bit), the size of each tile (32-bit, FRAME_ARCHIVE_STORED
+*              set for a stored tile), then the tiles.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+#ifndef FRAME_ARCHIVE_H
+#define FRAME_ARCHIVE_H
+
+#include <mil.h>
+#include <stdio.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "WorkerPool.h"
+
+#define FRAME_ARCHIVE_VERSION       2
+
+/* Flag of the tile sizes: the tile is stored without compression. */
+#define FRAME_ARCHIVE_STORED        0x80000000U
+
+/* Frame queued for compression. */
+typedef struct
+   {
+   std::vector<MIL_UINT8>   Raw;
+   std::vector<MIL_UINT8>   Packed;       /* Tile n starts at n*TileSizeByte. */
+   std::vector<MIL_UINT32>  TileSize;
+   std::vector<MIL_DOUBLE>  TileTime;     /* Compression time of each tile.  */
+   MIL_UINT64               FrameNumber;
+   MIL_DOUBLE               TimeStamp;
+   MIL_DOUBLE               QueueTime;
+   std::atomic<MIL_INT>     TilesLeft;
+   std::atomic<bool>        Compressed;
+   } FrameArchiveSlotStruct;
+
+/* Archive of one camera. */
+typedef struct
+   {
+   FILE*                    File;
+   MIL_INT                  SizeX;
+   MIL_INT                  SizeY;
+   MIL_INT                  SampleByte;   /* 1 or 2. */
+   MIL_INT                  SizeBand;
+   MIL_INT                  FrameSizeByte;
+   MIL_INT                  TileRows;
+   MIL_INT                  TileCount;
+   MIL_INT                  TileSizeByte;
+
+   FrameArchiveSlotStruct*  Slots;
+   MIL_INT                  SlotCount;
+   WorkerQueueStruct        Queue;        /* Frames queued and written. */
+
+   /* Statistics, updated by the writer. */
+   MIL_UINT64               RawBytes;
+   MIL_UINT64               StoredBytes;
+   MIL_UINT64               StoredTiles;
+   MIL_DOUBLE               CompressTime;
+   MIL_DOUBLE               FirstQueueTime;
+   MIL_DOUBLE               LastWriteTime;
+   WorkerLatencyStruct      Latency;
+   bool                     WriteError;
+   } FrameArchiveStruct;
+
+/* Archive being read. */
+typedef struct
+   {
+   FILE*                    File;
+   MIL_INT                  SizeX;
+   MIL_INT                  SizeY;
+   MIL_INT                  SampleByte;
+   MIL_INT                  SizeBand;
+   MIL_INT                  TileRows;
+   MIL_INT                  TileCount;
+   std::vector<MIL_UINT32>  TileSize;
+   std::vector<MIL_UINT8>   Packed;
+   std::vector<MIL_UINT8>   Residual;
+   } FrameArchiveReaderStruct;
+
+/* Compression threads, and the writer thread. ThreadCount 0 uses one */
+/* compression thread per core but one.                               */
+bool FrameArchiveStart(MIL_ID MilSystem, MIL_INT ThreadCount);
+void FrameArchiveStop();
+
+/* Archive of the frames of the size and type of MilBuffer, with SlotCount */
+/* frames queued at most and tiles of about TileSizeByte bytes.            */
+bool FrameArchiveOpen(const MIL_TEXT_CHAR* FileName, MIL_ID MilBuffer, MIL_INT SlotCount, MIL_INT TileSizeByte,
+                      FrameArchiveStruct* Archive);
+bool FrameArchiveFrame(FrameArchiveStruct* Archive, MIL_ID MilBuffer, MIL_UINT64 FrameNumber, MIL_DOUBLE TimeStamp);
+void FrameArchivePrintStatistics(FrameArchiveStruct* Archive, const MIL_TEXT_CHAR* Name);
+void FrameArchiveClose(FrameArchiveStruct* Archive);
+
+/* Reading. FrameArchiveReadFrame() fills Data as MbufGet() does:   */
+/* SizeBand planes of SizeY rows of SizeX samples. It returns false  */
+/* at the end of the file or if the frame is corrupted.              */
+bool FrameArchiveReadOpen(const MIL_TEXT_CHAR* FileName, FrameArchiveReaderStruct* Reader);
+bool FrameArchiveReadFrame(FrameArchiveReaderStruct* Reader, MIL_UINT64* FrameNumber, MIL_DOUBLE* TimeStamp,
+                           std::vector<MIL_UINT8>& Data);
+void FrameArchiveReadClose(FrameArchiveReaderStruct* Reader);
+
+#endif
@@ -0,0 +1,554 @@
+﻿/********************************************************************************/
+/*
+* File name: FrameBus.cpp
+*
+* Synopsis:  Implementation of the shared-memory frame bus. See FrameBus.h.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. */
+#include "FrameBus.h"
+#include <atomic>
+#include <new>
+#if M_MIL_USE_WINDOWS
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#endif
+
+using namespace std;
+
+/* Layout constants of the shared-memory object. The control region is sized to */
+/* the Windows allocation granularity so that the slot ring can be mapped       */
+/* separately, read-only, on both platforms.                                   */
+#define FRAME_BUS_MAGIC             0x5355424DU    /* "MBUS" */
+#define FRAME_BUS_VERSION           3
+#define FRAME_BUS_REGION_ALIGNMENT  (64*1024)
+#define FRAME_BUS_SLOT_ALIGNMENT    4096
+#define FRAME_BUS_HEADER_ALIGNMENT  64
+
+#define ALIGN_UP(Value, Alignment)  ((((Value) + (Alignment) - 1) / (Alignment)) * (Alignment))
+
+/* Subscriber table entry, written by the subscriber that owns it. */
+typedef struct
+   {
+   atomic<MIL_UINT32> InUse;
+   atomic<MIL_INT64>  ProcessId;
+   atomic<MIL_UINT64> NextFrame;
+   atomic<MIL_UINT64> FramesRead;
+   atomic<MIL_UINT64> Overruns;
+   } SharedSubscriberStruct;
+
+/* Control region, at offset 0 of the shared-memory object. */
+typedef struct
+   {
+   MIL_UINT32             Magic;
+   MIL_UINT32             Version;
+   MIL_INT64              PublisherProcessId;
+   MIL_INT64              SlotCount;
+   MIL_INT64              SlotSizeByte;
+   MIL_INT64              SlotStrideByte;
+   MIL_INT64              SlotHeaderSizeByte;
+   MIL_INT64              ControlSizeByte;
+   atomic<MIL_UINT64>     PublishedCount;
+   SharedSubscriberStruct Subscribers[FRAME_BUS_MAX_SUBSCRIBERS];
+   } SharedControlStruct;
+
+/* Header at the start of every slot. Sequence is 2n while frame n is complete */
+/* in the slot and 2n-1 while the publisher is writing it.                     */
+typedef struct
+   {
+   atomic<MIL_UINT64> Sequence;
+   FrameBusInfoStruct Info;
+   } SharedSlotHeaderStruct;
+
+#define CONTROL_SIZE_BYTE     ALIGN_UP((MIL_INT64)sizeof(SharedControlStruct), FRAME_BUS_REGION_ALIGNMENT)
+#define SLOT_HEADER_SIZE_BYTE ALIGN_UP((MIL_INT64)sizeof(SharedSlotHeaderStruct), FRAME_BUS_HEADER_ALIGNMENT)
+
+static SharedControlStruct* Control(FrameBusStruct* Bus)
+   {
+   return (SharedControlStruct*)Bus->Control;
+   }
+
+static SharedSlotHeaderStruct* SlotHeader(FrameBusStruct* Bus, MIL_UINT64 FrameNumber)
+   {
+   SharedControlStruct* Ctrl = Control(Bus);
+   MIL_INT64 Slot = (MIL_INT64)((FrameNumber - 1) % (MIL_UINT64)Ctrl->SlotCount);
+   return (SharedSlotHeaderStruct*)(Bus->Slots + Slot*Ctrl->SlotStrideByte);
+   }
+
+static bool IsProcessAlive(MIL_INT64 ProcessId)
+   {
+#if M_MIL_USE_WINDOWS
+   HANDLE Process = OpenProcess(SYNCHRONIZE, FALSE, (DWORD)ProcessId);
+   if (Process == NULL)
+      return false;
+   bool Alive = (WaitForSingleObject(Process, 0) == WAIT_TIMEOUT);
+   CloseHandle(Process);
+   return Alive;
+#else
+   return (kill((pid_t)ProcessId, 0) == 0) || (errno != ESRCH);
+#endif
+   }
+
+static MIL_INT64 CurrentProcessId()
+   {
+#if M_MIL_USE_WINDOWS
+   return (MIL_INT64)GetCurrentProcessId();
+#else
+   return (MIL_INT64)getpid();
+#endif
+   }
+
+#if !M_MIL_USE_WINDOWS
+/* Returns true if the shared-memory object Name is a complete frame bus whose  */
+/* publisher has exited without removing it. A bus still being created, or of  */
+/* an unknown layout, is never considered stale.                               */
+static bool IsStale(const MIL_TEXT_CHAR* Name)
+   {
+   struct stat Status;
+   bool Stale = false;
+   int Fd = shm_open(Name, O_RDONLY, 0);
+
+   if (Fd < 0)
+      return false;
+   if (fstat(Fd, &Status) == 0 && Status.st_size >= (off_t)sizeof(SharedControlStruct))
+      {
+      void* Base = mmap(NULL, sizeof(SharedControlStruct), PROT_READ, MAP_SHARED, Fd, 0);
+      if (Base != MAP_FAILED)
+         {
+         const SharedControlStruct* Ctrl = (const SharedControlStruct*)Base;
+         if (Ctrl->Magic == FRAME_BUS_MAGIC && Ctrl->Version == FRAME_BUS_VERSION)
+            {
+            atomic_thread_fence(memory_order_acquire);
+            Stale = !IsProcessAlive(Ctrl->PublisherProcessId);
+            }
+         munmap(Base, sizeof(SharedControlStruct));
+         }
+      }
+   close(Fd);
+   return Stale;
+   }
+#endif
+
+/* Creates the shared-memory object and initializes the control region and slots. */
+/* Fails if a bus of the same name exists and its publisher is still running; the  */
+/* object left behind by a publisher that has exited is replaced.                  */
+bool FrameBusCreate(const MIL_TEXT_CHAR* Name, MIL_INT SlotCount, MIL_INT64 SlotSizeByte, FrameBusStruct* Bus)
+   {
+   MIL_INT64 SlotStrideByte = ALIGN_UP(SLOT_HEADER_SIZE_BYTE + SlotSizeByte, FRAME_BUS_SLOT_ALIGNMENT);
+   MIL_INT64 SlotsSizeByte = SlotStrideByte*SlotCount;
+   MIL_INT64 TotalSizeByte = CONTROL_SIZE_BYTE + SlotsSizeByte;
+   void* Base = NULL;
+
+   Bus->Mapping = NULL;
+   Bus->Control = NULL;
+   Bus->Slots = NULL;
+   Bus->SubscriberIndex = -1;
+   Bus->NextFrame = 0;
+   Bus->AcquiredSequence = 0;
+   Bus->Name = Name;
+
+   if (SlotCount <= 0 || SlotSizeByte <= 0)
+      return false;
+
+#if M_MIL_USE_WINDOWS
+   HANDLE Mapping = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                      (DWORD)(TotalSizeByte >> 32), (DWORD)(TotalSizeByte & 0xFFFFFFFF), Name);
+   if (Mapping == NULL)
+      return false;
+   if (GetLastError() == ERROR_ALREADY_EXISTS)
+      {
+      CloseHandle(Mapping);
+      return false;
+      }
+   Base = MapViewOfFile(Mapping, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)TotalSizeByte);
+   if (Base == NULL)
+      {
+      CloseHandle(Mapping);
+      return false;
+      }
+   Bus->Mapping = Mapping;
+#else
+   int Fd = shm_open(Name, O_CREAT | O_EXCL | O_RDWR, 0666);
+   if (Fd < 0 && errno == EEXIST && IsStale(Name))
+      {
+      shm_unlink(Name);
+      Fd = shm_open(Name, O_CREAT | O_EXCL | O_RDWR, 0666);
+      }
+   if (Fd < 0)
+      return false;
+   if (ftruncate(Fd, (off_t)TotalSizeByte) != 0)
+      {
+      close(Fd);
+      shm_unlink(Name);
+      return false;
+      }
+   Base = mmap(NULL, (size_t)TotalSizeByte, PROT_READ | PROT_WRITE, MAP_SHARED, Fd, 0);
+   close(Fd);
+   if (Base == MAP_FAILED)
+      {
+      shm_unlink(Name);
+      return false;
+      }
+#endif
+
+   /* Initialize the control region. */
+   SharedControlStruct* Ctrl = new (Base) SharedControlStruct;
+   Ctrl->Version = FRAME_BUS_VERSION;
+   Ctrl->PublisherProcessId = CurrentProcessId();
+   Ctrl->SlotCount = SlotCount;
+   Ctrl->SlotSizeByte = SlotSizeByte;
+   Ctrl->SlotStrideByte = SlotStrideByte;
+   Ctrl->SlotHeaderSizeByte = SLOT_HEADER_SIZE_BYTE;
+   Ctrl->ControlSizeByte = CONTROL_SIZE_BYTE;
+   Ctrl->PublishedCount.store(0);
+   for (MIL_INT i = 0; i < FRAME_BUS_MAX_SUBSCRIBERS; i++)
+      {
+      Ctrl->Subscribers[i].InUse.store(0);
+      Ctrl->Subscribers[i].ProcessId.store(0);
+      Ctrl->Subscribers[i].NextFrame.store(0);
+      Ctrl->Subscribers[i].FramesRead.store(0);
+      Ctrl->Subscribers[i].Overruns.store(0);
+      }
+
+   Bus->Control = Base;
+   Bus->Slots = (MIL_UINT8*)Base + CONTROL_SIZE_BYTE;
+   Bus->ControlSizeByte = CONTROL_SIZE_BYTE;
+   Bus->SlotsSizeByte = SlotsSizeByte;
+
+   for (MIL_INT i = 0; i < SlotCount; i++)
+      {
+      SharedSlotHeaderStruct* Header = new (Bus->Slots + i*SlotStrideByte) SharedSlotHeaderStruct;
+      Header->Sequence.store(0);
+      }
+
+   /* Subscribers check the magic number last, once everything else is valid. */
+   atomic_thread_fence(memory_order_release);
+   Ctrl->Magic = FRAME_BUS_MAGIC;
+   return true;
+   }
+
+/* Copies the grabbed buffer and its metadata, including its statistics when  */
+/* available, into the next slot of the ring. Never waits on subscribers.     */
+void FrameBusPublish(FrameBusStruct* Bus, MIL_ID MilBuffer, MIL_UINT64 FrameNumber, MIL_DOUBLE TimeStamp,
+                     const FrameStatsStruct* Stats)
+   {
+   SharedControlStruct* Ctrl = Control(Bus);
+   SharedSlotHeaderStruct* Header;
+   FrameBusInfoStruct Info;
+   MIL_INT SizeBand;
+
+   if (Ctrl == NULL || FrameNumber == 0)
+      return;
+
+   Info.FrameNumber = FrameNumber;
+   Info.TimeStamp = TimeStamp;
+   Info.SizeX = MbufInquire(MilBuffer, M_SIZE_X, M_NULL);
+   Info.SizeY = MbufInquire(MilBuffer, M_SIZE_Y, M_NULL);
+   Info.SizeBit = MbufInquire(MilBuffer, M_SIZE_BIT, M_NULL);
+   SizeBand = MbufInquire(MilBuffer, M_SIZE_BAND, M_NULL);
+   Info.PitchByte = Info.SizeX*((Info.SizeBit + 7)/8)*SizeBand;
+   Info.DataSizeByte = Info.PitchByte*Info.SizeY;
+   Info.Oversize = (Info.DataSizeByte > Ctrl->SlotSizeByte);
+   Info.StatsValid = (Stats != NULL);
+   if (Stats)
+      Info.Stats = *Stats;
+
+   /* A frame that does not fit is published without its data, to keep the */
+   /* frame numbers contiguous.                                             */
+   if (Info.Oversize)
+      Info.DataSizeByte = 0;
+
+   Header = SlotHeader(Bus, FrameNumber);
+
+   /* Mark the slot as being written before touching its contents. */
+   Header->Sequence.store(2*FrameNumber - 1, memory_order_relaxed);
+   atomic_thread_fence(memory_order_release);
+
+   Header->Info = Info;
+   if (!Info.Oversize)
+      MbufGet(MilBuffer, (MIL_UINT8*)Header + Ctrl->SlotHeaderSizeByte);
+
+   Header->Sequence.store(2*FrameNumber, memory_order_release);
+   Ctrl->PublishedCount.store(FrameNumber, memory_order_release);
+   }
+
+/* Prints the per-subscriber counters. */
+void FrameBusPrintStatistics(FrameBusStruct* Bus)
+   {
+   FrameBusSubscriberStatsStruct Stats[FRAME_BUS_MAX_SUBSCRIBERS];
+   MIL_INT Count = FrameBusGetSubscriberStats(Bus, Stats, FRAME_BUS_MAX_SUBSCRIBERS);
+
+   MosPrintf(MIL_TEXT("\n--------------------- Frame bus (%s) ---------------------\n\n"), Bus->Name.c_str());
+   MosPrintf(MIL_TEXT("%30s %llu\n"), MIL_TEXT("Frames published:"),
+             (unsigned long long)(Control(Bus) ? Control(Bus)->PublishedCount.load() : 0));
+
+   if (Count == 0)
+      {
+      MosPrintf(MIL_TEXT("%30s %s\n"), MIL_TEXT("Subscribers:"), MIL_TEXT("None"));
+      return;
+      }
+
+   MosPrintf(MIL_TEXT("\n%10s%-12s%-15s%-15s%-15s\n\n"), MIL_TEXT(""), MIL_TEXT("Process"), MIL_TEXT("Read"), MIL_TEXT("Overruns"), MIL_TEXT("Lag"));
+   for (MIL_INT i = 0; i < Count; i++)
+      MosPrintf(MIL_TEXT("%10s%-12lld%-15llu%-15llu%-15llu\n"), MIL_TEXT(""), (long long)Stats[i].ProcessId,
+                (unsigned long long)Stats[i].FramesRead, (unsigned long long)Stats[i].Overruns, (unsigned long long)Stats[i].Lag);
+   }
+
+/* Releases the publisher's mapping and removes the shared-memory object name. */
+/* Subscribers that still have it mapped keep their mapping until they leave.  */
+void FrameBusFree(FrameBusStruct* Bus)
+   {
+   if (Bus->Control == NULL)
+      return;
+
+#if M_MIL_USE_WINDOWS
+   UnmapViewOfFile(Bus->Control);
+   CloseHandle((HANDLE)Bus->Mapping);
+#else
+   munmap(Bus->Control, (size_t)(Bus->ControlSizeByte + Bus->SlotsSizeByte));
+   shm_unlink(Bus->Name.c_str());
+#endif
+   Bus->Control = NULL;
+   Bus->Slots = NULL;
+   Bus->Mapping = NULL;
+   }
+
+/* Maps an existing frame bus (control region read-write, slots read-only) and */
+/* claims an entry in the subscriber table.                                    */
+bool FrameBusSubscribe(const MIL_TEXT_CHAR* Name, FrameBusStruct* Bus)
+   {
+   SharedControlStruct* Ctrl = NULL;
+   MIL_INT64 SlotsSizeByte = 0;
+   void* Slots = NULL;
+
+   Bus->Mapping = NULL;
+   Bus->Control = NULL;
+   Bus->Slots = NULL;
+   Bus->SubscriberIndex = -1;
+   Bus->NextFrame = 0;
+   Bus->AcquiredSequence = 0;
+   Bus->Name = Name;
+
+#if M_MIL_USE_WINDOWS
+   HANDLE Mapping = OpenFileMapping(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, Name);
+   if (Mapping == NULL)
+      return false;
+   Ctrl = (SharedControlStruct*)MapViewOfFile(Mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, (SIZE_T)CONTROL_SIZE_BYTE);
+   if (Ctrl == NULL || Ctrl->Magic != FRAME_BUS_MAGIC || Ctrl->Version != FRAME_BUS_VERSION)
+      {
+      if (Ctrl)
+         UnmapViewOfFile(Ctrl);
+      CloseHandle(Mapping);
+      return false;
+      }
+   atomic_thread_fence(memory_order_acquire);
+   SlotsSizeByte = Ctrl->SlotStrideByte*Ctrl->SlotCount;
+   Slots = MapViewOfFile(Mapping, FILE_MAP_READ, (DWORD)(CONTROL_SIZE_BYTE >> 32),
+                         (DWORD)(CONTROL_SIZE_BYTE & 0xFFFFFFFF), (SIZE_T)SlotsSizeByte);
+   if (Slots == NULL)
+      {
+      UnmapViewOfFile(Ctrl);
+      CloseHandle(Mapping);
+      return false;
+      }
+   Bus->Mapping = Mapping;
+#else
+   int Fd = shm_open(Name, O_RDWR, 0);
+   if (Fd < 0)
+      return false;
+   Ctrl = (SharedControlStruct*)mmap(NULL, (size_t)CONTROL_SIZE_BYTE, PROT_READ | PROT_WRITE, MAP_SHARED, Fd, 0);
+   if (Ctrl == MAP_FAILED || Ctrl->Magic != FRAME_BUS_MAGIC || Ctrl->Version != FRAME_BUS_VERSION)
+      {
+      if (Ctrl != MAP_FAILED)
+         munmap(Ctrl, (size_t)CONTROL_SIZE_BYTE);
+      close(Fd);
+      return false;
+      }
+   atomic_thread_fence(memory_order_acquire);
+   SlotsSizeByte = Ctrl->SlotStrideByte*Ctrl->SlotCount;
+   Slots = mmap(NULL, (size_t)SlotsSizeByte, PROT_READ, MAP_SHARED, Fd, (off_t)CONTROL_SIZE_BYTE);
+   close(Fd);
+   if (Slots == MAP_FAILED)
+      {
+      munmap(Ctrl, (size_t)CONTROL_SIZE_BYTE);
+      return false;
+      }
+#endif
+
+   Bus->Control = Ctrl;
+   Bus->Slots = (MIL_UINT8*)Slots;
+   Bus->ControlSizeByte = CONTROL_SIZE_BYTE;
+   Bus->SlotsSizeByte = SlotsSizeByte;
+
+   /* Claim a free entry, or one left behind by a process that has exited. */
+   for (MIL_INT i = 0; i < FRAME_BUS_MAX_SUBSCRIBERS && Bus->SubscriberIndex < 0; i++)
+      {
+      SharedSubscriberStruct& Entry = Ctrl->Subscribers[i];
+      MIL_UINT32 Expected = 0;
+      bool Claimed = Entry.InUse.compare_exchange_strong(Expected, 1);
+
+      if (!Claimed && !IsProcessAlive(Entry.ProcessId.load()))
+         {
+         Expected = 1;
+         Claimed = Entry.InUse.compare_exchange_strong(Expected, 2);
+         if (Claimed)
+            Entry.InUse.store(1);
+         }
+
+      if (Claimed)
+         {
+         Bus->SubscriberIndex = i;
+         Bus->NextFrame = Ctrl->PublishedCount.load(memory_order_acquire) + 1;
+         Entry.ProcessId.store(CurrentProcessId());
+         Entry.FramesRead.store(0);
+         Entry.Overruns.store(0);
+         Entry.NextFrame.store(Bus->NextFrame);
+         }
+      }
+
+   if (Bus->SubscriberIndex < 0)
+      {
+      FrameBusUnsubscribe(Bus);
+      return false;
+      }
+   return true;
+   }
+
+/* Returns the next frame in place, without copying it. Frames overwritten     */
+/* before the subscriber could reach them are skipped and counted as overruns. */
+MIL_INT FrameBusAcquireFrame(FrameBusStruct* Bus, FrameBusFrameStruct* Frame)
+   {
+   SharedControlStruct* Ctrl = Control(Bus);
+
+   if (Ctrl == NULL || Bus->SubscriberIndex < 0)
+      return FRAME_BUS_ERROR;
+
+   SharedSubscriberStruct& Entry = Ctrl->Subscribers[Bus->SubscriberIndex];
+
+   for (;;)
+      {
+      MIL_UINT64 Published = Ctrl->PublishedCount.load(memory_order_acquire);
+
+      if (Bus->NextFrame > Published)
+         return FRAME_BUS_NO_FRAME;
+
+      /* Fell more than one ring behind: jump to the oldest frame still present. */
+      if (Published - Bus->NextFrame >= (MIL_UINT64)Ctrl->SlotCount)
+         {
+         MIL_UINT64 Oldest = Published - Ctrl->SlotCount + 1;
+         Entry.Overruns.fetch_add(Oldest - Bus->NextFrame, memory_order_relaxed);
+         Bus->NextFrame = Oldest;
+         Entry.NextFrame.store(Bus->NextFrame, memory_order_relaxed);
+         }
+
+      SharedSlotHeaderStruct* Header = SlotHeader(Bus, Bus->NextFrame);
+      MIL_UINT64 Sequence = Header->Sequence.load(memory_order_acquire);
+
+      if (Sequence == 2*Bus->NextFrame)
+         {
+         Frame->Info = Header->Info;
+         Frame->Data = (const MIL_UINT8*)Header + Ctrl->SlotHeaderSizeByte;
+         Bus->AcquiredSequence = Sequence;
+         return FRAME_BUS_FRAME_READY;
+         }
+
+      if (Sequence < 2*Bus->NextFrame)
+         return FRAME_BUS_NO_FRAME;
+
+      /* The slot already holds a newer frame. */
+      Entry.Overruns.fetch_add(1, memory_order_relaxed);
+      Bus->NextFrame++;
+      Entry.NextFrame.store(Bus->NextFrame, memory_order_relaxed);
+      }
+   }
+
+/* Ends the use of a frame returned by FrameBusAcquireFrame(). Returns false if */
+/* the publisher started overwriting the slot meanwhile, in which case the data */
+/* that was used must be discarded.                                            */
+bool FrameBusReleaseFrame(FrameBusStruct* Bus, const FrameBusFrameStruct* Frame)
+   {
+   SharedControlStruct* Ctrl = Control(Bus);
+
+   if (Ctrl == NULL || Bus->SubscriberIndex < 0 || Bus->AcquiredSequence == 0)
+      return false;
+
+   SharedSubscriberStruct& Entry = Ctrl->Subscribers[Bus->SubscriberIndex];
+   SharedSlotHeaderStruct* Header = SlotHeader(Bus, Frame->Info.FrameNumber);
+
+   atomic_thread_fence(memory_order_acquire);
+   bool Valid = (Header->Sequence.load(memory_order_relaxed) == Bus->AcquiredSequence);
+
+   if (Valid)
+      Entry.FramesRead.fetch_add(1, memory_order_relaxed);
+   else
+      Entry.Overruns.fetch_add(1, memory_order_relaxed);
+
+   Bus->AcquiredSequence = 0;
+   Bus->NextFrame = Frame->Info.FrameNumber + 1;
+   Entry.NextFrame.store(Bus->NextFrame, memory_order_relaxed);
+   return Valid;
+   }
+
+/* Frees the subscriber table entry and unmaps the frame bus. */
+void FrameBusUnsubscribe(FrameBusStruct* Bus)
+   {
+   SharedControlStruct* Ctrl = Control(Bus);
+
+   if (Ctrl == NULL)
+      return;
+
+   if (Bus->SubscriberIndex >= 0)
+      {
+      Ctrl->Subscribers[Bus->SubscriberIndex].InUse.store(0, memory_order_release);
+      Bus->SubscriberIndex = -1;
+      }
+
+#if M_MIL_USE_WINDOWS
+   if (Bus->Slots)
+      UnmapViewOfFile(Bus->Slots);
+   UnmapViewOfFile(Bus->Control);
+   CloseHandle((HANDLE)Bus->Mapping);
+#else
+   if (Bus->Slots)
+      munmap(Bus->Slots, (size_t)Bus->SlotsSizeByte);
+   munmap(Bus->Control, (size_t)Bus->ControlSizeByte);
+#endif
+   Bus->Control = NULL;
+   Bus->Slots = NULL;
+   Bus->Mapping = NULL;
+   }
+
+/* Fills Stats with the counters of the active subscribers and returns their count. */
+MIL_INT FrameBusGetSubscriberStats(FrameBusStruct* Bus, FrameBusSubscriberStatsStruct* Stats, MIL_INT MaxStats)
+   {
+   SharedControlStruct* Ctrl = Control(Bus);
+   MIL_INT Count = 0;
+
+   if (Ctrl == NULL)
+      return 0;
+
+   MIL_UINT64 Published = Ctrl->PublishedCount.load(memory_order_acquire);
+   for (MIL_INT i = 0; i < FRAME_BUS_MAX_SUBSCRIBERS && Count < MaxStats; i++)
+      {
+      SharedSubscriberStruct& Entry = Ctrl->Subscribers[i];
+      if (Entry.InUse.load(memory_order_acquire) == 0)
+         continue;
+
+      MIL_UINT64 NextFrame = Entry.NextFrame.load(memory_order_relaxed);
+      Stats[Count].ProcessId = Entry.ProcessId.load(memory_order_relaxed);
+      Stats[Count].FramesRead = Entry.FramesRead.load(memory_order_relaxed);
+      Stats[Count].Overruns = Entry.Overruns.load(memory_order_relaxed);
+      Stats[Count].Lag = (Published + 1 > NextFrame) ? (Published + 1 - NextFrame) : 0;
+      Count++;
+      }
+   return Count;
+   }
@@ -0,0 +1,101 @@
+﻿/********************************************************************************/
+/*
+* File name: FrameBus.h
+*
+* Synopsis:  Shared-memory frame bus used to hand grabbed frames and their
+*            metadata to consumers running in other processes.
+*
+*            The publisher owns a named shared-memory object made of a control
+*            region (header and subscriber table) followed by a ring of frame
+*            slots. Each slot is protected by a sequence counter: the publisher
+*            makes it odd while it writes the slot and even once the frame is
+*            complete. Subscribers map the slot ring read-only and access the
+*            frames in place; they validate the sequence counter before and after
+*            using a frame instead of locking, so they never block the publisher.
+*            A subscriber that falls more than one ring behind loses frames and
+*            has them counted as overruns in its entry of the subscriber table.
+*            A frame larger than a slot is still published, flagged Oversize
+*            and without its data, so subscribers see no gap in the numbers.
+*            There is one publisher per name: creating a bus whose publisher is
+*            still running fails.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+#ifndef FRAME_BUS_H
+#define FRAME_BUS_H
+
+#include <mil.h>
+#include "FrameStats.h"
+
+/* Maximum number of simultaneous subscribers. */
+#define FRAME_BUS_MAX_SUBSCRIBERS   16
+
+/* Return values of FrameBusAcquireFrame(). */
+#define FRAME_BUS_FRAME_READY       0
+#define FRAME_BUS_NO_FRAME          1
+#define FRAME_BUS_ERROR             2
+
+/* Metadata published with every frame. */
+typedef struct
+   {
+   MIL_UINT64 FrameNumber;       /* 1-based frame number given by the publisher.  */
+   MIL_DOUBLE TimeStamp;         /* Publisher host time stamp, in seconds.        */
+   MIL_INT64  SizeX;
+   MIL_INT64  SizeY;
+   MIL_INT64  SizeBit;
+   MIL_INT64  PitchByte;
+   MIL_INT64  DataSizeByte;      /* 0 if Oversize.                               */
+   MIL_INT64  Oversize;          /* The frame did not fit in a slot: no data.    */
+   MIL_INT64  StatsValid;        /* Stats holds the frame's statistics.          */
+   FrameStatsStruct Stats;
+   } FrameBusInfoStruct;
+
+/* Per-subscriber statistics, as seen in the subscriber table. */
+typedef struct
+   {
+   MIL_INT64  ProcessId;
+   MIL_UINT64 FramesRead;
+   MIL_UINT64 Overruns;
+   MIL_UINT64 Lag;               /* Frames published but not yet read. */
+   } FrameBusSubscriberStatsStruct;
+
+/* Publisher and subscriber handles. The contents are private to FrameBus.cpp. */
+typedef struct
+   {
+   void*      Mapping;
+   void*      Control;
+   MIL_UINT8* Slots;
+   MIL_INT64  ControlSizeByte;
+   MIL_INT64  SlotsSizeByte;
+   MIL_INT    SubscriberIndex;
+   MIL_UINT64 NextFrame;
+   MIL_UINT64 AcquiredSequence;
+   MIL_STRING Name;
+   } FrameBusStruct;
+
+/* Frame handed to a subscriber by FrameBusAcquireFrame(). Data points directly
+   in the read-only shared mapping and stays valid until FrameBusReleaseFrame(). */
+typedef struct
+   {
+   FrameBusInfoStruct Info;
+   const MIL_UINT8*   Data;
+   } FrameBusFrameStruct;
+
+/* Publisher side. */
+bool FrameBusCreate(const MIL_TEXT_CHAR* Name, MIL_INT SlotCount, MIL_INT64 SlotSizeByte, FrameBusStruct* Bus);
+void FrameBusPublish(FrameBusStruct* Bus, MIL_ID MilBuffer, MIL_UINT64 FrameNumber, MIL_DOUBLE TimeStamp,
+                     const FrameStatsStruct* Stats);
+void FrameBusPrintStatistics(FrameBusStruct* Bus);
+void FrameBusFree(FrameBusStruct* Bus);
+
+/* Subscriber side. */
+bool    FrameBusSubscribe(const MIL_TEXT_CHAR* Name, FrameBusStruct* Bus);
+MIL_INT FrameBusAcquireFrame(FrameBusStruct* Bus, FrameBusFrameStruct* Frame);
+bool    FrameBusReleaseFrame(FrameBusStruct* Bus, const FrameBusFrameStruct* Frame);
+void    FrameBusUnsubscribe(FrameBusStruct* Bus);
+
+/* Either side. */
+MIL_INT FrameBusGetSubscriberStats(FrameBusStruct* Bus, FrameBusSubscriberStatsStruct* Stats, MIL_INT MaxStats);
+
+#endif
@@ -0,0 +1,241 @@
+﻿/********************************************************************************/
+/*
+* File name: FrameProcessing.cpp
+*
+* Synopsis:  Implementation of the processing of the grabbed frames. See
+*            FrameProcessing.h.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. */
+#include "FrameProcessing.h"
+#include "Metrics.h"
+
+/* User's processing function called every time a grab buffer is modified. */
+/* -----------------------------------------------------------------------*/
+
+MIL_INT MFTYPE ProcessingFunction(MIL_INT HookType,
+                                  MIL_ID HookId,
+                                  void* HookDataPtr)
+   {
+   HookDataStruct *UserHookDataPtr = (HookDataStruct *)HookDataPtr;
+   MIL_DOUBLE StartTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+   MIL_ID ModifiedBufferId;
+   MIL_INT Corrupted = M_FALSE;
+
+   /* Retrieve the MIL_ID of the grabbed buffer, and whether it is complete. */
+   MdigGetHookInfo(HookId, M_MODIFIED_BUFFER+M_BUFFER_ID, &ModifiedBufferId);
+   if (UserHookDataPtr->MetricsDigitizer >= 0 || UserHookDataPtr->TriggerAuditPtr)
+      MdigGetHookInfo(HookId, M_CORRUPTED_FRAME, &Corrupted);
+
+   ProcessGrabbedFrame(UserHookDataPtr, ModifiedBufferId, Corrupted == M_YES, StartTime);
+   return 0;
+   }
+
+/* Body of the processing function, shared with the stream replay. */
+void ProcessGrabbedFrame(HookDataStruct* UserHookDataPtr, MIL_ID ModifiedBufferId, bool Corrupted, MIL_DOUBLE StartTime)
+   {
+   /* Number every grabbed frame, whether it is processed or not. Only this */
+   /* hook writes the count, so the recorded ids are unique.               */
+   UserHookDataPtr->ReceivedImageCount++;
+
+   /* Record and archive the block as it was grabbed. */
+   if (UserHookDataPtr->StreamCapturePtr)
+      StreamCaptureFrame(UserHookDataPtr->StreamCapturePtr, ModifiedBufferId,
+                         UserHookDataPtr->ReceivedImageCount, MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL));
+   if (UserHookDataPtr->FrameArchivePtr)
+      FrameArchiveFrame(UserHookDataPtr->FrameArchivePtr, ModifiedBufferId,
+                        UserHookDataPtr->ReceivedImageCount, StartTime);
+
+   /* Queue compressed frames for decoding; they are processed once decoded. */
+   if (UserHookDataPtr->CompressedStreamPtr)
+      CompressedStreamFrame(UserHookDataPtr->CompressedStreamPtr, ModifiedBufferId, UserHookDataPtr->ReceivedImageCount);
+   else
+      ProcessChangedFrame(UserHookDataPtr, ModifiedBufferId);
+
+   /* Count the frame and the time spent on it. */
+   if (UserHookDataPtr->MetricsDigitizer >= 0)
+      MetricsFrameProcessed(UserHookDataPtr->MetricsDigitizer, UserHookDataPtr->FrameSizeByte,
+                            MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) - StartTime, Corrupted);
+   if (UserHookDataPtr->TriggerAuditPtr)
+      TriggerAuditFrame(UserHookDataPtr->TriggerAuditPtr, Corrupted);
+
+   /* Measure the jitter, and pin the hook once the unpinned baseline is done. */
+   if (UserHookDataPtr->PlacementPtr)
+      PlacementFrame(UserHookDataPtr->PlacementPtr, StartTime, MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL));
+   }
+
+/* Processing done on every frame, whether it was grabbed or replayed. */
+void ProcessFrame(HookDataStruct* UserHookDataPtr, MIL_ID ModifiedBufferId)
+   {
+   MIL_DOUBLE FrameTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+   bool StatsValid = false;
+   bool Merged = false;
+   MIL_INT Set = -1;
+
+   if (UserHookDataPtr->ProcessedImageCount == 0)
+      UserHookDataPtr->FirstFrameTime = FrameTime;
+   UserHookDataPtr->LastFrameTime = FrameTime;
+
+   /* Compute the statistics of the frame, as grabbed, and measure their cost. */
+   if (UserHookDataPtr->ComputeFrameStats)
+      {
+      StatsValid = FrameStatsComputeBuffer(ModifiedBufferId, &UserHookDataPtr->FrameStats);
+      if (StatsValid)
+         {
+         UserHookDataPtr->StatsTime += MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) - FrameTime;
+         UserHookDataPtr->StatsPixelCount += (MIL_DOUBLE)UserHookDataPtr->FrameStats.PixelCount;
+         UserHookDataPtr->StatsFrameCount++;
+         }
+      }
+
+   /* Count the frame and publish it, with its statistics, to the other processes. */
+   UserHookDataPtr->ProcessedImageCount++;
+   if (UserHookDataPtr->FrameBusPtr)
+      FrameBusPublish(UserHookDataPtr->FrameBusPtr, ModifiedBufferId, (MIL_UINT64)UserHookDataPtr->ProcessedImageCount,
+                      FrameTime, StatsValid ? &UserHookDataPtr->FrameStats : M_NULL);
+
+   /* Let the exposure control react to the frame. */
+   if (UserHookDataPtr->AutoExposurePtr && StatsValid)
+      AutoExposureUpdate(UserHookDataPtr->AutoExposurePtr, &UserHookDataPtr->FrameStats,
+                         (MIL_UINT64)UserHookDataPtr->ProcessedImageCount, FrameTime);
+
+   /* Tag the frame with its sequencer set and merge the exposure brackets. */
+   if (UserHookDataPtr->SequencerPtr)
+      {
+      Set = SequencerFrameSet(UserHookDataPtr->SequencerPtr, (MIL_UINT64)UserHookDataPtr->ProcessedImageCount - 1);
+      if (UserHookDataPtr->HdrMergePtr && Set >= 0 && Set < (MIL_INT)UserHookDataPtr->SequencerPtr->Sets.size() &&
+          HdrMergeAdd(UserHookDataPtr->HdrMergePtr, ModifiedBufferId, Set, UserHookDataPtr->SequencerPtr->Sets[Set].ExposureTime))
+         {
+         HdrMergeToneMap(UserHookDataPtr->HdrMergePtr, UserHookDataPtr->MilImageDisp);
+         Merged = true;
+         }
+      }
+
+   /* Print the frame count. */
+   if (Set >= 0)
+      MosPrintf(MIL_TEXT("Processing frame #%lld (set %d).\r"), (long long)UserHookDataPtr->ProcessedImageCount, (int)Set);
+   else
+      MosPrintf(MIL_TEXT("Processing frame #%lld.\r"), (long long)UserHookDataPtr->ProcessedImageCount);
+
+   /* Update the display, with the merged images only when merging, and annotate the copy. */
+   if (!UserHookDataPtr->OverlayPtr)
+      {
+      if (!UserHookDataPtr->HdrMergePtr)
+         MbufCopy(ModifiedBufferId, UserHookDataPtr->MilImageDisp);
+      }
+   else if (OverlayFrame(UserHookDataPtr->OverlayPtr, FrameTime) || Merged)
+      {
+      if (!UserHookDataPtr->HdrMergePtr)
+         MbufCopy(ModifiedBufferId, UserHookDataPtr->MilImageDisp);
+      if (!UserHookDataPtr->HdrMergePtr || Merged)
+         DrawOverlay(UserHookDataPtr, Set, StatsValid, FrameTime);
+      }
+   }
+
+/* Draws the frame count, frame rate, time stamp and statistics on the display. */
+void DrawOverlay(HookDataStruct* UserHookDataPtr, MIL_INT Set, bool StatsValid, MIL_DOUBLE FrameTime)
+   {
+   MIL_TEXT_CHAR Text[4][OVERLAY_LINE_LENGTH_MAX];
+   const MIL_TEXT_CHAR* Lines[4] = {Text[0], Text[1], Text[2], Text[3]};
+   const FrameStatsStruct& Stats = UserHookDataPtr->FrameStats;
+   MIL_INT LineCount = 3;
+
+   if (Set >= 0)
+      MosSprintf(Text[0], OVERLAY_LINE_LENGTH_MAX, MIL_TEXT("#%lld (set %d)"),
+                 (long long)UserHookDataPtr->ProcessedImageCount, (int)Set);
+   else
+      MosSprintf(Text[0], OVERLAY_LINE_LENGTH_MAX, MIL_TEXT("#%lld"), (long long)UserHookDataPtr->ProcessedImageCount);
+   MosSprintf(Text[1], OVERLAY_LINE_LENGTH_MAX, MIL_TEXT("%.1f fps"), UserHookDataPtr->OverlayPtr->FrameRate);
+   MosSprintf(Text[2], OVERLAY_LINE_LENGTH_MAX, MIL_TEXT("t %.3f s"), FrameTime - UserHookDataPtr->FirstFrameTime);
+   if (StatsValid)
+      {
+      MosSprintf(Text[3], OVERLAY_LINE_LENGTH_MAX, MIL_TEXT("mean %.1f min %.0f max %.0f"),
+                 Stats.Mean, (double)Stats.Min, (double)Stats.Max);
+      LineCount++;
+      }
+   OverlayDraw(UserHookDataPtr->OverlayPtr, UserHookDataPtr->MilImageDisp, Lines, LineCount);
+   }
+
+/* Processes the frame unless it did not change since the last processed one. */
+void ProcessChangedFrame(HookDataStruct* UserHookDataPtr, MIL_ID ModifiedBufferId)
+   {
+   MIL_DOUBLE StartTime;
+
+   if (UserHookDataPtr->ChangeDetectPtr && !ChangeDetectFrame(UserHookDataPtr->ChangeDetectPtr, ModifiedBufferId))
+      return;
+
+   StartTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+   ProcessFrame(UserHookDataPtr, ModifiedBufferId);
+   if (UserHookDataPtr->ChangeDetectPtr)
+      ChangeDetectProcessed(UserHookDataPtr->ChangeDetectPtr, MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) - StartTime);
+   }
+
+/* Processes the decoded compressed frames, in the order they were grabbed. */
+void DecodedFrameFunction(MIL_ID MilDecodedBuffer, MIL_UINT64 FrameNumber, void* HookDataPtr)
+   {
+   ProcessChangedFrame((HookDataStruct*)HookDataPtr, MilDecodedBuffer);
+   }
+
+/* Initializes the User's processing function data structure. */
+void InitHookData(HookDataStruct* UserHookDataPtr, MIL_ID MilDigitizer, MIL_ID MilImageDisp, bool ComputeFrameStats)
+   {
+   UserHookDataPtr->MilDigitizer        = MilDigitizer;
+   UserHookDataPtr->MilImageDisp        = MilImageDisp;
+   UserHookDataPtr->ProcessedImageCount = 0;
+   UserHookDataPtr->FrameBusPtr         = M_NULL;
+   UserHookDataPtr->StreamCapturePtr    = M_NULL;
+   UserHookDataPtr->FrameArchivePtr     = M_NULL;
+   UserHookDataPtr->CompressedStreamPtr = M_NULL;
+   UserHookDataPtr->ReceivedImageCount  = 0;
+   UserHookDataPtr->ChangeDetectPtr     = M_NULL;
+   UserHookDataPtr->PlacementPtr        = M_NULL;
+   UserHookDataPtr->OverlayPtr          = M_NULL;
+   UserHookDataPtr->TriggerAuditPtr     = M_NULL;
+   UserHookDataPtr->AutoExposurePtr     = M_NULL;
+   UserHookDataPtr->SequencerPtr        = M_NULL;
+   UserHookDataPtr->HdrMergePtr         = M_NULL;
+   UserHookDataPtr->MetricsDigitizer    = -1;
+   UserHookDataPtr->FrameSizeByte       = 0;
+   UserHookDataPtr->ComputeFrameStats   = ComputeFrameStats;
+   UserHookDataPtr->StatsFrameCount     = 0;
+   UserHookDataPtr->StatsTime           = 0.0;
+   UserHookDataPtr->StatsPixelCount     = 0.0;
+   UserHookDataPtr->FirstFrameTime      = 0.0;
+   UserHookDataPtr->LastFrameTime       = 0.0;
+   }
+
+/* Prints the statistics of the last frame and the cost of computing them */
+/* compared to the time available per frame.                              */
+void PrintFrameStatsSummary(HookDataStruct* UserHookDataPtr)
+   {
+   const FrameStatsStruct& Stats = UserHookDataPtr->FrameStats;
+
+   if (UserHookDataPtr->StatsFrameCount == 0)
+      return;
+
+   MosPrintf(MIL_TEXT("\n\n--------------------- Frame statistics ---------------------\n\n"));
+   MosPrintf(MIL_TEXT("%30s %lld\n"), MIL_TEXT("Frames analyzed:"), (long long)UserHookDataPtr->StatsFrameCount);
+   MosPrintf(MIL_TEXT("%30s %.1f\n"), MIL_TEXT("Last frame mean:"), Stats.Mean);
+   MosPrintf(MIL_TEXT("%30s %u / %u\n"), MIL_TEXT("Last frame min / max:"), (unsigned int)Stats.Min, (unsigned int)Stats.Max);
+   MosPrintf(MIL_TEXT("%30s %llu (%.2f%%)\n"), MIL_TEXT("Last frame saturated pixels:"), (unsigned long long)Stats.SaturatedCount,
+             Stats.PixelCount ? 100.0*Stats.SaturatedCount/Stats.PixelCount : 0.0);
+   MosPrintf(MIL_TEXT("%30s %.1f\n"), MIL_TEXT("Last frame sharpness:"), Stats.Sharpness);
+
+   MIL_DOUBLE TimePerFrame = UserHookDataPtr->StatsTime/UserHookDataPtr->StatsFrameCount;
+   MosPrintf(MIL_TEXT("\n%30s %.3f ms\n"), MIL_TEXT("Cost per frame:"), 1000.0*TimePerFrame);
+   MosPrintf(MIL_TEXT("%30s %.3f ms\n"), MIL_TEXT("Cost per megapixel:"),
+             1000.0*UserHookDataPtr->StatsTime/(UserHookDataPtr->StatsPixelCount/1000000.0));
+
+   /* The frame budget is the average time between processed frames. */
+   if (UserHookDataPtr->ProcessedImageCount > 1)
+      {
+      MIL_DOUBLE FramePeriod = (UserHookDataPtr->LastFrameTime - UserHookDataPtr->FirstFrameTime)/
+                               (UserHookDataPtr->ProcessedImageCount - 1);
+      if (FramePeriod > 0.0)
+         MosPrintf(MIL_TEXT("%30s %.3f ms (%.1f%% used)\n"), MIL_TEXT("Frame budget:"), 1000.0*FramePeriod,
+                   100.0*TimePerFrame/FramePeriod);
+      }
+   }
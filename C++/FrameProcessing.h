@@ -0,0 +1,94 @@
+﻿/********************************************************************************/
+/*
+* File name: FrameProcessing.h
+*
+* Synopsis:  Processing of the grabbed frames: the MdigProcess() hook of the
+*            MilGige example and the processing done on every frame, grabbed,
+*            decoded or replayed.
+*
+*            The hook records, archives or queues the frame for decoding as
+*            configured in the hook data, then processes it: frame
+*            statistics, publication on the frame bus, exposure control,
+*            sequencer tagging and HDR merge, and the display with its
+*            overlay. The optional steps run only when their pointer in the
+*            hook data is set.
+*
+*            The benchmark of the bench directory calls the same functions,
+*            so that it times the code that runs in the example.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+#ifndef FRAME_PROCESSING_H
+#define FRAME_PROCESSING_H
+
+#include <mil.h>
+#include "FrameBus.h"
+#include "StreamCapture.h"
+#include "FrameStats.h"
+#include "AutoExposure.h"
+#include "FrameArchive.h"
+#include "Sequencer.h"
+#include "CompressedStream.h"
+#include "ChangeDetect.h"
+#include "Placement.h"
+#include "Overlay.h"
+#include "TriggerAudit.h"
+
+/* Processing function hook data. */
+typedef struct
+   {
+   MIL_ID  MilDigitizer;
+   MIL_ID  MilImageDisp;
+   MIL_INT ProcessedImageCount;
+   FrameBusStruct* FrameBusPtr;
+   StreamCaptureStruct* StreamCapturePtr;
+   FrameArchiveStruct* FrameArchivePtr;
+   CompressedStreamStruct* CompressedStreamPtr;
+   MIL_UINT64 ReceivedImageCount;
+   ChangeDetectStruct* ChangeDetectPtr;
+   PlacementStruct* PlacementPtr;
+   OverlayStruct* OverlayPtr;
+   TriggerAuditStruct* TriggerAuditPtr;
+   AutoExposureStruct* AutoExposurePtr;
+   SequencerStruct* SequencerPtr;
+   HdrMergeStruct* HdrMergePtr;
+   MIL_INT MetricsDigitizer;
+   MIL_INT64 FrameSizeByte;
+
+   /* Statistics of the last frame and their cost. */
+   bool             ComputeFrameStats;
+   FrameStatsStruct FrameStats;
+   MIL_INT          StatsFrameCount;
+   MIL_DOUBLE       StatsTime;
+   MIL_DOUBLE       StatsPixelCount;
+   MIL_DOUBLE       FirstFrameTime;
+   MIL_DOUBLE       LastFrameTime;
+   } HookDataStruct;
+
+/* Initializes the hook data, with no optional processing but the frame */
+/* statistics if ComputeFrameStats.                                     */
+void InitHookData(HookDataStruct* UserHookDataPtr, MIL_ID MilDigitizer, MIL_ID MilImageDisp, bool ComputeFrameStats);
+void PrintFrameStatsSummary(HookDataStruct* UserHookDataPtr);
+
+/* User's processing function prototype. */
+MIL_INT MFTYPE ProcessingFunction(MIL_INT HookType,
+                                  MIL_ID HookId,
+                                  void* HookDataPtr);
+
+/* Body of the processing function: records, archives, decodes and         */
+/* processes the frame. The stream replay calls it for every replayed frame, */
+/* so replayed frames take the same path as grabbed ones.                   */
+void ProcessGrabbedFrame(HookDataStruct* UserHookDataPtr, MIL_ID ModifiedBufferId, bool Corrupted, MIL_DOUBLE StartTime);
+
+/* Processing done on every frame, grabbed or replayed. */
+void ProcessFrame(HookDataStruct* UserHookDataPtr, MIL_ID ModifiedBufferId);
+void DrawOverlay(HookDataStruct* UserHookDataPtr, MIL_INT Set, bool StatsValid, MIL_DOUBLE FrameTime);
+
+/* Processing of the frames that changed. */
+void ProcessChangedFrame(HookDataStruct* UserHookDataPtr, MIL_ID ModifiedBufferId);
+
+/* Processing of the decoded compressed frames. */
+void DecodedFrameFunction(MIL_ID MilDecodedBuffer, MIL_UINT64 FrameNumber, void* HookDataPtr);
+
+#endif
@@ -0,0 +1,285 @@
+﻿/********************************************************************************/
+/*
+* File name: FrameStats.cpp
+*
+* Synopsis:  Implementation of the per-frame image statistics. See FrameStats.h.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. */
+#include "FrameStats.h"
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRAME_STATS_USE_SSE2  1
+#include <emmintrin.h>
+#else
+#define FRAME_STATS_USE_SSE2  0
+#endif
+
+/* The histogram is accumulated in 4 interleaved sub-histograms so that */
+/* runs of equal pixels do not serialize on the same counter.           */
+#define SUB_HISTOGRAM_COUNT   4
+
+static void ResetStats(FrameStatsStruct* Stats, MIL_INT SizeBit)
+   {
+   memset(Stats, 0, sizeof(*Stats));
+   Stats->SizeBit = SizeBit;
+   }
+
+/* Counts the 8 bins packed one per byte in Bins. The bins are taken from */
+/* a 64-bit integer rather than reloaded byte by byte from a stored       */
+/* vector, which would stall on every load.                               */
+static inline void CountBins(MIL_UINT32 SubHistograms[SUB_HISTOGRAM_COUNT][FRAME_STATS_HISTOGRAM_SIZE], MIL_UINT64 Bins)
+   {
+   SubHistograms[0][Bins & 0xFF]++;
+   SubHistograms[1][(Bins >> 8) & 0xFF]++;
+   SubHistograms[2][(Bins >> 16) & 0xFF]++;
+   SubHistograms[3][(Bins >> 24) & 0xFF]++;
+   SubHistograms[0][(Bins >> 32) & 0xFF]++;
+   SubHistograms[1][(Bins >> 40) & 0xFF]++;
+   SubHistograms[2][(Bins >> 48) & 0xFF]++;
+   SubHistograms[3][Bins >> 56]++;
+   }
+
+static void MergeHistograms(MIL_UINT32 SubHistograms[SUB_HISTOGRAM_COUNT][FRAME_STATS_HISTOGRAM_SIZE],
+                            FrameStatsStruct* Stats)
+   {
+   for (MIL_INT i = 0; i < FRAME_STATS_HISTOGRAM_SIZE; i++)
+      Stats->Histogram[i] = SubHistograms[0][i] + SubHistograms[1][i] + SubHistograms[2][i] + SubHistograms[3][i];
+   }
+
+/* 8-bit kernel. */
+void FrameStatsCompute8(const MIL_UINT8* Data, MIL_INT SizeX, MIL_INT SizeY, MIL_INT PitchByte,
+                        FrameStatsStruct* Stats)
+   {
+   MIL_UINT32 SubHistograms[SUB_HISTOGRAM_COUNT][FRAME_STATS_HISTOGRAM_SIZE];
+   MIL_UINT64 Sum = 0, GradientSum = 0, Saturated = 0;
+   MIL_UINT32 Min = 0xFF, Max = 0;
+
+   ResetStats(Stats, 8);
+   if (SizeX <= 0 || SizeY <= 0)
+      return;
+   memset(SubHistograms, 0, sizeof(SubHistograms));
+
+#if FRAME_STATS_USE_SSE2
+   const __m128i Zero = _mm_setzero_si128();
+   const __m128i One = _mm_set1_epi8(1);
+   const __m128i Full = _mm_set1_epi8((char)0xFF);
+   __m128i VMin = Full, VMax = Zero;
+#endif
+
+   for (MIL_INT y = 0; y < SizeY; y++)
+      {
+      const MIL_UINT8* Row = Data + y*PitchByte;
+      MIL_INT x = 0;
+
+#if FRAME_STATS_USE_SSE2
+      __m128i RowSum = Zero, RowSaturated = Zero, RowGradient = Zero;
+
+      /* Vector part; the gradient needs the next pixel so the last vector */
+      /* of the row is left to the scalar part.                           */
+      for (; x + 16 < SizeX; x += 16)
+         {
+         __m128i V = _mm_loadu_si128((const __m128i*)(Row + x));
+         __m128i Next = _mm_loadu_si128((const __m128i*)(Row + x + 1));
+         __m128i Diff = _mm_or_si128(_mm_subs_epu8(V, Next), _mm_subs_epu8(Next, V));
+         __m128i DiffLo = _mm_unpacklo_epi8(Diff, Zero);
+         __m128i DiffHi = _mm_unpackhi_epi8(Diff, Zero);
+         MIL_UINT64 Pixels[2];
+
+         VMin = _mm_min_epu8(VMin, V);
+         VMax = _mm_max_epu8(VMax, V);
+         RowSum = _mm_add_epi64(RowSum, _mm_sad_epu8(V, Zero));
+         RowSaturated = _mm_add_epi64(RowSaturated, _mm_sad_epu8(_mm_and_si128(_mm_cmpeq_epi8(V, Full), One), Zero));
+         RowGradient = _mm_add_epi32(RowGradient, _mm_add_epi32(_mm_madd_epi16(DiffLo, DiffLo), _mm_madd_epi16(DiffHi, DiffHi)));
+
+         memcpy(Pixels, Row + x, sizeof(Pixels));
+         CountBins(SubHistograms, Pixels[0]);
+         CountBins(SubHistograms, Pixels[1]);
+         }
+
+      /* Fold the row accumulators. A row's squared gradients fit in 32 bits */
+      /* per lane for any realistic sensor width.                             */
+      MIL_UINT64 Lanes64[2];
+      MIL_UINT32 Lanes32[4];
+      _mm_storeu_si128((__m128i*)Lanes64, RowSum);
+      Sum += Lanes64[0] + Lanes64[1];
+      _mm_storeu_si128((__m128i*)Lanes64, RowSaturated);
+      Saturated += Lanes64[0] + Lanes64[1];
+      _mm_storeu_si128((__m128i*)Lanes32, RowGradient);
+      GradientSum += (MIL_UINT64)Lanes32[0] + Lanes32[1] + Lanes32[2] + Lanes32[3];
+#endif
+
+      /* Scalar part. */
+      for (; x < SizeX; x++)
+         {
+         MIL_UINT32 Pixel = Row[x];
+         SubHistograms[x & (SUB_HISTOGRAM_COUNT - 1)][Pixel]++;
+         Sum += Pixel;
+         Min = (Pixel < Min) ? Pixel : Min;
+         Max = (Pixel > Max) ? Pixel : Max;
+         Saturated += (Pixel == 0xFF);
+         if (x + 1 < SizeX)
+            {
+            MIL_INT Diff = (MIL_INT)Row[x + 1] - (MIL_INT)Pixel;
+            GradientSum += (MIL_UINT64)(Diff*Diff);
+            }
+         }
+      }
+
+#if FRAME_STATS_USE_SSE2
+   MIL_UINT8 Lanes[16];
+   _mm_storeu_si128((__m128i*)Lanes, VMin);
+   for (MIL_INT i = 0; i < 16; i++)
+      Min = (Lanes[i] < Min) ? Lanes[i] : Min;
+   _mm_storeu_si128((__m128i*)Lanes, VMax);
+   for (MIL_INT i = 0; i < 16; i++)
+      Max = (Lanes[i] > Max) ? Lanes[i] : Max;
+#endif
+
+   MergeHistograms(SubHistograms, Stats);
+   Stats->PixelCount = SizeX*SizeY;
+   Stats->Min = Min;
+   Stats->Max = Max;
+   Stats->Mean = (MIL_DOUBLE)Sum/Stats->PixelCount;
+   Stats->SaturatedCount = Saturated;
+   Stats->Sharpness = (SizeX > 1) ? (MIL_DOUBLE)GradientSum/((SizeX - 1)*SizeY) : 0.0;
+   }
+
+/* 16-bit kernel. SSE2 has no unsigned 16-bit min/max, so the pixels are */
+/* biased by 0x8000 into the signed range for those operations.          */
+void FrameStatsCompute16(const MIL_UINT16* Data, MIL_INT SizeX, MIL_INT SizeY, MIL_INT PitchByte,
+                         MIL_INT SizeBit, FrameStatsStruct* Stats)
+   {
+   MIL_UINT32 SubHistograms[SUB_HISTOGRAM_COUNT][FRAME_STATS_HISTOGRAM_SIZE];
+   MIL_UINT64 Sum = 0, GradientSum = 0, Saturated = 0;
+   MIL_UINT32 Min = 0xFFFF, Max = 0;
+
+   if (SizeBit < 9 || SizeBit > 16)
+      SizeBit = 16;
+   const MIL_UINT32 SaturationLevel = (1U << SizeBit) - 1;
+   const int BinShift = (int)SizeBit - 8;
+
+   ResetStats(Stats, SizeBit);
+   if (SizeX <= 0 || SizeY <= 0)
+      return;
+   memset(SubHistograms, 0, sizeof(SubHistograms));
+
+#if FRAME_STATS_USE_SSE2
+   const __m128i Zero = _mm_setzero_si128();
+   const __m128i Bias = _mm_set1_epi16((short)0x8000);
+   const __m128i Ones = _mm_set1_epi16(1);
+   const __m128i VSaturation = _mm_set1_epi16((short)SaturationLevel);
+   const __m128i BinMax = _mm_set1_epi16(FRAME_STATS_HISTOGRAM_SIZE - 1);
+   const __m128i VShift = _mm_cvtsi32_si128(BinShift);
+   __m128i VMin = _mm_set1_epi16(0x7FFF), VMax = _mm_set1_epi16((short)0x8000);
+#endif
+
+   for (MIL_INT y = 0; y < SizeY; y++)
+      {
+      const MIL_UINT16* Row = (const MIL_UINT16*)((const MIL_UINT8*)Data + y*PitchByte);
+      MIL_INT x = 0;
+
+#if FRAME_STATS_USE_SSE2
+      __m128i RowSum = Zero, RowGradient = Zero, RowSaturated = Zero;
+      MIL_INT RowVectorPixels = 0;
+
+      for (; x + 8 < SizeX; x += 8)
+         {
+         __m128i V = _mm_loadu_si128((const __m128i*)(Row + x));
+         __m128i Next = _mm_loadu_si128((const __m128i*)(Row + x + 1));
+         __m128i Biased = _mm_xor_si128(V, Bias);
+         __m128i Diff = _mm_or_si128(_mm_subs_epu16(V, Next), _mm_subs_epu16(Next, V));
+         __m128i DiffLo = _mm_unpacklo_epi16(Diff, Zero);
+         __m128i DiffHi = _mm_unpackhi_epi16(Diff, Zero);
+         __m128i Bins = _mm_srl_epi16(V, VShift);
+         MIL_UINT64 BinValues;
+
+         VMin = _mm_min_epi16(VMin, Biased);
+         VMax = _mm_max_epi16(VMax, Biased);
+         RowSum = _mm_add_epi32(RowSum, _mm_madd_epi16(Biased, Ones));
+         RowSaturated = _mm_sub_epi16(RowSaturated, _mm_cmpeq_epi16(V, VSaturation));
+
+         /* Squares of the 16-bit differences need 32 bits each; accumulate */
+         /* them in 64-bit lanes.                                           */
+         RowGradient = _mm_add_epi64(RowGradient, _mm_mul_epu32(DiffLo, DiffLo));
+         RowGradient = _mm_add_epi64(RowGradient, _mm_mul_epu32(_mm_srli_epi64(DiffLo, 32), _mm_srli_epi64(DiffLo, 32)));
+         RowGradient = _mm_add_epi64(RowGradient, _mm_mul_epu32(DiffHi, DiffHi));
+         RowGradient = _mm_add_epi64(RowGradient, _mm_mul_epu32(_mm_srli_epi64(DiffHi, 32), _mm_srli_epi64(DiffHi, 32)));
+
+         /* Pixels above the significant bit depth go in the last bin. The */
+         /* bins are packed to bytes and counted from one 64-bit store.    */
+         Bins = _mm_xor_si128(_mm_min_epi16(_mm_xor_si128(Bins, Bias), _mm_xor_si128(BinMax, Bias)), Bias);
+         _mm_storel_epi64((__m128i*)&BinValues, _mm_packus_epi16(Bins, Bins));
+         CountBins(SubHistograms, BinValues);
+         RowVectorPixels += 8;
+         }
+
+      /* The biased sum is signed; remove the bias of every vector pixel. */
+      MIL_INT32 Lanes32[4];
+      MIL_UINT64 Lanes64[2];
+      _mm_storeu_si128((__m128i*)Lanes32, RowSum);
+      Sum += (MIL_UINT64)((MIL_INT64)Lanes32[0] + Lanes32[1] + Lanes32[2] + Lanes32[3] + 0x8000LL*RowVectorPixels);
+      _mm_storeu_si128((__m128i*)Lanes64, RowGradient);
+      GradientSum += Lanes64[0] + Lanes64[1];
+      _mm_storeu_si128((__m128i*)Lanes32, _mm_madd_epi16(RowSaturated, Ones));
+      Saturated += (MIL_UINT64)((MIL_INT64)Lanes32[0] + Lanes32[1] + Lanes32[2] + Lanes32[3]);
+#endif
+
+      for (; x < SizeX; x++)
+         {
+         MIL_UINT32 Pixel = Row[x];
+         MIL_UINT32 Bin = Pixel >> BinShift;
+         SubHistograms[x & (SUB_HISTOGRAM_COUNT - 1)][(Bin < FRAME_STATS_HISTOGRAM_SIZE) ? Bin : FRAME_STATS_HISTOGRAM_SIZE - 1]++;
+         Sum += Pixel;
+         Min = (Pixel < Min) ? Pixel : Min;
+         Max = (Pixel > Max) ? Pixel : Max;
+         Saturated += (Pixel == SaturationLevel);
+         if (x + 1 < SizeX)
+            {
+            MIL_INT64 Diff = (MIL_INT64)Row[x + 1] - (MIL_INT64)Pixel;
+            GradientSum += (MIL_UINT64)(Diff*Diff);
+            }
+         }
+      }
+
+#if FRAME_STATS_USE_SSE2
+   MIL_UINT16 Lanes[8];
+   _mm_storeu_si128((__m128i*)Lanes, _mm_xor_si128(VMin, Bias));
+   for (MIL_INT i = 0; i < 8; i++)
+      Min = (Lanes[i] < Min) ? Lanes[i] : Min;
+   _mm_storeu_si128((__m128i*)Lanes, _mm_xor_si128(VMax, Bias));
+   for (MIL_INT i = 0; i < 8; i++)
+      Max = (Lanes[i] > Max) ? Lanes[i] : Max;
+#endif
+
+   MergeHistograms(SubHistograms, Stats);
+   Stats->PixelCount = SizeX*SizeY;
+   Stats->Min = Min;
+   Stats->Max = Max;
+   Stats->Mean = (MIL_DOUBLE)Sum/Stats->PixelCount;
+   Stats->SaturatedCount = Saturated;
+   Stats->Sharpness = (SizeX > 1) ? (MIL_DOUBLE)GradientSum/((SizeX - 1)*SizeY) : 0.0;
+   }
+
+bool FrameStatsComputeBuffer(MIL_ID MilBuffer, FrameStatsStruct* Stats)
+   {
+   void* HostAddress = M_NULL;
+   MIL_INT SizeX = MbufInquire(MilBuffer, M_SIZE_X, M_NULL);
+   MIL_INT SizeY = MbufInquire(MilBuffer, M_SIZE_Y, M_NULL);
+   MIL_INT SizeBit = MbufInquire(MilBuffer, M_SIZE_BIT, M_NULL);
+   MIL_INT PitchByte = MbufInquire(MilBuffer, M_PITCH_BYTE, M_NULL);
+
+   MbufInquire(MilBuffer, M_HOST_ADDRESS, &HostAddress);
+   if (HostAddress == M_NULL)
+      return false;
+
+   if (SizeBit <= 8)
+      FrameStatsCompute8((const MIL_UINT8*)HostAddress, SizeX, SizeY, PitchByte, Stats);
+   else
+      FrameStatsCompute16((const MIL_UINT16*)HostAddress, SizeX, SizeY, PitchByte, SizeBit, Stats);
+   return true;
+   }
@@ -0,0 +1,55 @@
+﻿/********************************************************************************/
+/*
+* File name: FrameStats.h
+*
+* Synopsis:  Per-frame image statistics computed in a single pass over the
+*            grab buffer: intensity histogram, mean, minimum, maximum,
+*            saturated pixel count and a sharpness (focus) metric.
+*
+*            The sharpness is the mean squared difference between horizontally
+*            adjacent pixels, in pixel units squared. It increases as the image
+*            gets sharper and is meant to be compared between frames of the same
+*            scene and pixel depth.
+*
+*            On x86-64 the kernels use SSE2 for the minimum, maximum, sum,
+*            saturation and gradient terms. The histogram is accumulated in
+*            the same pass, in interleaved sub-histograms, with the bins taken
+*            8 at a time from 64-bit words.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <mil.h>
+
+/* Number of histogram bins. 16-bit pixels are binned on their 8 most */
+/* significant bits.                                                  */
+#define FRAME_STATS_HISTOGRAM_SIZE  256
+
+typedef struct
+   {
+   MIL_INT64  PixelCount;
+   MIL_INT64  SizeBit;
+   MIL_UINT32 Min;
+   MIL_UINT32 Max;
+   MIL_DOUBLE Mean;
+   MIL_UINT64 SaturatedCount;
+   MIL_DOUBLE Sharpness;
+   MIL_UINT32 Histogram[FRAME_STATS_HISTOGRAM_SIZE];
+   } FrameStatsStruct;
+
+/* Kernels on raw pixel data. For 16-bit data, SizeBit is the number of */
+/* significant bits (for example 12 for Mono12), which sets the         */
+/* saturation level and the histogram binning.                          */
+void FrameStatsCompute8(const MIL_UINT8* Data, MIL_INT SizeX, MIL_INT SizeY, MIL_INT PitchByte,
+                        FrameStatsStruct* Stats);
+void FrameStatsCompute16(const MIL_UINT16* Data, MIL_INT SizeX, MIL_INT SizeY, MIL_INT PitchByte,
+                         MIL_INT SizeBit, FrameStatsStruct* Stats);
+
+/* Computes the statistics of the first band of a MIL buffer. Returns false */
+/* if the buffer is not accessible from the host.                          */
+bool FrameStatsComputeBuffer(MIL_ID MilBuffer, FrameStatsStruct* Stats);
+
+#endif
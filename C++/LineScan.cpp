@@ -0,0 +1,297 @@
+﻿/********************************************************************************/
+/*
+* File name: LineScan.cpp
+*
+* Synopsis:  Implementation of the line-scan ring. See LineScan.h.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. */
+#include "FeatureAccess.h"
+#include "LineScan.h"
+
+using namespace std;
+
+/* Lines of the ring that consumers can still read behind the last published line. */
+static MIL_UINT64 SafeLines(const LineScanRingStruct* Ring)
+   {
+   return (MIL_UINT64)(Ring->MilBlocks.size() - LINESCAN_GUARD_BLOCKS)*Ring->BlockLines;
+   }
+
+/* Mean intensity of one line, as a fraction of full scale. */
+static MIL_DOUBLE LineMean(const LineScanRingStruct* Ring, const MIL_UINT8* Line)
+   {
+   MIL_UINT64 Sum = 0;
+
+   if (Ring->SizeBit <= 8)
+      {
+      for (MIL_INT x = 0; x < Ring->SizeX; x++)
+         Sum += Line[x];
+      }
+   else
+      {
+      const MIL_UINT16* Line16 = (const MIL_UINT16*)Line;
+      for (MIL_INT x = 0; x < Ring->SizeX; x++)
+         Sum += Line16[x];
+      }
+   return (MIL_DOUBLE)Sum/((MIL_DOUBLE)Ring->SizeX*(MIL_DOUBLE)((1ULL << Ring->SizeBit) - 1));
+   }
+
+static void EndObject(LineScanRingStruct* Ring, MIL_UINT64 EndLine)
+   {
+   MIL_UINT64 Lines = EndLine - Ring->ObjectFirstLine;
+
+   Ring->ObjectCount++;
+   Ring->ObjectLinesTotal += Lines;
+   if (Ring->ObjectCount == 1 || Lines < Ring->ObjectLinesMin)
+      Ring->ObjectLinesMin = Lines;
+   if (Lines > Ring->ObjectLinesMax)
+      Ring->ObjectLinesMax = Lines;
+   Ring->CurrentObject = 0;
+   }
+
+/* Allocates the ring and its BlockCount grab buffers. Each block has the */
+/* digitizer's current height (the camera's Height feature) in lines.    */
+bool LineScanRingAlloc(MIL_ID MilSystem, MIL_ID MilDigitizer, MIL_INT BlockCount, MIL_DOUBLE ObjectThreshold,
+                       MIL_INT MinGapLines, LineScanRingStruct* Ring)
+   {
+   MIL_INT Type = FeatureAccessMdigInquire(MilDigitizer, M_TYPE, M_NULL);
+
+   Ring->MilRing = M_NULL;
+   Ring->MilBlocks.clear();
+   Ring->SizeX = FeatureAccessMdigInquire(MilDigitizer, M_SIZE_X, M_NULL);
+   Ring->BlockLines = FeatureAccessMdigInquire(MilDigitizer, M_SIZE_Y, M_NULL);
+   Ring->SizeBit = FeatureAccessMdigInquire(MilDigitizer, M_SIZE_BIT, M_NULL);
+   Ring->RingLines = (MIL_INT64)BlockCount*Ring->BlockLines;
+
+   /* The ring holds monochrome lines; the blocks must be able to wrap. */
+   if (FeatureAccessMdigInquire(MilDigitizer, M_SIZE_BAND, M_NULL) != 1 || BlockCount <= LINESCAN_GUARD_BLOCKS ||
+       Ring->BlockLines <= 0 || Ring->SizeX <= 0)
+      return false;
+
+   MbufAlloc2d(MilSystem, Ring->SizeX, Ring->RingLines, Type, M_IMAGE+M_GRAB+M_PROC, &Ring->MilRing);
+   if (Ring->MilRing == M_NULL)
+      return false;
+   Ring->RingAddress = (MIL_UINT8*)MbufInquire(Ring->MilRing, M_HOST_ADDRESS, M_NULL);
+   Ring->PitchByte = MbufInquire(Ring->MilRing, M_PITCH_BYTE, M_NULL);
+   if (Ring->RingAddress == M_NULL)
+      {
+      MbufFree(Ring->MilRing);
+      Ring->MilRing = M_NULL;
+      return false;
+      }
+   MbufClear(Ring->MilRing, 0);
+
+   for (MIL_INT b = 0; b < BlockCount; b++)
+      {
+      MIL_ID MilBlock = M_NULL;
+      MbufChild2d(Ring->MilRing, 0, b*Ring->BlockLines, Ring->SizeX, Ring->BlockLines, &MilBlock);
+      if (MilBlock == M_NULL)
+         {
+         LineScanRingFree(Ring);
+         return false;
+         }
+      Ring->MilBlocks.push_back(MilBlock);
+      }
+
+   Ring->LineObject.assign((size_t)Ring->RingLines, 0);
+   Ring->WrittenLines.store(0);
+   Ring->Stopped.store(false);
+   Ring->ObjectThreshold = ObjectThreshold;
+   Ring->MinGapLines = MinGapLines;
+   Ring->CurrentObject = Ring->ObjectFirstLine = Ring->LastObjectId = 0;
+   Ring->GapLines = 0;
+   Ring->StartTime = Ring->LastBlockTime = 0.0;
+   Ring->BlocksGrabbed = Ring->Discontinuities = 0;
+   Ring->ObjectCount = Ring->ObjectLinesMin = Ring->ObjectLinesMax = Ring->ObjectLinesTotal = 0;
+   Ring->ConsumerOverruns.store(0);
+   return true;
+   }
+
+/* Segments and publishes the block grabbed in MilBlocks[BufferIndex]. */
+void LineScanBlockGrabbed(LineScanRingStruct* Ring, MIL_INT BufferIndex)
+   {
+   MIL_UINT64 BlockCount = Ring->MilBlocks.size();
+   MIL_UINT64 Line = Ring->WrittenLines.load(memory_order_relaxed);
+   MIL_UINT64 ExpectedIndex = (Line/Ring->BlockLines) % BlockCount;
+
+   Ring->LastBlockTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+   if (Ring->BlocksGrabbed++ == 0)
+      Ring->StartTime = Ring->LastBlockTime;
+
+   /* Blocks arrive in list order; if not, skip to the block's place so the */
+   /* line numbers keep matching the ring. The object in progress is cut.   */
+   if ((MIL_UINT64)BufferIndex != ExpectedIndex)
+      {
+      Ring->Discontinuities++;
+      Line += (((MIL_UINT64)BufferIndex + BlockCount - ExpectedIndex) % BlockCount)*Ring->BlockLines;
+      if (Ring->CurrentObject)
+         EndObject(Ring, Line);
+      }
+
+   for (MIL_INT y = 0; y < Ring->BlockLines; y++, Line++)
+      {
+      MIL_UINT64 RingLine = Line % Ring->RingLines;
+
+      if (Ring->ObjectThreshold > 0.0)
+         {
+         bool Present = LineMean(Ring, Ring->RingAddress + RingLine*Ring->PitchByte) >= Ring->ObjectThreshold;
+         if (Present)
+            {
+            if (Ring->CurrentObject == 0)
+               {
+               Ring->CurrentObject = ++Ring->LastObjectId;
+               Ring->ObjectFirstLine = Line;
+               }
+            Ring->GapLines = 0;
+            }
+         else if (Ring->CurrentObject && ++Ring->GapLines > Ring->MinGapLines)
+            EndObject(Ring, Line);
+         }
+      Ring->LineObject[(size_t)RingLine] = Ring->CurrentObject;
+      }
+
+   Ring->WrittenLines.store(Line, memory_order_release);
+   }
+
+/* Called once MdigProcess() is stopped: no block is grabbed anymore, so the */
+/* object in progress ends with the last line published.                    */
+void LineScanStop(LineScanRingStruct* Ring)
+   {
+   if (Ring->CurrentObject)
+      EndObject(Ring, Ring->WrittenLines.load(memory_order_relaxed));
+   Ring->Stopped.store(true, memory_order_release);
+   }
+
+void LineScanConsumerInit(LineScanRingStruct* Ring, LineScanConsumerStruct* Consumer)
+   {
+   Consumer->NextLine = Ring->WrittenLines.load(memory_order_acquire);
+   Consumer->OpenObject = 0;
+   Consumer->LostLines = 0;
+   }
+
+/* Returns the next strip of the consumer without consuming it. */
+MIL_INT LineScanReadStrip(LineScanRingStruct* Ring, LineScanConsumerStruct* Consumer, LineScanStripStruct* Strip)
+   {
+   /* Once stopped, the lines published are final. */
+   bool Stopped = Ring->Stopped.load(memory_order_acquire);
+   MIL_UINT64 Written = Ring->WrittenLines.load(memory_order_acquire);
+   MIL_UINT64 Object, End, SegmentEnd;
+
+   if (Consumer->NextLine >= Written)
+      {
+      /* The object open at the stop ended with the last strip. */
+      if (!Stopped || Consumer->OpenObject == 0)
+         return LINESCAN_NO_STRIP;
+      Strip->FirstLine = Consumer->NextLine;
+      Strip->LineCount = 0;
+      Strip->ObjectId = Consumer->OpenObject;
+      Strip->ObjectEnd = true;
+      Strip->Data = Ring->RingAddress + (Consumer->NextLine % Ring->RingLines)*Ring->PitchByte;
+      Strip->PitchByte = Ring->PitchByte;
+      Consumer->OpenObject = 0;
+      return LINESCAN_STRIP_READY;
+      }
+
+   /* The consumer fell too far behind; resume at the most recent lines. */
+   if (Written - Consumer->NextLine > SafeLines(Ring))
+      {
+      Consumer->LostLines += Written - Consumer->NextLine;
+      Consumer->NextLine = Written;
+      Consumer->OpenObject = 0;
+      Ring->ConsumerOverruns.fetch_add(1);
+      return LINESCAN_STRIP_OVERRUN;
+      }
+
+   Object = Ring->LineObject[(size_t)(Consumer->NextLine % Ring->RingLines)];
+   Strip->FirstLine = Consumer->NextLine;
+   Strip->Data = Ring->RingAddress + (Consumer->NextLine % Ring->RingLines)*Ring->PitchByte;
+   Strip->PitchByte = Ring->PitchByte;
+
+   /* The previous object ended exactly where the last strip did. */
+   if (Consumer->OpenObject && Object != Consumer->OpenObject)
+      {
+      Strip->LineCount = 0;
+      Strip->ObjectId = Consumer->OpenObject;
+      Strip->ObjectEnd = true;
+      Consumer->OpenObject = 0;
+      return LINESCAN_STRIP_READY;
+      }
+
+   /* Extend the strip up to the end of the ring, of the object or of the published lines. */
+   SegmentEnd = Consumer->NextLine - (Consumer->NextLine % Ring->RingLines) + Ring->RingLines;
+   for (End = Consumer->NextLine + 1; End < Written && End < SegmentEnd; End++)
+      {
+      if (Ring->LineObject[(size_t)(End % Ring->RingLines)] != Object)
+         break;
+      }
+
+   Strip->LineCount = (MIL_INT)(End - Consumer->NextLine);
+   Strip->ObjectId = Object;
+   if (End < Written)
+      Strip->ObjectEnd = (Object != 0) && (Ring->LineObject[(size_t)(End % Ring->RingLines)] != Object);
+   else
+      Strip->ObjectEnd = (Object != 0) && Stopped;
+   Consumer->OpenObject = (Object != 0 && !Strip->ObjectEnd) ? Object : 0;
+   return LINESCAN_STRIP_READY;
+   }
+
+/* Consumes the strip. Returns false if the ring wrapped onto it while it */
+/* was being read, in which case its content is not reliable.            */
+bool LineScanReleaseStrip(LineScanRingStruct* Ring, LineScanConsumerStruct* Consumer, const LineScanStripStruct* Strip)
+   {
+   MIL_UINT64 Written = Ring->WrittenLines.load(memory_order_acquire);
+
+   Consumer->NextLine = Strip->FirstLine + Strip->LineCount;
+   if (Written - Strip->FirstLine > SafeLines(Ring))
+      {
+      Ring->ConsumerOverruns.fetch_add(1);
+      return false;
+      }
+   return true;
+   }
+
+void LineScanPrintStatistics(LineScanRingStruct* Ring, MIL_ID MilDigitizer)
+   {
+   MIL_UINT64 Lines = Ring->WrittenLines.load();
+   MIL_DOUBLE Duration = Ring->LastBlockTime - Ring->StartTime;
+   MIL_INT MissedBlocks = 0;
+
+   FeatureAccessMdigInquire(MilDigitizer, M_PROCESS_FRAME_MISSED, &MissedBlocks);
+
+   MosPrintf(MIL_TEXT("\n--------------------- Line-scan acquisition ---------------------\n\n"));
+   MosPrintf(MIL_TEXT("%30s %lld x %lld lines (%lld blocks of %lld lines)\n"), MIL_TEXT("Ring:"),
+             (long long)Ring->SizeX, (long long)Ring->RingLines, (long long)Ring->MilBlocks.size(), (long long)Ring->BlockLines);
+   MosPrintf(MIL_TEXT("%30s %llu\n"), MIL_TEXT("Blocks grabbed:"), (unsigned long long)Ring->BlocksGrabbed);
+   MosPrintf(MIL_TEXT("%30s %llu\n"), MIL_TEXT("Lines stitched:"), (unsigned long long)Lines);
+   /* The first block is not timed: its lines were acquired before StartTime. */
+   if (Ring->BlocksGrabbed > 1 && Duration > 0.0)
+      MosPrintf(MIL_TEXT("%30s %.0f lines/s\n"), MIL_TEXT("Line rate:"),
+                (MIL_DOUBLE)(Ring->BlocksGrabbed - 1)*Ring->BlockLines/Duration);
+   MosPrintf(MIL_TEXT("%30s %lld (%lld lines lost)\n"), MIL_TEXT("Grab overruns:"), (long long)MissedBlocks,
+             (long long)MissedBlocks*Ring->BlockLines);
+   MosPrintf(MIL_TEXT("%30s %llu\n"), MIL_TEXT("Out-of-order blocks:"), (unsigned long long)Ring->Discontinuities);
+   MosPrintf(MIL_TEXT("%30s %llu\n"), MIL_TEXT("Consumer overruns:"), (unsigned long long)Ring->ConsumerOverruns.load());
+   if (Ring->ObjectThreshold > 0.0)
+      {
+      MosPrintf(MIL_TEXT("%30s %llu\n"), MIL_TEXT("Objects:"), (unsigned long long)Ring->ObjectCount);
+      if (Ring->ObjectCount)
+         MosPrintf(MIL_TEXT("%30s %llu / %.0f / %llu lines\n"), MIL_TEXT("Object length min/avg/max:"),
+                   (unsigned long long)Ring->ObjectLinesMin, (MIL_DOUBLE)Ring->ObjectLinesTotal/Ring->ObjectCount,
+                   (unsigned long long)Ring->ObjectLinesMax);
+      }
+   }
+
+void LineScanRingFree(LineScanRingStruct* Ring)
+   {
+   while (!Ring->MilBlocks.empty())
+      {
+      MbufFree(Ring->MilBlocks.back());
+      Ring->MilBlocks.pop_back();
+      }
+   if (Ring->MilRing)
+      MbufFree(Ring->MilRing);
+   Ring->MilRing = M_NULL;
+   }
@@ -0,0 +1,120 @@
+﻿/********************************************************************************/
+/*
+* File name: LineScan.h
+*
+* Synopsis:  Line-scan acquisition into a rolling ring of lines.
+*
+*            The ring is one large host buffer. The grab buffers given to
+*            MdigProcess() are consecutive child buffers of it, each holding
+*            one block of BlockLines lines, so MIL grabs every line directly
+*            at its place in the stitched image and no line is copied. Since
+*            MdigProcess() fills its buffers in list order, the blocks follow
+*            each other in the ring and wrap around at its end.
+*
+*            LineScanBlockGrabbed() is called from the processing function
+*            for every block. It segments the lines into objects (runs of
+*            lines whose mean intensity is above a threshold, for example
+*            parts on a dark conveyor whose lines are triggered by an encoder,
+*            so that objects of any length are found) and publishes the block.
+*
+*            Consumers, on any thread, read the stitched lines as strips that
+*            never cross the end of the ring or an object boundary, while the
+*            object is still being scanned. A strip stays valid until the ring
+*            wraps around onto it; LineScanReleaseStrip() reports whether that
+*            happened while it was being read. Once the acquisition is stopped,
+*            LineScanStop() ends the object still being scanned, so that it is
+*            counted and its end is reported to the consumers like any other.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+#ifndef LINE_SCAN_H
+#define LINE_SCAN_H
+
+#include <mil.h>
+#include <atomic>
+#include <vector>
+
+/* Blocks at the head of the ring that consumers must not read, because */
+/* MIL may already be grabbing into them.                               */
+#define LINESCAN_GUARD_BLOCKS       2
+
+/* Return values of LineScanReadStrip(). */
+#define LINESCAN_STRIP_READY        0
+#define LINESCAN_NO_STRIP           1
+#define LINESCAN_STRIP_OVERRUN      2
+
+typedef struct
+   {
+   MIL_ID                    MilRing;
+   std::vector<MIL_ID>       MilBlocks;       /* Grab buffers, children of MilRing. */
+   MIL_INT                   BlockLines;
+   MIL_INT                   SizeX;
+   MIL_INT                   SizeBit;
+   MIL_INT                   PitchByte;
+   MIL_INT64                 RingLines;
+   MIL_UINT8*                RingAddress;
+
+   /* Object of each line of the ring, 0 for background. */
+   std::vector<MIL_UINT64>   LineObject;
+
+   /* Lines published to the consumers since the start, and whether */
+   /* they are all published.                                        */
+   std::atomic<MIL_UINT64>   WrittenLines;
+   std::atomic<bool>         Stopped;
+
+   /* Segmentation. */
+   MIL_DOUBLE                ObjectThreshold;  /* Fraction of full scale; 0 disables it. */
+   MIL_INT                   MinGapLines;
+   MIL_UINT64                CurrentObject;
+   MIL_UINT64                ObjectFirstLine;
+   MIL_INT                   GapLines;
+   MIL_UINT64                LastObjectId;
+
+   /* Statistics. */
+   MIL_DOUBLE                StartTime;
+   MIL_DOUBLE                LastBlockTime;
+   MIL_UINT64                BlocksGrabbed;
+   MIL_UINT64                Discontinuities;
+   MIL_UINT64                ObjectCount;
+   MIL_UINT64                ObjectLinesMin;
+   MIL_UINT64                ObjectLinesMax;
+   MIL_UINT64                ObjectLinesTotal;
+   std::atomic<MIL_UINT64>   ConsumerOverruns;
+   } LineScanRingStruct;
+
+/* Read position of one consumer. */
+typedef struct
+   {
+   MIL_UINT64                NextLine;
+   MIL_UINT64                OpenObject;      /* Object whose end was not reported yet. */
+   MIL_UINT64                LostLines;
+   } LineScanConsumerStruct;
+
+/* Contiguous lines of the ring belonging to the same object. */
+typedef struct
+   {
+   MIL_UINT64                FirstLine;
+   MIL_INT                   LineCount;
+   MIL_UINT64                ObjectId;        /* 0 for background.                  */
+   bool                      ObjectEnd;       /* The object ends with this strip,   */
+                                              /* which may then have no lines.      */
+   const void*               Data;
+   MIL_INT                   PitchByte;
+   } LineScanStripStruct;
+
+/* Ring. An object ends after more than MinGapLines background lines, */
+/* which are counted as part of it.                                   */
+bool LineScanRingAlloc(MIL_ID MilSystem, MIL_ID MilDigitizer, MIL_INT BlockCount, MIL_DOUBLE ObjectThreshold,
+                       MIL_INT MinGapLines, LineScanRingStruct* Ring);
+void LineScanBlockGrabbed(LineScanRingStruct* Ring, MIL_INT BufferIndex);
+void LineScanStop(LineScanRingStruct* Ring);
+void LineScanPrintStatistics(LineScanRingStruct* Ring, MIL_ID MilDigitizer);
+void LineScanRingFree(LineScanRingStruct* Ring);
+
+/* Consumers. */
+void    LineScanConsumerInit(LineScanRingStruct* Ring, LineScanConsumerStruct* Consumer);
+MIL_INT LineScanReadStrip(LineScanRingStruct* Ring, LineScanConsumerStruct* Consumer, LineScanStripStruct* Strip);
+bool    LineScanReleaseStrip(LineScanRingStruct* Ring, LineScanConsumerStruct* Consumer, const LineScanStripStruct* Strip);
+
+#endif
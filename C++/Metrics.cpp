@@ -0,0 +1,624 @@
+﻿/********************************************************************************/
+/*
+* File name: Metrics.cpp
+*
+* Synopsis:  Implementation of the live acquisition metrics. See Metrics.h.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. Winsock must be included before windows.h. */
+#include <mil.h>
+#if M_MIL_USE_WINDOWS
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+typedef int SOCKET;
+#define INVALID_SOCKET              (-1)
+#define closesocket                 close
+#endif
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Metrics.h"
+#include "FeatureAccess.h"
+
+using namespace std;
+
+/* Longest wait of the metrics thread, in seconds, which bounds the stop latency. */
+#define METRICS_POLL_PERIOD         0.2
+
+/* Longest time, in seconds, given to a client to send its request and read */
+/* the answer, so that a stalled client cannot stall the metrics thread.     */
+#define METRICS_CLIENT_TIMEOUT      1.0
+
+/* Counters of one digitizer, written only by the thread that owns them. */
+typedef struct
+   {
+   atomic<MIL_UINT64>   FramesProcessed;
+   atomic<MIL_UINT64>   BytesProcessed;
+   atomic<MIL_UINT64>   CorruptedFrames;
+   atomic<MIL_UINT64>   HookTimeNs;
+   atomic<MIL_UINT64>   HookHistogram[METRICS_HISTOGRAM_SIZE];
+   } CounterStruct;
+
+/* Counters of one thread. The padding keeps two shards off the same cache line. */
+typedef struct
+   {
+   char                 PaddingBefore[64];
+   CounterStruct        Digitizers[METRICS_DIGITIZER_MAX];
+   char                 PaddingAfter[64];
+   } ShardStruct;
+
+/* Sum of the shards for one digitizer. */
+typedef struct
+   {
+   MIL_UINT64           FramesProcessed;
+   MIL_UINT64           BytesProcessed;
+   MIL_UINT64           CorruptedFrames;
+   MIL_UINT64           HookTimeNs;
+   MIL_UINT64           HookHistogram[METRICS_HISTOGRAM_SIZE];
+   } CounterTotalStruct;
+
+/* Values maintained by MIL, inquired at collection time. */
+typedef struct
+   {
+   bool                 InUse;
+   MIL_ID               MilDigitizer;   /* M_NULL once removed; the last values are kept. */
+   MIL_INT              BufferCount;
+   MIL_INT              FramesGrabbed;
+   MIL_INT              FramesMissed;
+   MIL_INT              PendingGrabs;
+   MIL_DOUBLE           FrameRate;
+   MIL_INT              PacketsResent;  /* -1 if not inquired successfully. */
+   MIL_INT              PacketsMissed;  /* -1 if not inquired successfully. */
+   } DigitizerStruct;
+
+typedef struct
+   {
+   bool                 Started;
+   MIL_ID               MilThread;
+   atomic<bool>         StopRequested;
+   SOCKET               ListenSocket;
+   MIL_STRING           DumpFileName;
+   MIL_DOUBLE           DumpPeriod;
+
+   /* Protects the digitizer table and the shard list. */
+   mutex                Lock;
+   DigitizerStruct      Digitizers[METRICS_DIGITIZER_MAX];
+   vector<ShardStruct*> Shards;
+
+   MIL_UINT64           ScrapeCount;
+   MIL_UINT64           DumpCount;
+   } MetricsStateStruct;
+
+static MetricsStateStruct Metrics;
+
+/* Shard of the calling thread. Shards live as long as the process, so that */
+/* a thread that outlives a MetricsStop()/MetricsStart() pair stays valid.  */
+static thread_local ShardStruct* LocalShard = M_NULL;
+
+static ShardStruct* GetLocalShard()
+   {
+   if (LocalShard == M_NULL)
+      {
+      ShardStruct* Shard = new ShardStruct;
+      lock_guard<mutex> Guard(Metrics.Lock);
+      Metrics.Shards.push_back(Shard);
+      LocalShard = Shard;
+      }
+   return LocalShard;
+   }
+
+/* Single-writer increment: no read-modify-write instruction is needed. */
+static inline void Add(atomic<MIL_UINT64>& Counter, MIL_UINT64 Value)
+   {
+   Counter.store(Counter.load(memory_order_relaxed) + Value, memory_order_relaxed);
+   }
+
+static void ResetCounters(MIL_INT Digitizer)
+   {
+   for (size_t i = 0; i < Metrics.Shards.size(); i++)
+      {
+      CounterStruct& Counters = Metrics.Shards[i]->Digitizers[Digitizer];
+      Counters.FramesProcessed.store(0, memory_order_relaxed);
+      Counters.BytesProcessed.store(0, memory_order_relaxed);
+      Counters.CorruptedFrames.store(0, memory_order_relaxed);
+      Counters.HookTimeNs.store(0, memory_order_relaxed);
+      for (MIL_INT Bin = 0; Bin < METRICS_HISTOGRAM_SIZE; Bin++)
+         Counters.HookHistogram[Bin].store(0, memory_order_relaxed);
+      }
+   }
+
+static void SumCounters(MIL_INT Digitizer, CounterTotalStruct* Total)
+   {
+   memset(Total, 0, sizeof(CounterTotalStruct));
+   for (size_t i = 0; i < Metrics.Shards.size(); i++)
+      {
+      const CounterStruct& Counters = Metrics.Shards[i]->Digitizers[Digitizer];
+      Total->FramesProcessed += Counters.FramesProcessed.load(memory_order_relaxed);
+      Total->BytesProcessed += Counters.BytesProcessed.load(memory_order_relaxed);
+      Total->CorruptedFrames += Counters.CorruptedFrames.load(memory_order_relaxed);
+      Total->HookTimeNs += Counters.HookTimeNs.load(memory_order_relaxed);
+      for (MIL_INT Bin = 0; Bin < METRICS_HISTOGRAM_SIZE; Bin++)
+         Total->HookHistogram[Bin] += Counters.HookHistogram[Bin].load(memory_order_relaxed);
+      }
+   }
+
+/* Upper bound, in seconds, of a histogram bucket, as exported. The last */
+/* bucket also counts the longer durations, so its bound is +Inf.        */
+static string BucketBound(MIL_INT Bin)
+   {
+   char Bound[32];
+
+   if (Bin >= METRICS_HISTOGRAM_SIZE - 1)
+      return "+Inf";
+   snprintf(Bound, sizeof(Bound), "%g", (MIL_DOUBLE)(1ULL << Bin)*1e-6);
+   return Bound;
+   }
+
+/* Upper bound of the histogram bucket holding the quantile. */
+static string HistogramQuantile(const CounterTotalStruct& Total, MIL_DOUBLE Quantile)
+   {
+   MIL_UINT64 Rank, Sum = 0;
+
+   if (Total.FramesProcessed == 0)
+      return "0";
+   Rank = (MIL_UINT64)(Quantile*(MIL_DOUBLE)(Total.FramesProcessed - 1)) + 1;
+   for (MIL_INT Bin = 0; Bin < METRICS_HISTOGRAM_SIZE; Bin++)
+      {
+      Sum += Total.HookHistogram[Bin];
+      if (Sum >= Rank)
+         return BucketBound(Bin);
+      }
+   return BucketBound(METRICS_HISTOGRAM_SIZE - 1);
+   }
+
+static void Append(string& Text, const char* Format, ...)
+   {
+   char Line[256];
+   va_list Args;
+   va_start(Args, Format);
+   vsnprintf(Line, sizeof(Line), Format, Args);
+   va_end(Args);
+   Text += Line;
+   }
+
+static void AppendHeader(string& Text, const char* Name, const char* Type, const char* Help)
+   {
+   Append(Text, "# HELP %s %s\n# TYPE %s %s\n", Name, Help, Name, Type);
+   }
+
+/* Inquires a packet count of the GigE Vision transport; -1 if it fails. */
+static MIL_INT InquirePacketCount(MIL_ID MilDigitizer, MIL_INT InquireType, const char* InquireTypeName)
+   {
+   MIL_INT Count = 0;
+
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+   FeatureAccessMdigInquireFrom(__FUNCTION__, InquireTypeName, MilDigitizer, InquireType, &Count);
+   if (MappGetError(M_DEFAULT, M_CURRENT, M_NULL) != M_NULL_ERROR)
+      Count = -1;
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+   return Count;
+   }
+
+/* Builds the exposition text. */
+static string CollectMetrics()
+   {
+   CounterTotalStruct Totals[METRICS_DIGITIZER_MAX];
+   MIL_UINT64 FeatureAccesses = 0, FeatureErrors = 0;
+   string Text;
+   MIL_INT d;
+
+   lock_guard<mutex> Guard(Metrics.Lock);
+   for (d = 0; d < METRICS_DIGITIZER_MAX; d++)
+      {
+      DigitizerStruct& Dig = Metrics.Digitizers[d];
+      if (!Dig.InUse)
+         continue;
+      if (Dig.MilDigitizer)
+         {
+         FeatureAccessMdigInquire(Dig.MilDigitizer, M_PROCESS_FRAME_COUNT, &Dig.FramesGrabbed);
+         FeatureAccessMdigInquire(Dig.MilDigitizer, M_PROCESS_FRAME_MISSED, &Dig.FramesMissed);
+         FeatureAccessMdigInquire(Dig.MilDigitizer, M_PROCESS_FRAME_RATE, &Dig.FrameRate);
+         FeatureAccessMdigInquire(Dig.MilDigitizer, M_PROCESS_PENDING_GRAB_NUM, &Dig.PendingGrabs);
+         Dig.PacketsResent = InquirePacketCount(Dig.MilDigitizer, M_GC_TOTAL_PACKETS_RESENDS_NB, "M_GC_TOTAL_PACKETS_RESENDS_NB");
+         Dig.PacketsMissed = InquirePacketCount(Dig.MilDigitizer, M_GC_TOTAL_PACKETS_MISSED, "M_GC_TOTAL_PACKETS_MISSED");
+         }
+      SumCounters(d, &Totals[d]);
+      }
+
+#define FOR_EACH_DIGITIZER for (d = 0; d < METRICS_DIGITIZER_MAX; d++) if (Metrics.Digitizers[d].InUse)
+
+   AppendHeader(Text, "milgige_frames_grabbed_total", "counter", "Frames grabbed by MdigProcess.");
+   FOR_EACH_DIGITIZER Append(Text, "milgige_frames_grabbed_total{digitizer=\"%d\"} %lld\n", (int)d,
+                             (long long)Metrics.Digitizers[d].FramesGrabbed);
+   AppendHeader(Text, "milgige_frames_processed_total", "counter", "Frames handed to the processing function.");
+   FOR_EACH_DIGITIZER Append(Text, "milgige_frames_processed_total{digitizer=\"%d\"} %llu\n", (int)d,
+                             (unsigned long long)Totals[d].FramesProcessed);
+   AppendHeader(Text, "milgige_frames_missed_total", "counter", "Frames dropped because no grab buffer was available.");
+   FOR_EACH_DIGITIZER Append(Text, "milgige_frames_missed_total{digitizer=\"%d\"} %lld\n", (int)d,
+                             (long long)Metrics.Digitizers[d].FramesMissed);
+   AppendHeader(Text, "milgige_frames_corrupted_total", "counter", "Frames received incomplete or with errors.");
+   FOR_EACH_DIGITIZER Append(Text, "milgige_frames_corrupted_total{digitizer=\"%d\"} %llu\n", (int)d,
+                             (unsigned long long)Totals[d].CorruptedFrames);
+   AppendHeader(Text, "milgige_bytes_processed_total", "counter", "Image bytes handed to the processing function.");
+   FOR_EACH_DIGITIZER Append(Text, "milgige_bytes_processed_total{digitizer=\"%d\"} %llu\n", (int)d,
+                             (unsigned long long)Totals[d].BytesProcessed);
+   AppendHeader(Text, "milgige_packets_resent_total", "counter", "GigE Vision stream packets resent at the request of the host.");
+   FOR_EACH_DIGITIZER if (Metrics.Digitizers[d].PacketsResent >= 0)
+      Append(Text, "milgige_packets_resent_total{digitizer=\"%d\"} %lld\n", (int)d,
+             (long long)Metrics.Digitizers[d].PacketsResent);
+   AppendHeader(Text, "milgige_packets_missed_total", "counter", "GigE Vision stream packets never received, after the resends.");
+   FOR_EACH_DIGITIZER if (Metrics.Digitizers[d].PacketsMissed >= 0)
+      Append(Text, "milgige_packets_missed_total{digitizer=\"%d\"} %lld\n", (int)d,
+             (long long)Metrics.Digitizers[d].PacketsMissed);
+
+   AppendHeader(Text, "milgige_frame_rate", "gauge", "Grab frame rate measured by MIL, in frames per second.");
+   FOR_EACH_DIGITIZER Append(Text, "milgige_frame_rate{digitizer=\"%d\"} %.3f\n", (int)d,
+                             Metrics.Digitizers[d].FrameRate);
+   AppendHeader(Text, "milgige_bandwidth_bytes", "gauge", "Image bandwidth, in bytes per second.");
+   FOR_EACH_DIGITIZER Append(Text, "milgige_bandwidth_bytes{digitizer=\"%d\"} %.0f\n", (int)d,
+                             Totals[d].FramesProcessed ?
+                             Metrics.Digitizers[d].FrameRate*Totals[d].BytesProcessed/Totals[d].FramesProcessed : 0.0);
+   AppendHeader(Text, "milgige_buffer_pool_size", "gauge", "Grab buffers given to MdigProcess.");
+   FOR_EACH_DIGITIZER Append(Text, "milgige_buffer_pool_size{digitizer=\"%d\"} %lld\n", (int)d,
+                             (long long)Metrics.Digitizers[d].BufferCount);
+   AppendHeader(Text, "milgige_buffers_queued", "gauge", "Grab buffers queued for grab.");
+   FOR_EACH_DIGITIZER Append(Text, "milgige_buffers_queued{digitizer=\"%d\"} %lld\n", (int)d,
+                             (long long)Metrics.Digitizers[d].PendingGrabs);
+   AppendHeader(Text, "milgige_buffers_in_use", "gauge", "Grab buffers held by the processing.");
+   FOR_EACH_DIGITIZER Append(Text, "milgige_buffers_in_use{digitizer=\"%d\"} %lld\n", (int)d,
+                             (long long)(Metrics.Digitizers[d].BufferCount - Metrics.Digitizers[d].PendingGrabs));
+
+   AppendHeader(Text, "milgige_hook_duration_seconds", "histogram", "Duration of the processing function.");
+   FOR_EACH_DIGITIZER
+      {
+      MIL_UINT64 Cumulative = 0;
+      for (MIL_INT Bin = 0; Bin < METRICS_HISTOGRAM_SIZE; Bin++)
+         {
+         Cumulative += Totals[d].HookHistogram[Bin];
+         Append(Text, "milgige_hook_duration_seconds_bucket{digitizer=\"%d\",le=\"%s\"} %llu\n", (int)d,
+                BucketBound(Bin).c_str(), (unsigned long long)Cumulative);
+         }
+      Append(Text, "milgige_hook_duration_seconds_sum{digitizer=\"%d\"} %.9f\n", (int)d, Totals[d].HookTimeNs*1e-9);
+      Append(Text, "milgige_hook_duration_seconds_count{digitizer=\"%d\"} %llu\n", (int)d,
+             (unsigned long long)Totals[d].FramesProcessed);
+      }
+   AppendHeader(Text, "milgige_hook_duration_quantile_seconds", "gauge",
+                "Quantiles of the processing function duration, as histogram bucket bounds.");
+   FOR_EACH_DIGITIZER
+      {
+      Append(Text, "milgige_hook_duration_quantile_seconds{digitizer=\"%d\",quantile=\"0.5\"} %s\n", (int)d,
+             HistogramQuantile(Totals[d], 0.5).c_str());
+      Append(Text, "milgige_hook_duration_quantile_seconds{digitizer=\"%d\",quantile=\"0.99\"} %s\n", (int)d,
+             HistogramQuantile(Totals[d], 0.99).c_str());
+      Append(Text, "milgige_hook_duration_quantile_seconds{digitizer=\"%d\",quantile=\"0.999\"} %s\n", (int)d,
+             HistogramQuantile(Totals[d], 0.999).c_str());
+      }
+#undef FOR_EACH_DIGITIZER
+
+   FeatureAccessGetCounts(&FeatureAccesses, &FeatureErrors);
+   AppendHeader(Text, "milgige_feature_accesses_total", "counter", "GenICam feature accesses.");
+   Append(Text, "milgige_feature_accesses_total %llu\n", (unsigned long long)FeatureAccesses);
+   AppendHeader(Text, "milgige_feature_access_errors_total", "counter", "GenICam feature accesses that failed.");
+   Append(Text, "milgige_feature_access_errors_total %llu\n", (unsigned long long)FeatureErrors);
+
+   return Text;
+   }
+
+static FILE* OpenFile(const MIL_TEXT_CHAR* FileName)
+   {
+   FILE* File = NULL;
+#if M_MIL_USE_WINDOWS
+   _wfopen_s(&File, FileName, L"wb");
+#else
+   File = fopen(FileName, "wb");
+#endif
+   return File;
+   }
+
+/* Writes the metrics next to the dump file and renames it, so readers never */
+/* see a partial file.                                                      */
+static void DumpMetrics()
+   {
+   MIL_STRING TempFileName = Metrics.DumpFileName + MIL_TEXT(".tmp");
+   string Text = CollectMetrics();
+   FILE* File = OpenFile(TempFileName.c_str());
+
+   if (File == NULL)
+      return;
+   fwrite(Text.data(), 1, Text.size(), File);
+   fclose(File);
+#if M_MIL_USE_WINDOWS
+   MoveFileExW(TempFileName.c_str(), Metrics.DumpFileName.c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+   rename(TempFileName.c_str(), Metrics.DumpFileName.c_str());
+#endif
+   Metrics.DumpCount++;
+   }
+
+/* Bounds each recv() and send() on Socket to METRICS_CLIENT_TIMEOUT. */
+static void SetClientTimeout(SOCKET Socket)
+   {
+#if M_MIL_USE_WINDOWS
+   DWORD Timeout = (DWORD)(METRICS_CLIENT_TIMEOUT*1000.0);
+#else
+   timeval Timeout;
+   Timeout.tv_sec = (time_t)METRICS_CLIENT_TIMEOUT;
+   Timeout.tv_usec = (long)((METRICS_CLIENT_TIMEOUT - (MIL_DOUBLE)Timeout.tv_sec)*1000000.0);
+#endif
+   setsockopt(Socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&Timeout, sizeof(Timeout));
+   setsockopt(Socket, SOL_SOCKET, SO_SNDTIMEO, (const char*)&Timeout, sizeof(Timeout));
+   }
+
+/* Makes accept() return at once when the client that made the listen socket */
+/* readable has already gone.                                                 */
+static void SetNonBlocking(SOCKET Socket)
+   {
+#if M_MIL_USE_WINDOWS
+   u_long NonBlocking = 1;
+   ioctlsocket(Socket, FIONBIO, &NonBlocking);
+#else
+   fcntl(Socket, F_SETFL, fcntl(Socket, F_GETFL, 0) | O_NONBLOCK);
+#endif
+   }
+
+/* Answers one HTTP request. Only GET /metrics is served. The client gets */
+/* METRICS_CLIENT_TIMEOUT to send its request and as much to read the    */
+/* answer; past that, it is dropped.                                     */
+static void ServeRequest(SOCKET Client)
+   {
+   char Request[2048];
+   string Response, Body;
+   int Received = 0, Size;
+   MIL_DOUBLE Deadline;
+
+   /* The accepted socket can inherit the non-blocking mode of the listen socket. */
+#if M_MIL_USE_WINDOWS
+   u_long Blocking = 0;
+   ioctlsocket(Client, FIONBIO, &Blocking);
+#else
+   fcntl(Client, F_SETFL, fcntl(Client, F_GETFL, 0) & ~O_NONBLOCK);
+#endif
+   SetClientTimeout(Client);
+
+   /* Read the request line and headers. */
+   Deadline = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) + METRICS_CLIENT_TIMEOUT;
+   while (Received < (int)sizeof(Request) - 1)
+      {
+      if (MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) > Deadline)
+         break;
+      Size = (int)recv(Client, Request + Received, (int)sizeof(Request) - 1 - Received, 0);
+      if (Size <= 0)
+         break;
+      Received += Size;
+      Request[Received] = '\0';
+      if (strstr(Request, "\r\n\r\n"))
+         break;
+      }
+   Request[Received] = '\0';
+
+   if (strncmp(Request, "GET /metrics ", 13) == 0 || strncmp(Request, "GET /metrics?", 13) == 0)
+      {
+      Body = CollectMetrics();
+      Append(Response, "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                       "Content-Length: %llu\r\nConnection: close\r\n\r\n", (unsigned long long)Body.size());
+      Response += Body;
+      Metrics.ScrapeCount++;
+      }
+   else
+      Response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+   Deadline = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) + METRICS_CLIENT_TIMEOUT;
+   for (size_t Sent = 0; Sent < Response.size(); )
+      {
+      if (MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) > Deadline)
+         break;
+      Size = (int)send(Client, Response.data() + Sent, (int)(Response.size() - Sent), 0);
+      if (Size <= 0)
+         break;
+      Sent += Size;
+      }
+   closesocket(Client);
+   }
+
+static MIL_UINT32 MFTYPE MetricsThread(void* ThreadContext)
+   {
+   MIL_DOUBLE NextDump = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) + Metrics.DumpPeriod;
+
+   while (!Metrics.StopRequested.load())
+      {
+      MIL_DOUBLE Now = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+      MIL_DOUBLE Wait = METRICS_POLL_PERIOD;
+
+      if (!Metrics.DumpFileName.empty())
+         {
+         if (Now >= NextDump)
+            {
+            DumpMetrics();
+            NextDump = Now + Metrics.DumpPeriod;
+            }
+         if (NextDump - Now < Wait)
+            Wait = NextDump - Now;
+         }
+
+      if (Metrics.ListenSocket != INVALID_SOCKET)
+         {
+         fd_set ReadSet;
+         timeval Timeout;
+         FD_ZERO(&ReadSet);
+         FD_SET(Metrics.ListenSocket, &ReadSet);
+         Timeout.tv_sec = 0;
+         Timeout.tv_usec = (long)(Wait*1000000.0);
+         if (select((int)Metrics.ListenSocket + 1, &ReadSet, NULL, NULL, &Timeout) > 0)
+            {
+            SOCKET Client = accept(Metrics.ListenSocket, NULL, NULL);
+            if (Client != INVALID_SOCKET)
+               ServeRequest(Client);
+            }
+         }
+      else
+         MosSleep((MIL_INT)(Wait*1000.0) + 1);
+      }
+
+   return 0;
+   }
+
+static SOCKET OpenListenSocket(MIL_INT Port)
+   {
+   sockaddr_in Address;
+   int Reuse = 1;
+   SOCKET Socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+   if (Socket == INVALID_SOCKET)
+      return INVALID_SOCKET;
+   setsockopt(Socket, SOL_SOCKET, SO_REUSEADDR, (const char*)&Reuse, sizeof(Reuse));
+
+   memset(&Address, 0, sizeof(Address));
+   Address.sin_family = AF_INET;
+   Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   Address.sin_port = htons((unsigned short)Port);
+   if (bind(Socket, (sockaddr*)&Address, sizeof(Address)) != 0 || listen(Socket, 4) != 0)
+      {
+      closesocket(Socket);
+      return INVALID_SOCKET;
+      }
+   SetNonBlocking(Socket);
+   return Socket;
+   }
+
+bool MetricsStart(MIL_ID MilSystem, MIL_INT HttpPort, const MIL_TEXT_CHAR* DumpFileName, MIL_DOUBLE DumpPeriod)
+   {
+   Metrics.Started = true;
+   Metrics.MilThread = M_NULL;
+   Metrics.StopRequested.store(false);
+   Metrics.ListenSocket = INVALID_SOCKET;
+   Metrics.DumpFileName = DumpFileName ? DumpFileName : MIL_TEXT("");
+   Metrics.DumpPeriod = DumpPeriod;
+   Metrics.ScrapeCount = Metrics.DumpCount = 0;
+   for (MIL_INT d = 0; d < METRICS_DIGITIZER_MAX; d++)
+      Metrics.Digitizers[d].InUse = false;
+
+   if (HttpPort)
+      {
+#if M_MIL_USE_WINDOWS
+      WSADATA WsaData;
+      if (WSAStartup(MAKEWORD(2, 2), &WsaData) == 0)
+         {
+         Metrics.ListenSocket = OpenListenSocket(HttpPort);
+         if (Metrics.ListenSocket == INVALID_SOCKET)
+            WSACleanup();
+         }
+#else
+      Metrics.ListenSocket = OpenListenSocket(HttpPort);
+#endif
+      if (Metrics.ListenSocket == INVALID_SOCKET)
+         MosPrintf(MIL_TEXT("\nThe metrics endpoint could not listen on port %d.\n"), (int)HttpPort);
+      else
+         MosPrintf(MIL_TEXT("\nMetrics available at http://127.0.0.1:%d/metrics.\n"), (int)HttpPort);
+      }
+   if (!Metrics.DumpFileName.empty())
+      MosPrintf(MIL_TEXT("Metrics written to %s every %g s.\n"), Metrics.DumpFileName.c_str(), DumpPeriod);
+
+   if (Metrics.ListenSocket == INVALID_SOCKET && Metrics.DumpFileName.empty())
+      return false;
+
+   FeatureAccessCountStart();
+   MthrAlloc(MilSystem, M_THREAD, M_DEFAULT, &MetricsThread, M_NULL, &Metrics.MilThread);
+   return (Metrics.MilThread != M_NULL);
+   }
+
+/* Stops the thread, writes the dump file a last time and closes the endpoint. */
+void MetricsStop()
+   {
+   if (!Metrics.Started)
+      return;
+   Metrics.Started = false;
+
+   if (Metrics.MilThread)
+      {
+      Metrics.StopRequested.store(true);
+      MthrWait(Metrics.MilThread, M_THREAD_END_WAIT, M_NULL);
+      MthrFree(Metrics.MilThread);
+      Metrics.MilThread = M_NULL;
+      if (!Metrics.DumpFileName.empty())
+         DumpMetrics();
+      MosPrintf(MIL_TEXT("\nMetrics served %llu time(s) and written %llu time(s).\n"),
+                (unsigned long long)Metrics.ScrapeCount, (unsigned long long)Metrics.DumpCount);
+      }
+   if (Metrics.ListenSocket != INVALID_SOCKET)
+      {
+      closesocket(Metrics.ListenSocket);
+      Metrics.ListenSocket = INVALID_SOCKET;
+#if M_MIL_USE_WINDOWS
+      WSACleanup();
+#endif
+      }
+   }
+
+MIL_INT MetricsAddDigitizer(MIL_ID MilDigitizer, MIL_INT BufferCount)
+   {
+   lock_guard<mutex> Guard(Metrics.Lock);
+   for (MIL_INT d = 0; d < METRICS_DIGITIZER_MAX; d++)
+      {
+      DigitizerStruct& Dig = Metrics.Digitizers[d];
+      if (Dig.InUse && Dig.MilDigitizer)
+         continue;
+      Dig.InUse = true;
+      Dig.MilDigitizer = MilDigitizer;
+      Dig.BufferCount = BufferCount;
+      Dig.FramesGrabbed = Dig.FramesMissed = Dig.PendingGrabs = 0;
+      Dig.FrameRate = 0.0;
+      Dig.PacketsResent = Dig.PacketsMissed = -1;
+      ResetCounters(d);
+      return d;
+      }
+   return -1;
+   }
+
+void MetricsRemoveDigitizer(MIL_INT Digitizer)
+   {
+   if (Digitizer < 0 || Digitizer >= METRICS_DIGITIZER_MAX)
+      return;
+   lock_guard<mutex> Guard(Metrics.Lock);
+   Metrics.Digitizers[Digitizer].MilDigitizer = M_NULL;
+   Metrics.Digitizers[Digitizer].PendingGrabs = 0;
+   Metrics.Digitizers[Digitizer].FrameRate = 0.0;
+   }
+
+void MetricsFrameProcessed(MIL_INT Digitizer, MIL_INT64 SizeByte, MIL_DOUBLE HookDuration, bool Corrupted)
+   {
+   MIL_INT Bin = 0;
+   MIL_DOUBLE Microseconds = HookDuration*1e6;
+
+   if (Digitizer < 0 || Digitizer >= METRICS_DIGITIZER_MAX)
+      return;
+
+   CounterStruct& Counters = GetLocalShard()->Digitizers[Digitizer];
+   Add(Counters.FramesProcessed, 1);
+   Add(Counters.BytesProcessed, (MIL_UINT64)SizeByte);
+   if (Corrupted)
+      Add(Counters.CorruptedFrames, 1);
+   Add(Counters.HookTimeNs, (MIL_UINT64)(HookDuration*1e9));
+
+   while (Microseconds > 1.0 && Bin < METRICS_HISTOGRAM_SIZE - 1)
+      {
+      Microseconds /= 2.0;
+      Bin++;
+      }
+   Add(Counters.HookHistogram[Bin], 1);
+   }
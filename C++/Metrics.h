@@ -0,0 +1,62 @@
+﻿/********************************************************************************/
+/*
+* File name: Metrics.h
+*
+* Synopsis:  Live acquisition metrics in the Prometheus text exposition format,
+*            served on a local HTTP endpoint (GET /metrics) and/or written
+*            periodically to a file, for example for the node_exporter
+*            textfile collector.
+*
+*            Each registered digitizer exports, with a "digitizer" label:
+*            - frames grabbed, processed, missed and corrupted, bytes
+*              processed, and stream packets resent and missed (counters);
+*            - frame rate, bandwidth, grab buffer pool size, buffers queued
+*              for grab and buffers held by the processing (gauges);
+*            - the duration of the processing function (histogram, with
+*              p50/p99/p999 gauges).
+*            The feature access error counts of FeatureAccess.h are exported
+*            for the whole process.
+*
+*            The grab path only updates counters owned by the calling thread,
+*            with relaxed atomic stores and no lock; they are summed when the
+*            metrics are collected. The values maintained by MIL (grabbed and
+*            missed frames, rate, pending grabs) are inquired at collection
+*            time.
+*
+*            The packet counts are the M_GC_TOTAL_PACKETS_RESENDS_NB and
+*            M_GC_TOTAL_PACKETS_MISSED of the digitizer; they are omitted for
+*            a digitizer that does not report them.
+*
+*            An HTTP client has METRICS_CLIENT_TIMEOUT seconds (Metrics.cpp)
+*            to send its request and as much to read the answer.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <mil.h>
+
+/* Maximum number of digitizers registered at the same time. */
+#define METRICS_DIGITIZER_MAX       8
+
+/* Processing duration histogram: bucket n counts durations up to 2^n us. */
+#define METRICS_HISTOGRAM_SIZE      24
+
+/* Starts the metrics thread. HttpPort 0 disables the endpoint, which only  */
+/* listens on the loopback interface; a M_NULL DumpFileName disables the    */
+/* file. Returns false if neither could be started.                        */
+bool MetricsStart(MIL_ID MilSystem, MIL_INT HttpPort, const MIL_TEXT_CHAR* DumpFileName, MIL_DOUBLE DumpPeriod);
+void MetricsStop();
+
+/* Registers a digitizer processing BufferCount grab buffers. Returns its */
+/* index, or -1. After MetricsRemoveDigitizer() the last values remain    */
+/* exported and the digitizer can be freed.                               */
+MIL_INT MetricsAddDigitizer(MIL_ID MilDigitizer, MIL_INT BufferCount);
+void    MetricsRemoveDigitizer(MIL_INT Digitizer);
+
+/* Grab path: called once per processed frame. */
+void MetricsFrameProcessed(MIL_INT Digitizer, MIL_INT64 SizeByte, MIL_DOUBLE HookDuration, bool Corrupted);
+
+#endif
@@ -1,1128 +1,1922 @@
-﻿/********************************************************************************/
-/*
-* File name: milgige.cpp
-*
-* Synopsis:  This program demonstrates new MIL features for managing GigE Vision(tm)
-*            devices using the Matrox Driver for GigE Vision(tm).
-*
-* Note:      The camera features inquired by this example are taken from the GenICam(tm)
-*            Standard Feature Naming Convention (SFNC). It can be downloaded from the
-*            European Machine Vision Association's web site: http://www.emva.org/
-*            Only a subset of defined SNFC features are used by this example for
-*            illustrative purposes.
-*
-*            Some of the features accessed by this example might not be implemented
-*            by your camera, therefore MIL error prints are temporarily disabled while
-*            the process of feature enumeration is done. SFNC features not supported
-*            by your camera will be marked with N/A. Because of this the code for
-*            enumerating features is made more complex to account for varying
-*            implementations by camera manufacturers.
-*
-* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
-* All Rights Reserved
-*/
-
-/* Headers. */
-#include <mil.h>
-#include <vector>
-#if M_MIL_USE_WINDOWS
-#include <windows.h>
-#endif
-
-using namespace std;
-
-/* Set the PRINT_LOOKUP_TABLE define to 1 to print your camera's LUT       */
-/* values (if present).                                                    */
-#define PRINT_LOOKUP_TABLE       0
-
-/* List of function prototypes used to enumerate and print camera features. */
-void CameraPrintDeviceControls(MIL_ID MilDigitizer);
-void CameraPrintTransportLayerControls(MIL_ID MilDigitizer);
-void CameraPrintImageFormatControls(MIL_ID MilDigitizer);
-void CameraPrintAcquisitionControls(MIL_ID MilDigitizer);
-void CameraPrintIOControls(MIL_ID MilDigitizer);
-void CameraPrintCounterAndTimerControls(MIL_ID MilDigitizer);
-void CameraPrintEventControls(MIL_ID MilDigitizer);
-void CameraPrintLUT(MIL_ID MilDigitizer);
-void CameraPrintDeviceCapabilities(MIL_ID MilDigitizer);
-void CameraPrintControlProtocolCapabilities(MIL_ID MilDigitizer);
-void CameraPrintStreamProtocolCapabilities(MIL_ID MilDigitizer);
-void CameraPrintMessageProtocolCapabilities(MIL_ID MilDigitizer);
-void CameraPrintStreamChannelCapabilities(MIL_ID MilDigitizer);
-void CameraPrintPhysicalLinkConfigurationCapabilities(MIL_ID MilDigitizer);
-void CameraPrintNetworkInterfaceCapabilities(MIL_ID MilDigitizer);
-void CameraPrintNetworkInterfaceConfiguration(MIL_ID MilDigitizer);
-
-/* List of function prototypes used to perform triggered acquisition. */
-typedef enum {eSingleFrame=1, eMultiFrame, eContinuous} eTriggerType;
-void SetTriggerControls(MIL_ID MilDigitizer, eTriggerType& Type, MIL_INT64& NbFrames,
-   MIL_STRING& oTriggerSelector, bool &SoftwareTriggerSelected);
-void SelectTriggerSource(MIL_ID MilDigitizer, bool& SoftwareTriggerSelected);
-void ResetTriggerControls(MIL_ID MilDigitizer);
-void DoTriggeredAcquisition(MIL_ID MilSystem, MIL_ID MilDigitizer, MIL_ID MilImageDisp);
-
-/* Global variables used to store camera capabilities. */
-bool ContinuousAMSupport = false;
-bool SingleFrameAMSupport = false;
-bool MultiFrameAMSupport = false;
-MIL_INT MultipleAcquisitionModeSupport = 0;
-bool CanTriggerAcquisitionStart = false;
-bool CanTriggerFrameStart = false;
-
-/* Main function. */
-int MosMain(void)
-   {
-   MIL_ID MilApplication,  /* Application identifier.  */
-          MilSystem,       /* System identifier.       */
-          MilDisplay,      /* Display identifier.      */
-          MilDigitizer,    /* Digitizer identifier.    */
-          MilImage;        /* Image buffer identifier. */
-   MIL_INT SystemType;
-   MIL_INT Selection;
-
-   /* Allocate defaults. */
-   MappAllocDefault(M_DEFAULT, &MilApplication, &MilSystem, &MilDisplay, M_NULL, M_NULL);
-
-   /* Get information on the system we are using and print a welcome message to the console. */
-   MsysInquire(MilSystem, M_SYSTEM_TYPE, &SystemType);
-
-   if ((SystemType != M_SYSTEM_GIGE_VISION_TYPE) &&
-       (SystemType != M_SYSTEM_GEVIQ_TYPE))
-      {
-      /* Print error message. */
-      MosPrintf(MIL_TEXT("This example program can only be used with the Matrox Driver for ")
-                MIL_TEXT("GigE Vision or the\nMatrox GevIQ Smart GigE Vision Adapter.\n"));
-      MosPrintf(MIL_TEXT("Please ensure that the default system type is set accordingly in ")
-                MIL_TEXT("MIL Config.\n"));
-      MosPrintf(MIL_TEXT("-------------------------------------------------------------\n\n"));
-      MosPrintf(MIL_TEXT("Press <enter> to quit.\n"));
-      MosGetch();
-      MappFreeDefault(MilApplication, MilSystem, MilDisplay, M_NULL, M_NULL);
-      return 1;
-      }
-
-   /* Allocate the digitizer controlling the camera. */
-   MdigAlloc(MilSystem, M_DEFAULT, MIL_TEXT("M_DEFAULT"), M_DEFAULT, &MilDigitizer);
-
-   /* In cases where the preferred method for device allocation requires allocating with     */
-   /* a user-defined name the following code can be used. "MyCameraName" must be replaced    */
-   /* with the actual camera name written in the camera.                                     */
-
-   /* MdigAlloc(MilSystem, M_GC_CAMERA_ID(MIL_TEXT("MyCameraName")), MIL_TEXT("M_DEFAULT"),  */
-   /*    M_GC_DEVICE_NAME, &MilDigitizer);                                              */
-
-
-   /* Allocate grab and display buffer. */
-   MbufAllocColor(MilSystem,
-      MdigInquire(MilDigitizer, M_SIZE_BAND, M_NULL),
-      MdigInquire(MilDigitizer, M_SIZE_X, M_NULL),
-      MdigInquire(MilDigitizer, M_SIZE_Y, M_NULL),
-      MdigInquire(MilDigitizer, M_TYPE, M_NULL),
-      M_IMAGE + M_DISP + M_GRAB,
-      &MilImage);
-   MbufClear(MilImage, 0);
-
-   /* Print a message. */
-   MosPrintf(MIL_TEXT("This example showcases GigE Vision specific features.\n"));
-   MosPrintf(MIL_TEXT("Press <Enter> to start.\n\n"));
-   MosGetch();
-#if M_MIL_USE_WINDOWS
-   system("cls");
-#endif
-   MosPrintf(MIL_TEXT("------------------------------------------------------------\n\n"));
-   MosPrintf(MIL_TEXT("                  Camera features summary.                  \n"));
-
-   /* Disable error printing in case camera is not SFNC compliant with regard
-      to some of the features it supports. */
-   MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
-
-   /* Enumerate and print camera features. */
-   CameraPrintDeviceControls(MilDigitizer);
-   CameraPrintTransportLayerControls(MilDigitizer);
-   CameraPrintImageFormatControls(MilDigitizer);
-   CameraPrintAcquisitionControls(MilDigitizer);
-   CameraPrintEventControls(MilDigitizer);
-   CameraPrintIOControls(MilDigitizer);
-   CameraPrintCounterAndTimerControls(MilDigitizer);
-#if PRINT_LOOKUP_TABLE
-   CameraPrintLUT(MilDigitizer);
-#endif
-
-   /* Re-enable error printing. */
-   MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
-
-   /* Print a message. */
-   MosPrintf(MIL_TEXT("\nPress <Enter> to continue.\n"));
-   MosGetch();
-
-   CameraPrintDeviceCapabilities(MilDigitizer);
-
-   MosPrintf(MIL_TEXT("\nPress <Enter> to continue.\n"));
-   MosGetch();
-
-   /* Clear the console text. */
-#if M_MIL_USE_WINDOWS
-   system("cls");
-#endif
-   /* Pop-up the camera feature browser GUI. */
-   MdigControl(MilDigitizer, M_GC_FEATURE_BROWSER, M_OPEN+M_ASYNCHRONOUS);
-   
-   /* Print a message. */
-   MosPrintf(MIL_TEXT("\nDisplaying the camera's feature browser.\n"));
-   MosPrintf(MIL_TEXT("Press <Enter> to continue.\n"));
-   MosGetch();
-
-   /* Start a continuous acquisition. */
-   MdispSelect(MilDisplay, MilImage);
-   MdigGrabContinuous(MilDigitizer, MilImage);
-
-   /* Print a message. */
-   MosPrintf(MIL_TEXT("\nContinuous image grab in progress.\n"));
-   MosPrintf(MIL_TEXT("Press <Enter> to stop.\n"));
-   MosGetch();
-   
-   /* Stop the continuous acquisition. */
-   MdigHalt(MilDigitizer);
-
-   /* If we can trigger AcquisitionStart or FrameStart events, ask if we should do
-      triggered grabs. */
-   if(CanTriggerAcquisitionStart || CanTriggerFrameStart)
-      {
-#if M_MIL_USE_WINDOWS
-      system("cls");
-#endif
-      MosPrintf(MIL_TEXT("\nYour camera supports acquisition triggers.\n"));
-      MosPrintf(MIL_TEXT("Do you want to test triggered acquisition (Y/N)? "));
-      Selection = MosGetch();
-      MosPrintf(MIL_TEXT("\n"));
-      if ((Selection == 'Y') || (Selection == 'y'))
-         DoTriggeredAcquisition(MilSystem, MilDigitizer, MilImage);
-         }
-   else
-      {
-      MosPrintf(MIL_TEXT("\nPress <Enter> to quit.\n"));
-      MosGetch();
-      }
-
-
-   MappFreeDefault(MilApplication, MilSystem, MilDisplay, MilDigitizer, MilImage);
-
-   return 0;
-   }
-
-/* Prints SFNC features */
-void CameraPrintDeviceControls(MIL_ID MilDigitizer)
-   {
-   MIL_STRING CameraVendor;
-   MIL_STRING CameraModel;
-   MIL_STRING CameraSerialNumber;
-   MIL_STRING CameraUserName;
-   MIL_STRING CameraScanType;
-   MIL_STRING InterfaceName;
-   MIL_STRING IpAddress;
-
-   MdigInquireFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("DeviceVendorName"), M_TYPE_STRING, CameraVendor);
-   MdigInquireFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("DeviceModelName"), M_TYPE_STRING, CameraModel);
-   MdigInquireFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("DeviceID"), M_TYPE_STRING, CameraSerialNumber);
-   MdigInquireFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("DeviceUserID"), M_TYPE_STRING, CameraUserName);
-   MdigInquireFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("DeviceScanType"), M_TYPE_STRING, CameraScanType);
-
-   MosPrintf(MIL_TEXT("\n------------------ Camera Device Controls ------------------\n\n"));
-   MosPrintf(MIL_TEXT("%30s %s %s\n"), MIL_TEXT("Camera:"), CameraVendor.empty() ? MIL_TEXT("N/A") : CameraVendor.c_str(), CameraModel.empty() ? MIL_TEXT("N/A") : CameraModel.c_str());
-   MosPrintf(MIL_TEXT("%30s %s\n"), MIL_TEXT("Serial number:"), CameraSerialNumber.empty() ? MIL_TEXT("N/A") : CameraSerialNumber.c_str());
-   MosPrintf(MIL_TEXT("%30s %s\n"), MIL_TEXT("User-defined name:"), CameraUserName.empty() ? MIL_TEXT("N/A") : CameraUserName.c_str());
-   MosPrintf(MIL_TEXT("%30s %s\n"), MIL_TEXT("Device scan type:"), CameraScanType.empty() ? MIL_TEXT("N/A") : CameraScanType.c_str());
-
-   MdigInquire(MilDigitizer, M_GC_LOCAL_IP_ADDRESS_STRING, IpAddress);
-   MdigInquire(MilDigitizer, M_GC_INTERFACE_NAME, InterfaceName);
-   MosPrintf(MIL_TEXT("%30s %s (%s)\n"), MIL_TEXT("Camera is connected to:"), InterfaceName.c_str(), IpAddress.c_str());
-   }
-
-/* Prints SFNC features */
-void CameraPrintImageFormatControls(MIL_ID MilDigitizer)
-   {
-   MIL_INT64 SensorWidth = 0, SensorHeight = 0;
-   MIL_INT64 Width = 0, Height = 0, WidthMax = 0, HeightMax = 0, WidthMin = 0, HeightMin = 0;
-   MIL_INT PixFrmtCount = 0;
-   MIL_BOOL ReverseX = M_FALSE, ReverseY = M_FALSE;
-   vector<MIL_STRING> PixelFormats;
-
-   MdigInquireFeature(MilDigitizer, M_FEATURE_VALUE,  MIL_TEXT("SensorWidth"),   M_TYPE_INT64, &SensorWidth);
-   MdigInquireFeature(MilDigitizer, M_FEATURE_VALUE,  MIL_TEXT("SensorHeight"),  M_TYPE_INT64, &SensorHeight);
-   MdigInquireFeature(MilDigitizer, M_FEATURE_VALUE,  MIL_TEXT("Width"),         M_TYPE_INT64, &Width);
-   MdigInquireFeature(MilDigitizer, M_FEATURE_VALUE,  MIL_TEXT("Height"),        M_TYPE_INT64, &Height);
-   MdigInquireFeature(MilDigitizer, M_FEATURE_VALUE,  MIL_TEXT("ReverseX"),      M_TYPE_BOOLEAN, &ReverseX);
-   MdigInquireFeature(MilDigitizer, M_FEATURE_VALUE,  MIL_TEXT("ReverseY"),      M_TYPE_BOOLEAN, &ReverseY);
-   MdigInquireFeature(MilDigitizer, M_FEATURE_MAX,    MIL_TEXT("Width"),         M_TYPE_INT64, &WidthMax);
-   MdigInquireFeature(MilDigitizer, M_FEATURE_MAX,    MIL_TEXT("Height"),        M_TYPE_INT64, &HeightMax);
-   MdigInquireFeature(MilDigitizer, M_FEATURE_MIN,    MIL_TEXT("Width"),         M_TYPE_INT64, &WidthMin);
-   MdigInquireFeature(MilDigitizer, M_FEATURE_MIN,    MIL_TEXT("Height"),        M_TYPE_INT64, &HeightMin);
-
-   MdigInquireFeature(MilDigitizer, M_FEATURE_ENUM_ENTRY_COUNT, MIL_TEXT("PixelFormat"), M_TYPE_MIL_INT, &PixFrmtCount);
-   if(PixFrmtCount)
-      {
-      PixelFormats.assign(PixFrmtCount, MIL_TEXT(""));
-      for (size_t i = 0; i<PixelFormats.size(); i++)
-         {
-         MdigInquireFeature(MilDigitizer, M_FEATURE_ENUM_ENTRY_NAME+i, MIL_TEXT("PixelFormat"), M_TYPE_STRING, PixelFormats[i]);
-         }
-      }
-
-   MosPrintf(MIL_TEXT("\n------------------- Image Format Controls ------------------\n\n"));
-   MosPrintf(MIL_TEXT("%30s %4lld x %-4lld\n"), MIL_TEXT("Sensor size:"), SensorWidth?SensorWidth:Width, SensorHeight?SensorHeight:Height);
-   MosPrintf(MIL_TEXT("%30s %4lld x %-4lld\n"), MIL_TEXT("Current ROI:"), Width, Height);
-   MosPrintf(MIL_TEXT("%30s %4lld x %-4lld;%4lld x %-4lld\n"), MIL_TEXT("Maximum and Minimum ROI:"), WidthMax, HeightMax, WidthMin, HeightMin);
-   MosPrintf(MIL_TEXT("\n%30s %s\n"), MIL_TEXT("Image Reverse X:"), ReverseX ? MIL_TEXT("true") : MIL_TEXT("false"));
-   MosPrintf(MIL_TEXT("%30s %s\n"), MIL_TEXT("Image Reverse Y:"), ReverseY ? MIL_TEXT("true") : MIL_TEXT("false"));
-   MosPrintf(MIL_TEXT("\n%30s %s\n"), MIL_TEXT("Supported pixel formats:"), PixelFormats.size() ? PixelFormats[0].c_str() : MIL_TEXT("N/A"));
-   for (size_t i = 1; i<PixelFormats.size(); i++)
-      MosPrintf(MIL_TEXT("                               %s\n"), PixelFormats[i].c_str());
-   }
-
-/* Prints SFNC features */
-void CameraPrintAcquisitionControls(MIL_ID MilDigitizer)
-   {
-   vector<MIL_STRING> AcquisitionModes;
-   vector<MIL_STRING> TriggerSelectors;
-   vector<MIL_STRING> ExposureModes;
-   MIL_DOUBLE ExposureTime = 0.0;
-   MIL_INT AcMdCount = 0;
-   MIL_INT TgSelCount = 0;
-   MIL_INT ExMdCount = 0;
-
-   MdigInquireFeature(MilDigitizer, M_FEATURE_ENUM_ENTRY_COUNT, MIL_TEXT("AcquisitionMode"), M_TYPE_MIL_INT, &AcMdCount);
-   if(AcMdCount)
-      {
-      AcquisitionModes.assign(AcMdCount, MIL_TEXT(""));
-      if(AcMdCount > 1)
-         MultipleAcquisitionModeSupport = 1;
-
-   for (size_t i = 0; i < AcquisitionModes.size(); i++)
-      {
-         MdigInquireFeature(MilDigitizer, M_FEATURE_ENUM_ENTRY_NAME + i, MIL_TEXT("AcquisitionMode"), M_TYPE_STRING, AcquisitionModes[i]);
-
-      if(MIL_TEXT("Continuous") == AcquisitionModes[i])
-         ContinuousAMSupport = true;
-      else if(MIL_TEXT("SingleFrame") == AcquisitionModes[i])
-         SingleFrameAMSupport = true;
-      else if(MIL_TEXT("MultiFrame") == AcquisitionModes[i])
-         MultiFrameAMSupport = true;
-      }
-      }
-
-   MdigInquireFeature(MilDigitizer, M_FEATURE_ENUM_ENTRY_COUNT, MIL_TEXT("TriggerSelector"), M_TYPE_MIL_INT, &TgSelCount);
-   if(TgSelCount)
-      {
-      TriggerSelectors.assign(TgSelCount, MIL_TEXT(""));
-   for (size_t i = 0; i < TriggerSelectors.size(); i++)
-      {
-         MdigInquireFeature(MilDigitizer, M_FEATURE_ENUM_ENTRY_NAME + i, MIL_TEXT("TriggerSelector"), M_TYPE_STRING, TriggerSelectors[i]);
-
-      if(MIL_TEXT("AcquisitionStart") == TriggerSelectors[i])
-         CanTriggerAcquisitionStart = true;
-      else if(MIL_TEXT("FrameStart") == TriggerSelectors[i])
-         CanTriggerFrameStart = true;
-      }
-      }
-
-   MdigInquireFeature(MilDigitizer, M_FEATURE_ENUM_ENTRY_COUNT, MIL_TEXT("ExposureMode"), M_TYPE_MIL_INT, &ExMdCount);
-   if(ExMdCount)
-      {
-      ExposureModes.assign(ExMdCount, MIL_TEXT(""));
-      for (size_t i = 0; i < ExposureModes.size(); i++)
-         {
-         MdigInquireFeature(MilDigitizer, M_FEATURE_ENUM_ENTRY_NAME+i, MIL_TEXT("ExposureMode"), M_TYPE_STRING, ExposureModes[i]);
-         }
-      }
-
-   MdigInquireFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("ExposureTime"), M_TYPE_MIL_DOUBLE, &ExposureTime);
-
-   MosPrintf(MIL_TEXT("\n------------------- Acquisition Controls -------------------\n\n"));
-   
-   MosPrintf(MIL_TEXT("%30s %s\n"), MIL_TEXT("Supported acquisition modes:"), AcquisitionModes.size() ? AcquisitionModes[0].c_str() : MIL_TEXT("N/A"));
-   for (size_t i = 1; i < AcquisitionModes.size(); i++)
-      MosPrintf(MIL_TEXT("%30s %s\n"), MIL_TEXT(""), AcquisitionModes[i].c_str());
-
-   MosPrintf(MIL_TEXT("\n%30s %s\n"), MIL_TEXT("Supported trigger selectors:"), TriggerSelectors.size() ? TriggerSelectors[0].c_str() : MIL_TEXT("N/A"));
-   for (size_t i = 1; i < TriggerSelectors.size(); i++)
-      MosPrintf(MIL_TEXT("%30s %s\n"), MIL_TEXT(""), TriggerSelectors[i].c_str());
-
-   MosPrintf(MIL_TEXT("\n%30s %s\n"), MIL_TEXT("Supported exposure modes:"), ExposureModes.size() ? ExposureModes[0].c_str() : MIL_TEXT("N/A"));
-   for (size_t i = 1; i < ExposureModes.size(); i++)
-      MosPrintf(MIL_TEXT("%30s %s\n"), MIL_TEXT(""), ExposureModes[i].c_str());
-
-   if(ExposureTime == 0.0)
-      MosPrintf(MIL_TEXT("\n%30s %s\n"), MIL_TEXT("Exposure time:"), MIL_TEXT("N/A"));
-   else
-      MosPrintf(MIL_TEXT("\n%30s %.1f us\n"), MIL_TEXT("Exposure time:"), ExposureTime);
-   }
-
-/* Prints SFNC features */
-void CameraPrintIOControls(MIL_ID MilDigitizer)
-   {
-   vector<MIL_STRING> Lines;
-   vector<MIL_STRING> LineFormats;
-   vector<MIL_STRING> LineModes;
-   MIL_INT LineCnt = 0;
-
-   MdigInquireFeature(MilDigitizer, M_FEATURE_ENUM_ENTRY_COUNT, MIL_TEXT("LineSelector"), M_TYPE_MIL_INT, &LineCnt);
-   if(LineCnt)
-      {
-      Lines.assign(LineCnt, MIL_TEXT(""));
-      LineFormats.assign(LineCnt, MIL_TEXT(""));
-      LineModes.assign(LineCnt, MIL_TEXT(""));
-   for (size_t i = 0; i < Lines.size(); i++)
-      {
-         MdigInquireFeature(MilDigitizer, M_FEATURE_ENUM_ENTRY_NAME+i, MIL_TEXT("LineSelector"), M_TYPE_STRING, Lines[i]);
-         }
-
-      for (size_t i = 0; i < Lines.size(); i++)
-         {
-      MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("LineSelector"), M_TYPE_STRING, Lines[i]);
-         MdigInquireFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("LineMode"), M_TYPE_STRING, LineModes[i]);
-         MdigInquireFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("LineFormat"), M_TYPE_STRING, LineFormats[i]);
-      }
-      }
-   
-   MosPrintf(MIL_TEXT("\n------------------- Digital I/O Controls -------------------\n\n"));
-
-   MosPrintf(MIL_TEXT("%7s%-18s%-18s%-18s%7s\n\n"), MIL_TEXT(""), MIL_TEXT("Name"), MIL_TEXT("Mode"), MIL_TEXT("Format"), MIL_TEXT(""));
-
-   if(LineCnt == 0)
-      MosPrintf(MIL_TEXT("%7s%-18s%-18s%-18s%7s\n"), MIL_TEXT(""), MIL_TEXT("N/A"), MIL_TEXT("N/A"), MIL_TEXT("N/A"), MIL_TEXT(""));
-   else
-      {
-      for (size_t i = 0; i < Lines.size(); i++)
-         MosPrintf(MIL_TEXT("%7s%-18s%-18s%-18s%7s\n"), MIL_TEXT(""), Lines[i].c_str(), LineModes[i].c_str(), LineFormats[i].c_str(), MIL_TEXT(""));
-      }
-   }
-
-/* Prints SFNC features */
-void CameraPrintTransportLayerControls(MIL_ID MilDigitizer)
-   {
-   MIL_INT64 GigEMajorVersion = 0;
-   MIL_INT64 GigEMinorVersion = 0;
-   MIL_INT64 StreamChannelPacketSize = 0;
-   MIL_INT64 CurrentIp = -1;
-   MIL_INT64 MAC = -1;
-   MIL_UINT8* Ip = (MIL_UINT8*)&CurrentIp;
-   MIL_UINT8* pMAC = (MIL_UINT8*)&MAC;
-
-   MdigInquireFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GevVersionMajor"),      M_TYPE_INT64, &GigEMajorVersion);
-   MdigInquireFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GevVersionMinor"),      M_TYPE_INT64, &GigEMinorVersion);
-   MdigInquireFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GevSCPSPacketSize"),    M_TYPE_INT64, &StreamChannelPacketSize);
-   MdigInquireFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GevMACAddress"),        M_TYPE_INT64, &MAC);
-   MdigInquireFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GevCurrentIPAddress"),  M_TYPE_INT64, &CurrentIp);
-
-   MosPrintf(MIL_TEXT("\n-------------- Camera Transport Layer Controls -------------\n\n"));
-   if(GigEMajorVersion == 0)
-      MosPrintf(MIL_TEXT("%30s N/A\n"), MIL_TEXT("GigE Vision Version:"));
-   else 
-      MosPrintf(MIL_TEXT("%30s %d.%d\n"), MIL_TEXT("GigE Vision Version:"), (int)GigEMajorVersion, (int)GigEMinorVersion);
-
-   if(MAC == -1)
-      MosPrintf(MIL_TEXT("%30s N/A\n"), MIL_TEXT("MAC Address:"));
-   else
-      MosPrintf(MIL_TEXT("%30s %.2X-%.2X-%.2X-%.2X-%.2X-%.2X\n"), MIL_TEXT("MAC Address:"), pMAC[5], pMAC[4], pMAC[3], pMAC[2], pMAC[1], pMAC[0]);
-
-   if(CurrentIp == -1)
-      MosPrintf(MIL_TEXT("%30s N/A\n"), MIL_TEXT("Current IP Address:"));
-   else
-      MosPrintf(MIL_TEXT("%30s %d.%d.%d.%d\n"), MIL_TEXT("Current IP Address:"), (int)Ip[3], (int)Ip[2], (int)Ip[1], (int)Ip[0]);
-   
-   MosPrintf(MIL_TEXT("%30s %lld\n"), MIL_TEXT("Packet size:"), (long long)StreamChannelPacketSize);
-   }
-
-/* Prints SFNC features */
-void CameraPrintCounterAndTimerControls(MIL_ID MilDigitizer)
-   {
-   vector<MIL_STRING> Counters;
-   vector<MIL_STRING> CountersStatus;
-   vector<MIL_STRING> Timers;
-   vector<MIL_STRING> TimersStatus;
-   MIL_INT CountersCnt = 0;
-   MIL_INT TimersCnt = 0;
-
-   MdigInquireFeature(MilDigitizer, M_FEATURE_ENUM_ENTRY_COUNT, MIL_TEXT("CounterSelector"), M_TYPE_MIL_INT, &CountersCnt);
-   if(CountersCnt)
-      {
-      Counters.assign(CountersCnt, MIL_TEXT(""));
-      CountersStatus.assign(CountersCnt, MIL_TEXT(""));
-   for (size_t i = 0; i < Counters.size(); i++)
-      {
-         MdigInquireFeature(MilDigitizer, M_FEATURE_ENUM_ENTRY_NAME + i, MIL_TEXT("CounterSelector"), M_TYPE_STRING, Counters[i]);
-      }
-      }
-
-   MdigInquireFeature(MilDigitizer, M_FEATURE_ENUM_ENTRY_COUNT, MIL_TEXT("TimerSelector"), M_TYPE_MIL_INT, &TimersCnt);
-   if(TimersCnt)
-      {
-      Timers.assign(TimersCnt, MIL_TEXT(""));
-      TimersStatus.assign(TimersCnt, MIL_TEXT(""));
-   for (size_t i = 0; i < Timers.size(); i++)
-      {
-         MdigInquireFeature(MilDigitizer, M_FEATURE_ENUM_ENTRY_NAME + i, MIL_TEXT("TimerSelector"), M_TYPE_STRING, Timers[i]);
-         }
-      }
-
-   for (size_t i = 0; i < CountersStatus.size(); i++)
-      {
-      MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("CounterSelector"), M_TYPE_STRING, Counters[i]);
-      MdigInquireFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("CounterStatus"), M_TYPE_STRING, CountersStatus[i]);
-      }
-
-   for (size_t i = 0; i < TimersStatus.size(); i++)
-      {
-      MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TimerSelector"), M_TYPE_STRING, Timers[i]);
-      MdigInquireFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TimerStatus"), M_TYPE_STRING, TimersStatus[i]);
-      }
-
-   MosPrintf(MIL_TEXT("\n---------------- Counter and Timer Controls ----------------\n\n"));
-
-   MosPrintf(MIL_TEXT("%20s%-15s%-15s%20s\n\n"), MIL_TEXT(""), MIL_TEXT("Name"), MIL_TEXT("Status"), MIL_TEXT(""));
-
-   if (Counters.size() == 0)
-      MosPrintf(MIL_TEXT("%20s%-15s%-15s%20s\n"), MIL_TEXT(""), MIL_TEXT("N/A"), MIL_TEXT("N/A"), MIL_TEXT(""));
-   else
-      {
-      for (size_t i = 0; i < Counters.size(); i++)
-         MosPrintf(MIL_TEXT("%20s%-15s%-15s%20s\n"), MIL_TEXT(""), Counters[i].c_str(), CountersStatus[i].c_str(), MIL_TEXT(""));
-      }
-
-   if (Timers.size() == 0)
-      MosPrintf(MIL_TEXT("%20s%-15s%-15s%20s\n"), MIL_TEXT(""), MIL_TEXT("N/A"), MIL_TEXT("N/A"), MIL_TEXT(""));
-   else
-      {
-      for (size_t i = 0; i < Timers.size(); i++)
-         MosPrintf(MIL_TEXT("%20s%-15s%-15s%20s\n"), MIL_TEXT(""), Timers[i].c_str(), TimersStatus[i].c_str(), MIL_TEXT(""));
-      }
-   }
-
-/* Prints SFNC features */
-void CameraPrintEventControls(MIL_ID MilDigitizer)
-   {
-   vector<MIL_STRING> Events;
-   MIL_INT EventCnt = 0;
-
-   MdigInquireFeature(MilDigitizer, M_FEATURE_ENUM_ENTRY_COUNT, MIL_TEXT("EventSelector"), M_TYPE_MIL_INT, &EventCnt);
-   if(EventCnt)
-      {
-      Events.assign(EventCnt, MIL_TEXT(""));
-      for (size_t i = 0; i < Events.size(); i++)
-         {
-         MdigInquireFeature(MilDigitizer, M_FEATURE_ENUM_ENTRY_NAME + i, MIL_TEXT("EventSelector"), M_TYPE_STRING, Events[i]);
-         }
-      }
-   
-   MosPrintf(MIL_TEXT("\n---------------------- Event Controls ----------------------\n\n"));
-   MosPrintf(MIL_TEXT("%30s "), MIL_TEXT("Supported events:"));
-
-   if(Events.size() == 0)
-      MosPrintf(MIL_TEXT("N/A\n"));
-   else
-      {
-      MosPrintf(MIL_TEXT("%s\n"), Events[0].c_str());
-      for(size_t i = 1; i < Events.size(); i++)
-         MosPrintf(MIL_TEXT("                               %s\n"), Events[i].c_str());
-      }
-   }
-
-void CameraPrintLUT(MIL_ID MilDigitizer)
-   {
-   MIL_INT64 MinIndex = 0, MaxIndex = 0, LutValue = 0;
-   MIL_INT LutSelCount = 0;
-   vector<MIL_STRING> LutSelectors;
-   MIL_STRING Str(16, '\0');
-
-   MdigInquireFeature(MilDigitizer, M_FEATURE_ENUM_ENTRY_COUNT, MIL_TEXT("LUTSelector"), M_TYPE_MIL_INT, &LutSelCount);
-   if(LutSelCount)
-      {
-      LutSelectors.assign(LutSelCount, MIL_TEXT(""));
-   for (size_t i = 0; i < LutSelectors.size(); i++)
-      {
-         MdigInquireFeature(MilDigitizer, M_FEATURE_ENUM_ENTRY_NAME + i, MIL_TEXT("LUTSelector"), M_TYPE_STRING, LutSelectors[i]);
-
-      MosPrintf(MIL_TEXT("\nPress <Enter> to print %s Lookup table.\n"), LutSelectors[i].c_str());
-      MosGetch();
-#if M_MIL_USE_WINDOWS
-      system("cls");
-#endif
-
-      MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("LUTSelector"), M_TYPE_STRING, LutSelectors[i]);
-
-      MosPrintf(MIL_TEXT("\n------- Printing (%s) lookup table contents -----\n"), LutSelectors[i].c_str());
-
-      MdigInquireFeature(MilDigitizer, M_FEATURE_MIN, MIL_TEXT("LUTIndex"), M_TYPE_INT64, &MinIndex);
-      MdigInquireFeature(MilDigitizer, M_FEATURE_MAX, MIL_TEXT("LUTIndex"), M_TYPE_INT64, &MaxIndex);
-
-      for (MIL_INT64 j = MinIndex; j <= MaxIndex; j++)
-         {
-         MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("LUTIndex"), M_TYPE_INT64, &j);
-         MdigInquireFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("LUTValue"), M_TYPE_INT64, &LutValue);
-
-         if ((j % 5) == 0)
-            MosPrintf(MIL_TEXT("\n"));
-
-         MosSprintf(&Str[0], Str.size(), MIL_TEXT("[%lld]"), (long long)j);
-         MosPrintf(MIL_TEXT("%7s : %-6lld"), Str.c_str(), (long long)LutValue);
-         }
-      }
-   }
-   }
-
-void CameraPrintDeviceCapabilities(MIL_ID MilDigitizer)
-   {
-#if M_MIL_USE_WINDOWS
-   system("cls");
-#endif
-   MosPrintf(MIL_TEXT("------------------------------------------------------------\n\n"));
-   MosPrintf(MIL_TEXT("                      Camera capabilities.                  \n\n"));
-   CameraPrintControlProtocolCapabilities(MilDigitizer);
-   MosPrintf(MIL_TEXT("\nPress <Enter> to continue\n"));
-   MosGetch();
-#if M_MIL_USE_WINDOWS
-   system("cls");
-#endif
-   MosPrintf(MIL_TEXT("------------------------------------------------------------\n\n"));
-   MosPrintf(MIL_TEXT("                      Camera capabilities.                  \n\n"));
-   CameraPrintStreamProtocolCapabilities(MilDigitizer);
-   MosPrintf(MIL_TEXT("\nPress <Enter> to continue\n"));
-   MosGetch();
-#if M_MIL_USE_WINDOWS
-   system("cls");
-#endif
-   MosPrintf(MIL_TEXT("------------------------------------------------------------\n\n"));
-   MosPrintf(MIL_TEXT("                      Camera capabilities.                  \n\n"));
-   CameraPrintMessageProtocolCapabilities(MilDigitizer);
-   MosPrintf(MIL_TEXT("\nPress <Enter> to continue\n"));
-   MosGetch();
-#if M_MIL_USE_WINDOWS
-   system("cls");
-#endif
-   MosPrintf(MIL_TEXT("------------------------------------------------------------\n\n"));
-   MosPrintf(MIL_TEXT("                      Camera capabilities.                  \n\n"));
-   CameraPrintStreamChannelCapabilities(MilDigitizer);
-   MosPrintf(MIL_TEXT("\nPress <Enter> to continue\n"));
-   MosGetch();
-#if M_MIL_USE_WINDOWS
-   system("cls");
-#endif
-   MosPrintf(MIL_TEXT("------------------------------------------------------------\n\n"));
-   MosPrintf(MIL_TEXT("                      Camera capabilities.                  \n\n"));
-   CameraPrintPhysicalLinkConfigurationCapabilities(MilDigitizer);
-   MosPrintf(MIL_TEXT("\nPress <Enter> to continue\n"));
-   MosGetch();
-#if M_MIL_USE_WINDOWS
-   system("cls");
-#endif
-   MosPrintf(MIL_TEXT("------------------------------------------------------------\n\n"));
-   MosPrintf(MIL_TEXT("                      Camera capabilities.                  \n\n"));
-   CameraPrintNetworkInterfaceCapabilities(MilDigitizer);
-   MosPrintf(MIL_TEXT("\nPress <Enter> to continue\n"));
-   MosGetch();
-#if M_MIL_USE_WINDOWS
-   system("cls");
-#endif
-   MosPrintf(MIL_TEXT("------------------------------------------------------------\n\n"));
-   MosPrintf(MIL_TEXT("                      Camera capabilities.                  \n\n"));
-   CameraPrintNetworkInterfaceConfiguration(MilDigitizer);
-   }
-
-void CameraPrintControlProtocolCapabilities(MIL_ID MilDigitizer)
-   {
-   MIL_INT Capability = 0;
-   MdigInquire(MilDigitizer, M_GC_CONTROL_PROTOCOL_CAPABILITY, &Capability);
-   
-   MosPrintf(MIL_TEXT("Control Protocol Capabilities\n\n"));
-
-   if (Capability == 0)
-      {
-      MosPrintf(MIL_TEXT("None\n"));
-      return;
-      }
-
-   if (Capability & M_GC_USER_DEFINED_NAME_SUPPORT)
-      MosPrintf(MIL_TEXT("User defined name\n"));
-   if (Capability & M_GC_SERIAL_NUMBER_SUPPORT)
-      MosPrintf(MIL_TEXT("Serial number\n"));
-   if (Capability & M_GC_HEARTBEAT_DISABLE_SUPPORT)
-      MosPrintf(MIL_TEXT("Heartbeat disable\n"));
-   if (Capability & M_GC_LINK_SPEED_REGISTER_SUPPORT)
-      MosPrintf(MIL_TEXT("Link speed register\n"));
-   if (Capability & M_GC_PORT_AND_IP_REGISTER_SUPPORT)
-      MosPrintf(MIL_TEXT("Port and IP register\n"));
-   if (Capability & M_GC_MANIFEST_TABLE_SUPPORT)
-      MosPrintf(MIL_TEXT("Manifest table\n"));
-   if (Capability & M_GC_TEST_DATA_SUPPORT)
-      MosPrintf(MIL_TEXT("Test data\n"));
-   if (Capability & M_GC_DISCOVERY_ACK_DELAY_SUPPORT)
-      MosPrintf(MIL_TEXT("Discovery ack delay\n"));
-   if (Capability & M_GC_WRITABLE_DISCOVERY_ACK_DELAY_SUPPORT)
-      MosPrintf(MIL_TEXT("Writable discovery ack_delay\n"));
-   if (Capability & M_GC_EXTENDED_STATUS_CODES_1_SUPPORT)
-      MosPrintf(MIL_TEXT("Extended status codes 1.1\n"));
-   if (Capability & M_GC_PRIMARY_APP_SWITCHOVER_SUPPORT)
-      MosPrintf(MIL_TEXT("Primary app switchover\n"));
-   if (Capability & M_GC_UNCONDITIONAL_ACTION_SUPPORT)
-      MosPrintf(MIL_TEXT("Unconditional action\n"));
-   if (Capability & M_GC_IEEE_1588_SUPPORT)
-      MosPrintf(MIL_TEXT("IEEE 1588\n"));
-   if (Capability & M_GC_EXTENDED_STATUS_CODES_2_SUPPORT)
-      MosPrintf(MIL_TEXT("Extended status codes 2.0\n"));
-   if (Capability & M_GC_SCHEDULED_ACTION_SUPPORT)
-      MosPrintf(MIL_TEXT("Scheduled action\n"));
-   if (Capability & M_GC_ACTION_SUPPORT)
-      MosPrintf(MIL_TEXT("Action\n"));
-   if (Capability & M_GC_PENDING_ACK_SUPPORT)
-      MosPrintf(MIL_TEXT("Pending ack\n"));
-   if (Capability & M_GC_EVENT_DATA_SUPPORT)
-      MosPrintf(MIL_TEXT("Event data\n"));
-   if (Capability & M_GC_EVENT_SUPPORT)
-      MosPrintf(MIL_TEXT("Event\n"));
-   if (Capability & M_GC_PACKET_RESEND_SUPPORT)
-      MosPrintf(MIL_TEXT("Packet resend\n"));
-   if (Capability & M_GC_WRITE_MEM_SUPPORT)
-      MosPrintf(MIL_TEXT("Write mem\n"));
-   if (Capability & M_GC_CONCATENATION_SUPPORT)
-      MosPrintf(MIL_TEXT("Concatenation\n"));
-   }
-
-void CameraPrintStreamProtocolCapabilities(MIL_ID MilDigitizer)
-   {
-   MIL_INT Capability = 0;
-   MdigInquire(MilDigitizer, M_GC_STREAM_PROTOCOL_CAPABILITY, &Capability);
-
-   MosPrintf(MIL_TEXT("Stream Protocol Capabilities\n\n"));
-   
-   if (Capability == 0)
-      {
-      MosPrintf(MIL_TEXT("None\n"));
-      return;
-      }
-
-   if (Capability & M_GC_FIREWALL_TRAVERSAL_SUPPORT)
-      MosPrintf(MIL_TEXT("Firewall traversal\n"));
-   if (Capability & M_GC_LEGACY_16BIT_BLOCK_SUPPORT)
-      MosPrintf(MIL_TEXT("Legacy 16bit block\n"));
-   }
-
-void CameraPrintMessageProtocolCapabilities(MIL_ID MilDigitizer)
-   {
-   MIL_INT Capability = 0;
-   MdigInquire(MilDigitizer, M_GC_MESSAGE_PROTOCOL_CAPABILITY, &Capability);
-
-   MosPrintf(MIL_TEXT("Message Protocol Capabilities\n\n"));
-
-   if (Capability == 0)
-      {
-      MosPrintf(MIL_TEXT("None\n"));
-      return;
-      }
-
-   if (Capability & M_GC_FIREWALL_TRAVERSAL_SUPPORT)
-      MosPrintf(MIL_TEXT("Firewall traversal\n"));
-   }
-
-void CameraPrintStreamChannelCapabilities(MIL_ID MilDigitizer)
-   {
-   MIL_INT Capability = 0;
-   MdigInquire(MilDigitizer, M_GC_STREAM_CHANNEL_CAPABILITY, &Capability);
-
-   MosPrintf(MIL_TEXT("Stream Channel Capabilities\n\n"));
-
-   if (Capability == 0)
-      {
-      MosPrintf(MIL_TEXT("None\n"));
-      return;
-      }
-
-   if (Capability & M_GC_BIG_AND_LITTLE_ENDIAN_SUPPORT)
-      MosPrintf(MIL_TEXT("Big and little_endian\n"));
-   if (Capability & M_GC_IP_REASSEMBLY_SUPPORT)
-      MosPrintf(MIL_TEXT("IP reassembly\n"));
-   if (Capability & M_GC_MULTI_ZONE_SUPPORT)
-      MosPrintf(MIL_TEXT("Multi zone\n"));
-   if (Capability & M_GC_PACKET_RESEND_OPTION_SUPPORT)
-      MosPrintf(MIL_TEXT("Packet resend option\n"));
-   if (Capability & M_GC_ALL_IN_SUPPORT)
-      MosPrintf(MIL_TEXT("All in\n"));
-   if (Capability & M_GC_UNCONDITIONAL_STREAMING_SUPPORT)
-      MosPrintf(MIL_TEXT("Unconditional streaming\n"));
-   if (Capability & M_GC_EXTENDED_CHUNK_DATA_SUPPORT)
-      MosPrintf(MIL_TEXT("Extended chunk data\n"));
-   }
-
-void CameraPrintPhysicalLinkConfigurationCapabilities(MIL_ID MilDigitizer)
-   {
-   MIL_INT Capability = 0;
-   MdigInquire(MilDigitizer, M_GC_PHYSICAL_LINK_CONFIGURATION_CAPABILITY, &Capability);
-
-   MosPrintf(MIL_TEXT("Physical Link Configuration Capabilities\n\n"));
-
-   if (Capability == 0)
-      {
-      MosPrintf(MIL_TEXT("None\n"));
-      return;
-      }
-
-   if (Capability & M_GC_SINGLE_LINK_SUPPORT)
-      MosPrintf(MIL_TEXT("Single link\n"));
-   if (Capability & M_GC_MULTIPLE_LINK_SUPPORT)
-      MosPrintf(MIL_TEXT("Multiple link\n"));
-   if (Capability & M_GC_STATIC_LINK_AGGREGATION_SUPPORT)
-      MosPrintf(MIL_TEXT("Static link aggregation\n"));
-   if (Capability & M_GC_DYNAMIC_LINK_AGGREGATION_SUPPORT)
-      MosPrintf(MIL_TEXT("Dynamic link aggregation\n"));
-   }
-
-void CameraPrintNetworkInterfaceCapabilities(MIL_ID MilDigitizer)
-   {
-   MIL_INT Capability = 0;
-   MdigInquire(MilDigitizer, M_GC_NETWORK_INTERFACE_CAPABILITY, &Capability);
-
-   MosPrintf(MIL_TEXT("Network Interface Capabilities\n\n"));
-
-   if (Capability == 0)
-      {
-      MosPrintf(MIL_TEXT("None\n"));
-      return;
-      }
-
-   if (Capability & M_GC_PAUSE_RECEPTION_SUPPORT)
-      MosPrintf(MIL_TEXT("Pause reception\n"));
-   if (Capability & M_GC_PAUSE_GENERATION_SUPPORT)
-      MosPrintf(MIL_TEXT("Pause generation\n"));
-   if (Capability & M_GC_LINK_LOCAL_ADDRESS_SUPPORT)
-      MosPrintf(MIL_TEXT("Link local address\n"));
-   if (Capability & M_GC_DHCP_SUPPORT)
-      MosPrintf(MIL_TEXT("DHCP\n"));
-   if (Capability & M_GC_PERSISTENT_IP_SUPPORT)
-      MosPrintf(MIL_TEXT("Persistent IP\n"));
-   }
-
-void CameraPrintNetworkInterfaceConfiguration(MIL_ID MilDigitizer)
-   {
-   MIL_INT Configuration = 0;
-   MdigInquire(MilDigitizer, M_GC_NETWORK_INTERFACE_CONFIGURATION, &Configuration);
-
-   MosPrintf(MIL_TEXT("Network Interface Configuration\n\n"));
-
-   if (Configuration == 0)
-      {
-      MosPrintf(MIL_TEXT("None\n"));
-      return;
-      }
-
-   if (Configuration & M_GC_PAUSE_RECEPTION_SUPPORT)
-      MosPrintf(MIL_TEXT("Pause reception Enabled\n"));
-   if (Configuration & M_GC_PAUSE_GENERATION_SUPPORT)
-      MosPrintf(MIL_TEXT("Pause generation Enabled\n"));
-   if (Configuration & M_GC_LINK_LOCAL_ADDRESS_SUPPORT)
-      MosPrintf(MIL_TEXT("Link local address Enabled\n"));
-   if (Configuration & M_GC_DHCP_SUPPORT)
-      MosPrintf(MIL_TEXT("DHCP Enabled\n"));
-   if (Configuration & M_GC_PERSISTENT_IP_SUPPORT)
-      MosPrintf(MIL_TEXT("Persistent IP Enabled\n"));
-   }
-
-/* Set the camera in triggered mode according to the user's input. */
-void SetTriggerControls(MIL_ID MilDigitizer, eTriggerType& Type, MIL_INT64& NbFrames, MIL_STRING& oTriggerSelector, bool &SoftwareTriggerSelected)
-   {
-   MIL_INT Done = 0;
-
-   if(CanTriggerAcquisitionStart && MultipleAcquisitionModeSupport)
-      {
-      MIL_INT Selection;
-
-      do
-         {
-         MosPrintf(MIL_TEXT("\n\n%-35s"), MIL_TEXT("Do you want to trigger a:")); 
-
-         if(ContinuousAMSupport)
-            MosPrintf(MIL_TEXT("(C) %-30s\n%35s"), MIL_TEXT("Continuous acquisition"), MIL_TEXT(""));
-         if(MultiFrameAMSupport)
-            MosPrintf(MIL_TEXT("(M) %-30s\n%35s"), MIL_TEXT("MultiFrame acquisition"), MIL_TEXT(""));
-         if(SingleFrameAMSupport)
-            MosPrintf(MIL_TEXT("(S) %-30s\n%35s"), MIL_TEXT("SingleFrame acquisition"), MIL_TEXT(""));
-
-         MosPrintf(MIL_TEXT("\n"));
-         Selection = MosGetch();
-         Done = 1;
-         switch(Selection)
-            {
-            case 'c':
-            case 'C':
-               oTriggerSelector = MIL_TEXT("AcquisitionStart");
-               MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("AcquisitionMode"), M_TYPE_STRING, MIL_TEXT("Continuous"));
-               MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerSelector"), M_TYPE_STRING, MIL_TEXT("AcquisitionStart"));
-               MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerMode"), M_TYPE_STRING, MIL_TEXT("On"));
-               MosPrintf(MIL_TEXT("Continuous acquisition trigger selected.\n"));
-               SelectTriggerSource(MilDigitizer, SoftwareTriggerSelected);
-               Type = eContinuous;
-               break;
-            case 'm':
-            case 'M':
-               oTriggerSelector = MIL_TEXT("AcquisitionStart");
-               MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("AcquisitionMode"), M_TYPE_STRING, MIL_TEXT("MultiFrame"));
-               MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerSelector"), M_TYPE_STRING, MIL_TEXT("AcquisitionStart"));
-               MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerMode"), M_TYPE_STRING, MIL_TEXT("On"));
-               MosPrintf(MIL_TEXT("Multi Frame acquisition trigger selected.\n"));
-               SelectTriggerSource(MilDigitizer, SoftwareTriggerSelected);
-
-               MosPrintf(MIL_TEXT("\n%-30s"), MIL_TEXT("\nHow many frames per trigger?"), MIL_TEXT(""));
-#if M_MIL_USE_WINDOWS
-               scanf_s("%lld", &(long long)NbFrames);
-#else
-               scanf("%lld", (long long *)&NbFrames);
-#endif
-               MosPrintf(MIL_TEXT("%lld Frames will be acquired per trigger.\n"), (long long)NbFrames);
-               MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("AcquisitionFrameCount"), M_TYPE_INT64, &NbFrames);
-               Type = eMultiFrame;
-               break;
-            case 's':
-            case 'S':
-               if(CanTriggerFrameStart)
-                  {
-                  oTriggerSelector = MIL_TEXT("FrameStart");
-                  MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("AcquisitionMode"), M_TYPE_STRING, MIL_TEXT("Continuous"));
-                  MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerSelector"), M_TYPE_STRING, MIL_TEXT("FrameStart"));
-                  MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerMode"), M_TYPE_STRING, MIL_TEXT("On"));
-                  }
-               else
-                  {
-                  oTriggerSelector = MIL_TEXT("AcquisitionStart");
-                  MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("AcquisitionMode"), M_TYPE_STRING, MIL_TEXT("SingleFrame"));
-                  MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerSelector"), M_TYPE_STRING, MIL_TEXT("AcquisitionStart"));
-                  MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerMode"), M_TYPE_STRING, MIL_TEXT("On"));
-                  }
-
-               MosPrintf(MIL_TEXT("Single Frame acquisition trigger selected.\n"));
-               SelectTriggerSource(MilDigitizer, SoftwareTriggerSelected);
-               Type = eSingleFrame;
-               break;
-            default:
-               MosPrintf(MIL_TEXT("Invalid selection."));
-               Done = 0;
-               break;
-            }
-         }
-      while(!Done);
-      }
-   else if(CanTriggerFrameStart)
-      {
-      oTriggerSelector = MIL_TEXT("FrameStart");
-      MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerSelector"), M_TYPE_STRING, MIL_TEXT("FrameStart"));
-      MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerMode"), M_TYPE_STRING, MIL_TEXT("On"));
-      MosPrintf(MIL_TEXT("\n\nFrame start trigger will be performed.\n"));
-      SelectTriggerSource(MilDigitizer, SoftwareTriggerSelected);
-      Type = eSingleFrame;
-      }
-   }
-
-/* Set the source of the trigger (software, input pin, ... according to the user's input */
-void SelectTriggerSource(MIL_ID MilDigitizer, bool& SoftwareTriggerSelected)
-   {
-   vector<MIL_STRING> TriggerSource;
-   MIL_INT Cnt = 0;
-   MIL_INT Done = 0;
-   int Selection = 0;
-
-   SoftwareTriggerSelected = false;
-   MosPrintf(MIL_TEXT("%-35s"), MIL_TEXT("Please select the trigger source:"));
-
-   MdigInquireFeature(MilDigitizer, M_FEATURE_ENUM_ENTRY_COUNT, MIL_TEXT("TriggerSource"), M_TYPE_MIL_INT, &Cnt);
-   if(Cnt)
-      {
-      TriggerSource.assign(Cnt, MIL_TEXT(""));
-      for (size_t i = 0; i < TriggerSource.size(); i++)
-         {
-         MdigInquireFeature(MilDigitizer, M_FEATURE_ENUM_ENTRY_NAME + i, MIL_TEXT("TriggerSource"), M_TYPE_STRING, TriggerSource[i]);
-         }
-
-   MosPrintf(MIL_TEXT("(%d) %-30s\n"), 0, TriggerSource[0].c_str());
-   for (size_t i = 1; i < TriggerSource.size(); i++)
-      {
-      MosPrintf(MIL_TEXT("%-35s(%d) %-20s\n"), MIL_TEXT(""), (int)i, TriggerSource[i].c_str());
-      }
-
-   do
-      {
-#if M_MIL_USE_WINDOWS
-      scanf_s("%d", &Selection);
-#else
-      scanf("%d", &Selection);
-#endif
-         if(Selection >= 0 && Selection < Cnt)
-         {
-         MosPrintf(MIL_TEXT("%s selected\n"), TriggerSource[Selection].c_str());
-         Done = 1;
-         }
-      else
-         MosPrintf(MIL_TEXT("Invalid selection.\n"));
-         }
-      while(!Done);
-
-      MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerSource"), M_TYPE_STRING, TriggerSource[Selection]);
-      if (TriggerSource[Selection] == MIL_TEXT("Software"))
-         SoftwareTriggerSelected = true;
-   }
-   }
-
-/* Puts the camera back in non-triggered mode. */
-void ResetTriggerControls(MIL_ID MilDigitizer)
-   {
-   MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
-   MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerSelector"), M_TYPE_STRING, MIL_TEXT("FrameStart"));
-   MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerMode"), M_TYPE_STRING, MIL_TEXT("Off"));
-
-   MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerSelector"), M_TYPE_STRING, MIL_TEXT("AcquisitionStart"));
-   MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerMode"), M_TYPE_STRING, MIL_TEXT("Off"));
-   MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
-   }
-
-/* User's processing function hook data structure. */
-typedef struct
-   {
-   MIL_ID  MilDigitizer;
-   MIL_ID  MilImageDisp;
-   MIL_INT ProcessedImageCount;
-   } HookDataStruct;
-
-/* User's processing function prototype. */
-MIL_INT MFTYPE ProcessingFunction(MIL_INT HookType,
-                                  MIL_ID HookId,
-                                  void* HookDataPtr);
-
-void DoTriggeredAcquisition(MIL_ID MilSystem, MIL_ID MilDigitizer, MIL_ID MilImageDisp)
-   {
-   eTriggerType TriggerType = (eTriggerType)0;
-   bool SoftwareTriggerSelected = false;
-   MIL_INT64 NbFrames = 10;
-   MIL_INT MilGrabBufferListSize;
-   MIL_INT Done = 0;
-   MIL_INT Ch = 0;
-   MIL_ID* MilGrabBufferList = NULL;
-   MIL_STRING TriggerSelector;
-   HookDataStruct UserHookData;
-   MIL_INT StartOp = M_START;
-
-   /*Set-up the camera in triggered mode according to the user's input. */
-   SetTriggerControls(MilDigitizer, TriggerType, NbFrames, TriggerSelector, SoftwareTriggerSelected);
-
-   MilGrabBufferList = new MIL_INT[(NbFrames == M_INFINITE) ? 10 : (size_t)NbFrames];
-
-   /* Allocate the grab buffers and clear them. */
-   MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
-   for(MilGrabBufferListSize = 0; 
-            MilGrabBufferListSize<NbFrames; MilGrabBufferListSize++)
-      {
-      MbufAlloc2d(MilSystem,
-                  MdigInquire(MilDigitizer, M_SIZE_X, M_NULL),
-                  MdigInquire(MilDigitizer, M_SIZE_Y, M_NULL),
-                  8+M_UNSIGNED,
-                  M_IMAGE+M_GRAB+M_PROC,
-                  &MilGrabBufferList[MilGrabBufferListSize]);
-
-      if (MilGrabBufferList[MilGrabBufferListSize])
-         {
-         MbufClear(MilGrabBufferList[MilGrabBufferListSize], 0xFF);
-         }
-      else
-         break;
-      }
-   MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
-
-   /* Initialize the User's processing function data structure. */
-   UserHookData.MilDigitizer        = MilDigitizer;
-   UserHookData.MilImageDisp        = MilImageDisp;
-   UserHookData.ProcessedImageCount = 0;
-
-   /* Set the grab timeout to infinite for triggered grab. */
-   MdigControl(MilDigitizer, M_GRAB_TIMEOUT, M_INFINITE);
-
-   /* Print a message and wait for a key press after a minimum number of frames. */
-   if(SoftwareTriggerSelected)
-      MosPrintf(MIL_TEXT("\n\nPress <t> to do a software trigger.\n"));
-   else
-      MosPrintf(MIL_TEXT("\n\nWaiting for a input trigger signal.\n"));
-   MosPrintf(MIL_TEXT("Press any other key to quit.\n\n"));
-
-   if (TriggerType == eMultiFrame)
-      StartOp = M_SEQUENCE + M_COUNT(NbFrames);
-
-   do
-      {
-      /* Start the processing. The processing function is called for every frame grabbed. */
-      MdigProcess(MilDigitizer, MilGrabBufferList, MilGrabBufferListSize,
-                     StartOp, M_ASYNCHRONOUS, ProcessingFunction, &UserHookData);
-
-      /* If trigger mode is software, send a software trigger when the user presses the <T> key. */
-      if(SoftwareTriggerSelected)
-         {
-         do
-            {
-            Ch =  MosGetch();
-            if(Ch == 'T' || Ch == 't')
-               {
-               MdigControlFeature(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerSelector"), M_TYPE_STRING, TriggerSelector);
-               MdigControlFeature(MilDigitizer, M_FEATURE_EXECUTE, MIL_TEXT("TriggerSoftware"), M_DEFAULT, M_NULL);
-               if(TriggerType == eMultiFrame)
-                  break;
-               }
-            else
-               Done = 1;
-            }
-         while(!Done);
-         }
-      else if(TriggerType != eMultiFrame)
-         Done = MosGetch();
-      else if(MosKbhit())
-         Done = 1;
-
-      /* Stop the processing. */
-      MdigProcess(MilDigitizer, MilGrabBufferList, MilGrabBufferListSize,
-                                 Done ? M_STOP : M_STOP+M_WAIT, M_DEFAULT, ProcessingFunction, &UserHookData);
-      }
-   while(!Done);
-
-   /* Reset the camera to non-triggered mode. */
-   ResetTriggerControls(MilDigitizer);
-   
-   /* Free the grab buffers. */
-   while(MilGrabBufferListSize > 0)
-      MbufFree(MilGrabBufferList[--MilGrabBufferListSize]);
-   
-   delete [] MilGrabBufferList;
-   }
-
-/* User's processing function called every time a grab buffer is modified. */
-/* -----------------------------------------------------------------------*/
-
-/* Local defines. */
-#define STRING_LENGTH_MAX  20
-#define STRING_POS_X       20
-#define STRING_POS_Y       20
-
-MIL_INT MFTYPE ProcessingFunction(MIL_INT HookType,
-                                  MIL_ID HookId,
-                                  void* HookDataPtr)
-   {
-   HookDataStruct *UserHookDataPtr = (HookDataStruct *)HookDataPtr;
-   MIL_ID ModifiedBufferId;
-   MIL_TEXT_CHAR Text[STRING_LENGTH_MAX]= {MIL_TEXT('\0'),};
-
-   /* Retrieve the MIL_ID of the grabbed buffer. */
-   MdigGetHookInfo(HookId, M_MODIFIED_BUFFER+M_BUFFER_ID, &ModifiedBufferId);
-
-   /* Print and draw the frame count. */
-   UserHookDataPtr->ProcessedImageCount++;
-   MosPrintf(MIL_TEXT("Processing frame #%lld.\r"), (long long)UserHookDataPtr->ProcessedImageCount);
-   MosSprintf(Text, STRING_LENGTH_MAX, MIL_TEXT("%lld"), 
-                                       (long long)UserHookDataPtr->ProcessedImageCount);
-   MgraText(M_DEFAULT, ModifiedBufferId, STRING_POS_X, STRING_POS_Y, Text);
-
-   /* Perform the processing and update the display. */
-   MbufCopy(ModifiedBufferId, UserHookDataPtr->MilImageDisp);
-   
-   return 0;
-   }
+﻿/********************************************************************************/
+/*
+* File name: milgige.cpp
+*
+* Synopsis:  This program demonstrates new MIL features for managing GigE Vision(tm)
+*            devices using the Matrox Driver for GigE Vision(tm).
+*
+* Note:      The camera features inquired by this example are taken from the GenICam(tm)
+*            Standard Feature Naming Convention (SFNC). It can be downloaded from the
+*            European Machine Vision Association's web site: http://www.emva.org/
+*            Only a subset of defined SNFC features are used by this example for
+*            illustrative purposes.
+*
+*            Some of the features accessed by this example might not be implemented
+*            by your camera, therefore MIL error prints are temporarily disabled while
+*            the process of feature enumeration is done. SFNC features not supported
+*            by your camera will be marked with N/A. Because of this the code for
+*            enumerating features is made more complex to account for varying
+*            implementations by camera manufacturers.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. */
+#include <mil.h>
+#include <vector>
+#include <math.h>
+#if M_MIL_USE_WINDOWS
+#include <windows.h>
+#endif
+#include "FrameBus.h"
+#include "StreamCapture.h"
+#include "FrameStats.h"
+#include "AutoExposure.h"
+#include "StartupTrace.h"
+#include "FeatureAccess.h"
+#include "Metrics.h"
+#include "LineScan.h"
+#include "FrameArchive.h"
+#include "Sequencer.h"
+#include "FeatureAsync.h"
+#include "CompressedStream.h"
+#include "ChangeDetect.h"
+#include "Placement.h"
+#include "RoiPlanner.h"
+#include "Overlay.h"
+#include "FeatureCatalog.h"
+#include "TriggerAudit.h"
+#include "MultiStream.h"
+#include "FrameProcessing.h"
+
+using namespace std;
+
+/* Set the PRINT_LOOKUP_TABLE define to 1 to print your camera's LUT       */
+/* values (if present).                                                    */
+#define PRINT_LOOKUP_TABLE       0
+
+/* Set the ROI_PLANNER define to 1 to be offered, before the continuous   */
+/* grab, the ROI, binning/decimation and pixel format combinations that    */
+/* reach ROI_PLANNER_FRAME_RATE within ROI_PLANNER_LINK_USAGE (fraction)   */
+/* of the link, and to apply one of them (see RoiPlanner.h).               */
+#define ROI_PLANNER              0
+#define ROI_PLANNER_FRAME_RATE   100.0
+#define ROI_PLANNER_LINK_USAGE   0.9
+#define ROI_PLANNER_CHOICES      9
+
+/* Set the USE_FRAME_BUS define to 1 to publish the frames grabbed during  */
+/* triggered acquisition on a shared-memory frame bus, so that other       */
+/* processes can read them in place (see FrameBus.h).                      */
+#define USE_FRAME_BUS            0
+#if M_MIL_USE_WINDOWS
+#define FRAME_BUS_NAME           MIL_TEXT("Local\\MilGigeFrameBus")
+#else
+#define FRAME_BUS_NAME           MIL_TEXT("/MilGigeFrameBus")
+#endif
+#define FRAME_BUS_SLOT_COUNT     32
+
+/* Set the STREAM_CAPTURE define to 1 to record the stream and the control */
+/* transactions of the triggered acquisition to STREAM_CAPTURE_FILE, with */
+/* STREAM_CAPTURE_SLOTS frames queued for its writer thread at most. Set   */
+/* the STREAM_REPLAY define to 1 to feed that file to the frame processing */
+/* instead of grabbing from a camera, either at the original timing        */
+/* (STREAM_REPLAY_REAL_TIME 1) or as fast as possible.                     */
+#define STREAM_CAPTURE           0
+#define STREAM_REPLAY            0
+#define STREAM_REPLAY_REAL_TIME  1
+#define STREAM_CAPTURE_FILE      MIL_TEXT("MilGigeCapture.pcap")
+#define STREAM_CAPTURE_SLOTS     8
+
+/* Set the MULTI_STREAM define to 1 to receive the stream of cameras with  */
+/* several stream channels or aggregated links over MULTI_STREAM_CHANNELS  */
+/* channels at most, on the UDP ports from MULTI_STREAM_BASE_PORT, each    */
+/* with its own receive thread and ring of MULTI_STREAM_RING_PACKETS       */
+/* packets, instead of the MIL grab path. With MULTI_STREAM_LOOPBACK 1, a  */
+/* software device sends MULTI_STREAM_LOOPBACK_SIZE_X x _SIZE_Y frames at  */
+/* MULTI_STREAM_LOOPBACK_RATE fps on the loopback interface, split by      */
+/* packet (link aggregation) or by frame (stream channels), and no camera  */
+/* is needed (see MultiStream.h): setting both defines to 1 runs only the */
+/* software device, never the camera. The camera streams with the packet  */
+/* size of its channels; MULTI_STREAM_PACKET_SIZE is that of the software  */
+/* device.                                                                 */
+#define MULTI_STREAM                0
+#define MULTI_STREAM_LOOPBACK       0
+#define MULTI_STREAM_CHANNELS       4
+#define MULTI_STREAM_BASE_PORT      20202
+#define MULTI_STREAM_PACKET_SIZE    9000
+#define MULTI_STREAM_RING_PACKETS   2048
+#define MULTI_STREAM_SLOTS          16
+#define MULTI_STREAM_LOOPBACK_SIZE_X 1280
+#define MULTI_STREAM_LOOPBACK_SIZE_Y 1024
+#define MULTI_STREAM_LOOPBACK_RATE  400.0
+#define MULTI_STREAM_LOOPBACK_SPLIT MULTI_STREAM_SPLIT_PACKETS
+
+/* Set the COMPUTE_FRAME_STATS define to 0 to skip the per-frame image     */
+/* statistics (histogram, mean, min/max, saturation and sharpness).        */
+#define COMPUTE_FRAME_STATS      1
+
+/* Set the USE_AUTO_EXPOSURE define to 1 to control the camera's exposure */
+/* time and gain from the host during triggered acquisition, so that the  */
+/* mean intensity of the grabbed frames stays at AUTO_EXPOSURE_TARGET     */
+/* (fraction of full scale) within AUTO_EXPOSURE_DEADBAND (see            */
+/* AutoExposure.h).                                                       */
+#define USE_AUTO_EXPOSURE        0
+#define AUTO_EXPOSURE_TARGET     0.45
+#define AUTO_EXPOSURE_DEADBAND   0.05
+
+/* Set the STARTUP_TRACE define to 1 to record the start-up phases and the */
+/* feature accesses, up to the end of the continuous grab, and write them  */
+/* to STARTUP_TRACE_FILE in Chrome trace format (see StartupTrace.h).      */
+#define STARTUP_TRACE            0
+#define STARTUP_TRACE_FILE       MIL_TEXT("MilGigeStartup.json")
+
+/* Set the FEATURE_ACCESS_PROFILE define to 1 to time every feature access */
+/* and print, at exit, the accesses sorted by total time with their error  */
+/* rate and latency distribution (see FeatureAccess.h).                    */
+#define FEATURE_ACCESS_PROFILE   0
+
+/* Set the USE_METRICS define to 1 to export the acquisition counters of  */
+/* the triggered acquisition in Prometheus text format, on a local HTTP   */
+/* endpoint (METRICS_HTTP_PORT, 0 to disable) and in METRICS_DUMP_FILE    */
+/* every METRICS_DUMP_PERIOD seconds (see Metrics.h).                     */
+#define USE_METRICS              0
+#define METRICS_HTTP_PORT        9464
+#define METRICS_DUMP_FILE        MIL_TEXT("MilGigeMetrics.prom")
+#define METRICS_DUMP_PERIOD      5.0
+
+/* Set the FRAME_ARCHIVE define to 1 to compress the frames of the        */
+/* triggered acquisition losslessly to FRAME_ARCHIVE_FILE, on             */
+/* FRAME_ARCHIVE_THREADS threads (0 for one per core but one), with up to */
+/* FRAME_ARCHIVE_SLOTS frames queued and tiles of about                   */
+/* FRAME_ARCHIVE_TILE_SIZE bytes (see FrameArchive.h).                    */
+#define FRAME_ARCHIVE            0
+#define FRAME_ARCHIVE_FILE       MIL_TEXT("MilGigeFrames.mgfa")
+#define FRAME_ARCHIVE_THREADS    0
+#define FRAME_ARCHIVE_SLOTS      16
+#define FRAME_ARCHIVE_TILE_SIZE  65536
+
+/* Set the SEQUENCER define to 1 to offer exposure bracketing (see          */
+/* Sequencer.h) in triggered acquisition: SEQUENCER_BRACKET_COUNT sets      */
+/* whose exposure times are SEQUENCER_BRACKET_RATIO apart around the        */
+/* current one, programmed in the camera's sequencer when                   */
+/* SEQUENCER_USE_CAMERA is 1 and it has one, and emulated on the host       */
+/* otherwise. Set SEQUENCER_HDR_MERGE to 1 to display the brackets merged   */
+/* into a tone-mapped HDR image.                                            */
+#define SEQUENCER                0
+#define SEQUENCER_BRACKET_COUNT  3
+#define SEQUENCER_BRACKET_RATIO  4.0
+#define SEQUENCER_USE_CAMERA     1
+#define SEQUENCER_HDR_MERGE      1
+
+/* Set the CHANGE_DETECT define to 1 to skip the processing of the frames  */
+/* of the triggered acquisition that did not change since the last        */
+/* processed one. The mean of each cell of a CHANGE_DETECT_GRID x          */
+/* CHANGE_DETECT_GRID grid, sampled every CHANGE_DETECT_ROW_STEP rows, is   */
+/* compared; a frame is processed when one cell changed by                 */
+/* CHANGE_DETECT_THRESHOLD (fraction of full scale) or more, or after      */
+/* CHANGE_DETECT_MAX_SKIP skipped frames (see ChangeDetect.h).             */
+#define CHANGE_DETECT            0
+#define CHANGE_DETECT_GRID       16
+#define CHANGE_DETECT_ROW_STEP   4
+#define CHANGE_DETECT_THRESHOLD  0.03
+#define CHANGE_DETECT_MAX_SKIP   30
+
+/* Set the PLACEMENT define to 1 to run the triggered acquisition on the    */
+/* NUMA node of the camera's network interface: the processing hook and the */
+/* worker threads are pinned to cores of the node, away from the cores that */
+/* serve the interface's interrupts, and the grab buffers are allocated on  */
+/* the node. The first PLACEMENT_BASELINE_FRAMES frames are processed       */
+/* unpinned, to compare the jitter of the two layouts (see Placement.h).    */
+#define PLACEMENT                  0
+#define PLACEMENT_BASELINE_FRAMES  200
+
+/* The frame count, frame rate, time stamp and statistics are drawn on the */
+/* display copy only, leaving the grabbed frames untouched, and the display */
+/* is refreshed OVERLAY_REFRESH_RATE times per second at most (0 for every  */
+/* frame). The frames in between are not copied to the display (see         */
+/* Overlay.h).                                                              */
+#define OVERLAY_REFRESH_RATE       30.0
+#define OVERLAY_POS_X              20
+#define OVERLAY_POS_Y              20
+
+/* Set the TRIGGER_AUDIT define to 1 to count the trigger edges, accepted   */
+/* and ignored triggers and exposures on the camera's counters during the   */
+/* triggered acquisition. They are read every TRIGGER_AUDIT_PERIOD seconds */
+/* and reconciled with the frames received, to report each lost frame by  */
+/* where it was lost (see TriggerAudit.h).                                  */
+#define TRIGGER_AUDIT              0
+#define TRIGGER_AUDIT_PERIOD       1.0
+
+/* Compressed payloads (see CompressedStream.h). Set COMPRESSED_STREAM to 1  */
+/* to grab JPEG payloads, when the camera can send them, in triggered       */
+/* acquisition. They are decoded on COMPRESSED_STREAM_THREADS threads (0 for */
+/* one per core but one), with COMPRESSED_STREAM_SLOTS frames queued at most. */
+#define COMPRESSED_STREAM          0
+#define COMPRESSED_STREAM_THREADS  0
+#define COMPRESSED_STREAM_SLOTS    8
+
+/* Asynchronous feature access (see FeatureAsync.h). The trigger controls */
+/* are reset through FeatureAsync, which only pays off when several        */
+/* digitizers are configured at once; set FEATURE_ASYNC_THREADS to the     */
+/* number of I/O threads for that case, 0 to access the features from the  */
+/* calling thread.                                                          */
+#define FEATURE_ASYNC_THREADS    0
+
+/* Line-scan acquisition (see LineScan.h), offered for line-scan cameras.  */
+/* Lines are grabbed in blocks of LINESCAN_BLOCK_LINES into a ring of      */
+/* LINESCAN_BLOCK_COUNT blocks. Set LINESCAN_ENCODER_TRIGGER to 1 to       */
+/* trigger each line from LINESCAN_TRIGGER_SOURCE. Objects are runs of     */
+/* lines brighter than LINESCAN_OBJECT_THRESHOLD (fraction of full scale,  */
+/* 0 to disable) ending after more than LINESCAN_OBJECT_GAP_LINES lines.   */
+#define LINESCAN_BLOCK_LINES       64
+#define LINESCAN_BLOCK_COUNT       128
+#define LINESCAN_ENCODER_TRIGGER   0
+#define LINESCAN_TRIGGER_SOURCE    MIL_TEXT("Encoder0")
+#define LINESCAN_OBJECT_THRESHOLD  0.25
+#define LINESCAN_OBJECT_GAP_LINES  16
+
+/* List of function prototypes used to enumerate and print camera features. */
+void CameraSetCapabilities(const CameraFeatureCatalog& Features);
+void CameraPrintConnection(MIL_ID MilDigitizer);
+void CameraPrintLUT(MIL_ID MilDigitizer);
+void CameraPrintDeviceCapabilities(MIL_ID MilDigitizer);
+void CameraPrintControlProtocolCapabilities(MIL_ID MilDigitizer);
+void CameraPrintStreamProtocolCapabilities(MIL_ID MilDigitizer);
+void CameraPrintMessageProtocolCapabilities(MIL_ID MilDigitizer);
+void CameraPrintStreamChannelCapabilities(MIL_ID MilDigitizer);
+void CameraPrintPhysicalLinkConfigurationCapabilities(MIL_ID MilDigitizer);
+void CameraPrintNetworkInterfaceCapabilities(MIL_ID MilDigitizer);
+void CameraPrintNetworkInterfaceConfiguration(MIL_ID MilDigitizer);
+
+/* List of function prototypes used to perform triggered acquisition. */
+typedef enum {eSingleFrame=1, eMultiFrame, eContinuous} eTriggerType;
+void SetTriggerControls(MIL_ID MilDigitizer, eTriggerType& Type, MIL_INT64& NbFrames,
+   MIL_STRING& oTriggerSelector, bool &SoftwareTriggerSelected);
+void SelectTriggerSource(MIL_ID MilDigitizer, bool& SoftwareTriggerSelected);
+void ResetTriggerControls(MIL_ID MilDigitizer);
+void DoTriggeredAcquisition(MIL_ID MilSystem, MIL_ID MilDigitizer, MIL_ID MilImageDisp);
+bool StartExposureBracketing(MIL_ID MilSystem, MIL_ID MilDigitizer, SequencerStruct* Sequencer);
+
+/* Function prototype used to plan the ROI for a target frame rate. */
+bool DoRoiPlanning(MIL_ID MilDigitizer);
+
+/* Function prototype used to replay a stream capture file. */
+void DoStreamReplay(MIL_ID MilSystem, MIL_ID MilDisplay);
+
+/* List of function prototypes used to receive over several stream channels. */
+void DoMultiStreamAcquisition(MIL_ID MilSystem, MIL_ID MilDigitizer, MIL_ID MilDisplay);
+bool CanStreamOnSeveralChannels(MIL_ID MilDigitizer);
+
+/* List of function prototypes used to perform line-scan acquisition. */
+void DoLineScanAcquisition(MIL_ID MilSystem, MIL_ID MilDigitizer);
+
+/* List of function prototypes used to trace the start-up. */
+MIL_INT WaitForKey();
+MIL_INT MFTYPE FirstFrameFunction(MIL_INT HookType, MIL_ID HookId, void* HookDataPtr);
+
+/* Global variables used to store camera capabilities. */
+bool ContinuousAMSupport = false;
+bool SingleFrameAMSupport = false;
+bool MultiFrameAMSupport = false;
+MIL_INT MultipleAcquisitionModeSupport = 0;
+bool CanTriggerAcquisitionStart = false;
+bool CanTriggerFrameStart = false;
+bool LineScanCamera = false;
+
+/* Main function. */
+int MosMain(void)
+   {
+   MIL_ID MilApplication,  /* Application identifier.  */
+          MilSystem,       /* System identifier.       */
+          MilDisplay,      /* Display identifier.      */
+          MilDigitizer,    /* Digitizer identifier.    */
+          MilImage;        /* Image buffer identifier. */
+   MIL_INT SystemType;
+   MIL_INT Selection;
+   bool FirstFrameSeen = false;
+   CameraFeatureCatalog CameraFeatures;
+
+#if STARTUP_TRACE
+   StartupTraceStart(STARTUP_TRACE_FILE);
+#endif
+#if FEATURE_ACCESS_PROFILE
+   FeatureAccessProfileStart();
+#endif
+
+   /* Allocate defaults. */
+   StartupTraceBegin(MIL_TEXT("MappAllocDefault"), "phase");
+   MappAllocDefault(M_DEFAULT, &MilApplication, &MilSystem, &MilDisplay, M_NULL, M_NULL);
+   StartupTraceEnd();
+
+#if STREAM_REPLAY
+   /* Replay a previously captured stream; no camera is needed. */
+   DoStreamReplay(MilSystem, MilDisplay);
+   MappFreeDefault(MilApplication, MilSystem, MilDisplay, M_NULL, M_NULL);
+   return 0;
+#endif
+
+#if MULTI_STREAM && MULTI_STREAM_LOOPBACK
+   /* Receive the stream of the software device; no camera is needed. */
+   DoMultiStreamAcquisition(MilSystem, M_NULL, MilDisplay);
+   MappFreeDefault(MilApplication, MilSystem, MilDisplay, M_NULL, M_NULL);
+   return 0;
+#endif
+
+   /* Get information on the system we are using and print a welcome message to the console. */
+   MsysInquire(MilSystem, M_SYSTEM_TYPE, &SystemType);
+
+   if ((SystemType != M_SYSTEM_GIGE_VISION_TYPE) &&
+       (SystemType != M_SYSTEM_GEVIQ_TYPE))
+      {
+      /* Print error message. */
+      MosPrintf(MIL_TEXT("This example program can only be used with the Matrox Driver for ")
+                MIL_TEXT("GigE Vision or the\nMatrox GevIQ Smart GigE Vision Adapter.\n"));
+      MosPrintf(MIL_TEXT("Please ensure that the default system type is set accordingly in ")
+                MIL_TEXT("MIL Config.\n"));
+      MosPrintf(MIL_TEXT("-------------------------------------------------------------\n\n"));
+      MosPrintf(MIL_TEXT("Press <enter> to quit.\n"));
+      MosGetch();
+      MappFreeDefault(MilApplication, MilSystem, MilDisplay, M_NULL, M_NULL);
+      return 1;
+      }
+
+   /* Allocate the digitizer controlling the camera. */
+   StartupTraceBegin(MIL_TEXT("MdigAlloc"), "phase");
+   MdigAlloc(MilSystem, M_DEFAULT, MIL_TEXT("M_DEFAULT"), M_DEFAULT, &MilDigitizer);
+   StartupTraceEnd();
+#if FEATURE_ASYNC_THREADS
+   FeatureAsyncStart(MilSystem, FEATURE_ASYNC_THREADS);
+#endif
+
+   /* In cases where the preferred method for device allocation requires allocating with     */
+   /* a user-defined name the following code can be used. "MyCameraName" must be replaced    */
+   /* with the actual camera name written in the camera.                                     */
+
+   /* MdigAlloc(MilSystem, M_GC_CAMERA_ID(MIL_TEXT("MyCameraName")), MIL_TEXT("M_DEFAULT"),  */
+   /*    M_GC_DEVICE_NAME, &MilDigitizer);                                              */
+
+
+   /* Allocate grab and display buffer. */
+   StartupTraceBegin(MIL_TEXT("MbufAllocColor"), "phase");
+   MbufAllocColor(MilSystem,
+      FeatureAccessMdigInquire(MilDigitizer, M_SIZE_BAND, M_NULL),
+      FeatureAccessMdigInquire(MilDigitizer, M_SIZE_X, M_NULL),
+      FeatureAccessMdigInquire(MilDigitizer, M_SIZE_Y, M_NULL),
+      FeatureAccessMdigInquire(MilDigitizer, M_TYPE, M_NULL),
+      M_IMAGE + M_DISP + M_GRAB,
+      &MilImage);
+   MbufClear(MilImage, 0);
+   StartupTraceEnd();
+
+   /* Print a message. */
+   MosPrintf(MIL_TEXT("This example showcases GigE Vision specific features.\n"));
+   MosPrintf(MIL_TEXT("Press <Enter> to start.\n\n"));
+   WaitForKey();
+#if M_MIL_USE_WINDOWS
+   system("cls");
+#endif
+   MosPrintf(MIL_TEXT("------------------------------------------------------------\n\n"));
+   MosPrintf(MIL_TEXT("                  Camera features summary.                  \n"));
+
+   /* Disable error printing in case camera is not SFNC compliant with regard
+      to some of the features it supports. */
+   StartupTraceBegin(MIL_TEXT("Feature summary"), "phase");
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+
+   /* Read the camera features of the catalog in one planned pass and print them. */
+   CameraFeatures.Read(__FUNCTION__, MilDigitizer, FEATURE_CATALOG_ALL);
+   CameraSetCapabilities(CameraFeatures);
+   for (size_t i = 0; i < FEATURE_CATALOG_CATEGORY_COUNT; i++)
+      {
+      CameraFeatures.Print(FeatureCatalogCategories[i].Category, FeatureCatalogCategories[i].Title);
+      if (FeatureCatalogCategories[i].Category == FEATURE_CATALOG_DEVICE)
+         CameraPrintConnection(MilDigitizer);
+      }
+#if PRINT_LOOKUP_TABLE
+   CameraPrintLUT(MilDigitizer);
+#endif
+
+   /* Re-enable error printing. */
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+   StartupTraceEnd();
+
+   /* Print a message. */
+   MosPrintf(MIL_TEXT("\nPress <Enter> to continue.\n"));
+   WaitForKey();
+
+   StartupTraceBegin(MIL_TEXT("Device capabilities"), "phase");
+   CameraPrintDeviceCapabilities(MilDigitizer);
+   StartupTraceEnd();
+
+   MosPrintf(MIL_TEXT("\nPress <Enter> to continue.\n"));
+   WaitForKey();
+
+   /* Clear the console text. */
+#if M_MIL_USE_WINDOWS
+   system("cls");
+#endif
+   /* Pop-up the camera feature browser GUI. */
+   StartupTraceBegin(MIL_TEXT("Feature browser"), "phase");
+   MdigControl(MilDigitizer, M_GC_FEATURE_BROWSER, M_OPEN+M_ASYNCHRONOUS);
+   StartupTraceEnd();
+   
+   /* Print a message. */
+   MosPrintf(MIL_TEXT("\nDisplaying the camera's feature browser.\n"));
+   MosPrintf(MIL_TEXT("Press <Enter> to continue.\n"));
+   WaitForKey();
+
+#if ROI_PLANNER
+   /* Fit the ROI to the target frame rate, and reallocate the grab buffer */
+   /* to the new image size.                                               */
+   if (DoRoiPlanning(MilDigitizer))
+      {
+      MbufFree(MilImage);
+      MbufAllocColor(MilSystem,
+         FeatureAccessMdigInquire(MilDigitizer, M_SIZE_BAND, M_NULL),
+         FeatureAccessMdigInquire(MilDigitizer, M_SIZE_X, M_NULL),
+         FeatureAccessMdigInquire(MilDigitizer, M_SIZE_Y, M_NULL),
+         FeatureAccessMdigInquire(MilDigitizer, M_TYPE, M_NULL),
+         M_IMAGE + M_DISP + M_GRAB,
+         &MilImage);
+      MbufClear(MilImage, 0);
+      }
+#endif
+
+   /* Start a continuous acquisition. */
+   StartupTraceBegin(MIL_TEXT("MdigGrabContinuous"), "phase");
+   if (StartupTraceIsActive())
+      MdigHookFunction(MilDigitizer, M_GRAB_FRAME_END, FirstFrameFunction, &FirstFrameSeen);
+   MdispSelect(MilDisplay, MilImage);
+   MdigGrabContinuous(MilDigitizer, MilImage);
+   StartupTraceEnd();
+
+   /* Print a message. */
+   MosPrintf(MIL_TEXT("\nContinuous image grab in progress.\n"));
+   MosPrintf(MIL_TEXT("Press <Enter> to stop.\n"));
+   WaitForKey();
+   
+   /* Stop the continuous acquisition. */
+   MdigHalt(MilDigitizer);
+
+   /* The start-up is over; write the trace. */
+   if (StartupTraceIsActive())
+      {
+      MdigHookFunction(MilDigitizer, M_GRAB_FRAME_END+M_UNHOOK, FirstFrameFunction, &FirstFrameSeen);
+      StartupTraceStop();
+      }
+
+   /* Line-scan cameras can also be tested with line blocks stitched in a ring. */
+   if(LineScanCamera)
+      {
+      MosPrintf(MIL_TEXT("\nYour camera is a line-scan camera.\n"));
+      MosPrintf(MIL_TEXT("Do you want to test line-scan acquisition (Y/N)? "));
+      Selection = MosGetch();
+      MosPrintf(MIL_TEXT("\n"));
+      if ((Selection == 'Y') || (Selection == 'y'))
+         DoLineScanAcquisition(MilSystem, MilDigitizer);
+      }
+
+#if MULTI_STREAM
+   /* Cameras with several stream channels or links can stream over all of them. */
+   if(CanStreamOnSeveralChannels(MilDigitizer))
+      {
+      MosPrintf(MIL_TEXT("\nYour camera can stream over several channels or links.\n"));
+      MosPrintf(MIL_TEXT("Do you want to test multi-channel receive (Y/N)? "));
+      Selection = MosGetch();
+      MosPrintf(MIL_TEXT("\n"));
+      if ((Selection == 'Y') || (Selection == 'y'))
+         DoMultiStreamAcquisition(MilSystem, MilDigitizer, MilDisplay);
+      }
+#endif
+
+   /* If we can trigger AcquisitionStart or FrameStart events, ask if we should do
+      triggered grabs. */
+   if(CanTriggerAcquisitionStart || CanTriggerFrameStart)
+      {
+#if M_MIL_USE_WINDOWS
+      system("cls");
+#endif
+      MosPrintf(MIL_TEXT("\nYour camera supports acquisition triggers.\n"));
+      MosPrintf(MIL_TEXT("Do you want to test triggered acquisition (Y/N)? "));
+      Selection = MosGetch();
+      MosPrintf(MIL_TEXT("\n"));
+      if ((Selection == 'Y') || (Selection == 'y'))
+         DoTriggeredAcquisition(MilSystem, MilDigitizer, MilImage);
+         }
+   else
+      {
+      MosPrintf(MIL_TEXT("\nPress <Enter> to quit.\n"));
+      MosGetch();
+      }
+
+   /* Print the feature access profile while the application is still allocated. */
+   FeatureAccessProfileReport();
+
+   FeatureAsyncStop();
+   MappFreeDefault(MilApplication, MilSystem, MilDisplay, MilDigitizer, MilImage);
+
+   return 0;
+   }
+
+/* Waits for a key press. The wait is traced so it can be excluded from the start-up time. */
+MIL_INT WaitForKey()
+   {
+   StartupTraceBegin(MIL_TEXT("Wait for key"), STARTUP_TRACE_CATEGORY_PROMPT);
+   MIL_INT Key = MosGetch();
+   StartupTraceEnd();
+   return Key;
+   }
+
+/* Marks the end of the first grabbed frame in the start-up trace. */
+MIL_INT MFTYPE FirstFrameFunction(MIL_INT HookType, MIL_ID HookId, void* HookDataPtr)
+   {
+   bool* FirstFrameSeen = (bool*)HookDataPtr;
+
+   if (!*FirstFrameSeen)
+      {
+      *FirstFrameSeen = true;
+      StartupTraceInstant(MIL_TEXT("First frame"));
+      }
+   return 0;
+   }
+
+/* Sets the capabilities of the camera from the features of the summary. */
+void CameraSetCapabilities(const CameraFeatureCatalog& Features)
+   {
+   const MIL_STRING& CameraScanType = Features.Value<FEATURE_CATALOG_INDEX("DeviceScanType")>().String;
+   const vector<MIL_STRING>& AcquisitionModes = Features.Value<FEATURE_CATALOG_INDEX("AcquisitionMode")>().Entries;
+   const vector<MIL_STRING>& TriggerSelectors = Features.Value<FEATURE_CATALOG_INDEX("TriggerSelector")>().Entries;
+
+   LineScanCamera = (CameraScanType == MIL_TEXT("Linescan") || CameraScanType == MIL_TEXT("LineScan"));
+
+   if(AcquisitionModes.size() > 1)
+      MultipleAcquisitionModeSupport = 1;
+   for (size_t i = 0; i < AcquisitionModes.size(); i++)
+      {
+      if(MIL_TEXT("Continuous") == AcquisitionModes[i])
+         ContinuousAMSupport = true;
+      else if(MIL_TEXT("SingleFrame") == AcquisitionModes[i])
+         SingleFrameAMSupport = true;
+      else if(MIL_TEXT("MultiFrame") == AcquisitionModes[i])
+         MultiFrameAMSupport = true;
+      }
+
+   for (size_t i = 0; i < TriggerSelectors.size(); i++)
+      {
+      if(MIL_TEXT("AcquisitionStart") == TriggerSelectors[i])
+         CanTriggerAcquisitionStart = true;
+      else if(MIL_TEXT("FrameStart") == TriggerSelectors[i])
+         CanTriggerFrameStart = true;
+      }
+   }
+
+/* Prints the host interface the camera is connected to. */
+void CameraPrintConnection(MIL_ID MilDigitizer)
+   {
+   MIL_STRING InterfaceName;
+   MIL_STRING IpAddress;
+
+   FeatureAccessMdigInquire(MilDigitizer, M_GC_LOCAL_IP_ADDRESS_STRING, IpAddress);
+   FeatureAccessMdigInquire(MilDigitizer, M_GC_INTERFACE_NAME, InterfaceName);
+   MosPrintf(MIL_TEXT("%30s %s (%s)\n"), MIL_TEXT("Camera is connected to:"), InterfaceName.c_str(), IpAddress.c_str());
+   }
+
+void CameraPrintLUT(MIL_ID MilDigitizer)
+   {
+   MIL_INT64 MinIndex = 0, MaxIndex = 0, LutValue = 0;
+   MIL_INT LutSelCount = 0;
+   vector<MIL_STRING> LutSelectors;
+   MIL_STRING Str(16, '\0');
+
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_ENUM_ENTRY_COUNT, MIL_TEXT("LUTSelector"), M_TYPE_MIL_INT, &LutSelCount);
+   if(LutSelCount)
+      {
+      LutSelectors.assign(LutSelCount, MIL_TEXT(""));
+   for (size_t i = 0; i < LutSelectors.size(); i++)
+      {
+         FeatureAccessInquire(MilDigitizer, M_FEATURE_ENUM_ENTRY_NAME + i, MIL_TEXT("LUTSelector"), M_TYPE_STRING, LutSelectors[i]);
+
+      MosPrintf(MIL_TEXT("\nPress <Enter> to print %s Lookup table.\n"), LutSelectors[i].c_str());
+      MosGetch();
+#if M_MIL_USE_WINDOWS
+      system("cls");
+#endif
+
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("LUTSelector"), M_TYPE_STRING, LutSelectors[i]);
+
+      MosPrintf(MIL_TEXT("\n------- Printing (%s) lookup table contents -----\n"), LutSelectors[i].c_str());
+
+      FeatureAccessInquire(MilDigitizer, M_FEATURE_MIN, MIL_TEXT("LUTIndex"), M_TYPE_INT64, &MinIndex);
+      FeatureAccessInquire(MilDigitizer, M_FEATURE_MAX, MIL_TEXT("LUTIndex"), M_TYPE_INT64, &MaxIndex);
+
+      for (MIL_INT64 j = MinIndex; j <= MaxIndex; j++)
+         {
+         FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("LUTIndex"), M_TYPE_INT64, &j);
+         FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("LUTValue"), M_TYPE_INT64, &LutValue);
+
+         if ((j % 5) == 0)
+            MosPrintf(MIL_TEXT("\n"));
+
+         MosSprintf(&Str[0], Str.size(), MIL_TEXT("[%lld]"), (long long)j);
+         MosPrintf(MIL_TEXT("%7s : %-6lld"), Str.c_str(), (long long)LutValue);
+         }
+      }
+   }
+   }
+
+void CameraPrintDeviceCapabilities(MIL_ID MilDigitizer)
+   {
+#if M_MIL_USE_WINDOWS
+   system("cls");
+#endif
+   MosPrintf(MIL_TEXT("------------------------------------------------------------\n\n"));
+   MosPrintf(MIL_TEXT("                      Camera capabilities.                  \n\n"));
+   CameraPrintControlProtocolCapabilities(MilDigitizer);
+   MosPrintf(MIL_TEXT("\nPress <Enter> to continue\n"));
+   MosGetch();
+#if M_MIL_USE_WINDOWS
+   system("cls");
+#endif
+   MosPrintf(MIL_TEXT("------------------------------------------------------------\n\n"));
+   MosPrintf(MIL_TEXT("                      Camera capabilities.                  \n\n"));
+   CameraPrintStreamProtocolCapabilities(MilDigitizer);
+   MosPrintf(MIL_TEXT("\nPress <Enter> to continue\n"));
+   MosGetch();
+#if M_MIL_USE_WINDOWS
+   system("cls");
+#endif
+   MosPrintf(MIL_TEXT("------------------------------------------------------------\n\n"));
+   MosPrintf(MIL_TEXT("                      Camera capabilities.                  \n\n"));
+   CameraPrintMessageProtocolCapabilities(MilDigitizer);
+   MosPrintf(MIL_TEXT("\nPress <Enter> to continue\n"));
+   MosGetch();
+#if M_MIL_USE_WINDOWS
+   system("cls");
+#endif
+   MosPrintf(MIL_TEXT("------------------------------------------------------------\n\n"));
+   MosPrintf(MIL_TEXT("                      Camera capabilities.                  \n\n"));
+   CameraPrintStreamChannelCapabilities(MilDigitizer);
+   MosPrintf(MIL_TEXT("\nPress <Enter> to continue\n"));
+   MosGetch();
+#if M_MIL_USE_WINDOWS
+   system("cls");
+#endif
+   MosPrintf(MIL_TEXT("------------------------------------------------------------\n\n"));
+   MosPrintf(MIL_TEXT("                      Camera capabilities.                  \n\n"));
+   CameraPrintPhysicalLinkConfigurationCapabilities(MilDigitizer);
+   MosPrintf(MIL_TEXT("\nPress <Enter> to continue\n"));
+   MosGetch();
+#if M_MIL_USE_WINDOWS
+   system("cls");
+#endif
+   MosPrintf(MIL_TEXT("------------------------------------------------------------\n\n"));
+   MosPrintf(MIL_TEXT("                      Camera capabilities.                  \n\n"));
+   CameraPrintNetworkInterfaceCapabilities(MilDigitizer);
+   MosPrintf(MIL_TEXT("\nPress <Enter> to continue\n"));
+   MosGetch();
+#if M_MIL_USE_WINDOWS
+   system("cls");
+#endif
+   MosPrintf(MIL_TEXT("------------------------------------------------------------\n\n"));
+   MosPrintf(MIL_TEXT("                      Camera capabilities.                  \n\n"));
+   CameraPrintNetworkInterfaceConfiguration(MilDigitizer);
+   }
+
+void CameraPrintControlProtocolCapabilities(MIL_ID MilDigitizer)
+   {
+   MIL_INT Capability = 0;
+   FeatureAccessMdigInquire(MilDigitizer, M_GC_CONTROL_PROTOCOL_CAPABILITY, &Capability);
+   
+   MosPrintf(MIL_TEXT("Control Protocol Capabilities\n\n"));
+
+   if (Capability == 0)
+      {
+      MosPrintf(MIL_TEXT("None\n"));
+      return;
+      }
+
+   if (Capability & M_GC_USER_DEFINED_NAME_SUPPORT)
+      MosPrintf(MIL_TEXT("User defined name\n"));
+   if (Capability & M_GC_SERIAL_NUMBER_SUPPORT)
+      MosPrintf(MIL_TEXT("Serial number\n"));
+   if (Capability & M_GC_HEARTBEAT_DISABLE_SUPPORT)
+      MosPrintf(MIL_TEXT("Heartbeat disable\n"));
+   if (Capability & M_GC_LINK_SPEED_REGISTER_SUPPORT)
+      MosPrintf(MIL_TEXT("Link speed register\n"));
+   if (Capability & M_GC_PORT_AND_IP_REGISTER_SUPPORT)
+      MosPrintf(MIL_TEXT("Port and IP register\n"));
+   if (Capability & M_GC_MANIFEST_TABLE_SUPPORT)
+      MosPrintf(MIL_TEXT("Manifest table\n"));
+   if (Capability & M_GC_TEST_DATA_SUPPORT)
+      MosPrintf(MIL_TEXT("Test data\n"));
+   if (Capability & M_GC_DISCOVERY_ACK_DELAY_SUPPORT)
+      MosPrintf(MIL_TEXT("Discovery ack delay\n"));
+   if (Capability & M_GC_WRITABLE_DISCOVERY_ACK_DELAY_SUPPORT)
+      MosPrintf(MIL_TEXT("Writable discovery ack_delay\n"));
+   if (Capability & M_GC_EXTENDED_STATUS_CODES_1_SUPPORT)
+      MosPrintf(MIL_TEXT("Extended status codes 1.1\n"));
+   if (Capability & M_GC_PRIMARY_APP_SWITCHOVER_SUPPORT)
+      MosPrintf(MIL_TEXT("Primary app switchover\n"));
+   if (Capability & M_GC_UNCONDITIONAL_ACTION_SUPPORT)
+      MosPrintf(MIL_TEXT("Unconditional action\n"));
+   if (Capability & M_GC_IEEE_1588_SUPPORT)
+      MosPrintf(MIL_TEXT("IEEE 1588\n"));
+   if (Capability & M_GC_EXTENDED_STATUS_CODES_2_SUPPORT)
+      MosPrintf(MIL_TEXT("Extended status codes 2.0\n"));
+   if (Capability & M_GC_SCHEDULED_ACTION_SUPPORT)
+      MosPrintf(MIL_TEXT("Scheduled action\n"));
+   if (Capability & M_GC_ACTION_SUPPORT)
+      MosPrintf(MIL_TEXT("Action\n"));
+   if (Capability & M_GC_PENDING_ACK_SUPPORT)
+      MosPrintf(MIL_TEXT("Pending ack\n"));
+   if (Capability & M_GC_EVENT_DATA_SUPPORT)
+      MosPrintf(MIL_TEXT("Event data\n"));
+   if (Capability & M_GC_EVENT_SUPPORT)
+      MosPrintf(MIL_TEXT("Event\n"));
+   if (Capability & M_GC_PACKET_RESEND_SUPPORT)
+      MosPrintf(MIL_TEXT("Packet resend\n"));
+   if (Capability & M_GC_WRITE_MEM_SUPPORT)
+      MosPrintf(MIL_TEXT("Write mem\n"));
+   if (Capability & M_GC_CONCATENATION_SUPPORT)
+      MosPrintf(MIL_TEXT("Concatenation\n"));
+   }
+
+void CameraPrintStreamProtocolCapabilities(MIL_ID MilDigitizer)
+   {
+   MIL_INT Capability = 0;
+   FeatureAccessMdigInquire(MilDigitizer, M_GC_STREAM_PROTOCOL_CAPABILITY, &Capability);
+
+   MosPrintf(MIL_TEXT("Stream Protocol Capabilities\n\n"));
+   
+   if (Capability == 0)
+      {
+      MosPrintf(MIL_TEXT("None\n"));
+      return;
+      }
+
+   if (Capability & M_GC_FIREWALL_TRAVERSAL_SUPPORT)
+      MosPrintf(MIL_TEXT("Firewall traversal\n"));
+   if (Capability & M_GC_LEGACY_16BIT_BLOCK_SUPPORT)
+      MosPrintf(MIL_TEXT("Legacy 16bit block\n"));
+   }
+
+void CameraPrintMessageProtocolCapabilities(MIL_ID MilDigitizer)
+   {
+   MIL_INT Capability = 0;
+   FeatureAccessMdigInquire(MilDigitizer, M_GC_MESSAGE_PROTOCOL_CAPABILITY, &Capability);
+
+   MosPrintf(MIL_TEXT("Message Protocol Capabilities\n\n"));
+
+   if (Capability == 0)
+      {
+      MosPrintf(MIL_TEXT("None\n"));
+      return;
+      }
+
+   if (Capability & M_GC_FIREWALL_TRAVERSAL_SUPPORT)
+      MosPrintf(MIL_TEXT("Firewall traversal\n"));
+   }
+
+void CameraPrintStreamChannelCapabilities(MIL_ID MilDigitizer)
+   {
+   MIL_INT Capability = 0;
+   FeatureAccessMdigInquire(MilDigitizer, M_GC_STREAM_CHANNEL_CAPABILITY, &Capability);
+
+   MosPrintf(MIL_TEXT("Stream Channel Capabilities\n\n"));
+
+   if (Capability == 0)
+      {
+      MosPrintf(MIL_TEXT("None\n"));
+      return;
+      }
+
+   if (Capability & M_GC_BIG_AND_LITTLE_ENDIAN_SUPPORT)
+      MosPrintf(MIL_TEXT("Big and little_endian\n"));
+   if (Capability & M_GC_IP_REASSEMBLY_SUPPORT)
+      MosPrintf(MIL_TEXT("IP reassembly\n"));
+   if (Capability & M_GC_MULTI_ZONE_SUPPORT)
+      MosPrintf(MIL_TEXT("Multi zone\n"));
+   if (Capability & M_GC_PACKET_RESEND_OPTION_SUPPORT)
+      MosPrintf(MIL_TEXT("Packet resend option\n"));
+   if (Capability & M_GC_ALL_IN_SUPPORT)
+      MosPrintf(MIL_TEXT("All in\n"));
+   if (Capability & M_GC_UNCONDITIONAL_STREAMING_SUPPORT)
+      MosPrintf(MIL_TEXT("Unconditional streaming\n"));
+   if (Capability & M_GC_EXTENDED_CHUNK_DATA_SUPPORT)
+      MosPrintf(MIL_TEXT("Extended chunk data\n"));
+   }
+
+void CameraPrintPhysicalLinkConfigurationCapabilities(MIL_ID MilDigitizer)
+   {
+   MIL_INT Capability = 0;
+   FeatureAccessMdigInquire(MilDigitizer, M_GC_PHYSICAL_LINK_CONFIGURATION_CAPABILITY, &Capability);
+
+   MosPrintf(MIL_TEXT("Physical Link Configuration Capabilities\n\n"));
+
+   if (Capability == 0)
+      {
+      MosPrintf(MIL_TEXT("None\n"));
+      return;
+      }
+
+   if (Capability & M_GC_SINGLE_LINK_SUPPORT)
+      MosPrintf(MIL_TEXT("Single link\n"));
+   if (Capability & M_GC_MULTIPLE_LINK_SUPPORT)
+      MosPrintf(MIL_TEXT("Multiple link\n"));
+   if (Capability & M_GC_STATIC_LINK_AGGREGATION_SUPPORT)
+      MosPrintf(MIL_TEXT("Static link aggregation\n"));
+   if (Capability & M_GC_DYNAMIC_LINK_AGGREGATION_SUPPORT)
+      MosPrintf(MIL_TEXT("Dynamic link aggregation\n"));
+   }
+
+void CameraPrintNetworkInterfaceCapabilities(MIL_ID MilDigitizer)
+   {
+   MIL_INT Capability = 0;
+   FeatureAccessMdigInquire(MilDigitizer, M_GC_NETWORK_INTERFACE_CAPABILITY, &Capability);
+
+   MosPrintf(MIL_TEXT("Network Interface Capabilities\n\n"));
+
+   if (Capability == 0)
+      {
+      MosPrintf(MIL_TEXT("None\n"));
+      return;
+      }
+
+   if (Capability & M_GC_PAUSE_RECEPTION_SUPPORT)
+      MosPrintf(MIL_TEXT("Pause reception\n"));
+   if (Capability & M_GC_PAUSE_GENERATION_SUPPORT)
+      MosPrintf(MIL_TEXT("Pause generation\n"));
+   if (Capability & M_GC_LINK_LOCAL_ADDRESS_SUPPORT)
+      MosPrintf(MIL_TEXT("Link local address\n"));
+   if (Capability & M_GC_DHCP_SUPPORT)
+      MosPrintf(MIL_TEXT("DHCP\n"));
+   if (Capability & M_GC_PERSISTENT_IP_SUPPORT)
+      MosPrintf(MIL_TEXT("Persistent IP\n"));
+   }
+
+void CameraPrintNetworkInterfaceConfiguration(MIL_ID MilDigitizer)
+   {
+   MIL_INT Configuration = 0;
+   FeatureAccessMdigInquire(MilDigitizer, M_GC_NETWORK_INTERFACE_CONFIGURATION, &Configuration);
+
+   MosPrintf(MIL_TEXT("Network Interface Configuration\n\n"));
+
+   if (Configuration == 0)
+      {
+      MosPrintf(MIL_TEXT("None\n"));
+      return;
+      }
+
+   if (Configuration & M_GC_PAUSE_RECEPTION_SUPPORT)
+      MosPrintf(MIL_TEXT("Pause reception Enabled\n"));
+   if (Configuration & M_GC_PAUSE_GENERATION_SUPPORT)
+      MosPrintf(MIL_TEXT("Pause generation Enabled\n"));
+   if (Configuration & M_GC_LINK_LOCAL_ADDRESS_SUPPORT)
+      MosPrintf(MIL_TEXT("Link local address Enabled\n"));
+   if (Configuration & M_GC_DHCP_SUPPORT)
+      MosPrintf(MIL_TEXT("DHCP Enabled\n"));
+   if (Configuration & M_GC_PERSISTENT_IP_SUPPORT)
+      MosPrintf(MIL_TEXT("Persistent IP Enabled\n"));
+   }
+
+/* Set the camera in triggered mode according to the user's input. */
+void SetTriggerControls(MIL_ID MilDigitizer, eTriggerType& Type, MIL_INT64& NbFrames, MIL_STRING& oTriggerSelector, bool &SoftwareTriggerSelected)
+   {
+   MIL_INT Done = 0;
+
+   if(CanTriggerAcquisitionStart && MultipleAcquisitionModeSupport)
+      {
+      MIL_INT Selection;
+
+      do
+         {
+         MosPrintf(MIL_TEXT("\n\n%-35s"), MIL_TEXT("Do you want to trigger a:")); 
+
+         if(ContinuousAMSupport)
+            MosPrintf(MIL_TEXT("(C) %-30s\n%35s"), MIL_TEXT("Continuous acquisition"), MIL_TEXT(""));
+         if(MultiFrameAMSupport)
+            MosPrintf(MIL_TEXT("(M) %-30s\n%35s"), MIL_TEXT("MultiFrame acquisition"), MIL_TEXT(""));
+         if(SingleFrameAMSupport)
+            MosPrintf(MIL_TEXT("(S) %-30s\n%35s"), MIL_TEXT("SingleFrame acquisition"), MIL_TEXT(""));
+
+         MosPrintf(MIL_TEXT("\n"));
+         Selection = MosGetch();
+         Done = 1;
+         switch(Selection)
+            {
+            case 'c':
+            case 'C':
+               oTriggerSelector = MIL_TEXT("AcquisitionStart");
+               FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("AcquisitionMode"), M_TYPE_STRING, MIL_TEXT("Continuous"));
+               FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerSelector"), M_TYPE_STRING, MIL_TEXT("AcquisitionStart"));
+               FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerMode"), M_TYPE_STRING, MIL_TEXT("On"));
+               MosPrintf(MIL_TEXT("Continuous acquisition trigger selected.\n"));
+               SelectTriggerSource(MilDigitizer, SoftwareTriggerSelected);
+               Type = eContinuous;
+               break;
+            case 'm':
+            case 'M':
+               oTriggerSelector = MIL_TEXT("AcquisitionStart");
+               FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("AcquisitionMode"), M_TYPE_STRING, MIL_TEXT("MultiFrame"));
+               FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerSelector"), M_TYPE_STRING, MIL_TEXT("AcquisitionStart"));
+               FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerMode"), M_TYPE_STRING, MIL_TEXT("On"));
+               MosPrintf(MIL_TEXT("Multi Frame acquisition trigger selected.\n"));
+               SelectTriggerSource(MilDigitizer, SoftwareTriggerSelected);
+
+               MosPrintf(MIL_TEXT("\n%-30s"), MIL_TEXT("\nHow many frames per trigger?"), MIL_TEXT(""));
+#if M_MIL_USE_WINDOWS
+               scanf_s("%lld", &(long long)NbFrames);
+#else
+               scanf("%lld", (long long *)&NbFrames);
+#endif
+               MosPrintf(MIL_TEXT("%lld Frames will be acquired per trigger.\n"), (long long)NbFrames);
+               FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("AcquisitionFrameCount"), M_TYPE_INT64, &NbFrames);
+               Type = eMultiFrame;
+               break;
+            case 's':
+            case 'S':
+               if(CanTriggerFrameStart)
+                  {
+                  oTriggerSelector = MIL_TEXT("FrameStart");
+                  FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("AcquisitionMode"), M_TYPE_STRING, MIL_TEXT("Continuous"));
+                  FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerSelector"), M_TYPE_STRING, MIL_TEXT("FrameStart"));
+                  FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerMode"), M_TYPE_STRING, MIL_TEXT("On"));
+                  }
+               else
+                  {
+                  oTriggerSelector = MIL_TEXT("AcquisitionStart");
+                  FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("AcquisitionMode"), M_TYPE_STRING, MIL_TEXT("SingleFrame"));
+                  FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerSelector"), M_TYPE_STRING, MIL_TEXT("AcquisitionStart"));
+                  FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerMode"), M_TYPE_STRING, MIL_TEXT("On"));
+                  }
+
+               MosPrintf(MIL_TEXT("Single Frame acquisition trigger selected.\n"));
+               SelectTriggerSource(MilDigitizer, SoftwareTriggerSelected);
+               Type = eSingleFrame;
+               break;
+            default:
+               MosPrintf(MIL_TEXT("Invalid selection."));
+               Done = 0;
+               break;
+            }
+         }
+      while(!Done);
+      }
+   else if(CanTriggerFrameStart)
+      {
+      oTriggerSelector = MIL_TEXT("FrameStart");
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerSelector"), M_TYPE_STRING, MIL_TEXT("FrameStart"));
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerMode"), M_TYPE_STRING, MIL_TEXT("On"));
+      MosPrintf(MIL_TEXT("\n\nFrame start trigger will be performed.\n"));
+      SelectTriggerSource(MilDigitizer, SoftwareTriggerSelected);
+      Type = eSingleFrame;
+      }
+   }
+
+/* Set the source of the trigger (software, input pin, ... according to the user's input */
+void SelectTriggerSource(MIL_ID MilDigitizer, bool& SoftwareTriggerSelected)
+   {
+   vector<MIL_STRING> TriggerSource;
+   MIL_INT Cnt = 0;
+   MIL_INT Done = 0;
+   int Selection = 0;
+
+   SoftwareTriggerSelected = false;
+   MosPrintf(MIL_TEXT("%-35s"), MIL_TEXT("Please select the trigger source:"));
+
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_ENUM_ENTRY_COUNT, MIL_TEXT("TriggerSource"), M_TYPE_MIL_INT, &Cnt);
+   if(Cnt)
+      {
+      TriggerSource.assign(Cnt, MIL_TEXT(""));
+      for (size_t i = 0; i < TriggerSource.size(); i++)
+         {
+         FeatureAccessInquire(MilDigitizer, M_FEATURE_ENUM_ENTRY_NAME + i, MIL_TEXT("TriggerSource"), M_TYPE_STRING, TriggerSource[i]);
+         }
+
+   MosPrintf(MIL_TEXT("(%d) %-30s\n"), 0, TriggerSource[0].c_str());
+   for (size_t i = 1; i < TriggerSource.size(); i++)
+      {
+      MosPrintf(MIL_TEXT("%-35s(%d) %-20s\n"), MIL_TEXT(""), (int)i, TriggerSource[i].c_str());
+      }
+
+   do
+      {
+#if M_MIL_USE_WINDOWS
+      scanf_s("%d", &Selection);
+#else
+      scanf("%d", &Selection);
+#endif
+         if(Selection >= 0 && Selection < Cnt)
+         {
+         MosPrintf(MIL_TEXT("%s selected\n"), TriggerSource[Selection].c_str());
+         Done = 1;
+         }
+      else
+         MosPrintf(MIL_TEXT("Invalid selection.\n"));
+         }
+      while(!Done);
+
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerSource"), M_TYPE_STRING, TriggerSource[Selection]);
+      if (TriggerSource[Selection] == MIL_TEXT("Software"))
+         SoftwareTriggerSelected = true;
+   }
+   }
+
+/* Puts the camera back in non-triggered mode. */
+void ResetTriggerControls(MIL_ID MilDigitizer)
+   {
+   vector< future<bool> > Operations;
+
+   /* The writes are ordered on the strand of the digitizer. */
+   if (CanTriggerFrameStart)
+      {
+      Operations.push_back(FeatureAsyncSetString(MilDigitizer, MIL_TEXT("TriggerSelector"), MIL_TEXT("FrameStart")));
+      Operations.push_back(FeatureAsyncSetString(MilDigitizer, MIL_TEXT("TriggerMode"), MIL_TEXT("Off")));
+      }
+   if (CanTriggerAcquisitionStart)
+      {
+      Operations.push_back(FeatureAsyncSetString(MilDigitizer, MIL_TEXT("TriggerSelector"), MIL_TEXT("AcquisitionStart")));
+      Operations.push_back(FeatureAsyncSetString(MilDigitizer, MIL_TEXT("TriggerMode"), MIL_TEXT("Off")));
+      }
+   if (!FeatureAsyncWaitAll(Operations))
+      MosPrintf(MIL_TEXT("Warning: the trigger mode of the camera could not be reset to Off.\n\n"));
+   }
+
+void DoTriggeredAcquisition(MIL_ID MilSystem, MIL_ID MilDigitizer, MIL_ID MilImageDisp)
+   {
+   eTriggerType TriggerType = (eTriggerType)0;
+   bool SoftwareTriggerSelected = false;
+   MIL_INT64 NbFrames = 10;
+   MIL_INT MilGrabBufferListSize;
+   MIL_INT Done = 0;
+   MIL_INT Ch = 0;
+   MIL_ID* MilGrabBufferList = NULL;
+   MIL_STRING TriggerSelector;
+   HookDataStruct UserHookData;
+   MIL_INT StartOp = M_START;
+#if USE_FRAME_BUS
+   FrameBusStruct FrameBus;
+#endif
+#if STREAM_CAPTURE
+   StreamCaptureStruct StreamCapture;
+   MIL_INT64 StreamPacketSize = 0;
+   MIL_STRING FeatureValue;
+#endif
+#if FRAME_ARCHIVE
+   FrameArchiveStruct FrameArchive;
+#endif
+#if COMPRESSED_STREAM
+   CompressedStreamStruct CompressedStream;
+#endif
+#if CHANGE_DETECT
+   ChangeDetectStruct ChangeDetect;
+#endif
+#if PLACEMENT
+   PlacementStruct Placement;
+   bool Placed = false;
+#endif
+#if TRIGGER_AUDIT
+   TriggerAuditStruct TriggerAudit;
+#endif
+   OverlayStruct Overlay;
+   bool Compressed = false;
+#if USE_AUTO_EXPOSURE
+   AutoExposureStruct AutoExposure;
+#endif
+#if SEQUENCER
+   SequencerStruct Sequencer;
+   HdrMergeStruct HdrMerge;
+#endif
+
+   /*Set-up the camera in triggered mode according to the user's input. */
+   SetTriggerControls(MilDigitizer, TriggerType, NbFrames, TriggerSelector, SoftwareTriggerSelected);
+
+   MilGrabBufferList = new MIL_INT[(NbFrames == M_INFINITE) ? 10 : (size_t)NbFrames];
+
+#if PLACEMENT
+   /* Choose the cores and the memory node of the camera's network interface. */
+   Placed = PlacementStart(MilDigitizer, PLACEMENT_BASELINE_FRAMES, &Placement);
+   if (Placed)
+      PlacementBeginAllocation(&Placement);
+#endif
+
+   /* Allocate the grab buffers and clear them, compressed if the camera sends JPEG payloads. */
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+#if COMPRESSED_STREAM
+   Compressed = CompressedStreamEnable(MilDigitizer);
+#endif
+   for(MilGrabBufferListSize = 0; 
+            MilGrabBufferListSize<NbFrames; MilGrabBufferListSize++)
+      {
+      MbufAlloc2d(MilSystem,
+                  FeatureAccessMdigInquire(MilDigitizer, M_SIZE_X, M_NULL),
+                  FeatureAccessMdigInquire(MilDigitizer, M_SIZE_Y, M_NULL),
+                  8+M_UNSIGNED,
+                  M_IMAGE+M_GRAB+M_PROC+(Compressed ? COMPRESSED_STREAM_ATTRIBUTE : 0),
+                  &MilGrabBufferList[MilGrabBufferListSize]);
+
+      if (MilGrabBufferList[MilGrabBufferListSize])
+         {
+         MbufClear(MilGrabBufferList[MilGrabBufferListSize], 0xFF);
+         }
+      else
+         break;
+      }
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+
+   /* Initialize the User's processing function data structure. */
+   InitHookData(&UserHookData, MilDigitizer, MilImageDisp, COMPUTE_FRAME_STATS != 0);
+   OverlayInit(MilSystem, OVERLAY_POS_X, OVERLAY_POS_Y, OVERLAY_REFRESH_RATE, &Overlay);
+   UserHookData.OverlayPtr = &Overlay;
+
+#if PLACEMENT
+   if (Placed)
+      {
+      PlacementEndAllocation(&Placement, MilGrabBufferList, MilGrabBufferListSize);
+      UserHookData.PlacementPtr = &Placement;
+      }
+#endif
+
+#if USE_FRAME_BUS
+   /* Create the frame bus with slots large enough for one grab buffer. */
+   if (MilGrabBufferListSize && FrameBusCreate(FRAME_BUS_NAME, FRAME_BUS_SLOT_COUNT,
+         MbufInquire(MilGrabBufferList[0], M_SIZE_X, M_NULL)*MbufInquire(MilGrabBufferList[0], M_SIZE_Y, M_NULL)*
+         ((MbufInquire(MilGrabBufferList[0], M_SIZE_BIT, M_NULL) + 7)/8), &FrameBus))
+      {
+      UserHookData.FrameBusPtr = &FrameBus;
+      MosPrintf(MIL_TEXT("\nPublishing frames on the %s frame bus.\n"), FRAME_BUS_NAME);
+      }
+   else
+      MosPrintf(MIL_TEXT("\nThe frame bus could not be created; another process may be publishing on %s.\n"), FRAME_BUS_NAME);
+#endif
+
+#if STREAM_CAPTURE
+   /* Record the stream with the camera's packet size, preceded by the trigger set-up. */
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GevSCPSPacketSize"), M_TYPE_INT64, &StreamPacketSize);
+   if (MilGrabBufferListSize &&
+       StreamCaptureOpen(MilSystem, STREAM_CAPTURE_FILE, StreamPacketSize,
+          MbufInquire(MilGrabBufferList[0], M_SIZE_X, M_NULL)*MbufInquire(MilGrabBufferList[0], M_SIZE_Y, M_NULL)*
+          MbufInquire(MilGrabBufferList[0], M_SIZE_BAND, M_NULL)*((MbufInquire(MilGrabBufferList[0], M_SIZE_BIT, M_NULL) + 7)/8),
+          STREAM_CAPTURE_SLOTS, &StreamCapture))
+      {
+      UserHookData.StreamCapturePtr = &StreamCapture;
+      MosPrintf(MIL_TEXT("\nCapturing the stream to %s.\n"), STREAM_CAPTURE_FILE);
+
+      /* Record every feature access from now on, starting with the trigger set-up. */
+      FeatureAccessSetTransactionRecorder(StreamCaptureTransaction, &StreamCapture);
+      FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("AcquisitionMode"), M_TYPE_STRING, FeatureValue);
+      FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerSelector"), M_TYPE_STRING, FeatureValue);
+      FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerSource"), M_TYPE_STRING, FeatureValue);
+      }
+   else
+      MosPrintf(MIL_TEXT("\n%s could not be created.\n"), STREAM_CAPTURE_FILE);
+#endif
+
+#if FRAME_ARCHIVE
+   /* Compress the grabbed frames on the archive threads. */
+   if (MilGrabBufferListSize && FrameArchiveStart(MilSystem, FRAME_ARCHIVE_THREADS) &&
+       FrameArchiveOpen(FRAME_ARCHIVE_FILE, MilGrabBufferList[0], FRAME_ARCHIVE_SLOTS, FRAME_ARCHIVE_TILE_SIZE,
+                        &FrameArchive))
+      {
+      UserHookData.FrameArchivePtr = &FrameArchive;
+      MosPrintf(MIL_TEXT("\nArchiving the frames to %s.\n"), FRAME_ARCHIVE_FILE);
+      }
+   else
+      MosPrintf(MIL_TEXT("\n%s could not be created.\n"), FRAME_ARCHIVE_FILE);
+#endif
+
+#if COMPRESSED_STREAM
+   /* Decode the payloads on the decoder threads and process the frames in order. */
+   if (Compressed && MilGrabBufferListSize && CompressedStreamStart(MilSystem, COMPRESSED_STREAM_THREADS) &&
+       CompressedStreamOpen(MilSystem, MilGrabBufferList[0], COMPRESSED_STREAM_SLOTS, DecodedFrameFunction,
+                            &UserHookData, &CompressedStream))
+      {
+      UserHookData.CompressedStreamPtr = &CompressedStream;
+      MosPrintf(MIL_TEXT("\nGrabbing JPEG payloads, decoded on the decoder threads.\n"));
+      }
+   else if (Compressed)
+      MosPrintf(MIL_TEXT("\nGrabbing JPEG payloads, decoded in the processing function.\n"));
+#endif
+
+#if USE_METRICS
+   /* Export the counters of this digitizer while it processes. */
+   if (MilGrabBufferListSize && MetricsStart(MilSystem, METRICS_HTTP_PORT, METRICS_DUMP_FILE, METRICS_DUMP_PERIOD))
+      {
+      UserHookData.MetricsDigitizer = MetricsAddDigitizer(MilDigitizer, MilGrabBufferListSize);
+      UserHookData.FrameSizeByte = MbufInquire(MilGrabBufferList[0], M_SIZE_X, M_NULL)*
+         MbufInquire(MilGrabBufferList[0], M_SIZE_Y, M_NULL)*MbufInquire(MilGrabBufferList[0], M_SIZE_BAND, M_NULL)*
+         ((MbufInquire(MilGrabBufferList[0], M_SIZE_BIT, M_NULL) + 7)/8);
+      }
+#endif
+
+#if USE_AUTO_EXPOSURE
+   /* Drive the exposure from the statistics of the grabbed frames. */
+   if (AutoExposureStart(MilSystem, MilDigitizer, AUTO_EXPOSURE_TARGET, AUTO_EXPOSURE_DEADBAND, &AutoExposure))
+      {
+      UserHookData.AutoExposurePtr = &AutoExposure;
+      UserHookData.ComputeFrameStats = true;
+      MosPrintf(MIL_TEXT("\nSoftware auto-exposure enabled (target %.0f%% of full scale).\n"), 100.0*AUTO_EXPOSURE_TARGET);
+      }
+   else
+      {
+      AutoExposureStop(&AutoExposure);
+      MosPrintf(MIL_TEXT("\nThe exposure time of this camera cannot be controlled.\n"));
+      }
+#endif
+
+#if SEQUENCER
+   /* Cycle the exposure time from frame to frame, unless it is controlled automatically. */
+   if (MilGrabBufferListSize && !UserHookData.AutoExposurePtr)
+      {
+      MosPrintf(MIL_TEXT("\nDo you want to bracket the exposure time with the sequencer (Y/N)? "));
+      Ch = MosGetch();
+      MosPrintf(MIL_TEXT("\n"));
+      if ((Ch == 'Y') || (Ch == 'y'))
+         {
+         if (StartExposureBracketing(MilSystem, MilDigitizer, &Sequencer))
+            {
+            UserHookData.SequencerPtr = &Sequencer;
+#if SEQUENCER_HDR_MERGE
+            HdrMergeInit(MilGrabBufferList[0], (MIL_INT)Sequencer.Sets.size(), &HdrMerge);
+            UserHookData.HdrMergePtr = &HdrMerge;
+#endif
+            }
+         else
+            {
+            SequencerStop(&Sequencer);
+            MosPrintf(MIL_TEXT("The exposure time of this camera cannot be bracketed.\n"));
+            }
+         }
+      Ch = 0;
+      }
+#endif
+
+#if CHANGE_DETECT
+   /* Skip the frames of a still scene; the sequencer needs every frame to tag them. */
+   if (!UserHookData.SequencerPtr)
+      {
+      ChangeDetectInit(CHANGE_DETECT_GRID, CHANGE_DETECT_ROW_STEP, CHANGE_DETECT_THRESHOLD, CHANGE_DETECT_MAX_SKIP,
+                       &ChangeDetect);
+      UserHookData.ChangeDetectPtr = &ChangeDetect;
+      }
+#endif
+
+#if TRIGGER_AUDIT
+   /* Count the triggers and exposures on the camera, from now on. */
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+   if (TriggerAuditStart(MilSystem, MilDigitizer, TRIGGER_AUDIT_PERIOD, &TriggerAudit))
+      UserHookData.TriggerAuditPtr = &TriggerAudit;
+   else
+      MosPrintf(MIL_TEXT("The triggers cannot be audited: the camera has no usable counter.\n"));
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+#endif
+
+   /* Set the grab timeout to infinite for triggered grab. */
+   MdigControl(MilDigitizer, M_GRAB_TIMEOUT, M_INFINITE);
+
+   /* Print a message and wait for a key press after a minimum number of frames. */
+   if(SoftwareTriggerSelected)
+      MosPrintf(MIL_TEXT("\n\nPress <t> to do a software trigger.\n"));
+   else
+      MosPrintf(MIL_TEXT("\n\nWaiting for a input trigger signal.\n"));
+   MosPrintf(MIL_TEXT("Press any other key to quit.\n\n"));
+
+   if (TriggerType == eMultiFrame)
+      StartOp = M_SEQUENCE + M_COUNT(NbFrames);
+
+   do
+      {
+      /* Start the processing. The processing function is called for every frame grabbed. */
+      MdigProcess(MilDigitizer, MilGrabBufferList, MilGrabBufferListSize,
+                     StartOp, M_ASYNCHRONOUS, ProcessingFunction, &UserHookData);
+      if (UserHookData.TriggerAuditPtr)
+         TriggerAuditProcessStarted(UserHookData.TriggerAuditPtr);
+
+      /* If trigger mode is software, send a software trigger when the user presses the <T> key. */
+      if(SoftwareTriggerSelected)
+         {
+         do
+            {
+            Ch =  MosGetch();
+            if(Ch == 'T' || Ch == 't')
+               {
+               if (UserHookData.SequencerPtr && !SequencerWaitProgrammed(UserHookData.SequencerPtr, 1.0))
+                  MosPrintf(MIL_TEXT("The set of the next frame is not written yet.\n"));
+               FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerSelector"), M_TYPE_STRING, TriggerSelector);
+               FeatureAccessControl(MilDigitizer, M_FEATURE_EXECUTE, MIL_TEXT("TriggerSoftware"), M_DEFAULT, M_NULL);
+               if(TriggerType == eMultiFrame)
+                  break;
+               }
+            else
+               Done = 1;
+            }
+         while(!Done);
+         }
+      else if(TriggerType != eMultiFrame)
+         Done = MosGetch();
+      else if(MosKbhit())
+         Done = 1;
+
+      /* Stop the processing. */
+      MdigProcess(MilDigitizer, MilGrabBufferList, MilGrabBufferListSize,
+                                 Done ? M_STOP : M_STOP+M_WAIT, M_DEFAULT, ProcessingFunction, &UserHookData);
+      if (UserHookData.TriggerAuditPtr)
+         TriggerAuditProcessStopped(UserHookData.TriggerAuditPtr);
+      if (UserHookData.SequencerPtr)
+         SequencerProcessStopped(UserHookData.SequencerPtr);
+      }
+   while(!Done);
+
+#if COMPRESSED_STREAM
+   /* Process the frames still being decoded and go back to uncompressed payloads. */
+   if (UserHookData.CompressedStreamPtr)
+      CompressedStreamClose(UserHookData.CompressedStreamPtr);
+   CompressedStreamStop();
+   if (Compressed)
+      {
+      MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+      CompressedStreamDisable(MilDigitizer);
+      MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+      }
+#endif
+
+#if TRIGGER_AUDIT
+   /* Take the final reading before the trigger controls are reset. */
+   if (UserHookData.TriggerAuditPtr)
+      TriggerAuditStop(UserHookData.TriggerAuditPtr);
+#endif
+
+   /* Reset the camera to non-triggered mode. */
+   ResetTriggerControls(MilDigitizer);
+
+#if USE_METRICS
+   /* Write the final values and stop serving them. */
+   if (UserHookData.MetricsDigitizer >= 0)
+      MetricsRemoveDigitizer(UserHookData.MetricsDigitizer);
+   MetricsStop();
+#endif
+
+#if USE_AUTO_EXPOSURE
+   if (UserHookData.AutoExposurePtr)
+      AutoExposureStop(UserHookData.AutoExposurePtr);
+#endif
+
+   if (UserHookData.SequencerPtr)
+      {
+      SequencerStop(UserHookData.SequencerPtr);
+      if (UserHookData.HdrMergePtr && UserHookData.HdrMergePtr->MergedCount)
+         MosPrintf(MIL_TEXT("%30s %llu (%.1f ms per bracket)\n"), MIL_TEXT("HDR images merged:"),
+                   (unsigned long long)UserHookData.HdrMergePtr->MergedCount,
+                   1e3*UserHookData.HdrMergePtr->MergeTime/UserHookData.HdrMergePtr->MergedCount);
+      if (UserHookData.HdrMergePtr)
+         HdrMergeFree(UserHookData.HdrMergePtr);
+      }
+
+   PrintFrameStatsSummary(&UserHookData);
+
+#if COMPRESSED_STREAM
+   if (UserHookData.CompressedStreamPtr)
+      CompressedStreamPrintStatistics(UserHookData.CompressedStreamPtr);
+#endif
+
+#if CHANGE_DETECT
+   if (UserHookData.ChangeDetectPtr)
+      ChangeDetectPrintStatistics(UserHookData.ChangeDetectPtr);
+#endif
+
+   OverlayPrintStatistics(UserHookData.OverlayPtr);
+
+#if TRIGGER_AUDIT
+   if (UserHookData.TriggerAuditPtr)
+      TriggerAuditPrintStatistics(UserHookData.TriggerAuditPtr);
+#endif
+
+#if PLACEMENT
+   /* Report the layout and the jitter, unpinned and pinned. */
+   if (UserHookData.PlacementPtr)
+      PlacementPrintStatistics(UserHookData.PlacementPtr);
+#endif
+
+#if STREAM_CAPTURE
+   if (UserHookData.StreamCapturePtr)
+      {
+      FeatureAccessSetTransactionRecorder(M_NULL, M_NULL);
+      StreamCaptureClose(UserHookData.StreamCapturePtr);
+      }
+#endif
+
+#if FRAME_ARCHIVE
+   /* Write the frames still queued and report the compression. */
+   if (UserHookData.FrameArchivePtr)
+      {
+      FrameArchiveClose(UserHookData.FrameArchivePtr);
+      FrameArchivePrintStatistics(UserHookData.FrameArchivePtr, FRAME_ARCHIVE_FILE);
+      }
+   FrameArchiveStop();
+#endif
+
+#if USE_FRAME_BUS
+   /* Print the subscribers' counters and remove the frame bus. */
+   if (UserHookData.FrameBusPtr)
+      {
+      FrameBusPrintStatistics(UserHookData.FrameBusPtr);
+      FrameBusFree(UserHookData.FrameBusPtr);
+      }
+#endif
+   
+#if PLACEMENT
+   if (Placed)
+      PlacementStop(&Placement);
+#endif
+
+   /* Free the grab buffers. */
+   while(MilGrabBufferListSize > 0)
+      MbufFree(MilGrabBufferList[--MilGrabBufferListSize]);
+   
+   delete [] MilGrabBufferList;
+   }
+
+/* Starts the sequencer with exposure times SEQUENCER_BRACKET_RATIO apart around */
+/* the current one.                                                            */
+bool StartExposureBracketing(MIL_ID MilSystem, MIL_ID MilDigitizer, SequencerStruct* Sequencer)
+   {
+   SequencerSetStruct Sets[SEQUENCER_BRACKET_COUNT];
+   MIL_DOUBLE Exposure = 0.0, ExposureMin = 0.0, ExposureMax = 0.0;
+
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("ExposureTime"), M_TYPE_MIL_DOUBLE, &Exposure);
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_MIN, MIL_TEXT("ExposureTime"), M_TYPE_MIL_DOUBLE, &ExposureMin);
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_MAX, MIL_TEXT("ExposureTime"), M_TYPE_MIL_DOUBLE, &ExposureMax);
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+   if (Exposure <= 0.0 || ExposureMax <= ExposureMin)
+      return false;
+
+   for (MIL_INT i = 0; i < SEQUENCER_BRACKET_COUNT; i++)
+      {
+      MIL_DOUBLE Time = Exposure*pow(SEQUENCER_BRACKET_RATIO, i - (SEQUENCER_BRACKET_COUNT - 1)/2.0);
+      Sets[i].Settings = SEQUENCER_EXPOSURE;
+      Sets[i].ExposureTime = (Time < ExposureMin) ? ExposureMin : ((Time > ExposureMax) ? ExposureMax : Time);
+      Sets[i].Gain = 0.0;
+      Sets[i].OffsetX = Sets[i].OffsetY = 0;
+      }
+
+   if (!SequencerStart(MilSystem, MilDigitizer, Sets, SEQUENCER_BRACKET_COUNT, SEQUENCER_USE_CAMERA != 0, Sequencer))
+      return false;
+   MosPrintf(MIL_TEXT("Bracketing %d exposure times from %.0f us to %.0f us (%s).\n"), (int)SEQUENCER_BRACKET_COUNT,
+             Sets[0].ExposureTime, Sets[SEQUENCER_BRACKET_COUNT - 1].ExposureTime,
+             Sequencer->Hardware ? MIL_TEXT("camera sequencer") : MIL_TEXT("host emulation"));
+   return true;
+   }
+
+/* Plans the ROI for ROI_PLANNER_FRAME_RATE and applies the user's choice. */
+/* Returns true if the image format of the camera was written.             */
+/* ------------------------------------------------------------------------ */
+bool DoRoiPlanning(MIL_ID MilDigitizer)
+   {
+   RoiPlannerLimitsStruct Limits;
+   RoiPlannerResultStruct Result;
+   vector<RoiPlannerCandidateStruct> Candidates;
+   MIL_INT Choices, Ch;
+   bool Applied;
+
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+   if (!RoiPlannerReadLimits(MilDigitizer, &Limits))
+      {
+      MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+      MosPrintf(MIL_TEXT("\nThe camera does not report its ROI limits.\n"));
+      return false;
+      }
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+
+   RoiPlannerPlan(Limits, ROI_PLANNER_FRAME_RATE, ROI_PLANNER_LINK_USAGE, Candidates);
+   MosPrintf(MIL_TEXT("\n------------------------ ROI planner -----------------------\n\n"));
+   MosPrintf(MIL_TEXT("%30s %.2f fps\n"), MIL_TEXT("Target frame rate:"), ROI_PLANNER_FRAME_RATE);
+   MosPrintf(MIL_TEXT("%30s %.0f Mb/s (%.0f%% used), %lld-byte packets\n"), MIL_TEXT("Link budget:"), Limits.LinkSpeed,
+             100.0*ROI_PLANNER_LINK_USAGE, (long long)Limits.PacketSize);
+   MosPrintf(MIL_TEXT("%30s %lld x %lld\n"), MIL_TEXT("Sensor size:"), (long long)Limits.SensorWidth,
+             (long long)Limits.SensorHeight);
+   if (Candidates.empty())
+      {
+      MosPrintf(MIL_TEXT("\nNo combination reaches the target frame rate.\n"));
+      return false;
+      }
+
+   Choices = ((MIL_INT)Candidates.size() < ROI_PLANNER_CHOICES) ? (MIL_INT)Candidates.size() : ROI_PLANNER_CHOICES;
+   RoiPlannerPrintCandidates(Candidates, Choices);
+   MosPrintf(MIL_TEXT("\nApply which combination (1-%d, any other key to keep the current one)? "), (int)Choices);
+   Ch = MosGetch();
+   MosPrintf(MIL_TEXT("\n"));
+   if (Ch < '1' || Ch >= '1' + Choices)
+      return false;
+
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+   Applied = RoiPlannerApply(MilDigitizer, Candidates[(size_t)(Ch - '1')], ROI_PLANNER_FRAME_RATE, Limits, &Result);
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+   if (!Applied)
+      MosPrintf(MIL_TEXT("\nThe camera rejected some of the settings; the previous ones were restored.\n"));
+   RoiPlannerPrintResult(Result, ROI_PLANNER_FRAME_RATE, Limits);
+   return true;
+   }
+
+/* Replays a stream capture file through the frame processing. */
+/* ----------------------------------------------------------- */
+void DoStreamReplay(MIL_ID MilSystem, MIL_ID MilDisplay)
+   {
+   StreamReplayStruct Replay;
+   StreamReplayFrameStruct Frame;
+   HookDataStruct UserHookData;
+   OverlayStruct Overlay;
+#if CHANGE_DETECT
+   ChangeDetectStruct ChangeDetect;
+#endif
+   MIL_ID MilReplayImage = M_NULL;
+   MIL_ID MilImageDisp = M_NULL;
+   MIL_DOUBLE StartTime, EndTime, FrameStartTime, Now;
+   MIL_DOUBLE ProcessingTime = 0.0;
+
+   if (!StreamReplayOpen(STREAM_CAPTURE_FILE, &Replay))
+      {
+      MosPrintf(MIL_TEXT("%s is not a valid stream capture file.\n"), STREAM_CAPTURE_FILE);
+      MosPrintf(MIL_TEXT("Press <Enter> to quit.\n"));
+      MosGetch();
+      return;
+      }
+
+   MosPrintf(MIL_TEXT("Replaying %s %s.\n"), STREAM_CAPTURE_FILE,
+             STREAM_REPLAY_REAL_TIME ? MIL_TEXT("at the original timing") : MIL_TEXT("as fast as possible"));
+   MosPrintf(MIL_TEXT("Press any key to stop.\n\n"));
+
+   /* Initialize the User's processing function data structure. */
+   InitHookData(&UserHookData, M_NULL, M_NULL, COMPUTE_FRAME_STATS != 0);
+   OverlayInit(MilSystem, OVERLAY_POS_X, OVERLAY_POS_Y, OVERLAY_REFRESH_RATE, &Overlay);
+   UserHookData.OverlayPtr = &Overlay;
+#if CHANGE_DETECT
+   ChangeDetectInit(CHANGE_DETECT_GRID, CHANGE_DETECT_ROW_STEP, CHANGE_DETECT_THRESHOLD, CHANGE_DETECT_MAX_SKIP,
+                    &ChangeDetect);
+   UserHookData.ChangeDetectPtr = &ChangeDetect;
+#endif
+
+   StartTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+   while (StreamReplayNextFrame(&Replay, &Frame) == STREAM_REPLAY_FRAME)
+      {
+      /* (Re)allocate the buffers when the format of the frames changes. */
+      if (!MilReplayImage ||
+          (MbufInquire(MilReplayImage, M_SIZE_X, M_NULL) != Frame.SizeX) ||
+          (MbufInquire(MilReplayImage, M_SIZE_Y, M_NULL) != Frame.SizeY) ||
+          (MbufInquire(MilReplayImage, M_SIZE_BIT, M_NULL) != Frame.SizeBit) ||
+          (MbufInquire(MilReplayImage, M_SIZE_BAND, M_NULL) != Frame.SizeBand))
+         {
+         if (MilReplayImage)
+            {
+            MdispSelect(MilDisplay, M_NULL);
+            MbufFree(MilImageDisp);
+            MbufFree(MilReplayImage);
+            }
+         MbufAllocColor(MilSystem, Frame.SizeBand, Frame.SizeX, Frame.SizeY, Frame.SizeBit + M_UNSIGNED,
+                        M_IMAGE + M_PROC, &MilReplayImage);
+         MbufAllocColor(MilSystem, Frame.SizeBand, Frame.SizeX, Frame.SizeY, Frame.SizeBit + M_UNSIGNED,
+                        M_IMAGE + M_DISP + M_PROC, &MilImageDisp);
+         MbufClear(MilImageDisp, 0);
+         MdispSelect(MilDisplay, MilImageDisp);
+         UserHookData.MilImageDisp = MilImageDisp;
+         }
+
+#if STREAM_REPLAY_REAL_TIME
+      /* Wait for the time at which the frame was originally received. */
+      Now = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+      while (Now < StartTime + Frame.RecordTime)
+         {
+         if (StartTime + Frame.RecordTime - Now > 0.002)
+            MosSleep(1);
+         Now = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+         }
+#endif
+
+      MbufPut(MilReplayImage, &Frame.Data[0]);
+
+      /* The same path as the processing function; incomplete frames are */
+      /* not replayed.                                                  */
+      FrameStartTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+      ProcessGrabbedFrame(&UserHookData, MilReplayImage, false, FrameStartTime);
+      Now = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+      ProcessingTime += Now - FrameStartTime;
+
+      if (MosKbhit())
+         {
+         MosGetch();
+         break;
+         }
+      }
+   EndTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+
+   MosPrintf(MIL_TEXT("\n\n---------------------- Stream replay -----------------------\n\n"));
+   MosPrintf(MIL_TEXT("%30s %llu\n"), MIL_TEXT("Frames replayed:"), (unsigned long long)Replay.FramesRead);
+   MosPrintf(MIL_TEXT("%30s %llu\n"), MIL_TEXT("Incomplete frames skipped:"), (unsigned long long)Replay.IncompleteFrames);
+   MosPrintf(MIL_TEXT("%30s %llu\n"), MIL_TEXT("Control transactions:"), (unsigned long long)Replay.ControlsRead);
+   MosPrintf(MIL_TEXT("%30s %.3f s\n"), MIL_TEXT("Elapsed time:"), EndTime - StartTime);
+   if (Replay.FramesRead)
+      {
+      MosPrintf(MIL_TEXT("%30s %.1f fps\n"), MIL_TEXT("Replay rate:"), Replay.FramesRead/(EndTime - StartTime));
+      MosPrintf(MIL_TEXT("%30s %.3f ms\n"), MIL_TEXT("Processing time per frame:"), 1000.0*ProcessingTime/Replay.FramesRead);
+      }
+   PrintFrameStatsSummary(&UserHookData);
+   OverlayPrintStatistics(&Overlay);
+#if CHANGE_DETECT
+   ChangeDetectPrintStatistics(&ChangeDetect);
+#endif
+   MosPrintf(MIL_TEXT("\nPress <Enter> to quit.\n"));
+   MosGetch();
+
+   StreamReplayClose(&Replay);
+   if (MilReplayImage)
+      {
+      MdispSelect(MilDisplay, M_NULL);
+      MbufFree(MilImageDisp);
+      MbufFree(MilReplayImage);
+      }
+   }
+
+/* Multi-channel receive.                                                   */
+/* -----------------------------------------------------------------------*/
+
+/* True if the camera has several stream channels or aggregates its links. */
+bool CanStreamOnSeveralChannels(MIL_ID MilDigitizer)
+   {
+   MIL_INT Capability = 0;
+   MIL_INT ChannelCount;
+
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+   FeatureAccessMdigInquire(MilDigitizer, M_GC_PHYSICAL_LINK_CONFIGURATION_CAPABILITY, &Capability);
+   ChannelCount = MultiStreamCameraChannelCount(MilDigitizer);
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+
+   return (ChannelCount > 1) ||
+          (Capability & (M_GC_MULTIPLE_LINK_SUPPORT | M_GC_STATIC_LINK_AGGREGATION_SUPPORT | M_GC_DYNAMIC_LINK_AGGREGATION_SUPPORT));
+   }
+
+/* Receives the stream of the camera, or of the software device if MilDigitizer */
+/* is M_NULL, over several channels and processes its frames in order.          */
+void DoMultiStreamAcquisition(MIL_ID MilSystem, MIL_ID MilDigitizer, MIL_ID MilDisplay)
+   {
+   MultiStreamStruct Stream;
+   MultiStreamDeviceStruct Device;
+   MultiStreamCameraStruct Camera;
+   StreamReplayFrameStruct Frame;
+   HookDataStruct UserHookData;
+   OverlayStruct Overlay;
+   MIL_ID MilStreamImage = M_NULL;
+   MIL_ID MilImageDisp = M_NULL;
+   MIL_INT ChannelCount = MULTI_STREAM_CHANNELS;
+   MIL_INT64 PacketSize = MULTI_STREAM_PACKET_SIZE;
+   MIL_DOUBLE FrameStartTime;
+   MIL_DOUBLE ProcessingTime = 0.0;
+   bool Started;
+
+   if (MilDigitizer)
+      {
+      MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+      if (MultiStreamCameraChannelCount(MilDigitizer) < ChannelCount)
+         ChannelCount = MultiStreamCameraChannelCount(MilDigitizer);
+      Started = MultiStreamReadCamera(MilDigitizer, ChannelCount, &Camera);
+      MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+      if (!Started)
+         {
+         MosPrintf(MIL_TEXT("The stream channels of the camera could not be read, or their packet sizes differ.\n"));
+         return;
+         }
+      PacketSize = Camera.PacketSizeByte;
+      }
+
+   if (!MultiStreamOpen(MilSystem, ChannelCount, MULTI_STREAM_BASE_PORT, MilDigitizer == M_NULL, PacketSize,
+                        MULTI_STREAM_RING_PACKETS, MULTI_STREAM_SLOTS, &Stream))
+      {
+      MosPrintf(MIL_TEXT("The stream channels could not be opened.\n"));
+      return;
+      }
+
+   if (MilDigitizer)
+      {
+      MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+      Started = MultiStreamStartCamera(MilDigitizer, &Stream, &Camera);
+      MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+      }
+   else
+      Started = MultiStreamDeviceStart(MilSystem, ChannelCount, MULTI_STREAM_BASE_PORT, MULTI_STREAM_PACKET_SIZE,
+                                       MULTI_STREAM_LOOPBACK_SIZE_X, MULTI_STREAM_LOOPBACK_SIZE_Y,
+                                       MULTI_STREAM_LOOPBACK_RATE, MULTI_STREAM_LOOPBACK_SPLIT, &Device);
+   if (!Started)
+      {
+      MosPrintf(MIL_TEXT("The %s could not be started on %d channel(s).\n"),
+                MilDigitizer ? MIL_TEXT("camera") : MIL_TEXT("software device"), (int)ChannelCount);
+      MultiStreamClose(&Stream);
+      return;
+      }
+
+   MosPrintf(MIL_TEXT("\nReceiving over %d channel(s) from port %d.\n"), (int)ChannelCount, (int)MULTI_STREAM_BASE_PORT);
+   MosPrintf(MIL_TEXT("Press any key to stop.\n\n"));
+
+   /* Initialize the User's processing function data structure. */
+   InitHookData(&UserHookData, M_NULL, M_NULL, COMPUTE_FRAME_STATS != 0);
+   OverlayInit(MilSystem, OVERLAY_POS_X, OVERLAY_POS_Y, OVERLAY_REFRESH_RATE, &Overlay);
+   UserHookData.OverlayPtr = &Overlay;
+
+   while (!MosKbhit())
+      {
+      if (MultiStreamNextFrame(&Stream, 0.1, &Frame) != MULTI_STREAM_FRAME)
+         continue;
+
+      /* (Re)allocate the buffers when the format of the frames changes. */
+      if (!MilStreamImage ||
+          (MbufInquire(MilStreamImage, M_SIZE_X, M_NULL) != Frame.SizeX) ||
+          (MbufInquire(MilStreamImage, M_SIZE_Y, M_NULL) != Frame.SizeY) ||
+          (MbufInquire(MilStreamImage, M_SIZE_BIT, M_NULL) != Frame.SizeBit) ||
+          (MbufInquire(MilStreamImage, M_SIZE_BAND, M_NULL) != Frame.SizeBand))
+         {
+         if (MilStreamImage)
+            {
+            MdispSelect(MilDisplay, M_NULL);
+            MbufFree(MilImageDisp);
+            MbufFree(MilStreamImage);
+            }
+         MbufAllocColor(MilSystem, Frame.SizeBand, Frame.SizeX, Frame.SizeY, Frame.SizeBit + M_UNSIGNED,
+                        M_IMAGE + M_PROC, &MilStreamImage);
+         MbufAllocColor(MilSystem, Frame.SizeBand, Frame.SizeX, Frame.SizeY, Frame.SizeBit + M_UNSIGNED,
+                        M_IMAGE + M_DISP + M_PROC, &MilImageDisp);
+         MbufClear(MilImageDisp, 0);
+         MdispSelect(MilDisplay, MilImageDisp);
+         UserHookData.MilImageDisp = MilImageDisp;
+         }
+
+      MbufPut(MilStreamImage, &Frame.Data[0]);
+
+      FrameStartTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+      ProcessFrame(&UserHookData, MilStreamImage);
+      ProcessingTime += MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) - FrameStartTime;
+      }
+   MosGetch();
+
+   if (MilDigitizer)
+      {
+      MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+      MultiStreamStopCamera(MilDigitizer, &Camera);
+      MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+      }
+   else
+      {
+      MultiStreamDeviceStop(&Device);
+      MultiStreamDevicePrintStatistics(&Device);
+      }
+   MultiStreamClose(&Stream);
+
+   MultiStreamPrintStatistics(&Stream);
+   if (Stream.FramesDelivered)
+      MosPrintf(MIL_TEXT("%30s %.3f ms\n"), MIL_TEXT("Processing time per frame:"), 1000.0*ProcessingTime/Stream.FramesDelivered);
+   PrintFrameStatsSummary(&UserHookData);
+   OverlayPrintStatistics(&Overlay);
+   MosPrintf(MIL_TEXT("\nPress <Enter> to continue.\n"));
+   MosGetch();
+
+   if (MilStreamImage)
+      {
+      MdispSelect(MilDisplay, M_NULL);
+      MbufFree(MilImageDisp);
+      MbufFree(MilStreamImage);
+      }
+   }
+
+/* Line-scan acquisition.                                                   */
+/* -----------------------------------------------------------------------*/
+
+/* Data of the thread consuming the stitched strips. */
+typedef struct
+   {
+   LineScanRingStruct*     Ring;
+   std::atomic<bool>       StopRequested;
+   MIL_UINT64              StripCount;
+   MIL_UINT64              ObjectCount;
+   MIL_UINT64              ObjectLines;
+   } LineScanConsumerDataStruct;
+
+/* Processing function called for every block of lines. */
+MIL_INT MFTYPE LineScanProcessingFunction(MIL_INT HookType, MIL_ID HookId, void* HookDataPtr)
+   {
+   LineScanRingStruct* Ring = (LineScanRingStruct*)HookDataPtr;
+   MIL_INT BufferIndex = 0;
+
+   MdigGetHookInfo(HookId, M_MODIFIED_BUFFER+M_BUFFER_INDEX, &BufferIndex);
+   LineScanBlockGrabbed(Ring, BufferIndex);
+   return 0;
+   }
+
+/* Downstream stage: reads the objects strip by strip while they are being scanned. */
+MIL_UINT32 MFTYPE LineScanConsumerFunction(void* ThreadContext)
+   {
+   LineScanConsumerDataStruct* Data = (LineScanConsumerDataStruct*)ThreadContext;
+   LineScanConsumerStruct Consumer;
+   LineScanStripStruct Strip;
+
+   /* Once stopped, read the strips left before leaving. */
+   LineScanConsumerInit(Data->Ring, &Consumer);
+   for (;;)
+      {
+      bool Stopping = Data->StopRequested.load();
+
+      switch (LineScanReadStrip(Data->Ring, &Consumer, &Strip))
+         {
+         case LINESCAN_STRIP_READY:
+            /* The strip's lines would be inspected here. */
+            if (Strip.ObjectId)
+               Data->ObjectLines += Strip.LineCount;
+            Data->StripCount++;
+            if (!LineScanReleaseStrip(Data->Ring, &Consumer, &Strip))
+               MosPrintf(MIL_TEXT("Strip overwritten while it was read.\n"));
+            if (Strip.ObjectEnd)
+               {
+               Data->ObjectCount++;
+               MosPrintf(MIL_TEXT("Object #%llu: %llu lines.\n"), (unsigned long long)Strip.ObjectId,
+                         (unsigned long long)Data->ObjectLines);
+               Data->ObjectLines = 0;
+               }
+            break;
+
+         case LINESCAN_STRIP_OVERRUN:
+            MosPrintf(MIL_TEXT("Consumer overrun: lines skipped.\n"));
+            Data->ObjectLines = 0;
+            break;
+
+         default:
+            if (Stopping)
+               return 0;
+            MosSleep(1);
+            break;
+         }
+      }
+   }
+
+void DoLineScanAcquisition(MIL_ID MilSystem, MIL_ID MilDigitizer)
+   {
+   LineScanRingStruct Ring;
+   LineScanConsumerDataStruct ConsumerData;
+   MIL_ID MilConsumerThread = M_NULL;
+   MIL_INT64 Height = 0, BlockLines = LINESCAN_BLOCK_LINES;
+   MIL_DOUBLE LineRate = 0.0;
+
+   /* Grab blocks of lines, optionally triggered line by line by the encoder. */
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("Height"), M_TYPE_INT64, &Height);
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("Height"), M_TYPE_INT64, &BlockLines);
+#if LINESCAN_ENCODER_TRIGGER
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerSelector"), M_TYPE_STRING, MIL_TEXT("LineStart"));
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerSource"), M_TYPE_STRING, LINESCAN_TRIGGER_SOURCE);
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerMode"), M_TYPE_STRING, MIL_TEXT("On"));
+#else
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("AcquisitionLineRate"), M_TYPE_MIL_DOUBLE, &LineRate);
+#endif
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+
+   if (!LineScanRingAlloc(MilSystem, MilDigitizer, LINESCAN_BLOCK_COUNT, LINESCAN_OBJECT_THRESHOLD,
+                          LINESCAN_OBJECT_GAP_LINES, &Ring))
+      MosPrintf(MIL_TEXT("\nThe line-scan ring could not be allocated.\n"));
+   else
+      {
+      ConsumerData.Ring = &Ring;
+      ConsumerData.StopRequested.store(false);
+      ConsumerData.StripCount = ConsumerData.ObjectCount = ConsumerData.ObjectLines = 0;
+      MthrAlloc(MilSystem, M_THREAD, M_DEFAULT, &LineScanConsumerFunction, &ConsumerData, &MilConsumerThread);
+
+      MosPrintf(MIL_TEXT("\nLine-scan acquisition in progress"));
+      if (LineRate > 0.0)
+         MosPrintf(MIL_TEXT(" (%.0f lines/s)"), LineRate);
+      MosPrintf(MIL_TEXT(".\nPress <Enter> to stop.\n\n"));
+
+      MdigProcess(MilDigitizer, &Ring.MilBlocks[0], (MIL_INT)Ring.MilBlocks.size(), M_START, M_ASYNCHRONOUS,
+                  LineScanProcessingFunction, &Ring);
+      MosGetch();
+      MdigProcess(MilDigitizer, &Ring.MilBlocks[0], (MIL_INT)Ring.MilBlocks.size(), M_STOP, M_DEFAULT,
+                  LineScanProcessingFunction, &Ring);
+      LineScanStop(&Ring);
+
+      if (MilConsumerThread)
+         {
+         ConsumerData.StopRequested.store(true);
+         MthrWait(MilConsumerThread, M_THREAD_END_WAIT, M_NULL);
+         MthrFree(MilConsumerThread);
+         }
+
+      LineScanPrintStatistics(&Ring, MilDigitizer);
+      MosPrintf(MIL_TEXT("%30s %llu strips, %llu objects\n"), MIL_TEXT("Consumed:"),
+                (unsigned long long)ConsumerData.StripCount, (unsigned long long)ConsumerData.ObjectCount);
+      LineScanRingFree(&Ring);
+      }
+
+   /* Restore the camera. */
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+#if LINESCAN_ENCODER_TRIGGER
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerSelector"), M_TYPE_STRING, MIL_TEXT("LineStart"));
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerMode"), M_TYPE_STRING, MIL_TEXT("Off"));
+#endif
+   if (Height)
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("Height"), M_TYPE_INT64, &Height);
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+   }
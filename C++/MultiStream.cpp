@@ -0,0 +1,906 @@
+﻿/********************************************************************************/
+/*
+* File name: MultiStream.cpp
+*
+* Synopsis:  Implementation of the multi-channel stream receive and of the
+*            software device. See MultiStream.h.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. Winsock must be included before windows.h. */
+#include <mil.h>
+#if M_MIL_USE_WINDOWS
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/ioctl.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+typedef int SOCKET;
+#define INVALID_SOCKET              (-1)
+#define closesocket                 close
+#define ioctlsocket                 ioctl
+#endif
+#include <string.h>
+#include <chrono>
+#include "MultiStream.h"
+#include "FeatureAccess.h"
+
+using namespace std;
+
+/* GVSP constants, as written by StreamCapture.cpp. */
+#define GVSP_HEADER_SIZE            8
+#define GVSP_FORMAT_LEADER          1
+#define GVSP_FORMAT_TRAILER         2
+#define GVSP_FORMAT_PAYLOAD         3
+#define GVSP_PAYLOAD_TYPE_IMAGE     0x0001
+#define GVSP_LEADER_SIZE            (GVSP_HEADER_SIZE + 36)
+#define GVSP_TRAILER_SIZE           (GVSP_HEADER_SIZE + 8)
+#define GVSP_BLOCK_ID_COUNT         0xFFFF
+#define UDP_PACKET_OVERHEAD         (20 + 8)
+#define GVSP_PACKET_OVERHEAD        (UDP_PACKET_OVERHEAD + GVSP_HEADER_SIZE)
+
+#define PFNC_MONO8                  0x01080001U
+#define PFNC_MONO16                 0x01100007U
+#define PFNC_RGB8_PLANAR            0x02180021U
+
+/* Largest frame reassembled; larger leaders are invalid. */
+#define MULTI_STREAM_FRAME_SIZE_MAX ((MIL_INT64)1 << 28)
+
+/* Longest wait of the receive threads, which bounds the close latency. */
+#define RECEIVE_POLL_PERIOD_US      100000
+
+/* Socket buffers, to absorb the bursts of the other channels. */
+#define SOCKET_BUFFER_SIZE          (16 << 20)
+
+/* Packets taken from one ring before going to the next. */
+#define CONSUMER_BATCH              32
+
+static void PutBE16(MIL_UINT8* Ptr, MIL_UINT32 Value)
+   {
+   Ptr[0] = (MIL_UINT8)(Value >> 8);
+   Ptr[1] = (MIL_UINT8)(Value);
+   }
+
+static void PutBE32(MIL_UINT8* Ptr, MIL_UINT32 Value)
+   {
+   Ptr[0] = (MIL_UINT8)(Value >> 24);
+   Ptr[1] = (MIL_UINT8)(Value >> 16);
+   Ptr[2] = (MIL_UINT8)(Value >> 8);
+   Ptr[3] = (MIL_UINT8)(Value);
+   }
+
+static MIL_UINT32 GetBE16(const MIL_UINT8* Ptr)
+   {
+   return ((MIL_UINT32)Ptr[0] << 8) | Ptr[1];
+   }
+
+static MIL_UINT32 GetBE32(const MIL_UINT8* Ptr)
+   {
+   return ((MIL_UINT32)Ptr[0] << 24) | ((MIL_UINT32)Ptr[1] << 16) | ((MIL_UINT32)Ptr[2] << 8) | Ptr[3];
+   }
+
+static void PutGvspHeader(MIL_UINT8* Ptr, MIL_UINT64 BlockId, MIL_UINT32 Format, MIL_UINT32 PacketId)
+   {
+   PutBE16(Ptr, 0);
+   PutBE16(Ptr + 2, (MIL_UINT32)((BlockId - 1) % GVSP_BLOCK_ID_COUNT) + 1);
+   Ptr[4] = (MIL_UINT8)(Format & 0x0F);
+   Ptr[5] = (MIL_UINT8)(PacketId >> 16);
+   Ptr[6] = (MIL_UINT8)(PacketId >> 8);
+   Ptr[7] = (MIL_UINT8)(PacketId);
+   }
+
+static void StartSockets()
+   {
+#if M_MIL_USE_WINDOWS
+   WSADATA WsaData;
+   WSAStartup(MAKEWORD(2, 2), &WsaData);
+#endif
+   }
+
+static void StopSockets()
+   {
+#if M_MIL_USE_WINDOWS
+   WSACleanup();
+#endif
+   }
+
+static SOCKET OpenSocket(MIL_INT Port, bool Loopback)
+   {
+   sockaddr_in Address;
+   int BufferSize = SOCKET_BUFFER_SIZE;
+   SOCKET Socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+   if (Socket == INVALID_SOCKET)
+      return INVALID_SOCKET;
+   setsockopt(Socket, SOL_SOCKET, Port ? SO_RCVBUF : SO_SNDBUF, (const char*)&BufferSize, sizeof(BufferSize));
+   if (!Port)
+      return Socket;
+
+   memset(&Address, 0, sizeof(Address));
+   Address.sin_family = AF_INET;
+   Address.sin_addr.s_addr = htonl(Loopback ? INADDR_LOOPBACK : INADDR_ANY);
+   Address.sin_port = htons((unsigned short)Port);
+   if (bind(Socket, (sockaddr*)&Address, sizeof(Address)) != 0)
+      {
+      closesocket(Socket);
+      return INVALID_SOCKET;
+      }
+   return Socket;
+   }
+
+/* Receive.                                                                 */
+/* -----------------------------------------------------------------------*/
+
+/* Moves the packets of one channel from its socket to its ring. */
+static MIL_UINT32 MFTYPE ReceiveThread(void* ThreadContext)
+   {
+   MultiStreamChannelStruct* Channel = (MultiStreamChannelStruct*)ThreadContext;
+   SOCKET Socket = (SOCKET)Channel->Socket;
+   MIL_UINT64 RingSize = (MIL_UINT64)Channel->RingSize;
+   size_t PacketSizeMax = (size_t)Channel->PacketSizeMax;
+   vector<MIL_UINT8> Discard(PacketSizeMax);
+
+   while (!Channel->StopRequested.load())
+      {
+      fd_set Readable;
+      timeval Wait = {0, RECEIVE_POLL_PERIOD_US};
+
+      FD_ZERO(&Readable);
+      FD_SET(Socket, &Readable);
+      if (select((int)Socket + 1, &Readable, M_NULL, M_NULL, &Wait) <= 0)
+         continue;
+
+      /* Drain the socket; it does not block. */
+      for (;;)
+         {
+         MIL_UINT64 Head = Channel->Head.load(memory_order_relaxed);
+         bool Full = (Head - Channel->Tail.load(memory_order_acquire) >= RingSize);
+         size_t Index = (size_t)(Head % RingSize);
+         MIL_UINT8* Packet = Full ? &Discard[0] : &Channel->RingData[Index*PacketSizeMax];
+         int Size = recv(Socket, (char*)Packet, (int)PacketSizeMax, 0);
+
+         if (Size < 0)
+            break;
+         Channel->Packets.fetch_add(1, memory_order_relaxed);
+         Channel->Bytes.fetch_add((MIL_UINT64)Size, memory_order_relaxed);
+         if (Full)
+            {
+            Channel->Overruns.fetch_add(1, memory_order_relaxed);
+            continue;
+            }
+         Channel->RingSizes[Index] = Size;
+         Channel->RingTimes[Index] = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+         Channel->Head.store(Head + 1, memory_order_release);
+
+         /* The consumer may be waiting only if it had emptied the ring. */
+         if (Channel->Tail.load(memory_order_acquire) == Head)
+            Channel->Ready->notify_one();
+         }
+      }
+   return 0;
+   }
+
+bool MultiStreamOpen(MIL_ID MilSystem, MIL_INT ChannelCount, MIL_INT BasePort, bool Loopback,
+                     MIL_INT64 StreamPacketSizeByte, MIL_INT RingSize, MIL_INT SlotCount, MultiStreamStruct* Stream)
+   {
+   u_long NonBlocking = 1;
+
+   if (ChannelCount < 1 || ChannelCount > MULTI_STREAM_CHANNEL_MAX || RingSize < 1 || SlotCount < 2 ||
+       StreamPacketSizeByte <= GVSP_PACKET_OVERHEAD || StreamPacketSizeByte - UDP_PACKET_OVERHEAD > MULTI_STREAM_PACKET_SIZE_MAX)
+      return false;
+
+   Stream->ChannelCount = ChannelCount;
+   Stream->PayloadPacketSizeByte = StreamPacketSizeByte - GVSP_PACKET_OVERHEAD;
+   Stream->Slots.assign((size_t)SlotCount, MultiStreamSlotStruct());
+   for (size_t s = 0; s < Stream->Slots.size(); s++)
+      Stream->Slots[s].InUse = false;
+   Stream->NextBlockId = 0;
+   Stream->StartTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+   Stream->FirstPacketTime = Stream->LastDeliveryTime = 0.0;
+   Stream->FramesDelivered = Stream->FramesIncomplete = Stream->FramesLost = Stream->FramesOutOfOrder = 0;
+   Stream->LatePackets = Stream->InvalidPackets = Stream->SplitFrames = 0;
+   Stream->SkewSum = Stream->SkewMax = 0.0;
+
+   StartSockets();
+   for (MIL_INT c = 0; c < MULTI_STREAM_CHANNEL_MAX; c++)
+      {
+      MultiStreamChannelStruct& Channel = Stream->Channels[c];
+
+      Channel.Port = BasePort + c;
+      Channel.Socket = -1;
+      Channel.MilThread = M_NULL;
+      Channel.StopRequested.store(false);
+      Channel.Ready = &Stream->Ready;
+      Channel.RingSize = RingSize;
+      Channel.PacketSizeMax = (MIL_INT)(StreamPacketSizeByte - UDP_PACKET_OVERHEAD);
+      Channel.Head.store(0);
+      Channel.Tail.store(0);
+      Channel.Packets.store(0);
+      Channel.Bytes.store(0);
+      Channel.Overruns.store(0);
+      Channel.FramesCarried = 0;
+      Channel.LagSum = Channel.LagMax = 0.0;
+      }
+
+   for (MIL_INT c = 0; c < ChannelCount; c++)
+      {
+      MultiStreamChannelStruct& Channel = Stream->Channels[c];
+      SOCKET Socket = OpenSocket(Channel.Port, Loopback);
+
+      if (Socket == INVALID_SOCKET)
+         {
+         MosPrintf(MIL_TEXT("Channel %d could not receive on port %d.\n"), (int)c, (int)Channel.Port);
+         MultiStreamClose(Stream);
+         return false;
+         }
+      ioctlsocket(Socket, FIONBIO, &NonBlocking);
+      Channel.Socket = (MIL_INT64)Socket;
+      Channel.RingData.assign((size_t)(RingSize*Channel.PacketSizeMax), 0);
+      Channel.RingSizes.assign((size_t)RingSize, 0);
+      Channel.RingTimes.assign((size_t)RingSize, 0.0);
+      MthrAlloc(MilSystem, M_THREAD, M_DEFAULT, &ReceiveThread, &Channel, &Channel.MilThread);
+      }
+   return true;
+   }
+
+void MultiStreamClose(MultiStreamStruct* Stream)
+   {
+   for (MIL_INT c = 0; c < Stream->ChannelCount; c++)
+      {
+      MultiStreamChannelStruct& Channel = Stream->Channels[c];
+
+      if (Channel.MilThread)
+         {
+         Channel.StopRequested.store(true);
+         MthrWait(Channel.MilThread, M_THREAD_END_WAIT, M_NULL);
+         MthrFree(Channel.MilThread);
+         Channel.MilThread = M_NULL;
+         }
+      if (Channel.Socket != -1)
+         {
+         closesocket((SOCKET)Channel.Socket);
+         Channel.Socket = -1;
+         }
+      }
+   StopSockets();
+   }
+
+/* Reassembly.                                                              */
+/* -----------------------------------------------------------------------*/
+
+static MultiStreamSlotStruct& SlotOf(MultiStreamStruct* Stream, MIL_UINT64 BlockId)
+   {
+   return Stream->Slots[(size_t)(BlockId % Stream->Slots.size())];
+   }
+
+static void ResetSlot(MultiStreamSlotStruct* Slot, MIL_UINT64 BlockId, MIL_DOUBLE Time)
+   {
+   Slot->InUse = true;
+   Slot->BlockId = BlockId;
+   Slot->LeaderSeen = false;
+   Slot->PacketCount = 0;
+   Slot->PacketsReceived = 0;
+   Slot->Complete = false;
+   Slot->FirstTime = Time;
+   Slot->CompleteTime = 0.0;
+   for (MIL_INT c = 0; c < MULTI_STREAM_CHANNEL_MAX; c++)
+      {
+      Slot->ChannelPackets[c] = 0;
+      Slot->ChannelLastTime[c] = 0.0;
+      }
+   }
+
+/* Gives up on the next frame. */
+static void DropNext(MultiStreamStruct* Stream)
+   {
+   MultiStreamSlotStruct& Slot = SlotOf(Stream, Stream->NextBlockId);
+
+   if (Slot.InUse && Slot.BlockId == Stream->NextBlockId)
+      {
+      Slot.InUse = false;
+      Stream->FramesIncomplete++;
+      }
+   else
+      Stream->FramesLost++;
+   Stream->NextBlockId++;
+   }
+
+static void ReadLeader(MultiStreamStruct* Stream, MultiStreamSlotStruct* Slot, const MIL_UINT8* Data)
+   {
+   StreamReplayFrameStruct& Frame = Slot->Frame;
+   MIL_INT64 FrameSize;
+
+   Frame.PixelFormat = GetBE32(Data + GVSP_HEADER_SIZE + 12);
+   Frame.SizeX = GetBE32(Data + GVSP_HEADER_SIZE + 16);
+   Frame.SizeY = GetBE32(Data + GVSP_HEADER_SIZE + 20);
+   Frame.SizeBit = (Frame.PixelFormat == PFNC_MONO16) ? 16 : 8;
+   Frame.SizeBand = (Frame.PixelFormat == PFNC_RGB8_PLANAR) ? 3 : 1;
+   FrameSize = Frame.SizeX*Frame.SizeY*Frame.SizeBand*(Frame.SizeBit/8);
+   if (FrameSize <= 0 || FrameSize > MULTI_STREAM_FRAME_SIZE_MAX)
+      {
+      Stream->InvalidPackets++;
+      return;
+      }
+   Frame.Data.resize((size_t)FrameSize);
+   Slot->LeaderSeen = true;
+   }
+
+/* Places one packet in its frame. */
+static void ReceivePacket(MultiStreamStruct* Stream, MIL_INT Channel, const MIL_UINT8* Data, MIL_INT Size, MIL_DOUBLE Time)
+   {
+   MIL_UINT32 BlockId16, Format, PacketId, Ahead;
+   MIL_UINT64 BlockId;
+
+   if (Size < GVSP_HEADER_SIZE || GetBE16(Data + 2) == 0)
+      {
+      Stream->InvalidPackets++;
+      return;
+      }
+   BlockId16 = GetBE16(Data + 2);
+   Format = Data[4] & 0x0F;
+   PacketId = ((MIL_UINT32)Data[5] << 16) | ((MIL_UINT32)Data[6] << 8) | Data[7];
+
+   /* Unwrap the 16-bit block ID from the next frame to deliver; IDs behind */
+   /* it are of frames already delivered or dropped.                       */
+   if (Stream->NextBlockId == 0)
+      {
+      Stream->NextBlockId = BlockId16;
+      Stream->FirstPacketTime = Time;
+      }
+   Ahead = (BlockId16 - 1 + GVSP_BLOCK_ID_COUNT - (MIL_UINT32)((Stream->NextBlockId - 1) % GVSP_BLOCK_ID_COUNT)) % GVSP_BLOCK_ID_COUNT;
+   if (Ahead >= GVSP_BLOCK_ID_COUNT/2)
+      {
+      Stream->LatePackets++;
+      return;
+      }
+   for (; Ahead >= (MIL_UINT32)Stream->Slots.size(); Ahead--)
+      DropNext(Stream);
+   BlockId = Stream->NextBlockId + Ahead;
+
+   MultiStreamSlotStruct& Slot = SlotOf(Stream, BlockId);
+   StreamReplayFrameStruct& Frame = Slot.Frame;
+   if (!Slot.InUse)
+      ResetSlot(&Slot, BlockId, Time);
+   else if (Slot.Complete)
+      {
+      Stream->LatePackets++;
+      return;
+      }
+
+   if (Format == GVSP_FORMAT_LEADER && Size >= GVSP_LEADER_SIZE && PacketId == 0)
+      ReadLeader(Stream, &Slot, Data);
+   else if (Format == GVSP_FORMAT_PAYLOAD && PacketId > 0)
+      {
+      MIL_INT64 Offset = (PacketId - 1)*Stream->PayloadPacketSizeByte;
+      MIL_INT64 Copy = Size - GVSP_HEADER_SIZE;
+
+      /* Before the leader, the size of the frame is not known yet. */
+      if (!Slot.LeaderSeen && Offset + Copy > (MIL_INT64)Frame.Data.size() && Offset + Copy <= MULTI_STREAM_FRAME_SIZE_MAX)
+         Frame.Data.resize((size_t)(Offset + Copy));
+      if (Offset + Copy > (MIL_INT64)Frame.Data.size())
+         Copy = (MIL_INT64)Frame.Data.size() - Offset;
+      if (Copy > 0)
+         memcpy(&Frame.Data[(size_t)Offset], Data + GVSP_HEADER_SIZE, (size_t)Copy);
+      }
+   else if (Format == GVSP_FORMAT_TRAILER && Size >= GVSP_TRAILER_SIZE)
+      Slot.PacketCount = (MIL_INT64)PacketId + 1;
+   else
+      {
+      Stream->InvalidPackets++;
+      return;
+      }
+
+   Slot.PacketsReceived++;
+   Slot.ChannelPackets[Channel]++;
+   Slot.ChannelLastTime[Channel] = Time;
+   if (Slot.LeaderSeen && Slot.PacketCount && Slot.PacketsReceived >= Slot.PacketCount)
+      {
+      Slot.Complete = true;
+      Slot.CompleteTime = Time;
+      if (BlockId != Stream->NextBlockId)
+         Stream->FramesOutOfOrder++;
+      }
+   }
+
+/* Takes the packets waiting in the rings, a batch per channel in turn. */
+/* Returns false if there were none.                                   */
+static bool TakePackets(MultiStreamStruct* Stream)
+   {
+   bool Taken = false;
+
+   for (MIL_INT c = 0; c < Stream->ChannelCount; c++)
+      {
+      MultiStreamChannelStruct& Channel = Stream->Channels[c];
+      MIL_UINT64 Tail = Channel.Tail.load(memory_order_relaxed);
+      MIL_UINT64 Head = Channel.Head.load(memory_order_acquire);
+
+      for (MIL_INT n = 0; n < CONSUMER_BATCH && Tail != Head; n++, Tail++)
+         {
+         size_t Index = (size_t)(Tail % (MIL_UINT64)Channel.RingSize);
+
+         ReceivePacket(Stream, c, &Channel.RingData[Index*(size_t)Channel.PacketSizeMax],
+                       Channel.RingSizes[Index], Channel.RingTimes[Index]);
+         Taken = true;
+         }
+      Channel.Tail.store(Tail, memory_order_release);
+      }
+   return Taken;
+   }
+
+/* Hands the next frame over and measures how far apart its channels completed. */
+static void Deliver(MultiStreamStruct* Stream, MultiStreamSlotStruct* Slot, StreamReplayFrameStruct* Frame)
+   {
+   MIL_DOUBLE First = 0.0, Last = 0.0;
+   MIL_INT Channels = 0;
+
+   for (MIL_INT c = 0; c < Stream->ChannelCount; c++)
+      {
+      if (!Slot->ChannelPackets[c])
+         continue;
+      if (!Channels || Slot->ChannelLastTime[c] < First)
+         First = Slot->ChannelLastTime[c];
+      if (!Channels || Slot->ChannelLastTime[c] > Last)
+         Last = Slot->ChannelLastTime[c];
+      Channels++;
+      }
+   for (MIL_INT c = 0; c < Stream->ChannelCount; c++)
+      {
+      MultiStreamChannelStruct& Channel = Stream->Channels[c];
+      MIL_DOUBLE Lag = Slot->ChannelLastTime[c] - First;
+
+      if (!Slot->ChannelPackets[c])
+         continue;
+      Channel.FramesCarried++;
+      Channel.LagSum += Lag;
+      if (Lag > Channel.LagMax)
+         Channel.LagMax = Lag;
+      }
+   if (Channels > 1)
+      {
+      Stream->SplitFrames++;
+      Stream->SkewSum += Last - First;
+      if (Last - First > Stream->SkewMax)
+         Stream->SkewMax = Last - First;
+      }
+
+   Frame->BlockId = Slot->BlockId;
+   Frame->PixelFormat = Slot->Frame.PixelFormat;
+   Frame->SizeX = Slot->Frame.SizeX;
+   Frame->SizeY = Slot->Frame.SizeY;
+   Frame->SizeBit = Slot->Frame.SizeBit;
+   Frame->SizeBand = Slot->Frame.SizeBand;
+   Frame->RecordTime = Slot->FirstTime - Stream->FirstPacketTime;
+   Frame->Data.swap(Slot->Frame.Data);
+
+   Slot->InUse = false;
+   Stream->NextBlockId++;
+   Stream->FramesDelivered++;
+   Stream->LastDeliveryTime = Last;
+   }
+
+/* Delivers the next frame if it is complete; drops it if a later frame has */
+/* been waiting for it too long.                                            */
+static bool DeliverNext(MultiStreamStruct* Stream, StreamReplayFrameStruct* Frame)
+   {
+   MIL_DOUBLE Now = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+
+   while (Stream->NextBlockId)
+      {
+      MultiStreamSlotStruct& Slot = SlotOf(Stream, Stream->NextBlockId);
+      bool Overdue = false;
+
+      if (Slot.InUse && Slot.BlockId == Stream->NextBlockId && Slot.Complete)
+         {
+         Deliver(Stream, &Slot, Frame);
+         return true;
+         }
+      for (MIL_UINT64 b = Stream->NextBlockId + 1; b < Stream->NextBlockId + Stream->Slots.size() && !Overdue; b++)
+         {
+         MultiStreamSlotStruct& Later = SlotOf(Stream, b);
+         Overdue = Later.InUse && Later.BlockId == b && Later.Complete && (Now - Later.CompleteTime > MULTI_STREAM_FRAME_TIMEOUT);
+         }
+      if (!Overdue)
+         return false;
+      DropNext(Stream);
+      }
+   return false;
+   }
+
+MIL_INT MultiStreamNextFrame(MultiStreamStruct* Stream, MIL_DOUBLE Timeout, StreamReplayFrameStruct* Frame)
+   {
+   MIL_DOUBLE Deadline = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) + Timeout;
+
+   if (Stream->Slots.empty())
+      return MULTI_STREAM_ERROR;
+
+   for (;;)
+      {
+      if (DeliverNext(Stream, Frame))
+         return MULTI_STREAM_FRAME;
+      if (TakePackets(Stream))
+         continue;
+      if (MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) >= Deadline)
+         return MULTI_STREAM_TIMEOUT;
+
+      /* Wait for a packet; a notification missed between the check and the */
+      /* wait only costs one period.                                        */
+      unique_lock<mutex> Guard(Stream->ReadyLock);
+      Stream->Ready.wait_for(Guard, chrono::milliseconds(1));
+      }
+   }
+
+void MultiStreamPrintStatistics(MultiStreamStruct* Stream)
+   {
+   MIL_DOUBLE Elapsed = Stream->LastDeliveryTime - Stream->FirstPacketTime;
+   MIL_UINT64 TotalBytes = 0;
+
+   for (MIL_INT c = 0; c < Stream->ChannelCount; c++)
+      TotalBytes += Stream->Channels[c].Bytes.load();
+
+   MosPrintf(MIL_TEXT("\n------------------- Multi-channel receive ------------------\n\n"));
+   MosPrintf(MIL_TEXT("%30s %d\n"), MIL_TEXT("Channels:"), (int)Stream->ChannelCount);
+   MosPrintf(MIL_TEXT("%30s %llu\n"), MIL_TEXT("Frames delivered:"), (unsigned long long)Stream->FramesDelivered);
+   MosPrintf(MIL_TEXT("%30s %llu\n"), MIL_TEXT("Incomplete frames dropped:"), (unsigned long long)Stream->FramesIncomplete);
+   MosPrintf(MIL_TEXT("%30s %llu\n"), MIL_TEXT("Frames lost:"), (unsigned long long)Stream->FramesLost);
+   MosPrintf(MIL_TEXT("%30s %llu\n"), MIL_TEXT("Frames completed out of order:"), (unsigned long long)Stream->FramesOutOfOrder);
+   MosPrintf(MIL_TEXT("%30s %llu late, %llu invalid\n"), MIL_TEXT("Packets discarded:"),
+             (unsigned long long)Stream->LatePackets, (unsigned long long)Stream->InvalidPackets);
+   if (Elapsed > 0.0)
+      MosPrintf(MIL_TEXT("%30s %.1f fps, %.0f Mb/s\n"), MIL_TEXT("Throughput:"),
+                Stream->FramesDelivered/Elapsed, 8.0*TotalBytes/Elapsed/1e6);
+   if (Stream->SplitFrames)
+      MosPrintf(MIL_TEXT("%30s %.3f ms mean, %.3f ms max over %llu frames\n"), MIL_TEXT("Skew between channels:"),
+                1e3*Stream->SkewSum/Stream->SplitFrames, 1e3*Stream->SkewMax, (unsigned long long)Stream->SplitFrames);
+
+   MosPrintf(MIL_TEXT("\n%30s %10s %10s %10s %10s %10s\n"), MIL_TEXT("Channel"), MIL_TEXT("Mb/s"),
+             MIL_TEXT("packets"), MIL_TEXT("overruns"), MIL_TEXT("lag (ms)"), MIL_TEXT("max (ms)"));
+   for (MIL_INT c = 0; c < Stream->ChannelCount; c++)
+      {
+      MultiStreamChannelStruct& Channel = Stream->Channels[c];
+      MIL_TEXT_CHAR Title[64];
+
+      MosSprintf(Title, 64, MIL_TEXT("%d (port %d):"), (int)c, (int)Channel.Port);
+      MosPrintf(MIL_TEXT("%30s %10.0f %10llu %10llu %10.3f %10.3f\n"), Title,
+                (Elapsed > 0.0) ? 8.0*Channel.Bytes.load()/Elapsed/1e6 : 0.0,
+                (unsigned long long)Channel.Packets.load(), (unsigned long long)Channel.Overruns.load(),
+                Channel.FramesCarried ? 1e3*Channel.LagSum/Channel.FramesCarried : 0.0, 1e3*Channel.LagMax);
+      }
+   }
+
+/* Camera.                                                                  */
+/* -----------------------------------------------------------------------*/
+
+MIL_INT MultiStreamCameraChannelCount(MIL_ID MilDigitizer)
+   {
+   MIL_INT64 Count = 0;
+
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("DeviceStreamChannelCount"), M_TYPE_INT64, &Count);
+   if (!FeatureAccessSucceeded() || Count < 1)
+      {
+      Count = 0;
+      FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GevStreamChannelCount"), M_TYPE_INT64, &Count);
+      if (!FeatureAccessSucceeded())
+         Count = 0;
+      }
+   return (Count < 1) ? 1 : (MIL_INT)Count;
+   }
+
+/* Returns the address in dotted notation as GevSCDA wants it, or -1. */
+static MIL_INT64 ParseIpAddress(const MIL_STRING& Text)
+   {
+   MIL_INT64 Address = 0, Part = -1;
+   MIL_INT Parts = 0;
+
+   for (size_t i = 0; i <= Text.size(); i++)
+      {
+      if (i < Text.size() && Text[i] >= MIL_TEXT('0') && Text[i] <= MIL_TEXT('9'))
+         Part = ((Part < 0) ? 0 : 10*Part) + (Text[i] - MIL_TEXT('0'));
+      else if ((i == Text.size() || Text[i] == MIL_TEXT('.')) && Part >= 0 && Part <= 255)
+         {
+         Address = (Address << 8) | Part;
+         Part = -1;
+         Parts++;
+         }
+      else
+         return -1;
+      }
+   return (Parts == 4) ? Address : -1;
+   }
+
+bool MultiStreamReadCamera(MIL_ID MilDigitizer, MIL_INT ChannelCount, MultiStreamCameraStruct* Camera)
+   {
+   Camera->ChannelCount = 0;
+   if (ChannelCount < 1 || ChannelCount > MULTI_STREAM_CHANNEL_MAX)
+      return false;
+
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GevStreamChannelSelector"), M_TYPE_INT64, &Camera->ChannelSelector);
+   if (!FeatureAccessSucceeded())
+      return false;
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("AcquisitionMode"), M_TYPE_STRING, Camera->AcquisitionMode);
+   if (!FeatureAccessSucceeded())
+      return false;
+
+   for (MIL_INT64 c = 0; c < ChannelCount; c++)
+      {
+      MultiStreamCameraChannelStruct& Channel = Camera->Channels[c];
+      MIL_INT64 PacketSizeByte = 0;
+
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GevStreamChannelSelector"), M_TYPE_INT64, &c);
+      if (!FeatureAccessSucceeded())
+         return false;
+      FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GevSCPSPacketSize"), M_TYPE_INT64, &PacketSizeByte);
+      if (!FeatureAccessSucceeded() || (c > 0 && PacketSizeByte != Camera->PacketSizeByte))
+         return false;
+      Camera->PacketSizeByte = PacketSizeByte;
+      FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GevSCDA"), M_TYPE_INT64, &Channel.Address);
+      if (!FeatureAccessSucceeded())
+         return false;
+      FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GevSCPHostPort"), M_TYPE_INT64, &Channel.HostPort);
+      if (!FeatureAccessSucceeded())
+         return false;
+      }
+
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GevStreamChannelSelector"), M_TYPE_INT64, &Camera->ChannelSelector);
+   Camera->ChannelCount = ChannelCount;
+   return FeatureAccessSucceeded();
+   }
+
+/* Gives the stream channels and the acquisition mode of the camera back */
+/* their settings. Returns false if a write failed.                      */
+static bool RestoreCamera(MIL_ID MilDigitizer, const MultiStreamCameraStruct* Camera)
+   {
+   bool Restored = true;
+
+   for (MIL_INT64 c = 0; c < Camera->ChannelCount; c++)
+      {
+      const MultiStreamCameraChannelStruct& Channel = Camera->Channels[c];
+
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GevStreamChannelSelector"), M_TYPE_INT64, &c);
+      if (!FeatureAccessSucceeded())
+         {
+         Restored = false;
+         continue;
+         }
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GevSCDA"), M_TYPE_INT64, &Channel.Address);
+      Restored = FeatureAccessSucceeded() && Restored;
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GevSCPHostPort"), M_TYPE_INT64, &Channel.HostPort);
+      Restored = FeatureAccessSucceeded() && Restored;
+      }
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GevStreamChannelSelector"), M_TYPE_INT64, &Camera->ChannelSelector);
+   Restored = FeatureAccessSucceeded() && Restored;
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("AcquisitionMode"), M_TYPE_STRING, Camera->AcquisitionMode);
+   return FeatureAccessSucceeded() && Restored;
+   }
+
+/* Writes the channels and starts the acquisition; stops at the first write */
+/* that fails.                                                              */
+static bool PointCamera(MIL_ID MilDigitizer, MIL_INT64 Address, const MultiStreamStruct* Stream, const MultiStreamCameraStruct* Camera)
+   {
+   MIL_INT64 Locked = 1;
+
+   for (MIL_INT64 c = 0; c < Camera->ChannelCount && c < Stream->ChannelCount; c++)
+      {
+      MIL_INT64 Port = Stream->Channels[c].Port;
+
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GevStreamChannelSelector"), M_TYPE_INT64, &c);
+      if (!FeatureAccessSucceeded())
+         return false;
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GevSCDA"), M_TYPE_INT64, &Address);
+      if (!FeatureAccessSucceeded())
+         return false;
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GevSCPHostPort"), M_TYPE_INT64, &Port);
+      if (!FeatureAccessSucceeded())
+         return false;
+      }
+
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("AcquisitionMode"), M_TYPE_STRING, MIL_TEXT("Continuous"));
+   if (!FeatureAccessSucceeded())
+      return false;
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TLParamsLocked"), M_TYPE_INT64, &Locked);
+   if (!FeatureAccessSucceeded())
+      return false;
+   FeatureAccessControl(MilDigitizer, M_FEATURE_EXECUTE, MIL_TEXT("AcquisitionStart"), M_DEFAULT, M_NULL);
+   return FeatureAccessSucceeded();
+   }
+
+bool MultiStreamStartCamera(MIL_ID MilDigitizer, const MultiStreamStruct* Stream, const MultiStreamCameraStruct* Camera)
+   {
+   MIL_STRING HostAddress;
+   MIL_INT64 Address;
+
+   FeatureAccessMdigInquire(MilDigitizer, M_GC_LOCAL_IP_ADDRESS_STRING, HostAddress);
+   Address = ParseIpAddress(HostAddress);
+   if (Address < 0)
+      return false;
+
+   if (PointCamera(MilDigitizer, Address, Stream, Camera))
+      return true;
+   MultiStreamStopCamera(MilDigitizer, Camera);
+   return false;
+   }
+
+void MultiStreamStopCamera(MIL_ID MilDigitizer, const MultiStreamCameraStruct* Camera)
+   {
+   MIL_INT64 Unlocked = 0;
+
+   FeatureAccessControl(MilDigitizer, M_FEATURE_EXECUTE, MIL_TEXT("AcquisitionStop"), M_DEFAULT, M_NULL);
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TLParamsLocked"), M_TYPE_INT64, &Unlocked);
+   if (!RestoreCamera(MilDigitizer, Camera))
+      MosPrintf(MIL_TEXT("Warning: the stream channels of the camera could not all be restored.\n"));
+   }
+
+/* Software device.                                                         */
+/* -----------------------------------------------------------------------*/
+
+static void Send(MultiStreamDeviceStruct* Device, const sockaddr_in* Addresses, MIL_UINT64 BlockId,
+                 MIL_UINT32 PacketId, const MIL_UINT8* Packet, MIL_INT64 Size)
+   {
+   MIL_INT Channel = (Device->Split == MULTI_STREAM_SPLIT_FRAMES) ?
+                     (MIL_INT)((BlockId - 1) % Device->ChannelCount) : (MIL_INT)(PacketId % Device->ChannelCount);
+
+   if (sendto((SOCKET)Device->Sockets[Channel], (const char*)Packet, (int)Size, 0,
+              (const sockaddr*)&Addresses[Channel], sizeof(sockaddr_in)) == (int)Size)
+      Device->PacketsSent++;
+   else
+      Device->SendErrors++;
+   }
+
+/* Sends a moving gradient, one GVSP block per frame. */
+static MIL_UINT32 MFTYPE DeviceThread(void* ThreadContext)
+   {
+   MultiStreamDeviceStruct* Device = (MultiStreamDeviceStruct*)ThreadContext;
+   MIL_INT64 FrameSize = Device->SizeX*Device->SizeY;
+   vector<MIL_UINT8> Image((size_t)FrameSize);
+   vector<MIL_UINT8> Packet((size_t)(GVSP_HEADER_SIZE + Device->PayloadPacketSizeByte));
+   MIL_UINT8 Leader[GVSP_LEADER_SIZE];
+   MIL_UINT8 Trailer[GVSP_TRAILER_SIZE];
+   sockaddr_in Addresses[MULTI_STREAM_CHANNEL_MAX];
+
+   for (MIL_INT c = 0; c < Device->ChannelCount; c++)
+      {
+      memset(&Addresses[c], 0, sizeof(sockaddr_in));
+      Addresses[c].sin_family = AF_INET;
+      Addresses[c].sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      Addresses[c].sin_port = htons((unsigned short)(Device->BasePort + c));
+      }
+
+   Device->StartTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+   for (MIL_UINT64 BlockId = 1; !Device->StopRequested.load(); BlockId++)
+      {
+      MIL_DOUBLE Now = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+      MIL_UINT64 TimeStampNs = (MIL_UINT64)((Now - Device->StartTime)*1e9);
+      MIL_UINT32 PacketId = 0;
+
+      /* Wait for the time of the frame. */
+      if (Device->FrameRate > 0.0)
+         {
+         MIL_DOUBLE Due = Device->StartTime + (BlockId - 1)/Device->FrameRate;
+
+         while (Now < Due && !Device->StopRequested.load())
+            {
+            if (Due - Now > 0.002)
+               MosSleep(1);
+            Now = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+            }
+         }
+
+      for (MIL_INT64 y = 0; y < Device->SizeY; y++)
+         {
+         MIL_UINT8* Row = &Image[(size_t)(y*Device->SizeX)];
+         MIL_UINT32 Base = (MIL_UINT32)(y + 4*BlockId);
+
+         for (MIL_INT64 x = 0; x < Device->SizeX; x++)
+            Row[x] = (MIL_UINT8)(Base + x);
+         }
+
+      memset(Leader, 0, sizeof(Leader));
+      PutGvspHeader(Leader, BlockId, GVSP_FORMAT_LEADER, PacketId);
+      PutBE16(Leader + GVSP_HEADER_SIZE + 2, GVSP_PAYLOAD_TYPE_IMAGE);
+      PutBE32(Leader + GVSP_HEADER_SIZE + 4, (MIL_UINT32)(TimeStampNs >> 32));
+      PutBE32(Leader + GVSP_HEADER_SIZE + 8, (MIL_UINT32)(TimeStampNs));
+      PutBE32(Leader + GVSP_HEADER_SIZE + 12, PFNC_MONO8);
+      PutBE32(Leader + GVSP_HEADER_SIZE + 16, (MIL_UINT32)Device->SizeX);
+      PutBE32(Leader + GVSP_HEADER_SIZE + 20, (MIL_UINT32)Device->SizeY);
+      Send(Device, Addresses, BlockId, PacketId++, Leader, sizeof(Leader));
+
+      for (MIL_INT64 Offset = 0; Offset < FrameSize; Offset += Device->PayloadPacketSizeByte)
+         {
+         MIL_INT64 Size = FrameSize - Offset;
+
+         if (Size > Device->PayloadPacketSizeByte)
+            Size = Device->PayloadPacketSizeByte;
+         PutGvspHeader(&Packet[0], BlockId, GVSP_FORMAT_PAYLOAD, PacketId);
+         memcpy(&Packet[GVSP_HEADER_SIZE], &Image[(size_t)Offset], (size_t)Size);
+         Send(Device, Addresses, BlockId, PacketId++, &Packet[0], GVSP_HEADER_SIZE + Size);
+         }
+
+      memset(Trailer, 0, sizeof(Trailer));
+      PutGvspHeader(Trailer, BlockId, GVSP_FORMAT_TRAILER, PacketId);
+      PutBE16(Trailer + GVSP_HEADER_SIZE + 2, GVSP_PAYLOAD_TYPE_IMAGE);
+      PutBE32(Trailer + GVSP_HEADER_SIZE + 4, (MIL_UINT32)Device->SizeY);
+      Send(Device, Addresses, BlockId, PacketId, Trailer, sizeof(Trailer));
+      Device->FramesSent++;
+      }
+   Device->StopTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+   return 0;
+   }
+
+bool MultiStreamDeviceStart(MIL_ID MilSystem, MIL_INT ChannelCount, MIL_INT BasePort, MIL_INT64 StreamPacketSizeByte,
+                            MIL_INT64 SizeX, MIL_INT64 SizeY, MIL_DOUBLE FrameRate, MIL_INT Split,
+                            MultiStreamDeviceStruct* Device)
+   {
+   if (ChannelCount < 1 || ChannelCount > MULTI_STREAM_CHANNEL_MAX || StreamPacketSizeByte <= GVSP_PACKET_OVERHEAD ||
+       SizeX <= 0 || SizeY <= 0)
+      return false;
+
+   Device->ChannelCount = ChannelCount;
+   Device->BasePort = BasePort;
+   Device->PayloadPacketSizeByte = StreamPacketSizeByte - GVSP_PACKET_OVERHEAD;
+   Device->SizeX = SizeX;
+   Device->SizeY = SizeY;
+   Device->FrameRate = FrameRate;
+   Device->Split = Split;
+   Device->MilThread = M_NULL;
+   Device->StopRequested.store(false);
+   Device->FramesSent = Device->PacketsSent = Device->SendErrors = 0;
+   Device->StartTime = Device->StopTime = 0.0;
+
+   StartSockets();
+   for (MIL_INT c = 0; c < MULTI_STREAM_CHANNEL_MAX; c++)
+      Device->Sockets[c] = -1;
+   for (MIL_INT c = 0; c < ChannelCount; c++)
+      {
+      SOCKET Socket = OpenSocket(0, true);
+
+      if (Socket == INVALID_SOCKET)
+         {
+         MultiStreamDeviceStop(Device);
+         return false;
+         }
+      Device->Sockets[c] = (MIL_INT64)Socket;
+      }
+
+   MthrAlloc(MilSystem, M_THREAD, M_DEFAULT, &DeviceThread, Device, &Device->MilThread);
+   return (Device->MilThread != M_NULL);
+   }
+
+void MultiStreamDeviceStop(MultiStreamDeviceStruct* Device)
+   {
+   if (Device->MilThread)
+      {
+      Device->StopRequested.store(true);
+      MthrWait(Device->MilThread, M_THREAD_END_WAIT, M_NULL);
+      MthrFree(Device->MilThread);
+      Device->MilThread = M_NULL;
+      }
+   for (MIL_INT c = 0; c < Device->ChannelCount; c++)
+      if (Device->Sockets[c] != -1)
+         {
+         closesocket((SOCKET)Device->Sockets[c]);
+         Device->Sockets[c] = -1;
+         }
+   StopSockets();
+   }
+
+void MultiStreamDevicePrintStatistics(MultiStreamDeviceStruct* Device)
+   {
+   MIL_DOUBLE Elapsed = Device->StopTime - Device->StartTime;
+
+   MosPrintf(MIL_TEXT("\n---------------------- Software device ---------------------\n\n"));
+   MosPrintf(MIL_TEXT("%30s %lld x %lld Mono8, split by %s over %d channel(s)\n"), MIL_TEXT("Stream:"),
+             (long long)Device->SizeX, (long long)Device->SizeY,
+             (Device->Split == MULTI_STREAM_SPLIT_FRAMES) ? MIL_TEXT("frame") : MIL_TEXT("packet"), (int)Device->ChannelCount);
+   MosPrintf(MIL_TEXT("%30s %llu\n"), MIL_TEXT("Frames sent:"), (unsigned long long)Device->FramesSent);
+   MosPrintf(MIL_TEXT("%30s %llu (%llu errors)\n"), MIL_TEXT("Packets sent:"),
+             (unsigned long long)Device->PacketsSent, (unsigned long long)Device->SendErrors);
+   if (Elapsed > 0.0)
+      MosPrintf(MIL_TEXT("%30s %.1f fps, %.0f Mb/s of pixels\n"), MIL_TEXT("Rate:"), Device->FramesSent/Elapsed,
+                8.0*Device->FramesSent*Device->SizeX*Device->SizeY/Elapsed/1e6);
+   }
@@ -0,0 +1,218 @@
+﻿/********************************************************************************/
+/*
+* File name: MultiStream.h
+*
+* Synopsis:  Receive of a GVSP stream spread over several stream channels or
+*            aggregated links, for cameras whose bandwidth exceeds one GigE
+*            link, and a software device that sends such a stream on the
+*            loopback interface to test it without a camera.
+*
+*            Each channel is a UDP port of the host (BasePort + channel) with
+*            its own receive thread and packet ring. The receive threads only
+*            move packets from their socket to their ring, time stamped; the
+*            reassembly is done by the consumer in MultiStreamNextFrame(),
+*            which places every packet in its frame from the block ID and
+*            packet ID of its GVSP header, whatever the channel that carried
+*            it. The stream can thus be split either by frame (multiple stream
+*            channels, each frame on one channel) or by packet (link
+*            aggregation, the packets of a frame spread over the links).
+*
+*            Frames are delivered in block ID order. A window of SlotCount
+*            frames is reassembled at once; a frame still incomplete when a
+*            later frame has been complete for MULTI_STREAM_FRAME_TIMEOUT, or
+*            when the window must move past it, is dropped.
+*
+*            Per channel, the throughput, the packets dropped because the
+*            ring was full and the lag of the channel behind the first one
+*            to complete its part of a frame are reported; per frame split
+*            over several channels, the skew between the first and last
+*            channel to complete.
+*
+*            With a camera, the stream channels are pointed at the host
+*            address of the digitizer (GevSCDA and GevSCPHostPort), so the
+*            camera streams to the application instead of the MIL grab path.
+*            The channels keep their packet size (GevSCPSPacketSize), and
+*            their destination and the acquisition mode are restored when
+*            the camera is stopped.
+*            The host side of link aggregation is seen as one interface;
+*            each channel is reported as one link. There is no packet
+*            resend.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+#ifndef MULTI_STREAM_H
+#define MULTI_STREAM_H
+
+#include <mil.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include "StreamCapture.h"
+
+/* Maximum number of channels of a stream. */
+#define MULTI_STREAM_CHANNEL_MAX       8
+
+/* Largest packet received, IP and UDP headers excluded (jumbo frames). */
+#define MULTI_STREAM_PACKET_SIZE_MAX   9000
+
+/* Seconds a complete frame waits for the earlier frames before they are dropped. */
+#define MULTI_STREAM_FRAME_TIMEOUT     0.1
+
+/* Ways the software device splits the stream over the channels. */
+#define MULTI_STREAM_SPLIT_FRAMES      0
+#define MULTI_STREAM_SPLIT_PACKETS     1
+
+/* Return values of MultiStreamNextFrame(). */
+#define MULTI_STREAM_FRAME             0
+#define MULTI_STREAM_TIMEOUT           1
+#define MULTI_STREAM_ERROR             2
+
+/* One channel: its socket, receive thread and packet ring. The ring has one */
+/* producer, the receive thread, and one consumer, MultiStreamNextFrame().   */
+typedef struct
+   {
+   MIL_INT                  Port;
+   MIL_INT64                Socket;          /* -1 if not open. */
+   MIL_ID                   MilThread;
+   std::atomic<bool>        StopRequested;
+   std::condition_variable* Ready;           /* Notified when the ring gets a packet. */
+
+   MIL_INT                  RingSize;
+   MIL_INT                  PacketSizeMax;   /* Largest packet of the channel, IP and UDP headers excluded. */
+   std::vector<MIL_UINT8>   RingData;        /* RingSize packets of PacketSizeMax bytes. */
+   std::vector<MIL_INT>     RingSizes;
+   std::vector<MIL_DOUBLE>  RingTimes;
+   std::atomic<MIL_UINT64>  Head;            /* Written by the receive thread. */
+   std::atomic<MIL_UINT64>  Tail;            /* Written by the consumer. */
+
+   /* Receive thread. */
+   std::atomic<MIL_UINT64>  Packets;
+   std::atomic<MIL_UINT64>  Bytes;
+   std::atomic<MIL_UINT64>  Overruns;        /* Packets dropped, ring full. */
+
+   /* Consumer. */
+   MIL_UINT64               FramesCarried;   /* Delivered frames with packets on the channel. */
+   MIL_DOUBLE               LagSum;
+   MIL_DOUBLE               LagMax;
+   } MultiStreamChannelStruct;
+
+/* Frame being reassembled. */
+typedef struct
+   {
+   bool                     InUse;
+   MIL_UINT64               BlockId;         /* Unwrapped. */
+   bool                     LeaderSeen;
+   MIL_INT64                PacketCount;     /* Leader to trailer, 0 until the trailer is seen. */
+   MIL_INT64                PacketsReceived;
+   bool                     Complete;
+   MIL_DOUBLE               FirstTime;
+   MIL_DOUBLE               CompleteTime;
+   MIL_INT64                ChannelPackets[MULTI_STREAM_CHANNEL_MAX];
+   MIL_DOUBLE               ChannelLastTime[MULTI_STREAM_CHANNEL_MAX];
+   StreamReplayFrameStruct  Frame;
+   } MultiStreamSlotStruct;
+
+typedef struct
+   {
+   MIL_INT                  ChannelCount;
+   MIL_INT64                PayloadPacketSizeByte;
+   MultiStreamChannelStruct Channels[MULTI_STREAM_CHANNEL_MAX];
+   std::mutex               ReadyLock;
+   std::condition_variable  Ready;
+
+   /* Reassembly, by the consumer only. */
+   std::vector<MultiStreamSlotStruct> Slots;
+   MIL_UINT64               NextBlockId;     /* Next frame to deliver, 0 until the first packet. */
+   MIL_DOUBLE               StartTime;
+   MIL_DOUBLE               FirstPacketTime;
+   MIL_DOUBLE               LastDeliveryTime;
+
+   /* Statistics. */
+   MIL_UINT64               FramesDelivered;
+   MIL_UINT64               FramesIncomplete;  /* Dropped with some of their packets. */
+   MIL_UINT64               FramesLost;        /* Dropped without any packet. */
+   MIL_UINT64               FramesOutOfOrder;  /* Completed before an earlier frame. */
+   MIL_UINT64               LatePackets;       /* Of frames already delivered or dropped. */
+   MIL_UINT64               InvalidPackets;
+   MIL_UINT64               SplitFrames;       /* Delivered frames carried by several channels. */
+   MIL_DOUBLE               SkewSum;
+   MIL_DOUBLE               SkewMax;
+   } MultiStreamStruct;
+
+/* Stream channel settings of the camera, before the stream. */
+typedef struct
+   {
+   MIL_INT64                Address;         /* GevSCDA. */
+   MIL_INT64                HostPort;        /* GevSCPHostPort. */
+   } MultiStreamCameraChannelStruct;
+
+typedef struct
+   {
+   MIL_INT                  ChannelCount;
+   MIL_INT64                PacketSizeByte;  /* GevSCPSPacketSize, the same on every channel. */
+   MIL_INT64                ChannelSelector; /* GevStreamChannelSelector. */
+   MIL_STRING               AcquisitionMode;
+   MultiStreamCameraChannelStruct Channels[MULTI_STREAM_CHANNEL_MAX];
+   } MultiStreamCameraStruct;
+
+/* Software device sending a test pattern. */
+typedef struct
+   {
+   MIL_INT                  ChannelCount;
+   MIL_INT                  BasePort;
+   MIL_INT64                PayloadPacketSizeByte;
+   MIL_INT64                SizeX;
+   MIL_INT64                SizeY;
+   MIL_DOUBLE               FrameRate;       /* 0 for as fast as possible. */
+   MIL_INT                  Split;
+   MIL_INT64                Sockets[MULTI_STREAM_CHANNEL_MAX];
+   MIL_ID                   MilThread;
+   std::atomic<bool>        StopRequested;
+   MIL_UINT64               FramesSent;
+   MIL_UINT64               PacketsSent;
+   MIL_UINT64               SendErrors;
+   MIL_DOUBLE               StartTime;
+   MIL_DOUBLE               StopTime;
+   } MultiStreamDeviceStruct;
+
+/* Opens ChannelCount channels on the ports from BasePort, on the loopback */
+/* interface only if Loopback, with rings of RingSize packets, and starts   */
+/* their receive threads. StreamPacketSizeByte is the GevSCPSPacketSize of  */
+/* the channels, IP and UDP headers included.                              */
+bool MultiStreamOpen(MIL_ID MilSystem, MIL_INT ChannelCount, MIL_INT BasePort, bool Loopback,
+                     MIL_INT64 StreamPacketSizeByte, MIL_INT RingSize, MIL_INT SlotCount, MultiStreamStruct* Stream);
+void MultiStreamClose(MultiStreamStruct* Stream);
+
+/* Returns the next frame in block ID order, MULTI_STREAM_TIMEOUT if none */
+/* arrived in Timeout seconds. The data of Frame is swapped with the data  */
+/* of the reassembled frame, so Frame is reused without copy.              */
+MIL_INT MultiStreamNextFrame(MultiStreamStruct* Stream, MIL_DOUBLE Timeout, StreamReplayFrameStruct* Frame);
+
+void MultiStreamPrintStatistics(MultiStreamStruct* Stream);
+
+/* Stream channels of the camera, from DeviceStreamChannelCount or */
+/* GevStreamChannelCount; 1 if neither is implemented.             */
+MIL_INT MultiStreamCameraChannelCount(MIL_ID MilDigitizer);
+
+/* Reads the settings of the first ChannelCount stream channels of the    */
+/* camera, to open the stream with their packet size and restore them.     */
+/* Returns false if one cannot be read or the packet sizes differ.         */
+bool MultiStreamReadCamera(MIL_ID MilDigitizer, MIL_INT ChannelCount, MultiStreamCameraStruct* Camera);
+
+/* Points the stream channels of the camera at the channels of Stream and */
+/* starts a continuous acquisition, restoring Camera if a write fails;    */
+/* stops it and restores Camera. Call with the error prints disabled.     */
+bool MultiStreamStartCamera(MIL_ID MilDigitizer, const MultiStreamStruct* Stream, const MultiStreamCameraStruct* Camera);
+void MultiStreamStopCamera(MIL_ID MilDigitizer, const MultiStreamCameraStruct* Camera);
+
+/* Starts and stops the software device, which sends SizeX x SizeY Mono8 */
+/* frames to the loopback ports from BasePort.                           */
+bool MultiStreamDeviceStart(MIL_ID MilSystem, MIL_INT ChannelCount, MIL_INT BasePort, MIL_INT64 StreamPacketSizeByte,
+                            MIL_INT64 SizeX, MIL_INT64 SizeY, MIL_DOUBLE FrameRate, MIL_INT Split,
+                            MultiStreamDeviceStruct* Device);
+void MultiStreamDeviceStop(MultiStreamDeviceStruct* Device);
+void MultiStreamDevicePrintStatistics(MultiStreamDeviceStruct* Device);
+
+#endif
@@ -0,0 +1,241 @@
+﻿/********************************************************************************/
+/*
+* File name: Overlay.cpp
+*
+* Synopsis:  Implementation of the display overlay. See Overlay.h.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. */
+#include "Overlay.h"
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OVERLAY_USE_SSE2  1
+#include <emmintrin.h>
+#else
+#define OVERLAY_USE_SSE2  0
+#endif
+
+using namespace std;
+
+/* Each character is rasterized alone in a slot of this size. */
+#define OVERLAY_SLOT_SIZE        48
+
+bool OverlayInit(MIL_ID MilSystem, MIL_INT PositionX, MIL_INT PositionY, MIL_DOUBLE RefreshRate,
+                 OverlayStruct* Overlay)
+   {
+   MIL_ID MilRaster = M_NULL;
+   vector<MIL_UINT8> Raster;
+   MIL_INT RasterSizeX = OVERLAY_SLOT_SIZE*OVERLAY_CHAR_COUNT;
+   MIL_INT MaxX = -1, MaxY = -1;
+
+   Overlay->PositionX = PositionX;
+   Overlay->PositionY = PositionY;
+   Overlay->RefreshPeriod = (RefreshRate > 0.0) ? 1.0/RefreshRate : 0.0;
+   Overlay->LastRefreshTime = 0.0;
+   Overlay->LastRefreshFrame = 0;
+   Overlay->FrameRate = 0.0;
+   Overlay->FrameCount = 0;
+   Overlay->RefreshCount = 0;
+   Overlay->DrawTime = 0.0;
+   Overlay->CellSizeX = Overlay->CellSizeY = 0;
+   Overlay->Fill.clear();
+   Overlay->Outline.clear();
+
+   /* Rasterize every character in its own slot. */
+   MbufAlloc2d(MilSystem, RasterSizeX, OVERLAY_SLOT_SIZE, 8+M_UNSIGNED, M_IMAGE+M_PROC, &MilRaster);
+   if (MilRaster == M_NULL)
+      return false;
+   MbufClear(MilRaster, 0);
+   for (MIL_INT c = 0; c < OVERLAY_CHAR_COUNT; c++)
+      {
+      MIL_TEXT_CHAR Text[2] = {(MIL_TEXT_CHAR)(OVERLAY_FIRST_CHAR + c), MIL_TEXT('\0')};
+      MgraText(M_DEFAULT, MilRaster, (MIL_DOUBLE)(c*OVERLAY_SLOT_SIZE), 0, Text);
+      }
+   Raster.resize((size_t)(RasterSizeX*OVERLAY_SLOT_SIZE));
+   MbufGet(MilRaster, &Raster[0]);
+   MbufFree(MilRaster);
+
+   /* The cells fit the largest glyph, with a margin of one pixel for the outline. */
+   for (MIL_INT y = 0; y < OVERLAY_SLOT_SIZE; y++)
+      for (MIL_INT x = 0; x < RasterSizeX; x++)
+         if (Raster[(size_t)(y*RasterSizeX + x)])
+            {
+            if (x%OVERLAY_SLOT_SIZE > MaxX)
+               MaxX = x%OVERLAY_SLOT_SIZE;
+            if (y > MaxY)
+               MaxY = y;
+            }
+   if (MaxX < 0)
+      return false;
+   Overlay->CellSizeX = MaxX + 3;
+   Overlay->CellSizeY = MaxY + 3;
+
+   size_t CellSize = (size_t)(Overlay->CellSizeX*Overlay->CellSizeY);
+   Overlay->Fill.assign(CellSize*OVERLAY_CHAR_COUNT, 0);
+   Overlay->Outline.assign(CellSize*OVERLAY_CHAR_COUNT, 0);
+   for (MIL_INT c = 0; c < OVERLAY_CHAR_COUNT; c++)
+      {
+      MIL_UINT8* Fill = &Overlay->Fill[c*CellSize];
+      MIL_UINT8* Outline = &Overlay->Outline[c*CellSize];
+
+      for (MIL_INT y = 0; y <= MaxY; y++)
+         for (MIL_INT x = 0; x <= MaxX; x++)
+            Fill[(y + 1)*Overlay->CellSizeX + x + 1] = Raster[(size_t)(y*RasterSizeX + c*OVERLAY_SLOT_SIZE + x)];
+
+      /* The outline is the glyph grown by one pixel. */
+      for (MIL_INT y = 0; y < Overlay->CellSizeY; y++)
+         for (MIL_INT x = 0; x < Overlay->CellSizeX; x++)
+            {
+            MIL_UINT8 Value = 0;
+            for (MIL_INT dy = -1; dy <= 1; dy++)
+               for (MIL_INT dx = -1; dx <= 1; dx++)
+                  {
+                  MIL_INT sx = x + dx, sy = y + dy;
+                  if (sx >= 0 && sy >= 0 && sx < Overlay->CellSizeX && sy < Overlay->CellSizeY &&
+                      Fill[sy*Overlay->CellSizeX + sx] > Value)
+                     Value = Fill[sy*Overlay->CellSizeX + sx];
+                  }
+            Outline[y*Overlay->CellSizeX + x] = Value;
+            }
+      }
+
+   Overlay->RowFill.resize((size_t)(OVERLAY_LINE_LENGTH_MAX*Overlay->CellSizeX*Overlay->CellSizeY));
+   Overlay->RowOutline.resize(Overlay->RowFill.size());
+   return true;
+   }
+
+bool OverlayFrame(OverlayStruct* Overlay, MIL_DOUBLE Time)
+   {
+   Overlay->FrameCount++;
+   if (Overlay->RefreshCount && Time - Overlay->LastRefreshTime < Overlay->RefreshPeriod)
+      return false;
+
+   if (Overlay->RefreshCount && Time > Overlay->LastRefreshTime)
+      Overlay->FrameRate = (Overlay->FrameCount - Overlay->LastRefreshFrame)/(Time - Overlay->LastRefreshTime);
+   Overlay->LastRefreshTime = Time;
+   Overlay->LastRefreshFrame = Overlay->FrameCount;
+   Overlay->RefreshCount++;
+   return true;
+   }
+
+/* Kernels: outline to black, then glyph to full scale.                     */
+/* -----------------------------------------------------------------------*/
+
+static void BlendRow8(MIL_UINT8* Dst, const MIL_UINT8* Fill, const MIL_UINT8* Outline, MIL_INT Count)
+   {
+   MIL_INT x = 0;
+
+#if OVERLAY_USE_SSE2
+   const __m128i Ones = _mm_set1_epi8((char)0xFF);
+   for (; x + 16 <= Count; x += 16)
+      {
+      __m128i Pixels = _mm_loadu_si128((const __m128i*)(Dst + x));
+      __m128i Dark = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(Outline + x)), Ones);
+      Pixels = _mm_max_epu8(_mm_min_epu8(Pixels, Dark), _mm_loadu_si128((const __m128i*)(Fill + x)));
+      _mm_storeu_si128((__m128i*)(Dst + x), Pixels);
+      }
+#endif
+   for (; x < Count; x++)
+      {
+      MIL_UINT8 Dark = (MIL_UINT8)(255 - Outline[x]);
+      MIL_UINT8 Pixel = (Dst[x] < Dark) ? Dst[x] : Dark;
+      Dst[x] = (Pixel > Fill[x]) ? Pixel : Fill[x];
+      }
+   }
+
+static void BlendRow16(MIL_UINT16* Dst, const MIL_UINT8* Fill, const MIL_UINT8* Outline, MIL_INT Count,
+                       MIL_UINT32 FullScale)
+   {
+   for (MIL_INT x = 0; x < Count; x++)
+      {
+      MIL_UINT32 Dark = FullScale - (Outline[x]*FullScale)/255;
+      MIL_UINT32 Bright = (Fill[x]*FullScale)/255;
+      MIL_UINT32 Pixel = (Dst[x] < Dark) ? Dst[x] : Dark;
+      Dst[x] = (MIL_UINT16)((Pixel > Bright) ? Pixel : Bright);
+      }
+   }
+
+void OverlayDraw(OverlayStruct* Overlay, MIL_ID MilDisplayImage, const MIL_TEXT_CHAR* const* Lines, MIL_INT LineCount)
+   {
+   MIL_DOUBLE Start = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+   MIL_UINT8* HostAddress = M_NULL;
+   MIL_INT SizeX = MbufInquire(MilDisplayImage, M_SIZE_X, M_NULL);
+   MIL_INT SizeY = MbufInquire(MilDisplayImage, M_SIZE_Y, M_NULL);
+   MIL_INT SizeBit = MbufInquire(MilDisplayImage, M_SIZE_BIT, M_NULL);
+   MIL_INT PitchByte = MbufInquire(MilDisplayImage, M_PITCH_BYTE, M_NULL);
+   MIL_INT CellSizeX = Overlay->CellSizeX, CellSizeY = Overlay->CellSizeY;
+   size_t CellSize = (size_t)(CellSizeX*CellSizeY);
+
+   MbufInquire(MilDisplayImage, M_HOST_ADDRESS, &HostAddress);
+   if (Overlay->Fill.empty() || HostAddress == M_NULL || SizeBit > 16 ||
+       MbufInquire(MilDisplayImage, M_SIZE_BAND, M_NULL) != 1)
+      {
+      for (MIL_INT Line = 0; Line < LineCount; Line++)
+         MgraText(M_DEFAULT, MilDisplayImage, (MIL_DOUBLE)Overlay->PositionX,
+                  (MIL_DOUBLE)(Overlay->PositionY + Line*(CellSizeY ? CellSizeY : 16)), Lines[Line]);
+      Overlay->DrawTime += MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) - Start;
+      return;
+      }
+
+   for (MIL_INT Line = 0; Line < LineCount; Line++)
+      {
+      MIL_INT Y0 = Overlay->PositionY + Line*CellSizeY;
+      MIL_INT Length = 0, Width, Count;
+
+      /* Lay out the cells of the line side by side. */
+      for (const MIL_TEXT_CHAR* Char = Lines[Line]; *Char && Length < OVERLAY_LINE_LENGTH_MAX; Char++, Length++)
+         {
+         MIL_INT Code = (MIL_INT)*Char - OVERLAY_FIRST_CHAR;
+         if (Code < 0 || Code >= OVERLAY_CHAR_COUNT)
+            Code = 0;
+         for (MIL_INT y = 0; y < CellSizeY; y++)
+            {
+            size_t Row = (size_t)(y*OVERLAY_LINE_LENGTH_MAX*CellSizeX + Length*CellSizeX);
+            memcpy(&Overlay->RowFill[Row], &Overlay->Fill[Code*CellSize + y*CellSizeX], (size_t)CellSizeX);
+            memcpy(&Overlay->RowOutline[Row], &Overlay->Outline[Code*CellSize + y*CellSizeX], (size_t)CellSizeX);
+            }
+         }
+
+      /* Blend the rows within the image. */
+      Width = Length*CellSizeX;
+      Count = (Overlay->PositionX + Width > SizeX) ? SizeX - Overlay->PositionX : Width;
+      if (Count <= 0 || Overlay->PositionX < 0)
+         continue;
+      for (MIL_INT y = 0; y < CellSizeY; y++)
+         {
+         const MIL_UINT8* Fill = &Overlay->RowFill[(size_t)(y*OVERLAY_LINE_LENGTH_MAX*CellSizeX)];
+         const MIL_UINT8* Outline = &Overlay->RowOutline[(size_t)(y*OVERLAY_LINE_LENGTH_MAX*CellSizeX)];
+         MIL_UINT8* Row = HostAddress + (Y0 + y)*PitchByte;
+         if (Y0 + y < 0 || Y0 + y >= SizeY)
+            continue;
+         if (SizeBit <= 8)
+            BlendRow8(Row + Overlay->PositionX, Fill, Outline, Count);
+         else
+            BlendRow16((MIL_UINT16*)Row + Overlay->PositionX, Fill, Outline, Count,
+                       (MIL_UINT32)((1U << SizeBit) - 1));
+         }
+      }
+
+   /* The pixels were written through the host address. */
+   MbufControl(MilDisplayImage, M_MODIFIED, M_DEFAULT);
+   Overlay->DrawTime += MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) - Start;
+   }
+
+void OverlayPrintStatistics(OverlayStruct* Overlay)
+   {
+   if (Overlay->FrameCount == 0)
+      return;
+
+   MosPrintf(MIL_TEXT("\n--------------------- Display overlay ---------------------\n\n"));
+   MosPrintf(MIL_TEXT("%30s %llu of %llu frames (%.1f%%)\n"), MIL_TEXT("Display refreshes:"),
+             (unsigned long long)Overlay->RefreshCount, (unsigned long long)Overlay->FrameCount,
+             100.0*Overlay->RefreshCount/Overlay->FrameCount);
+   if (Overlay->RefreshCount)
+      MosPrintf(MIL_TEXT("%30s %.1f us per refresh (%s)\n"), MIL_TEXT("Overlay cost:"),
+                1e6*Overlay->DrawTime/Overlay->RefreshCount,
+                Overlay->Fill.empty() ? MIL_TEXT("MgraText") : MIL_TEXT("glyph atlas"));
+   }
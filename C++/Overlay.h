@@ -0,0 +1,81 @@
+﻿/********************************************************************************/
+/*
+* File name: Overlay.h
+*
+* Synopsis:  Text overlay (frame count, frame rate, time stamp, statistics)
+*            drawn on the display copy only, so the grabbed frames that are
+*            recorded, archived or published are never annotated.
+*
+*            The glyphs of the default MIL font are rasterized once with
+*            MgraText() into an atlas of cells, with an outline that keeps
+*            the text readable on any background. Drawing a line copies its
+*            cells into a row buffer and blends it into the display image
+*            with SSE2 min/max, 16 pixels at a time.
+*
+*            The display is refreshed at most RefreshRate times per second:
+*            OverlayFrame() tells the processing whether this frame must be
+*            copied to the display, and the text is formatted and drawn only
+*            then. Frames in between cost neither the copy nor the overlay.
+*
+*            Display images that are not 8- or 16-bit, single-band host
+*            buffers get the text with MgraText() instead, still on the
+*            display copy only.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include <mil.h>
+#include <vector>
+
+/* Printable ASCII characters, from ' ' to '~'. */
+#define OVERLAY_FIRST_CHAR       32
+#define OVERLAY_CHAR_COUNT       95
+
+/* Longest line drawn, in characters. */
+#define OVERLAY_LINE_LENGTH_MAX  64
+
+typedef struct
+   {
+   /* Atlas: one cell per character, CellSizeX x CellSizeY pixels. */
+   MIL_INT                  CellSizeX;
+   MIL_INT                  CellSizeY;
+   std::vector<MIL_UINT8>   Fill;
+   std::vector<MIL_UINT8>   Outline;
+
+   /* Cells of the line being drawn. */
+   std::vector<MIL_UINT8>   RowFill;
+   std::vector<MIL_UINT8>   RowOutline;
+
+   MIL_INT                  PositionX;
+   MIL_INT                  PositionY;
+
+   /* Refresh. */
+   MIL_DOUBLE               RefreshPeriod;
+   MIL_DOUBLE               LastRefreshTime;
+   MIL_UINT64               LastRefreshFrame;
+   MIL_DOUBLE               FrameRate;     /* Of the frames offered, between the last two refreshes. */
+
+   /* Statistics. */
+   MIL_UINT64               FrameCount;
+   MIL_UINT64               RefreshCount;
+   MIL_DOUBLE               DrawTime;
+   } OverlayStruct;
+
+/* Rasterizes the atlas. RefreshRate 0 refreshes the display on every */
+/* frame. Returns false if the atlas could not be built; the text is  */
+/* then drawn with MgraText().                                        */
+bool OverlayInit(MIL_ID MilSystem, MIL_INT PositionX, MIL_INT PositionY, MIL_DOUBLE RefreshRate,
+                 OverlayStruct* Overlay);
+
+/* Counts a frame at Time and returns true if the display must be refreshed. */
+bool OverlayFrame(OverlayStruct* Overlay, MIL_DOUBLE Time);
+
+/* Draws the lines on the display image and marks it modified. */
+void OverlayDraw(OverlayStruct* Overlay, MIL_ID MilDisplayImage, const MIL_TEXT_CHAR* const* Lines, MIL_INT LineCount);
+
+void OverlayPrintStatistics(OverlayStruct* Overlay);
+
+#endif
@@ -0,0 +1,512 @@
+﻿/********************************************************************************/
+/*
+* File name: Placement.cpp
+*
+* Synopsis:  Implementation of the NUMA placement of the acquisition.
+*            See Placement.h.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. */
+#include "Placement.h"
+#include "FeatureAccess.h"
+#if M_MIL_USE_WINDOWS
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <dirent.h>
+#include <ifaddrs.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+
+using namespace std;
+
+#if !M_MIL_USE_WINDOWS
+/* Memory policy modes of set_mempolicy(2) and get_mempolicy(2), to avoid */
+/* depending on libnuma.                                                  */
+#ifndef MPOL_DEFAULT
+#define MPOL_DEFAULT                0
+#define MPOL_PREFERRED              1
+#define MPOL_F_NODE                 (1 << 0)
+#define MPOL_F_ADDR                 (1 << 1)
+#endif
+#define PLACEMENT_NODE_MAX          1024
+#endif
+
+/* Placement shared with the threads, which read it when its generation */
+/* differs from the one they applied.                                   */
+typedef struct
+   {
+   mutex                Lock;
+   atomic<MIL_UINT32>   Generation;
+   bool                 Pinned;
+   MIL_INT              HookCpu;
+   vector<MIL_INT>      WorkerCpus;
+   vector<MIL_INT>      AllowedCpus;   /* Affinity of the process, restored when unpinned. */
+   } PlacementStateStruct;
+
+static PlacementStateStruct State;
+static thread_local MIL_UINT32 LocalGeneration = 0;
+
+/* Threads.                                                                 */
+/* -----------------------------------------------------------------------*/
+
+static vector<MIL_INT> GetAllowedCpus()
+   {
+   vector<MIL_INT> Cpus;
+#if M_MIL_USE_WINDOWS
+   DWORD_PTR ProcessMask = 0, SystemMask = 0;
+   GetProcessAffinityMask(GetCurrentProcess(), &ProcessMask, &SystemMask);
+   for (MIL_INT Cpu = 0; Cpu < (MIL_INT)(8*sizeof(DWORD_PTR)); Cpu++)
+      if (ProcessMask & ((DWORD_PTR)1 << Cpu))
+         Cpus.push_back(Cpu);
+#else
+   cpu_set_t Set;
+   CPU_ZERO(&Set);
+   if (sched_getaffinity(0, sizeof(Set), &Set) == 0)
+      for (MIL_INT Cpu = 0; Cpu < CPU_SETSIZE; Cpu++)
+         if (CPU_ISSET(Cpu, &Set))
+            Cpus.push_back(Cpu);
+#endif
+   return Cpus;
+   }
+
+static void SetThreadCpus(const vector<MIL_INT>& Cpus)
+   {
+   if (Cpus.empty())
+      return;
+#if M_MIL_USE_WINDOWS
+   DWORD_PTR Mask = 0;
+   for (size_t i = 0; i < Cpus.size(); i++)
+      if (Cpus[i] < (MIL_INT)(8*sizeof(DWORD_PTR)))
+         Mask |= (DWORD_PTR)1 << Cpus[i];
+   SetThreadAffinityMask(GetCurrentThread(), Mask);
+#else
+   cpu_set_t Set;
+   CPU_ZERO(&Set);
+   for (size_t i = 0; i < Cpus.size(); i++)
+      if (Cpus[i] < CPU_SETSIZE)
+         CPU_SET(Cpus[i], &Set);
+   pthread_setaffinity_np(pthread_self(), sizeof(Set), &Set);
+#endif
+   }
+
+/* Applies the current placement to the calling thread. */
+static void ApplyPlacement(bool Hook)
+   {
+   lock_guard<mutex> Guard(State.Lock);
+   if (!State.Pinned)
+      SetThreadCpus(State.AllowedCpus);
+   else if (Hook)
+      SetThreadCpus(vector<MIL_INT>(1, State.HookCpu));
+   else
+      SetThreadCpus(State.WorkerCpus);
+   LocalGeneration = State.Generation.load();
+   }
+
+static void PublishPlacement(bool Pinned)
+   {
+   lock_guard<mutex> Guard(State.Lock);
+   State.Pinned = Pinned;
+   State.Generation.fetch_add(1);
+   }
+
+void PlacementWorkerThread()
+   {
+   if (LocalGeneration != State.Generation.load(memory_order_relaxed))
+      ApplyPlacement(false);
+   }
+
+/* Topology.                                                                */
+/* -----------------------------------------------------------------------*/
+
+#if !M_MIL_USE_WINDOWS
+static bool ReadLine(const string& Path, string& Line)
+   {
+   char Buffer[4096];
+   FILE* File = fopen(Path.c_str(), "r");
+   bool Read;
+
+   if (File == NULL)
+      return false;
+   Read = (fgets(Buffer, sizeof(Buffer), File) != NULL);
+   fclose(File);
+   if (!Read)
+      return false;
+   Line = Buffer;
+   while (!Line.empty() && (Line.back() == '\n' || Line.back() == '\r'))
+      Line.pop_back();
+   return true;
+   }
+
+/* Parses a sysfs CPU list such as "0-3,8,10-11". */
+static vector<MIL_INT> ParseCpuList(const string& List)
+   {
+   vector<MIL_INT> Cpus;
+   const char* Text = List.c_str();
+
+   while (*Text)
+      {
+      char* End;
+      long First = strtol(Text, &End, 10), Last;
+      if (End == Text)
+         break;
+      Last = First;
+      if (*End == '-')
+         Last = strtol(End + 1, &End, 10);
+      for (long Cpu = First; Cpu <= Last; Cpu++)
+         Cpus.push_back((MIL_INT)Cpu);
+      Text = (*End == ',') ? End + 1 : End;
+      }
+   return Cpus;
+   }
+
+/* Name of the interface with the address IpAddress, or Name if the system */
+/* knows it.                                                               */
+static string FindInterface(const string& IpAddress, const string& Name)
+   {
+   struct ifaddrs* Addresses = NULL;
+   string Found;
+
+   if (getifaddrs(&Addresses) == 0)
+      {
+      for (struct ifaddrs* Address = Addresses; Address && Found.empty(); Address = Address->ifa_next)
+         {
+         char Text[INET_ADDRSTRLEN];
+         if (Address->ifa_addr == NULL || Address->ifa_addr->sa_family != AF_INET)
+            continue;
+         if (inet_ntop(AF_INET, &((struct sockaddr_in*)Address->ifa_addr)->sin_addr, Text, sizeof(Text)) &&
+             IpAddress == Text)
+            Found = Address->ifa_name;
+         }
+      freeifaddrs(Addresses);
+      }
+   if (Found.empty() && !Name.empty() && access(("/sys/class/net/" + Name).c_str(), F_OK) == 0)
+      Found = Name;
+   return Found;
+   }
+
+/* Interrupts of the interface and the cores that serve them. */
+static void FindInterrupts(const string& DevicePath, PlacementStruct* Placement)
+   {
+   string Line;
+   DIR* Directory = opendir((DevicePath + "/msi_irqs").c_str());
+
+   if (Directory)
+      {
+      struct dirent* Entry;
+      while ((Entry = readdir(Directory)) != NULL)
+         if (Entry->d_name[0] >= '0' && Entry->d_name[0] <= '9')
+            Placement->Irqs.push_back((MIL_INT)atol(Entry->d_name));
+      closedir(Directory);
+      }
+   else if (ReadLine(DevicePath + "/irq", Line) && atol(Line.c_str()) > 0)
+      Placement->Irqs.push_back((MIL_INT)atol(Line.c_str()));
+   sort(Placement->Irqs.begin(), Placement->Irqs.end());
+
+   for (size_t i = 0; i < Placement->Irqs.size(); i++)
+      {
+      string IrqPath = "/proc/irq/" + to_string((long long)Placement->Irqs[i]);
+      if (ReadLine(IrqPath + "/effective_affinity_list", Line) || ReadLine(IrqPath + "/smp_affinity_list", Line))
+         {
+         vector<MIL_INT> Cpus = ParseCpuList(Line);
+         Placement->IrqCpus.insert(Placement->IrqCpus.end(), Cpus.begin(), Cpus.end());
+         }
+      }
+   sort(Placement->IrqCpus.begin(), Placement->IrqCpus.end());
+   Placement->IrqCpus.erase(unique(Placement->IrqCpus.begin(), Placement->IrqCpus.end()), Placement->IrqCpus.end());
+   }
+
+static void FindTopology(PlacementStruct* Placement, const vector<MIL_INT>& AllowedCpus)
+   {
+   string Interface = FindInterface(Placement->IpAddress, Placement->InterfaceName);
+   string DevicePath = "/sys/class/net/" + Interface + "/device";
+   string Line;
+   vector<MIL_INT> Cpus;
+
+   if (Interface.empty())
+      return;
+   Placement->InterfaceName = Interface;
+
+   /* Virtual interfaces have no device; -1 means a single node. */
+   if (ReadLine(DevicePath + "/numa_node", Line))
+      Placement->NumaNode = (MIL_INT)atol(Line.c_str());
+   if (ReadLine(DevicePath + "/local_cpulist", Line))
+      Cpus = ParseCpuList(Line);
+   else if (Placement->NumaNode >= 0 &&
+            ReadLine("/sys/devices/system/node/node" + to_string((long long)Placement->NumaNode) + "/cpulist", Line))
+      Cpus = ParseCpuList(Line);
+
+   for (size_t i = 0; i < Cpus.size(); i++)
+      if (find(AllowedCpus.begin(), AllowedCpus.end(), Cpus[i]) != AllowedCpus.end())
+         Placement->NodeCpus.push_back(Cpus[i]);
+
+   FindInterrupts(DevicePath, Placement);
+   }
+
+static long SetMemoryPolicy(int Mode, MIL_INT Node)
+   {
+   unsigned long Mask[PLACEMENT_NODE_MAX/(8*sizeof(unsigned long))] = {0};
+
+   if (Mode == MPOL_DEFAULT)
+      return syscall(SYS_set_mempolicy, Mode, NULL, 0);
+   Mask[Node/(8*sizeof(unsigned long))] |= 1UL << (Node%(8*sizeof(unsigned long)));
+   return syscall(SYS_set_mempolicy, Mode, Mask, (unsigned long)PLACEMENT_NODE_MAX + 1);
+   }
+
+static MIL_INT NodeOfAddress(const void* Address)
+   {
+   int Node = -1;
+   if (syscall(SYS_get_mempolicy, &Node, NULL, 0, Address, MPOL_F_NODE | MPOL_F_ADDR) != 0)
+      return -1;
+   return (MIL_INT)Node;
+   }
+#endif
+
+/* Placement.                                                               */
+/* -----------------------------------------------------------------------*/
+
+bool PlacementStart(MIL_ID MilDigitizer, MIL_UINT64 BaselineFrames, PlacementStruct* Placement)
+   {
+   vector<MIL_INT> AllowedCpus = GetAllowedCpus();
+   vector<MIL_INT> Candidates;
+
+   Placement->NumaNode = -1;
+   Placement->NodeCpus.clear();
+   Placement->IrqCpus.clear();
+   Placement->Irqs.clear();
+   Placement->HookCpu = -1;
+   Placement->WorkerCpus.clear();
+   Placement->BufferCount = 0;
+   Placement->BuffersOnNode = -1;
+   Placement->BaselineFrames = BaselineFrames;
+   Placement->FrameCount = 0;
+   Placement->LastStart = 0.0;
+   Placement->Pinned = false;
+   for (MIL_INT Part = 0; Part < 2; Part++)
+      {
+      Placement->Jitter[Part].Intervals.clear();
+      Placement->Jitter[Part].Durations.clear();
+      Placement->Jitter[Part].Intervals.reserve(PLACEMENT_SAMPLE_MAX);
+      Placement->Jitter[Part].Durations.reserve(PLACEMENT_SAMPLE_MAX);
+      }
+
+   FeatureAccessMdigInquire(MilDigitizer, M_GC_LOCAL_IP_ADDRESS_STRING, Placement->IpAddress);
+   FeatureAccessMdigInquire(MilDigitizer, M_GC_INTERFACE_NAME, Placement->InterfaceName);
+#if !M_MIL_USE_WINDOWS
+   FindTopology(Placement, AllowedCpus);
+#endif
+   if (Placement->NodeCpus.empty())
+      Placement->NodeCpus = AllowedCpus;
+   if (Placement->NodeCpus.empty())
+      return false;
+
+   /* The hook gets the first core of the node left free by the interrupts, */
+   /* the workers the others.                                               */
+   for (size_t i = 0; i < Placement->NodeCpus.size(); i++)
+      if (find(Placement->IrqCpus.begin(), Placement->IrqCpus.end(), Placement->NodeCpus[i]) == Placement->IrqCpus.end())
+         Candidates.push_back(Placement->NodeCpus[i]);
+   if (Candidates.empty())
+      Candidates = Placement->NodeCpus;
+   Placement->HookCpu = Candidates[0];
+   Placement->WorkerCpus.assign(Candidates.begin() + 1, Candidates.end());
+   if (Placement->WorkerCpus.empty())
+      for (size_t i = 0; i < Placement->NodeCpus.size(); i++)
+         if (Placement->NodeCpus[i] != Placement->HookCpu)
+            Placement->WorkerCpus.push_back(Placement->NodeCpus[i]);
+   if (Placement->WorkerCpus.empty())
+      Placement->WorkerCpus.push_back(Placement->HookCpu);
+
+   /* Share the choice with the threads. */
+   State.Lock.lock();
+   State.HookCpu = Placement->HookCpu;
+   State.WorkerCpus = Placement->WorkerCpus;
+   State.AllowedCpus = AllowedCpus;
+   State.Lock.unlock();
+   if (BaselineFrames == 0)
+      {
+      Placement->Pinned = true;
+      PublishPlacement(true);
+      }
+   return true;
+   }
+
+void PlacementStop(PlacementStruct* Placement)
+   {
+   if (Placement->Pinned)
+      PublishPlacement(false);
+   }
+
+void PlacementBeginAllocation(PlacementStruct* Placement)
+   {
+#if !M_MIL_USE_WINDOWS
+   if (Placement->NumaNode >= 0 && Placement->NumaNode < PLACEMENT_NODE_MAX)
+      SetMemoryPolicy(MPOL_PREFERRED, Placement->NumaNode);
+#endif
+   }
+
+void PlacementEndAllocation(PlacementStruct* Placement, const MIL_ID* MilBuffers, MIL_INT BufferCount)
+   {
+#if !M_MIL_USE_WINDOWS
+   if (Placement->NumaNode < 0 || Placement->NumaNode >= PLACEMENT_NODE_MAX)
+      return;
+   SetMemoryPolicy(MPOL_DEFAULT, 0);
+
+   /* A buffer is on the node if its first and last pages are. */
+   Placement->BufferCount = 0;
+   Placement->BuffersOnNode = 0;
+   for (MIL_INT i = 0; i < BufferCount; i++)
+      {
+      MIL_UINT8* HostAddress = M_NULL;
+      MIL_INT SizeByte = MbufInquire(MilBuffers[i], M_PITCH_BYTE, M_NULL)*MbufInquire(MilBuffers[i], M_SIZE_Y, M_NULL);
+      MbufInquire(MilBuffers[i], M_HOST_ADDRESS, &HostAddress);
+      if (HostAddress == M_NULL || SizeByte <= 0)
+         continue;
+      Placement->BufferCount++;
+      if (NodeOfAddress(HostAddress) == Placement->NumaNode && NodeOfAddress(HostAddress + SizeByte - 1) == Placement->NumaNode)
+         Placement->BuffersOnNode++;
+      }
+#endif
+   }
+
+void PlacementFrame(PlacementStruct* Placement, MIL_DOUBLE StartTime, MIL_DOUBLE EndTime)
+   {
+   PlacementJitterStruct& Jitter = Placement->Jitter[Placement->Pinned ? 1 : 0];
+
+   /* Intervals are only taken within a part of the run. */
+   if (Jitter.Durations.size() < PLACEMENT_SAMPLE_MAX)
+      {
+      if (!Jitter.Durations.empty())
+         Jitter.Intervals.push_back(StartTime - Placement->LastStart);
+      Jitter.Durations.push_back(EndTime - StartTime);
+      }
+   Placement->LastStart = StartTime;
+   Placement->FrameCount++;
+
+   if (!Placement->Pinned && Placement->FrameCount >= Placement->BaselineFrames)
+      {
+      Placement->Pinned = true;
+      PublishPlacement(true);
+      }
+   if (LocalGeneration != State.Generation.load(memory_order_relaxed))
+      ApplyPlacement(true);
+   }
+
+/* Statistics.                                                              */
+/* -----------------------------------------------------------------------*/
+
+static MIL_DOUBLE Quantile(vector<MIL_DOUBLE> Values, MIL_DOUBLE Fraction)
+   {
+   size_t Index;
+   if (Values.empty())
+      return 0.0;
+   Index = (size_t)(Fraction*(Values.size() - 1) + 0.5);
+   nth_element(Values.begin(), Values.begin() + Index, Values.end());
+   return Values[Index];
+   }
+
+/* Deviations of the intervals from their median. */
+static vector<MIL_DOUBLE> Deviations(const vector<MIL_DOUBLE>& Intervals)
+   {
+   MIL_DOUBLE Median = Quantile(Intervals, 0.5);
+   vector<MIL_DOUBLE> Values(Intervals.size());
+   for (size_t i = 0; i < Intervals.size(); i++)
+      Values[i] = fabs(Intervals[i] - Median);
+   return Values;
+   }
+
+static MIL_DOUBLE StandardDeviation(const vector<MIL_DOUBLE>& Values)
+   {
+   MIL_DOUBLE Sum = 0.0, SquareSum = 0.0, Mean;
+   if (Values.size() < 2)
+      return 0.0;
+   for (size_t i = 0; i < Values.size(); i++)
+      Sum += Values[i];
+   Mean = Sum/Values.size();
+   for (size_t i = 0; i < Values.size(); i++)
+      SquareSum += (Values[i] - Mean)*(Values[i] - Mean);
+   return sqrt(SquareSum/(Values.size() - 1));
+   }
+
+static void PrintCpuList(const MIL_TEXT_CHAR* Label, const vector<MIL_INT>& Cpus)
+   {
+   MosPrintf(MIL_TEXT("%30s "), Label);
+   if (Cpus.empty())
+      MosPrintf(MIL_TEXT("none"));
+   for (size_t i = 0; i < Cpus.size(); )
+      {
+      size_t Last = i;
+      while (Last + 1 < Cpus.size() && Cpus[Last + 1] == Cpus[Last] + 1)
+         Last++;
+      MosPrintf(MIL_TEXT("%s%d"), i ? MIL_TEXT(",") : MIL_TEXT(""), (int)Cpus[i]);
+      if (Last > i)
+         MosPrintf(MIL_TEXT("-%d"), (int)Cpus[Last]);
+      i = Last + 1;
+      }
+   MosPrintf(MIL_TEXT("\n"));
+   }
+
+/* Row of the jitter table, in ms; parts without samples are left blank. */
+static void PrintJitterRow(const MIL_TEXT_CHAR* Label, const PlacementStruct* Placement, MIL_DOUBLE Values[2])
+   {
+   MosPrintf(MIL_TEXT("%30s"), Label);
+   for (MIL_INT Part = 0; Part < 2; Part++)
+      {
+      if (Placement->Jitter[Part].Intervals.empty())
+         MosPrintf(MIL_TEXT(" %12s"), MIL_TEXT("-"));
+      else
+         MosPrintf(MIL_TEXT(" %9.3f ms"), 1e3*Values[Part]);
+      }
+   MosPrintf(MIL_TEXT("\n"));
+   }
+
+void PlacementPrintStatistics(PlacementStruct* Placement)
+   {
+   MIL_DOUBLE Values[4][2];
+
+   MosPrintf(MIL_TEXT("\n--------------------- Placement ---------------------\n\n"));
+   MosPrintf(MIL_TEXT("%30s %s (%s)\n"), MIL_TEXT("Network interface:"), Placement->InterfaceName.c_str(),
+             Placement->IpAddress.c_str());
+   if (Placement->NumaNode >= 0)
+      MosPrintf(MIL_TEXT("%30s %d\n"), MIL_TEXT("NUMA node:"), (int)Placement->NumaNode);
+   else
+      MosPrintf(MIL_TEXT("%30s unknown or single node\n"), MIL_TEXT("NUMA node:"));
+   PrintCpuList(MIL_TEXT("Node cores:"), Placement->NodeCpus);
+   PrintCpuList(MIL_TEXT("Interrupt cores:"), Placement->IrqCpus);
+   MosPrintf(MIL_TEXT("%30s %d\n"), MIL_TEXT("Processing hook core:"), (int)Placement->HookCpu);
+   PrintCpuList(MIL_TEXT("Worker cores:"), Placement->WorkerCpus);
+   if (Placement->BuffersOnNode >= 0)
+      MosPrintf(MIL_TEXT("%30s %d of %d on the node\n"), MIL_TEXT("Grab buffers:"), (int)Placement->BuffersOnNode,
+                (int)Placement->BufferCount);
+
+   for (MIL_INT Part = 0; Part < 2; Part++)
+      {
+      const PlacementJitterStruct& Jitter = Placement->Jitter[Part];
+      vector<MIL_DOUBLE> Deviation = Deviations(Jitter.Intervals);
+      Values[0][Part] = StandardDeviation(Jitter.Intervals);
+      Values[1][Part] = Quantile(Deviation, 0.99);
+      Values[2][Part] = Quantile(Jitter.Durations, 0.5);
+      Values[3][Part] = Quantile(Jitter.Durations, 0.99);
+      }
+   MosPrintf(MIL_TEXT("\n%30s %12s %12s\n"), MIL_TEXT(""), MIL_TEXT("Unpinned"), MIL_TEXT("Pinned"));
+   MosPrintf(MIL_TEXT("%30s %12llu %12llu\n"), MIL_TEXT("Frames:"),
+             (unsigned long long)Placement->Jitter[0].Durations.size(),
+             (unsigned long long)Placement->Jitter[1].Durations.size());
+   PrintJitterRow(MIL_TEXT("Interval std deviation:"), Placement, Values[0]);
+   PrintJitterRow(MIL_TEXT("Interval deviation p99:"), Placement, Values[1]);
+   PrintJitterRow(MIL_TEXT("Hook duration median:"), Placement, Values[2]);
+   PrintJitterRow(MIL_TEXT("Hook duration p99:"), Placement, Values[3]);
+   }
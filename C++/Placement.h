@@ -0,0 +1,90 @@
+﻿/********************************************************************************/
+/*
+* File name: Placement.h
+*
+* Synopsis:  Placement of the acquisition on the NUMA node of the camera's
+*            network interface, for hosts with more than one socket.
+*
+*            The node of the interface, the cores of that node and the cores
+*            serving its interrupts are read from sysfs (/sys/class/net and
+*            /proc/irq). The processing hook is pinned to a core of the node
+*            that does not serve the interrupts, and the worker threads of the
+*            acquisition (decoders, archive compression) to the other cores of
+*            the node. Memory allocated between PlacementBeginAllocation() and
+*            PlacementEndAllocation(), such as the grab buffers, is preferably
+*            taken from the node; the node where the buffers actually landed
+*            is reported, since MIL may allocate them from its own pool.
+*
+*            The first BaselineFrames frames are processed unpinned, so the
+*            jitter of the hook (deviation of the interval between frames and
+*            duration of the processing) can be compared with the pinned run.
+*            The grab buffers stay on the node for both parts.
+*
+*            Threads pin themselves: the hook when the baseline ends and the
+*            workers before their next job, so no thread handle is needed.
+*            On Windows, the cores are pinned but the node of the interface is
+*            not known; all the cores are used.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <mil.h>
+#include <vector>
+
+/* Frames whose jitter is kept per part of the run. */
+#define PLACEMENT_SAMPLE_MAX     100000
+
+/* Jitter of the processing hook during one part of the run. */
+typedef struct
+   {
+   std::vector<MIL_DOUBLE>  Intervals;   /* Between the starts of consecutive frames. */
+   std::vector<MIL_DOUBLE>  Durations;
+   } PlacementJitterStruct;
+
+typedef struct
+   {
+   /* Layout. */
+   MIL_STRING               InterfaceName;
+   MIL_STRING               IpAddress;
+   MIL_INT                  NumaNode;     /* -1 if unknown. */
+   std::vector<MIL_INT>     NodeCpus;
+   std::vector<MIL_INT>     IrqCpus;
+   std::vector<MIL_INT>     Irqs;
+   MIL_INT                  HookCpu;
+   std::vector<MIL_INT>     WorkerCpus;
+   MIL_INT                  BufferCount;
+   MIL_INT                  BuffersOnNode;   /* -1 if unknown. */
+
+   /* Jitter, unpinned then pinned. */
+   MIL_UINT64               BaselineFrames;
+   MIL_UINT64               FrameCount;
+   MIL_DOUBLE               LastStart;
+   bool                     Pinned;
+   PlacementJitterStruct    Jitter[2];
+   } PlacementStruct;
+
+/* Finds the node and the cores of the interface of MilDigitizer and starts */
+/* the placement. Returns false if there are no cores to choose from.       */
+bool PlacementStart(MIL_ID MilDigitizer, MIL_UINT64 BaselineFrames, PlacementStruct* Placement);
+
+/* Unpins the threads, the next time they check their placement. */
+void PlacementStop(PlacementStruct* Placement);
+
+/* Memory allocated by the calling thread between the two calls comes from */
+/* the node. Buffers are the MilBuffers to check.                          */
+void PlacementBeginAllocation(PlacementStruct* Placement);
+void PlacementEndAllocation(PlacementStruct* Placement, const MIL_ID* MilBuffers, MIL_INT BufferCount);
+
+/* Processing hook: called at the end of each frame with its start and end */
+/* times.                                                                   */
+void PlacementFrame(PlacementStruct* Placement, MIL_DOUBLE StartTime, MIL_DOUBLE EndTime);
+
+/* Worker threads: called before each job. Cheap when nothing changed. */
+void PlacementWorkerThread();
+
+void PlacementPrintStatistics(PlacementStruct* Placement);
+
+#endif
@@ -0,0 +1,439 @@
+﻿/********************************************************************************/
+/*
+* File name: RoiPlanner.cpp
+*
+* Synopsis:  Implementation of the ROI and frame rate planner.
+*            See RoiPlanner.h.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. */
+#include "RoiPlanner.h"
+#include <stdlib.h>
+#include <algorithm>
+#include "FeatureAccess.h"
+
+using namespace std;
+
+/* GigE Vision stream packets: IP, UDP and GVSP headers, then the Ethernet */
+/* header, FCS, preamble and inter-frame gap around each of them.          */
+#define GVSP_HEADER_BYTES           36
+#define ETHERNET_FRAMING_BYTES      38
+#define GVSP_LEADER_DATA_BYTES      36
+#define GVSP_TRAILER_DATA_BYTES     8
+#define GVSP_DEFAULT_PACKET_SIZE    1500
+
+static void ReadRange(MIL_ID MilDigitizer, const MIL_TEXT_CHAR* FeatureName, RoiPlannerRangeStruct* Range)
+   {
+   Range->Min = Range->Max = 0;
+   Range->Inc = 1;
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_MAX, FeatureName, M_TYPE_INT64, &Range->Max);
+   if (!FeatureAccessSucceeded())
+      {
+      Range->Max = 0;
+      return;
+      }
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_MIN, FeatureName, M_TYPE_INT64, &Range->Min);
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_INCREMENT, FeatureName, M_TYPE_INT64, &Range->Inc);
+   if (!FeatureAccessSucceeded() || Range->Inc <= 0)
+      Range->Inc = 1;
+   }
+
+static MIL_INT64 ReadInt(MIL_ID MilDigitizer, const MIL_TEXT_CHAR* FeatureName, MIL_INT64 Default)
+   {
+   MIL_INT64 Value = Default;
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, FeatureName, M_TYPE_INT64, &Value);
+   return FeatureAccessSucceeded() ? Value : Default;
+   }
+
+/* Largest value on the increments of Range, up to Value. */
+static MIL_INT64 RoundDown(MIL_INT64 Value, const RoiPlannerRangeStruct& Range)
+   {
+   if (Value < Range.Min)
+      return Value;
+   return Range.Min + ((Value - Range.Min)/Range.Inc)*Range.Inc;
+   }
+
+/* A factor of 1 needs no feature. */
+static bool FactorAllowed(const RoiPlannerRangeStruct& Range, MIL_INT64 Factor)
+   {
+   if (Factor == 1)
+      return true;
+   if (Range.Max == 0)
+      return false;
+   return Factor >= Range.Min && Factor <= Range.Max && (Factor - Range.Min)%Range.Inc == 0;
+   }
+
+MIL_INT RoiPlannerBitsPerPixel(const MIL_STRING& PixelFormat)
+   {
+   const MIL_TEXT_CHAR* Name = PixelFormat.c_str();
+   size_t Length = PixelFormat.size();
+   size_t Prefix = 0;
+   MIL_INT Depth;
+
+   /* YUV and YCbCr: bits per pixel set by the subsampling. */
+   if (PixelFormat.compare(0, 6, MIL_TEXT("YUV422")) == 0 || PixelFormat.compare(0, 8, MIL_TEXT("YCbCr422")) == 0)
+      return 16;
+   if (PixelFormat.compare(0, 6, MIL_TEXT("YUV411")) == 0 || PixelFormat.compare(0, 8, MIL_TEXT("YCbCr411")) == 0)
+      return 12;
+   if (PixelFormat.compare(0, 6, MIL_TEXT("YUV444")) == 0 || PixelFormat.compare(0, 7, MIL_TEXT("YCbCr8")) == 0)
+      return 24;
+
+   /* Mono, Bayer, RGB and BGR: depth of a component and component count. */
+   MIL_INT Components = 1;
+   if (PixelFormat.compare(0, 4, MIL_TEXT("Mono")) == 0)
+      Prefix = 4;
+   else if (PixelFormat.compare(0, 5, MIL_TEXT("Bayer")) == 0)
+      Prefix = 7;
+   else if (PixelFormat.compare(0, 4, MIL_TEXT("RGBa")) == 0 || PixelFormat.compare(0, 4, MIL_TEXT("BGRa")) == 0 ||
+            PixelFormat.compare(0, 4, MIL_TEXT("RGBA")) == 0 || PixelFormat.compare(0, 4, MIL_TEXT("BGRA")) == 0)
+      {
+      Prefix = 4;
+      Components = 4;
+      }
+   else if (PixelFormat.compare(0, 3, MIL_TEXT("RGB")) == 0 || PixelFormat.compare(0, 3, MIL_TEXT("BGR")) == 0)
+      {
+      Prefix = 3;
+      Components = 3;
+      }
+   else
+      return 0;
+   if (Length <= Prefix || Name[Prefix] < MIL_TEXT('0') || Name[Prefix] > MIL_TEXT('9'))
+      return 0;
+
+   Depth = 0;
+   while (Prefix < Length && Name[Prefix] >= MIL_TEXT('0') && Name[Prefix] <= MIL_TEXT('9'))
+      Depth = 10*Depth + (Name[Prefix++] - MIL_TEXT('0'));
+
+   /* GigE Vision "Packed" formats hold two 10- or 12-bit pixels in 3 bytes, */
+   /* PFNC "p" formats are bit-packed, others are padded to 8 or 16 bits.    */
+   if (Depth > 8 && PixelFormat.compare(Prefix, MIL_STRING::npos, MIL_TEXT("Packed")) == 0)
+      return 12*Components;
+   if (PixelFormat.compare(Prefix, MIL_STRING::npos, MIL_TEXT("p")) == 0)
+      return Depth*Components;
+   return ((Depth <= 8) ? 8 : 16)*Components;
+   }
+
+MIL_DOUBLE RoiPlannerWireBytes(MIL_INT64 PayloadByte, MIL_INT64 PacketSize)
+   {
+   MIL_INT64 PacketData, Packets;
+
+   if (PacketSize <= GVSP_HEADER_BYTES)
+      PacketSize = GVSP_DEFAULT_PACKET_SIZE;
+   PacketData = PacketSize - GVSP_HEADER_BYTES;
+   Packets = (PayloadByte + PacketData - 1)/PacketData;
+   return (MIL_DOUBLE)PayloadByte + (MIL_DOUBLE)(Packets + 2)*(GVSP_HEADER_BYTES + ETHERNET_FRAMING_BYTES) +
+          GVSP_LEADER_DATA_BYTES + GVSP_TRAILER_DATA_BYTES;
+   }
+
+bool RoiPlannerReadLimits(MIL_ID MilDigitizer, RoiPlannerLimitsStruct* Limits)
+   {
+   MIL_INT PixelFormatCount = 0;
+
+   ReadRange(MilDigitizer, MIL_TEXT("Width"), &Limits->Width);
+   ReadRange(MilDigitizer, MIL_TEXT("Height"), &Limits->Height);
+   if (Limits->Width.Max == 0 || Limits->Height.Max == 0)
+      return false;
+   ReadRange(MilDigitizer, MIL_TEXT("OffsetX"), &Limits->OffsetX);
+   ReadRange(MilDigitizer, MIL_TEXT("OffsetY"), &Limits->OffsetY);
+   ReadRange(MilDigitizer, MIL_TEXT("BinningHorizontal"), &Limits->BinningHorizontal);
+   ReadRange(MilDigitizer, MIL_TEXT("BinningVertical"), &Limits->BinningVertical);
+   ReadRange(MilDigitizer, MIL_TEXT("DecimationHorizontal"), &Limits->DecimationHorizontal);
+   ReadRange(MilDigitizer, MIL_TEXT("DecimationVertical"), &Limits->DecimationVertical);
+
+   Limits->CurrentHorizontalFactor = ReadInt(MilDigitizer, MIL_TEXT("BinningHorizontal"), 1)*
+                                     ReadInt(MilDigitizer, MIL_TEXT("DecimationHorizontal"), 1);
+   Limits->CurrentVerticalFactor = ReadInt(MilDigitizer, MIL_TEXT("BinningVertical"), 1)*
+                                   ReadInt(MilDigitizer, MIL_TEXT("DecimationVertical"), 1);
+   Limits->CurrentHeight = ReadInt(MilDigitizer, MIL_TEXT("Height"), 0);
+   Limits->SensorWidth = ReadInt(MilDigitizer, MIL_TEXT("SensorWidth"), 0);
+   Limits->SensorHeight = ReadInt(MilDigitizer, MIL_TEXT("SensorHeight"), 0);
+   if (Limits->SensorWidth <= 0)
+      Limits->SensorWidth = Limits->Width.Max*Limits->CurrentHorizontalFactor;
+   if (Limits->SensorHeight <= 0)
+      Limits->SensorHeight = Limits->Height.Max*Limits->CurrentVerticalFactor;
+
+   Limits->PixelFormats.clear();
+   Limits->PixelFormat.clear();
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("PixelFormat"), M_TYPE_STRING, Limits->PixelFormat);
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_ENUM_ENTRY_COUNT, MIL_TEXT("PixelFormat"), M_TYPE_MIL_INT, &PixelFormatCount);
+   if (!FeatureAccessSucceeded())
+      PixelFormatCount = 0;
+   Limits->PixelFormats.assign(PixelFormatCount, MIL_TEXT(""));
+   for (MIL_INT i = 0; i < PixelFormatCount; i++)
+      FeatureAccessInquire(MilDigitizer, M_FEATURE_ENUM_ENTRY_NAME + i, MIL_TEXT("PixelFormat"), M_TYPE_STRING,
+                         Limits->PixelFormats[(size_t)i]);
+   if (Limits->PixelFormats.empty() && !Limits->PixelFormat.empty())
+      Limits->PixelFormats.push_back(Limits->PixelFormat);
+
+   Limits->FrameRateMax = 0.0;
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_MAX, MIL_TEXT("AcquisitionFrameRate"), M_TYPE_MIL_DOUBLE, &Limits->FrameRateMax);
+   if (!FeatureAccessSucceeded())
+      Limits->FrameRateMax = 0.0;
+   Limits->ExposureTime = 0.0;
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("ExposureTime"), M_TYPE_MIL_DOUBLE, &Limits->ExposureTime);
+   if (!FeatureAccessSucceeded())
+      Limits->ExposureTime = 0.0;
+
+   Limits->PacketSize = ReadInt(MilDigitizer, MIL_TEXT("GevSCPSPacketSize"), GVSP_DEFAULT_PACKET_SIZE);
+   Limits->LinkSpeed = (MIL_DOUBLE)ReadInt(MilDigitizer, MIL_TEXT("GevLinkSpeed"), 0);
+   if (Limits->LinkSpeed <= 0.0)
+      Limits->LinkSpeed = ROI_PLANNER_DEFAULT_LINK;
+   return true;
+   }
+
+void RoiPlannerPlan(const RoiPlannerLimitsStruct& Limits, MIL_DOUBLE FrameRate, MIL_DOUBLE LinkUsage,
+                    vector<RoiPlannerCandidateStruct>& Candidates)
+   {
+   MIL_DOUBLE Budget = LinkUsage*Limits.LinkSpeed*1e6/8.0;
+   MIL_DOUBLE RowRate = Limits.FrameRateMax*Limits.CurrentHeight*Limits.CurrentVerticalFactor;
+
+   Candidates.clear();
+   if (FrameRate <= 0.0 || (Limits.ExposureTime > 0.0 && 1e6/Limits.ExposureTime < FrameRate))
+      return;
+
+   for (size_t Format = 0; Format < Limits.PixelFormats.size(); Format++)
+      {
+      MIL_INT Bits = RoiPlannerBitsPerPixel(Limits.PixelFormats[Format]);
+      if (Bits == 0)
+         continue;
+
+      for (MIL_INT64 Binning = 1; Binning <= ROI_PLANNER_FACTOR_MAX; Binning *= 2)
+         {
+         if (!FactorAllowed(Limits.BinningHorizontal, Binning) || !FactorAllowed(Limits.BinningVertical, Binning))
+            continue;
+         for (MIL_INT64 Decimation = 1; Binning*Decimation <= ROI_PLANNER_FACTOR_MAX; Decimation *= 2)
+            {
+            RoiPlannerCandidateStruct Candidate;
+            MIL_INT64 Factor = Binning*Decimation;
+            MIL_INT64 WidthMax, HeightMax, Height;
+
+            if (!FactorAllowed(Limits.DecimationHorizontal, Decimation) ||
+                !FactorAllowed(Limits.DecimationVertical, Decimation))
+               continue;
+            WidthMax = RoundDown(Limits.SensorWidth/Factor, Limits.Width);
+            HeightMax = RoundDown(Limits.SensorHeight/Factor, Limits.Height);
+            if (WidthMax < Limits.Width.Min || HeightMax < Limits.Height.Min)
+               continue;
+
+            /* Tallest full-width ROI that the sensor reads out in time and */
+            /* the link carries.                                            */
+            Height = HeightMax;
+            Candidate.Limit = MIL_TEXT("sensor");
+            if (RowRate > 0.0 && RowRate/(FrameRate*Factor) < (MIL_DOUBLE)Height)
+               {
+               Height = RoundDown((MIL_INT64)(RowRate/(FrameRate*Factor)), Limits.Height);
+               Candidate.Limit = MIL_TEXT("readout");
+               }
+            while (Height >= Limits.Height.Min &&
+                   RoiPlannerWireBytes(WidthMax*Height*Bits/8, Limits.PacketSize)*FrameRate > Budget)
+               {
+               Height -= Limits.Height.Inc;
+               Candidate.Limit = MIL_TEXT("link");
+               }
+            if (Height < Limits.Height.Min)
+               continue;
+
+            Candidate.PixelFormat = Limits.PixelFormats[Format];
+            Candidate.BitsPerPixel = Bits;
+            Candidate.Binning = Binning;
+            Candidate.Decimation = Decimation;
+            Candidate.Width = WidthMax;
+            Candidate.Height = Height;
+            Candidate.OffsetX = 0;
+            Candidate.OffsetY = RoundDown((HeightMax - Height)/2, Limits.OffsetY);
+            if (Candidate.OffsetY < 0)
+               Candidate.OffsetY = 0;
+            Candidate.Coverage = (MIL_DOUBLE)(WidthMax*Factor)*(MIL_DOUBLE)(Height*Factor)/
+                                 ((MIL_DOUBLE)Limits.SensorWidth*(MIL_DOUBLE)Limits.SensorHeight);
+            Candidate.Bandwidth = RoiPlannerWireBytes(WidthMax*Height*Bits/8, Limits.PacketSize)*FrameRate;
+            Candidate.FrameRateMax = Budget/RoiPlannerWireBytes(WidthMax*Height*Bits/8, Limits.PacketSize);
+            if (RowRate > 0.0)
+               Candidate.FrameRateMax = min(Candidate.FrameRateMax, RowRate/(MIL_DOUBLE)(Height*Factor));
+            if (Limits.ExposureTime > 0.0)
+               Candidate.FrameRateMax = min(Candidate.FrameRateMax, 1e6/Limits.ExposureTime);
+            Candidates.push_back(Candidate);
+            }
+         }
+      }
+
+   /* Largest field of view, then finest resolution, then deepest pixels. */
+   stable_sort(Candidates.begin(), Candidates.end(),
+               [](const RoiPlannerCandidateStruct& A, const RoiPlannerCandidateStruct& B)
+                  {
+                  if (A.Coverage != B.Coverage)
+                     return A.Coverage > B.Coverage;
+                  if (A.Binning*A.Decimation != B.Binning*B.Decimation)
+                     return A.Binning*A.Decimation < B.Binning*B.Decimation;
+                  return A.BitsPerPixel > B.BitsPerPixel;
+                  });
+   }
+
+static bool WriteInt(MIL_ID MilDigitizer, const MIL_TEXT_CHAR* FeatureName, MIL_INT64 Value)
+   {
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, FeatureName, M_TYPE_INT64, &Value);
+   return FeatureAccessSucceeded();
+   }
+
+/* Features written by RoiPlannerApply(). The binning and decimation of a */
+/* direction are only written if the camera implements them.              */
+typedef struct
+   {
+   MIL_STRING               PixelFormat;
+   MIL_INT64                BinningHorizontal;
+   MIL_INT64                BinningVertical;
+   MIL_INT64                DecimationHorizontal;
+   MIL_INT64                DecimationVertical;
+   MIL_INT64                Width;
+   MIL_INT64                Height;
+   MIL_INT64                OffsetX;
+   MIL_INT64                OffsetY;
+   MIL_BOOL                 FrameRateEnable;
+   MIL_DOUBLE               FrameRate;       /* 0 if not readable. */
+   } SettingsStruct;
+
+static void ReadSettings(MIL_ID MilDigitizer, SettingsStruct* Settings)
+   {
+   Settings->PixelFormat.clear();
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("PixelFormat"), M_TYPE_STRING, Settings->PixelFormat);
+   Settings->BinningHorizontal = ReadInt(MilDigitizer, MIL_TEXT("BinningHorizontal"), 1);
+   Settings->BinningVertical = ReadInt(MilDigitizer, MIL_TEXT("BinningVertical"), 1);
+   Settings->DecimationHorizontal = ReadInt(MilDigitizer, MIL_TEXT("DecimationHorizontal"), 1);
+   Settings->DecimationVertical = ReadInt(MilDigitizer, MIL_TEXT("DecimationVertical"), 1);
+   Settings->Width = ReadInt(MilDigitizer, MIL_TEXT("Width"), 0);
+   Settings->Height = ReadInt(MilDigitizer, MIL_TEXT("Height"), 0);
+   Settings->OffsetX = ReadInt(MilDigitizer, MIL_TEXT("OffsetX"), 0);
+   Settings->OffsetY = ReadInt(MilDigitizer, MIL_TEXT("OffsetY"), 0);
+
+   Settings->FrameRateEnable = M_FALSE;
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("AcquisitionFrameRateEnable"), M_TYPE_BOOLEAN,
+                        &Settings->FrameRateEnable);
+   Settings->FrameRate = 0.0;
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("AcquisitionFrameRate"), M_TYPE_MIL_DOUBLE,
+                        &Settings->FrameRate);
+   if (!FeatureAccessSucceeded())
+      Settings->FrameRate = 0.0;
+   }
+
+/* Writes the image format. Returns false if a write failed. */
+static bool WriteFormat(MIL_ID MilDigitizer, const SettingsStruct& Settings, const RoiPlannerLimitsStruct& Limits)
+   {
+   bool Ok = true;
+
+   /* Offsets first, so that the new size is always within the sensor. */
+   WriteInt(MilDigitizer, MIL_TEXT("OffsetX"), 0);
+   WriteInt(MilDigitizer, MIL_TEXT("OffsetY"), 0);
+   if (!Settings.PixelFormat.empty())
+      {
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("PixelFormat"), M_TYPE_STRING, Settings.PixelFormat);
+      Ok = FeatureAccessSucceeded() && Ok;
+      }
+   if (Limits.BinningHorizontal.Max)
+      Ok = WriteInt(MilDigitizer, MIL_TEXT("BinningHorizontal"), Settings.BinningHorizontal) && Ok;
+   if (Limits.BinningVertical.Max)
+      Ok = WriteInt(MilDigitizer, MIL_TEXT("BinningVertical"), Settings.BinningVertical) && Ok;
+   if (Limits.DecimationHorizontal.Max)
+      Ok = WriteInt(MilDigitizer, MIL_TEXT("DecimationHorizontal"), Settings.DecimationHorizontal) && Ok;
+   if (Limits.DecimationVertical.Max)
+      Ok = WriteInt(MilDigitizer, MIL_TEXT("DecimationVertical"), Settings.DecimationVertical) && Ok;
+   Ok = WriteInt(MilDigitizer, MIL_TEXT("Width"), Settings.Width) && Ok;
+   Ok = WriteInt(MilDigitizer, MIL_TEXT("Height"), Settings.Height) && Ok;
+   Ok = WriteInt(MilDigitizer, MIL_TEXT("OffsetX"), Settings.OffsetX) && Ok;
+   Ok = WriteInt(MilDigitizer, MIL_TEXT("OffsetY"), Settings.OffsetY) && Ok;
+   return Ok;
+   }
+
+bool RoiPlannerApply(MIL_ID MilDigitizer, const RoiPlannerCandidateStruct& Candidate, MIL_DOUBLE FrameRate,
+                     const RoiPlannerLimitsStruct& Limits, RoiPlannerResultStruct* Result)
+   {
+   SettingsStruct Previous, Next;
+   MIL_BOOL Enable = M_TRUE;
+   MIL_DOUBLE FrameRateMax = 0.0;
+   bool Ok;
+
+   ReadSettings(MilDigitizer, &Previous);
+   Next.PixelFormat = Candidate.PixelFormat;
+   Next.BinningHorizontal = Next.BinningVertical = Candidate.Binning;
+   Next.DecimationHorizontal = Next.DecimationVertical = Candidate.Decimation;
+   Next.Width = Candidate.Width;
+   Next.Height = Candidate.Height;
+   Next.OffsetX = Candidate.OffsetX;
+   Next.OffsetY = Candidate.OffsetY;
+   Ok = WriteFormat(MilDigitizer, Next, Limits);
+
+   /* Ask for the target rate, within what the camera now allows. */
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("AcquisitionFrameRateEnable"), M_TYPE_BOOLEAN, &Enable);
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_MAX, MIL_TEXT("AcquisitionFrameRate"), M_TYPE_MIL_DOUBLE, &FrameRateMax);
+   if (FeatureAccessSucceeded() && FrameRateMax > 0.0)
+      {
+      MIL_DOUBLE Rate = min(FrameRate, FrameRateMax);
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("AcquisitionFrameRate"), M_TYPE_MIL_DOUBLE, &Rate);
+      Ok = FeatureAccessSucceeded() && Ok;
+      }
+
+   /* A combination applied in part is not what was planned: go back to */
+   /* the previous settings.                                            */
+   if (!Ok)
+      {
+      WriteFormat(MilDigitizer, Previous, Limits);
+      if (Previous.FrameRate > 0.0)
+         FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("AcquisitionFrameRate"), M_TYPE_MIL_DOUBLE,
+                              &Previous.FrameRate);
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("AcquisitionFrameRateEnable"), M_TYPE_BOOLEAN,
+                           &Previous.FrameRateEnable);
+      FeatureAccessInquire(MilDigitizer, M_FEATURE_MAX, MIL_TEXT("AcquisitionFrameRate"), M_TYPE_MIL_DOUBLE, &FrameRateMax);
+      }
+
+   /* Read back what the camera does. */
+   Result->Width = ReadInt(MilDigitizer, MIL_TEXT("Width"), 0);
+   Result->Height = ReadInt(MilDigitizer, MIL_TEXT("Height"), 0);
+   Result->FrameRate = 0.0;
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("AcquisitionFrameRate"), M_TYPE_MIL_DOUBLE, &Result->FrameRate);
+   if (!FeatureAccessSucceeded())
+      Result->FrameRate = 0.0;
+   Result->FrameRateMax = FrameRateMax;
+   Result->PayloadSize = ReadInt(MilDigitizer, MIL_TEXT("PayloadSize"),
+                                 Result->Width*Result->Height*Candidate.BitsPerPixel/8);
+   Result->Bandwidth = RoiPlannerWireBytes(Result->PayloadSize,
+                                           ReadInt(MilDigitizer, MIL_TEXT("GevSCPSPacketSize"), Limits.PacketSize))*
+                       Result->FrameRate;
+   Result->LinkUsage = Result->Bandwidth*8.0/(Limits.LinkSpeed*1e6);
+   return Ok;
+   }
+
+void RoiPlannerPrintCandidates(const vector<RoiPlannerCandidateStruct>& Candidates, MIL_INT Count)
+   {
+   MosPrintf(MIL_TEXT("\n%3s  %-16s %3s %3s  %-24s %6s %8s %8s  %s\n"), MIL_TEXT("#"), MIL_TEXT("Pixel format"),
+             MIL_TEXT("Bin"), MIL_TEXT("Dec"), MIL_TEXT("ROI (offset)"), MIL_TEXT("View"), MIL_TEXT("Mb/s"),
+             MIL_TEXT("Max fps"), MIL_TEXT("Limit"));
+   for (MIL_INT i = 0; i < Count && i < (MIL_INT)Candidates.size(); i++)
+      {
+      const RoiPlannerCandidateStruct& Candidate = Candidates[(size_t)i];
+      MIL_TEXT_CHAR Roi[64];
+      MosSprintf(Roi, 64, MIL_TEXT("%lld x %lld (%lld, %lld)"), (long long)Candidate.Width, (long long)Candidate.Height,
+                 (long long)Candidate.OffsetX, (long long)Candidate.OffsetY);
+      MosPrintf(MIL_TEXT("%3d  %-16s %3d %3d  %-24s %5.0f%% %8.1f %8.1f  %s\n"), (int)(i + 1), Candidate.PixelFormat.c_str(),
+                (int)Candidate.Binning, (int)Candidate.Decimation, Roi, 100.0*Candidate.Coverage,
+                Candidate.Bandwidth*8.0/1e6, Candidate.FrameRateMax, Candidate.Limit);
+      }
+   }
+
+void RoiPlannerPrintResult(const RoiPlannerResultStruct& Result, MIL_DOUBLE FrameRate,
+                           const RoiPlannerLimitsStruct& Limits)
+   {
+   MosPrintf(MIL_TEXT("\n%30s %lld x %lld\n"), MIL_TEXT("ROI:"), (long long)Result.Width, (long long)Result.Height);
+   if (Result.FrameRate > 0.0)
+      MosPrintf(MIL_TEXT("%30s %.2f fps (target %.2f, maximum %.2f)\n"), MIL_TEXT("AcquisitionFrameRate:"),
+                Result.FrameRate, FrameRate, Result.FrameRateMax);
+   else
+      MosPrintf(MIL_TEXT("%30s N/A\n"), MIL_TEXT("AcquisitionFrameRate:"));
+   MosPrintf(MIL_TEXT("%30s %lld bytes\n"), MIL_TEXT("Payload:"), (long long)Result.PayloadSize);
+   MosPrintf(MIL_TEXT("%30s %.1f Mb/s (%.0f%% of the %.0f Mb/s link)\n"), MIL_TEXT("Bandwidth:"),
+             Result.Bandwidth*8.0/1e6, 100.0*Result.LinkUsage, Limits.LinkSpeed);
+   if (Result.FrameRate > 0.0 && Result.FrameRate < 0.99*FrameRate)
+      MosPrintf(MIL_TEXT("The camera does not reach the target rate with this combination.\n"));
+   if (Result.LinkUsage > 1.0)
+      MosPrintf(MIL_TEXT("The stream exceeds the link; frames will be lost.\n"));
+   }
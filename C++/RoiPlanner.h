@@ -0,0 +1,130 @@
+﻿/********************************************************************************/
+/*
+* File name: RoiPlanner.h
+*
+* Synopsis:  Planning of the ROI, binning, decimation and pixel format that
+*            reach a target frame rate within the bandwidth of the link.
+*
+*            The limits are read from the SFNC image format features (sensor
+*            size, Width/Height/Offset minimum, maximum and increment,
+*            Binning and Decimation ranges, PixelFormat entries), the packet
+*            size (GevSCPSPacketSize) and the link speed (GevLinkSpeed).
+*
+*            For each pixel format and binning/decimation factor, the planner
+*            keeps the full width and takes the tallest centered ROI, on the
+*            increments of the camera, whose stream fits in the link budget
+*            at the target rate. The stream is counted on the wire, with the
+*            IP/UDP/GVSP headers and the Ethernet framing of every packet.
+*            The sensor readout is modeled from the current maximum frame
+*            rate as a constant row rate, and the exposure time caps the rate
+*            of every combination.
+*
+*            The readout model is an estimate: once a combination is applied,
+*            the AcquisitionFrameRate reached and the bandwidth of the actual
+*            payload are read back from the camera.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+#ifndef ROI_PLANNER_H
+#define ROI_PLANNER_H
+
+#include <mil.h>
+#include <vector>
+
+/* Largest binning or decimation factor tried, in powers of 2. */
+#define ROI_PLANNER_FACTOR_MAX      4
+
+/* Link speed assumed when the camera does not report it, in Mb/s. */
+#define ROI_PLANNER_DEFAULT_LINK    1000.0
+
+/* Integer feature range. Max is 0 if the feature is not implemented. */
+typedef struct
+   {
+   MIL_INT64                Min;
+   MIL_INT64                Max;
+   MIL_INT64                Inc;
+   } RoiPlannerRangeStruct;
+
+/* Limits of the camera. Width and Height are at the current binning and */
+/* decimation; the planner scales them back to the sensor.              */
+typedef struct
+   {
+   MIL_INT64                SensorWidth;
+   MIL_INT64                SensorHeight;
+   RoiPlannerRangeStruct    Width;
+   RoiPlannerRangeStruct    Height;
+   RoiPlannerRangeStruct    OffsetX;
+   RoiPlannerRangeStruct    OffsetY;
+   RoiPlannerRangeStruct    BinningHorizontal;
+   RoiPlannerRangeStruct    BinningVertical;
+   RoiPlannerRangeStruct    DecimationHorizontal;
+   RoiPlannerRangeStruct    DecimationVertical;
+   std::vector<MIL_STRING>  PixelFormats;
+
+   /* Current settings, from which the row rate of the sensor is estimated. */
+   MIL_STRING               PixelFormat;
+   MIL_INT64                CurrentHeight;
+   MIL_INT64                CurrentVerticalFactor;    /* Binning x decimation. */
+   MIL_INT64                CurrentHorizontalFactor;
+   MIL_DOUBLE               FrameRateMax;
+   MIL_DOUBLE               ExposureTime;             /* us */
+
+   MIL_INT64                PacketSize;
+   MIL_DOUBLE               LinkSpeed;                /* Mb/s */
+   } RoiPlannerLimitsStruct;
+
+typedef struct
+   {
+   MIL_STRING               PixelFormat;
+   MIL_INT                  BitsPerPixel;
+   MIL_INT64                Binning;      /* Both directions. */
+   MIL_INT64                Decimation;   /* Both directions. */
+   MIL_INT64                Width;
+   MIL_INT64                Height;
+   MIL_INT64                OffsetX;
+   MIL_INT64                OffsetY;
+   MIL_DOUBLE               Coverage;      /* Fraction of the sensor in view. */
+   MIL_DOUBLE               Bandwidth;     /* Wire bytes per second at the target rate. */
+   MIL_DOUBLE               FrameRateMax;  /* Estimated. */
+   const MIL_TEXT_CHAR*     Limit;         /* What bounds the height. */
+   } RoiPlannerCandidateStruct;
+
+/* Frame rate and bandwidth read back after applying a combination. */
+typedef struct
+   {
+   MIL_INT64                Width;
+   MIL_INT64                Height;
+   MIL_DOUBLE               FrameRate;
+   MIL_DOUBLE               FrameRateMax;
+   MIL_INT64                PayloadSize;
+   MIL_DOUBLE               Bandwidth;
+   MIL_DOUBLE               LinkUsage;
+   } RoiPlannerResultStruct;
+
+/* Bits per pixel of a PFNC/GigE Vision pixel format, 0 if unknown. */
+MIL_INT RoiPlannerBitsPerPixel(const MIL_STRING& PixelFormat);
+
+/* Bytes on the wire for a payload of PayloadByte sent in PacketSize packets. */
+MIL_DOUBLE RoiPlannerWireBytes(MIL_INT64 PayloadByte, MIL_INT64 PacketSize);
+
+/* Reads the limits. Call with the error prints disabled. Returns false if */
+/* the camera does not report its ROI limits.                              */
+bool RoiPlannerReadLimits(MIL_ID MilDigitizer, RoiPlannerLimitsStruct* Limits);
+
+/* Combinations reaching FrameRate within LinkUsage (fraction) of the link, */
+/* the largest field of view first.                                         */
+void RoiPlannerPlan(const RoiPlannerLimitsStruct& Limits, MIL_DOUBLE FrameRate, MIL_DOUBLE LinkUsage,
+                    std::vector<RoiPlannerCandidateStruct>& Candidates);
+
+/* Applies a combination and sets AcquisitionFrameRate to FrameRate. Call */
+/* with the error prints disabled. If a write fails, the previous settings */
+/* are written back and false is returned; Result then holds them.         */
+bool RoiPlannerApply(MIL_ID MilDigitizer, const RoiPlannerCandidateStruct& Candidate, MIL_DOUBLE FrameRate,
+                     const RoiPlannerLimitsStruct& Limits, RoiPlannerResultStruct* Result);
+
+void RoiPlannerPrintCandidates(const std::vector<RoiPlannerCandidateStruct>& Candidates, MIL_INT Count);
+void RoiPlannerPrintResult(const RoiPlannerResultStruct& Result, MIL_DOUBLE FrameRate,
+                           const RoiPlannerLimitsStruct& Limits);
+
+#endif
@@ -0,0 +1,434 @@
+﻿/********************************************************************************/
+/*
+* File name: Sequencer.cpp
+*
+* Synopsis:  Implementation of the sequencer and of the HDR merge.
+*            See Sequencer.h.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. */
+#include "Sequencer.h"
+#include <math.h>
+#include <string.h>
+#include "FeatureAccess.h"
+
+using namespace std;
+
+/* Key value of the tone mapping, as a fraction of the log-average radiance. */
+#define HDR_KEY_VALUE               0.18
+#define HDR_GAMMA                   2.2
+#define HDR_GAMMA_LUT_SIZE          4096
+
+/* Writes the settings of one set. Call with the error prints disabled. */
+static bool WriteSet(MIL_ID MilDigitizer, const SequencerSetStruct& Set)
+   {
+   bool Ok = true;
+   MIL_DOUBLE ExposureTime = Set.ExposureTime, Gain = Set.Gain;
+   MIL_INT64 OffsetX = Set.OffsetX, OffsetY = Set.OffsetY;
+
+   if (Set.Settings & SEQUENCER_EXPOSURE)
+      {
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("ExposureTime"), M_TYPE_MIL_DOUBLE, &ExposureTime);
+      Ok = FeatureAccessSucceeded() && Ok;
+      }
+   if (Set.Settings & SEQUENCER_GAIN)
+      {
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("Gain"), M_TYPE_MIL_DOUBLE, &Gain);
+      Ok = FeatureAccessSucceeded() && Ok;
+      }
+   if (Set.Settings & SEQUENCER_OFFSET)
+      {
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("OffsetX"), M_TYPE_INT64, &OffsetX);
+      Ok = FeatureAccessSucceeded() && Ok;
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("OffsetY"), M_TYPE_INT64, &OffsetY);
+      Ok = FeatureAccessSucceeded() && Ok;
+      }
+   return Ok;
+   }
+
+/* Programs all the sets into the camera's sequencer in one pass. Call with */
+/* the error prints disabled. Returns false, with the sequencer off, if the */
+/* camera has none or rejected a setting.                                  */
+static bool ProgramCameraSequencer(SequencerStruct* Sequencer)
+   {
+   MIL_ID MilDigitizer = Sequencer->MilDigitizer;
+   MIL_INT ModeCount = 0;
+   MIL_INT64 SetCount = (MIL_INT64)Sequencer->Sets.size();
+   MIL_INT64 Zero = 0;
+   bool Ok = true;
+
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_ENUM_ENTRY_COUNT, MIL_TEXT("SequencerMode"), M_TYPE_MIL_INT, &ModeCount);
+   if (ModeCount == 0)
+      return false;
+
+   MIL_DOUBLE StartTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("SequencerMode"), M_TYPE_STRING, MIL_TEXT("Off"));
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("SequencerConfigurationMode"), M_TYPE_STRING, MIL_TEXT("On"));
+   Ok = FeatureAccessSucceeded();
+
+   for (MIL_INT64 i = 0; i < SetCount && Ok; i++)
+      {
+      MIL_INT64 Next = (i + 1) % SetCount;
+
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("SequencerSetSelector"), M_TYPE_INT64, &i);
+      Ok = FeatureAccessSucceeded() && WriteSet(MilDigitizer, Sequencer->Sets[(size_t)i]);
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("SequencerPathSelector"), M_TYPE_INT64, &Zero);
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("SequencerSetNext"), M_TYPE_INT64, &Next);
+      Ok = FeatureAccessSucceeded() && Ok;
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("SequencerTriggerSource"), M_TYPE_STRING, MIL_TEXT("FrameStart"));
+      Ok = FeatureAccessSucceeded() && Ok;
+      FeatureAccessControl(MilDigitizer, M_FEATURE_EXECUTE, MIL_TEXT("SequencerSetSave"), M_DEFAULT, M_NULL);
+      Ok = FeatureAccessSucceeded() && Ok;
+      }
+
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("SequencerConfigurationMode"), M_TYPE_STRING, MIL_TEXT("Off"));
+   if (Ok)
+      {
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("SequencerSetStart"), M_TYPE_INT64, &Zero);
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("SequencerMode"), M_TYPE_STRING, MIL_TEXT("On"));
+      Ok = FeatureAccessSucceeded();
+      }
+   if (!Ok)
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("SequencerMode"), M_TYPE_STRING, MIL_TEXT("Off"));
+
+   Sequencer->ProgramTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) - StartTime;
+   return Ok;
+   }
+
+/* Emulation: a frame started to arrive; its exposure is over. */
+static MIL_INT MFTYPE GrabStartFunction(MIL_INT HookType, MIL_ID EventId, void* UserDataPtr)
+   {
+   SequencerStruct* Sequencer = (SequencerStruct*)UserDataPtr;
+   MIL_UINT64 Frame = Sequencer->StartedCount.load();
+   MIL_UINT64 Programmed = Sequencer->ProgrammedFrame.load();
+
+   /* The frame was exposed with the last set written. */
+   if (Programmed < Frame)
+      Sequencer->LateCount++;
+   Sequencer->FrameSet[Frame % SEQUENCER_HISTORY_SIZE].store((MIL_INT)(Programmed % Sequencer->Sets.size()));
+
+   Sequencer->StartedCount.store(Frame + 1);
+   MthrControl(Sequencer->MilEvent, M_EVENT_SET, M_SIGNALED);
+   return 0;
+   }
+
+/* Emulation: writes the set of the next frame. */
+static MIL_UINT32 MFTYPE ControlThread(void* ThreadContext)
+   {
+   SequencerStruct* Sequencer = (SequencerStruct*)ThreadContext;
+
+   for (;;)
+      {
+      MthrWait(Sequencer->MilEvent, M_EVENT_WAIT, M_NULL);
+      if (Sequencer->StopRequested.load())
+         break;
+
+      MIL_UINT64 Next = Sequencer->StartedCount.load();
+      if (Sequencer->ProgrammedFrame.load() >= Next)
+         continue;
+
+      MIL_DOUBLE StartTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+      MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+      WriteSet(Sequencer->MilDigitizer, Sequencer->Sets[Next % Sequencer->Sets.size()]);
+      MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+      MIL_DOUBLE WriteTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) - StartTime;
+
+      Sequencer->ProgrammedFrame.store(Next);
+      Sequencer->WriteCount++;
+      Sequencer->WriteTime += WriteTime;
+      if (WriteTime > Sequencer->WriteTimeMax)
+         Sequencer->WriteTimeMax = WriteTime;
+      }
+   return 0;
+   }
+
+bool SequencerStart(MIL_ID MilSystem, MIL_ID MilDigitizer, const SequencerSetStruct* Sets, MIL_INT SetCount,
+                    bool AllowHardware, SequencerStruct* Sequencer)
+   {
+   bool Ok;
+
+   Sequencer->MilDigitizer = MilDigitizer;
+   Sequencer->MilThread = M_NULL;
+   Sequencer->MilEvent = M_NULL;
+   Sequencer->StopRequested.store(false);
+   Sequencer->Sets.assign(Sets, Sets + ((SetCount < SEQUENCER_SET_MAX) ? SetCount : SEQUENCER_SET_MAX));
+   Sequencer->Hardware = false;
+   Sequencer->StartedCount.store(0);
+   Sequencer->ProgrammedFrame.store(0);
+   Sequencer->MissedBase = 0;
+   for (MIL_INT i = 0; i < SEQUENCER_HISTORY_SIZE; i++)
+      Sequencer->FrameSet[i].store(0);
+   Sequencer->ProgramTime = 0.0;
+   Sequencer->WriteCount = 0;
+   Sequencer->WriteTime = Sequencer->WriteTimeMax = 0.0;
+   Sequencer->LateCount.store(0);
+   memset(Sequencer->TaggedCount, 0, sizeof(Sequencer->TaggedCount));
+   if (Sequencer->Sets.empty())
+      return false;
+
+   /* Keep the current settings to restore them, and turn their automatic control off. */
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+   Sequencer->Original.Settings = 0;
+   for (size_t i = 0; i < Sequencer->Sets.size(); i++)
+      Sequencer->Original.Settings |= Sequencer->Sets[i].Settings;
+   Sequencer->PreviousExposureAuto.clear();
+   Sequencer->PreviousGainAuto.clear();
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("ExposureAuto"), M_TYPE_STRING, Sequencer->PreviousExposureAuto);
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GainAuto"), M_TYPE_STRING, Sequencer->PreviousGainAuto);
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("ExposureAuto"), M_TYPE_STRING, MIL_TEXT("Off"));
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GainAuto"), M_TYPE_STRING, MIL_TEXT("Off"));
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("ExposureTime"), M_TYPE_MIL_DOUBLE, &Sequencer->Original.ExposureTime);
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("Gain"), M_TYPE_MIL_DOUBLE, &Sequencer->Original.Gain);
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("OffsetX"), M_TYPE_INT64, &Sequencer->Original.OffsetX);
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("OffsetY"), M_TYPE_INT64, &Sequencer->Original.OffsetY);
+
+   Sequencer->Hardware = AllowHardware && ProgramCameraSequencer(Sequencer);
+   Ok = Sequencer->Hardware || WriteSet(MilDigitizer, Sequencer->Sets[0]);
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+   if (!Ok || Sequencer->Hardware)
+      return Ok;
+
+   MthrAlloc(MilSystem, M_EVENT, M_NOT_SIGNALED + M_AUTO_RESET, M_NULL, M_NULL, &Sequencer->MilEvent);
+   MthrAlloc(MilSystem, M_THREAD, M_DEFAULT, &ControlThread, Sequencer, &Sequencer->MilThread);
+   if (Sequencer->MilThread == M_NULL)
+      return false;
+   MdigHookFunction(MilDigitizer, M_GRAB_FRAME_START, GrabStartFunction, Sequencer);
+   return true;
+   }
+
+/* Returns the set of the FrameIndex-th processed frame, -1 if it is not */
+/* one of the sets. Call once per frame, from the processing function.    */
+MIL_INT SequencerFrameSet(SequencerStruct* Sequencer, MIL_UINT64 FrameIndex)
+   {
+   MIL_INT Set;
+
+   FrameIndex += Sequencer->MissedBase;
+   if (Sequencer->Hardware)
+      Set = (MIL_INT)(FrameIndex % Sequencer->Sets.size());
+   else
+      Set = Sequencer->FrameSet[FrameIndex % SEQUENCER_HISTORY_SIZE].load();
+   if (Set < 0 || Set >= (MIL_INT)Sequencer->Sets.size())
+      return -1;
+   Sequencer->TaggedCount[Set]++;
+   return Set;
+   }
+
+/* Adds the frames missed by the run to the base. Call after each */
+/* MdigProcess() stop, before the next start.                     */
+void SequencerProcessStopped(SequencerStruct* Sequencer)
+   {
+   MIL_INT Missed = 0;
+
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+   FeatureAccessMdigInquire(Sequencer->MilDigitizer, M_PROCESS_FRAME_MISSED, &Missed);
+   if (FeatureAccessSucceeded())
+      Sequencer->MissedBase += (MIL_UINT64)Missed;
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+   }
+
+/* Emulation: waits until the set of the next frame is written. */
+bool SequencerWaitProgrammed(SequencerStruct* Sequencer, MIL_DOUBLE Timeout)
+   {
+   MIL_DOUBLE StartTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+
+   if (Sequencer->Hardware)
+      return true;
+   while (Sequencer->ProgrammedFrame.load() < Sequencer->StartedCount.load())
+      {
+      if (MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) - StartTime > Timeout)
+         return false;
+      MosSleep(1);
+      }
+   return true;
+   }
+
+/* Stops the sequence, restores the camera settings and prints the statistics. */
+void SequencerStop(SequencerStruct* Sequencer)
+   {
+   if (Sequencer->MilThread)
+      {
+      MdigHookFunction(Sequencer->MilDigitizer, M_GRAB_FRAME_START+M_UNHOOK, GrabStartFunction, Sequencer);
+      Sequencer->StopRequested.store(true);
+      MthrControl(Sequencer->MilEvent, M_EVENT_SET, M_SIGNALED);
+      MthrWait(Sequencer->MilThread, M_THREAD_END_WAIT, M_NULL);
+      MthrFree(Sequencer->MilThread);
+      Sequencer->MilThread = M_NULL;
+      }
+   if (Sequencer->MilEvent)
+      MthrFree(Sequencer->MilEvent);
+   Sequencer->MilEvent = M_NULL;
+   if (Sequencer->Sets.empty())
+      return;
+
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+   if (Sequencer->Hardware)
+      FeatureAccessControl(Sequencer->MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("SequencerMode"), M_TYPE_STRING, MIL_TEXT("Off"));
+   WriteSet(Sequencer->MilDigitizer, Sequencer->Original);
+   if (!Sequencer->PreviousExposureAuto.empty())
+      FeatureAccessControl(Sequencer->MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("ExposureAuto"), M_TYPE_STRING,
+                           Sequencer->PreviousExposureAuto.c_str());
+   if (!Sequencer->PreviousGainAuto.empty())
+      FeatureAccessControl(Sequencer->MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("GainAuto"), M_TYPE_STRING,
+                           Sequencer->PreviousGainAuto.c_str());
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+
+   MosPrintf(MIL_TEXT("\n--------------------- Sequencer ---------------------\n\n"));
+   MosPrintf(MIL_TEXT("%30s %s, %lld sets\n"), MIL_TEXT("Mode:"),
+             Sequencer->Hardware ? MIL_TEXT("Camera sequencer") : MIL_TEXT("Host emulation"),
+             (long long)Sequencer->Sets.size());
+   if (Sequencer->Hardware)
+      MosPrintf(MIL_TEXT("%30s %.1f ms\n"), MIL_TEXT("Programming pass:"), 1e3*Sequencer->ProgramTime);
+   else
+      {
+      if (Sequencer->WriteCount)
+         MosPrintf(MIL_TEXT("%30s %llu (avg %.2f ms, max %.2f ms)\n"), MIL_TEXT("Set writes:"),
+                   (unsigned long long)Sequencer->WriteCount, 1e3*Sequencer->WriteTime/Sequencer->WriteCount,
+                   1e3*Sequencer->WriteTimeMax);
+      MosPrintf(MIL_TEXT("%30s %llu of %llu frames\n"), MIL_TEXT("Late sets:"),
+                (unsigned long long)Sequencer->LateCount.load(), (unsigned long long)Sequencer->StartedCount.load());
+      }
+   for (size_t i = 0; i < Sequencer->Sets.size(); i++)
+      {
+      const SequencerSetStruct& Set = Sequencer->Sets[i];
+      MIL_TEXT_CHAR Label[32];
+      MosSprintf(Label, 32, MIL_TEXT("Set %d:"), (int)i);
+      MosPrintf(MIL_TEXT("%30s %llu frames"), Label, (unsigned long long)Sequencer->TaggedCount[i]);
+      if (Set.Settings & SEQUENCER_EXPOSURE)
+         MosPrintf(MIL_TEXT(", %.0f us"), Set.ExposureTime);
+      if (Set.Settings & SEQUENCER_GAIN)
+         MosPrintf(MIL_TEXT(", %.1f dB"), Set.Gain);
+      if (Set.Settings & SEQUENCER_OFFSET)
+         MosPrintf(MIL_TEXT(", offset (%lld, %lld)"), (long long)Set.OffsetX, (long long)Set.OffsetY);
+      MosPrintf(MIL_TEXT("\n"));
+      }
+   }
+
+/* HDR merge.                                                               */
+/* -----------------------------------------------------------------------*/
+
+void HdrMergeInit(MIL_ID MilBuffer, MIL_INT SetCount, HdrMergeStruct* Hdr)
+   {
+   size_t Size;
+
+   Hdr->SizeX = MbufInquire(MilBuffer, M_SIZE_X, M_NULL);
+   Hdr->SizeY = MbufInquire(MilBuffer, M_SIZE_Y, M_NULL);
+   Hdr->SizeBit = MbufInquire(MilBuffer, M_SIZE_BIT, M_NULL);
+   Hdr->SetCount = (SetCount < SEQUENCER_SET_MAX) ? SetCount : SEQUENCER_SET_MAX;
+   Hdr->Received = 0;
+   Size = (size_t)(Hdr->SizeX*Hdr->SizeY);
+   Hdr->Frame.resize(Size*((Hdr->SizeBit > 8) ? 2 : 1));
+   Hdr->Radiance.assign(Size, 0.0f);
+   Hdr->Weight.assign(Size, 0.0f);
+   Hdr->Fallback.assign(Size, 0.0f);
+   Hdr->FallbackExposure = 0.0;
+   Hdr->ToneMapped.resize(Size);
+   MbufAlloc2d(MbufInquire(MilBuffer, M_OWNER_SYSTEM, M_NULL), Hdr->SizeX, Hdr->SizeY, 8 + M_UNSIGNED, M_IMAGE + M_PROC,
+               &Hdr->MilToneMapped);
+   Hdr->MergedCount = 0;
+   Hdr->MergeTime = 0.0;
+   }
+
+/* Accumulates the frame, scaled by its exposure time, with a weight that */
+/* favors the mid-tones and excludes the black and saturated pixels.      */
+template <typename T>
+static void Accumulate(HdrMergeStruct* Hdr, const T* Frame, MIL_DOUBLE ExposureTime, bool Shortest)
+   {
+   size_t Size = Hdr->Radiance.size();
+   float Max = (float)((1ULL << Hdr->SizeBit) - 1);
+   float Scale = (float)(1.0/ExposureTime);
+   float WeightScale = 2.0f/Max;
+
+   for (size_t i = 0; i < Size; i++)
+      {
+      float Value = (float)Frame[i];
+      float Distance = (Value < Max - Value) ? Value : Max - Value;
+      float Weight = Distance*WeightScale;
+      Hdr->Radiance[i] += Weight*Value*Scale;
+      Hdr->Weight[i] += Weight;
+      if (Shortest)
+         Hdr->Fallback[i] = Value*Scale;
+      }
+   }
+
+bool HdrMergeAdd(HdrMergeStruct* Hdr, MIL_ID MilBuffer, MIL_INT SetIndex, MIL_DOUBLE ExposureTime)
+   {
+   MIL_DOUBLE StartTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+   bool Shortest;
+
+   if (SetIndex < 0 || SetIndex >= Hdr->SetCount || ExposureTime <= 0.0)
+      return false;
+
+   /* A bracket starts with the first set; an incomplete one is discarded. */
+   if (SetIndex == 0)
+      {
+      fill(Hdr->Radiance.begin(), Hdr->Radiance.end(), 0.0f);
+      fill(Hdr->Weight.begin(), Hdr->Weight.end(), 0.0f);
+      Hdr->FallbackExposure = 0.0;
+      Hdr->Received = 0;
+      }
+   if (Hdr->Received & ((MIL_INT)1 << SetIndex))
+      return false;
+
+   Shortest = (Hdr->FallbackExposure == 0.0 || ExposureTime < Hdr->FallbackExposure);
+   if (Shortest)
+      Hdr->FallbackExposure = ExposureTime;
+
+   MbufGet(MilBuffer, &Hdr->Frame[0]);
+   if (Hdr->SizeBit > 8)
+      Accumulate(Hdr, (const MIL_UINT16*)&Hdr->Frame[0], ExposureTime, Shortest);
+   else
+      Accumulate(Hdr, &Hdr->Frame[0], ExposureTime, Shortest);
+
+   Hdr->Received |= (MIL_INT)1 << SetIndex;
+   if (Hdr->Received != ((MIL_INT)1 << Hdr->SetCount) - 1)
+      {
+      Hdr->MergeTime += MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) - StartTime;
+      return false;
+      }
+
+   /* Pixels without a usable exposure take the shortest one. */
+   for (size_t i = 0; i < Hdr->Radiance.size(); i++)
+      Hdr->Radiance[i] = (Hdr->Weight[i] > 0.0f) ? Hdr->Radiance[i]/Hdr->Weight[i] : Hdr->Fallback[i];
+   Hdr->Received = 0;
+   Hdr->MergedCount++;
+   Hdr->MergeTime += MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) - StartTime;
+   return true;
+   }
+
+/* Global Reinhard operator on the log-average radiance, with gamma. The */
+/* 8-bit mono result is copied, so MbufCopy() converts it to the type    */
+/* and bands of MilDestination.                                          */
+void HdrMergeToneMap(HdrMergeStruct* Hdr, MIL_ID MilDestination)
+   {
+   size_t Size = Hdr->Radiance.size();
+   MIL_UINT8 Gamma[HDR_GAMMA_LUT_SIZE];
+   MIL_DOUBLE LogSum = 0.0;
+   float Scale;
+
+   if (Size == 0 || Hdr->MilToneMapped == M_NULL)
+      return;
+
+   for (MIL_INT i = 0; i < HDR_GAMMA_LUT_SIZE; i++)
+      Gamma[i] = (MIL_UINT8)(255.0*pow((MIL_DOUBLE)i/(HDR_GAMMA_LUT_SIZE - 1), 1.0/HDR_GAMMA) + 0.5);
+   for (size_t i = 0; i < Size; i++)
+      LogSum += log(1e-6 + Hdr->Radiance[i]);
+   Scale = (float)(HDR_KEY_VALUE/exp(LogSum/Size));
+
+   for (size_t i = 0; i < Size; i++)
+      {
+      float Luminance = Scale*Hdr->Radiance[i];
+      Hdr->ToneMapped[i] = Gamma[(MIL_INT)((HDR_GAMMA_LUT_SIZE - 1)*Luminance/(1.0f + Luminance))];
+      }
+   MbufPut2d(Hdr->MilToneMapped, 0, 0, Hdr->SizeX, Hdr->SizeY, &Hdr->ToneMapped[0]);
+   MbufCopy(Hdr->MilToneMapped, MilDestination);
+   }
+
+void HdrMergeFree(HdrMergeStruct* Hdr)
+   {
+   if (Hdr->MilToneMapped)
+      MbufFree(Hdr->MilToneMapped);
+   Hdr->MilToneMapped = M_NULL;
+   }
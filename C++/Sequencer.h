@@ -0,0 +1,119 @@
+﻿/********************************************************************************/
+/*
+* File name: Sequencer.h
+*
+* Synopsis:  Per-frame camera settings (exposure time, gain and ROI offset)
+*            cycling through a list of sets, for exposure bracketing and
+*            multi-light inspection, with the merge of exposure brackets into
+*            a high dynamic range image.
+*
+*            When the camera implements the SFNC sequencer (SequencerMode,
+*            SequencerSetSelector, SequencerSetSave, SequencerSetNext), all the
+*            sets are programmed into it in one pass and the camera switches
+*            sets by itself on every FrameStart.
+*
+*            Otherwise the sequence is emulated on the host: a control thread
+*            writes the set of the next frame as soon as the current frame
+*            starts to arrive (its exposure is then over), ahead of the next
+*            trigger. Frames that started before the write of their set ended
+*            are counted as late and tagged with the set they were really
+*            exposed with. With a software trigger, SequencerWaitProgrammed()
+*            holds the trigger until the set is written.
+*
+*            Frames are tagged by their index in the acquisition, modulo the
+*            number of sets: the count of frames processed, plus the frames
+*            MIL missed in the previous MdigProcess() runs, which
+*            SequencerProcessStopped() adds up after each stop, since MIL
+*            restarts its count with every run.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+#ifndef SEQUENCER_H
+#define SEQUENCER_H
+
+#include <mil.h>
+#include <atomic>
+#include <vector>
+
+#define SEQUENCER_SET_MAX           16
+
+/* Settings of a set. */
+#define SEQUENCER_EXPOSURE          0x1
+#define SEQUENCER_GAIN              0x2
+#define SEQUENCER_OFFSET            0x4
+
+/* Sets actually used by the last frames of the emulation. */
+#define SEQUENCER_HISTORY_SIZE      64
+
+typedef struct
+   {
+   MIL_INT                  Settings;      /* SEQUENCER_xxx applied by the set. */
+   MIL_DOUBLE               ExposureTime;  /* us */
+   MIL_DOUBLE               Gain;          /* dB */
+   MIL_INT64                OffsetX;
+   MIL_INT64                OffsetY;
+   } SequencerSetStruct;
+
+typedef struct
+   {
+   MIL_ID                   MilDigitizer;
+   MIL_ID                   MilThread;
+   MIL_ID                   MilEvent;
+   std::atomic<bool>        StopRequested;
+   std::vector<SequencerSetStruct> Sets;
+   bool                     Hardware;
+   SequencerSetStruct       Original;      /* Camera settings before the start. */
+   MIL_STRING               PreviousExposureAuto;  /* Empty if not implemented. */
+   MIL_STRING               PreviousGainAuto;
+
+   /* Frames whose transfer started, and frame whose set is in the camera. */
+   std::atomic<MIL_UINT64>  StartedCount;
+   std::atomic<MIL_UINT64>  ProgrammedFrame;
+   std::atomic<MIL_INT>     FrameSet[SEQUENCER_HISTORY_SIZE];
+   MIL_UINT64               MissedBase;    /* Frames missed by the previous MdigProcess() runs. */
+
+   /* Statistics. */
+   MIL_DOUBLE               ProgramTime;   /* Hardware: the programming pass.   */
+   MIL_UINT64               WriteCount;    /* Emulation: sets written.          */
+   MIL_DOUBLE               WriteTime;
+   MIL_DOUBLE               WriteTimeMax;
+   std::atomic<MIL_UINT64>  LateCount;
+   MIL_UINT64               TaggedCount[SEQUENCER_SET_MAX];
+   } SequencerStruct;
+
+/* Merge of a bracket of exposures into one radiance image, tone-mapped */
+/* to 8 bits for the display.                                          */
+typedef struct
+   {
+   MIL_INT                  SizeX;
+   MIL_INT                  SizeY;
+   MIL_INT                  SizeBit;
+   MIL_INT                  SetCount;
+   MIL_INT                  Received;      /* Mask of the sets of the bracket. */
+   std::vector<MIL_UINT8>   Frame;
+   std::vector<float>       Radiance;
+   std::vector<float>       Weight;
+   std::vector<float>       Fallback;      /* Radiance of the shortest exposure. */
+   MIL_DOUBLE               FallbackExposure;
+   std::vector<MIL_UINT8>   ToneMapped;
+   MIL_ID                   MilToneMapped; /* 8-bit mono, copied to the destination. */
+   MIL_UINT64               MergedCount;
+   MIL_DOUBLE               MergeTime;
+   } HdrMergeStruct;
+
+/* Sequencer. Sets that the camera cannot apply make SequencerStart() fail. */
+bool    SequencerStart(MIL_ID MilSystem, MIL_ID MilDigitizer, const SequencerSetStruct* Sets, MIL_INT SetCount,
+                       bool AllowHardware, SequencerStruct* Sequencer);
+MIL_INT SequencerFrameSet(SequencerStruct* Sequencer, MIL_UINT64 FrameIndex);
+void    SequencerProcessStopped(SequencerStruct* Sequencer);
+bool    SequencerWaitProgrammed(SequencerStruct* Sequencer, MIL_DOUBLE Timeout);
+void    SequencerStop(SequencerStruct* Sequencer);
+
+/* HDR merge. HdrMergeAdd() returns true when the frame completes a bracket. */
+void HdrMergeInit(MIL_ID MilBuffer, MIL_INT SetCount, HdrMergeStruct* Hdr);
+bool HdrMergeAdd(HdrMergeStruct* Hdr, MIL_ID MilBuffer, MIL_INT SetIndex, MIL_DOUBLE ExposureTime);
+void HdrMergeToneMap(HdrMergeStruct* Hdr, MIL_ID MilDestination);
+void HdrMergeFree(HdrMergeStruct* Hdr);
+
+#endif
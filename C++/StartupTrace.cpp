@@ -0,0 +1,240 @@
+﻿/********************************************************************************/
+/*
+* File name: StartupTrace.cpp
+*
+* Synopsis:  Implementation of the start-up trace. See StartupTrace.h.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. */
+#include "StartupTrace.h"
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+typedef struct
+   {
+   char         Phase;      /* Chrome trace phase: 'B', 'E', 'X' or 'i'. */
+   MIL_STRING   Name;
+   const char*  Category;
+   const char*  Caller;
+   MIL_DOUBLE   Time;       /* Microseconds. */
+   MIL_DOUBLE   Duration;
+   MIL_UINT32   ThreadIndex;
+   } TraceEventStruct;
+
+typedef struct
+   {
+   atomic<bool>                      Active;
+   chrono::steady_clock::time_point  Origin;
+   MIL_STRING                        FileName;
+   mutex                             Lock;
+   vector<TraceEventStruct>          Events;
+   } TraceStateStruct;
+
+static TraceStateStruct Trace;
+
+/* Small per-thread index, in order of first use, used as the trace "tid". */
+static atomic<MIL_UINT32> NextThreadIndex(1);
+static thread_local MIL_UINT32 ThreadIndex = 0;
+
+static MIL_UINT32 CurrentThreadIndex()
+   {
+   if (ThreadIndex == 0)
+      ThreadIndex = NextThreadIndex++;
+   return ThreadIndex;
+   }
+
+static void AddEvent(char Phase, const MIL_TEXT_CHAR* Name, const char* Category, MIL_DOUBLE Time,
+                     MIL_DOUBLE Duration, const char* Caller)
+   {
+   TraceEventStruct Event;
+   Event.Phase = Phase;
+   Event.Name = Name;
+   Event.Category = Category;
+   Event.Caller = Caller;
+   Event.Time = Time;
+   Event.Duration = Duration;
+   Event.ThreadIndex = CurrentThreadIndex();
+
+   lock_guard<mutex> Guard(Trace.Lock);
+   Trace.Events.push_back(Event);
+   }
+
+/* Trace files are ASCII; other characters are replaced. */
+static void WriteJsonString(FILE* File, const MIL_STRING& Text)
+   {
+   fputc('"', File);
+   for (size_t i = 0; i < Text.size(); i++)
+      {
+      if (Text[i] == MIL_TEXT('"') || Text[i] == MIL_TEXT('\\'))
+         fputc('\\', File);
+      fputc((Text[i] >= 0x20 && Text[i] < 0x80) ? (char)Text[i] : '?', File);
+      }
+   fputc('"', File);
+   }
+
+static FILE* OpenFile(const MIL_TEXT_CHAR* FileName)
+   {
+   FILE* File = NULL;
+#if M_MIL_USE_WINDOWS
+   _wfopen_s(&File, FileName, L"wt");
+#else
+   File = fopen(FileName, "wt");
+#endif
+   return File;
+   }
+
+void StartupTraceStart(const MIL_TEXT_CHAR* FileName)
+   {
+   lock_guard<mutex> Guard(Trace.Lock);
+   Trace.FileName = FileName;
+   Trace.Events.clear();
+   Trace.Events.reserve(4096);
+   Trace.Origin = chrono::steady_clock::now();
+   CurrentThreadIndex();
+   Trace.Active.store(true);
+   }
+
+bool StartupTraceIsActive()
+   {
+   return Trace.Active.load(memory_order_relaxed);
+   }
+
+MIL_DOUBLE StartupTraceTime()
+   {
+   return chrono::duration<MIL_DOUBLE, micro>(chrono::steady_clock::now() - Trace.Origin).count();
+   }
+
+void StartupTraceBegin(const MIL_TEXT_CHAR* Name, const char* Category)
+   {
+   if (StartupTraceIsActive())
+      AddEvent('B', Name, Category, StartupTraceTime(), 0.0, M_NULL);
+   }
+
+void StartupTraceEnd()
+   {
+   if (StartupTraceIsActive())
+      AddEvent('E', MIL_TEXT(""), "", StartupTraceTime(), 0.0, M_NULL);
+   }
+
+void StartupTraceInstant(const MIL_TEXT_CHAR* Name)
+   {
+   if (StartupTraceIsActive())
+      AddEvent('i', Name, "mark", StartupTraceTime(), 0.0, M_NULL);
+   }
+
+void StartupTraceSpan(const MIL_TEXT_CHAR* Name, const char* Category, MIL_DOUBLE StartTime, MIL_DOUBLE EndTime,
+                      const char* Caller)
+   {
+   if (StartupTraceIsActive())
+      AddEvent('X', Name, Category, StartTime, EndTime - StartTime, Caller);
+   }
+
+void StartupTraceStop()
+   {
+   vector<MIL_STRING> PhaseNames;
+   vector<MIL_DOUBLE> PhaseDurations;
+   vector<MIL_STRING> OpenNames;
+   vector<MIL_DOUBLE> OpenTimes;
+   vector<bool> OpenPrompts;
+   MIL_DOUBLE PromptTime = 0.0, SpanTime = 0.0, EndTime;
+   MIL_UINT64 SpanCount = 0;
+   FILE* File;
+
+   if (!StartupTraceIsActive())
+      return;
+   EndTime = StartupTraceTime();
+   Trace.Active.store(false);
+
+   lock_guard<mutex> Guard(Trace.Lock);
+
+   File = OpenFile(Trace.FileName.c_str());
+   if (File)
+      {
+      fprintf(File, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+      fprintf(File, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"MilGige\"}}");
+      for (size_t i = 0; i < Trace.Events.size(); i++)
+         {
+         const TraceEventStruct& Event = Trace.Events[i];
+         fprintf(File, ",\n{\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%.3f", Event.Phase, Event.ThreadIndex, Event.Time);
+         if (Event.Phase != 'E')
+            {
+            fprintf(File, ",\"name\":");
+            WriteJsonString(File, Event.Name);
+            fprintf(File, ",\"cat\":\"%s\"", Event.Category);
+            }
+         if (Event.Phase == 'X')
+            fprintf(File, ",\"dur\":%.3f", Event.Duration);
+         if (Event.Phase == 'i')
+            fprintf(File, ",\"s\":\"p\"");
+         if (Event.Caller)
+            fprintf(File, ",\"args\":{\"caller\":\"%s\"}", Event.Caller);
+         fprintf(File, "}");
+         }
+      fprintf(File, "\n]}\n");
+      fclose(File);
+      }
+
+   /* Summarize the outermost phases of the first thread, the marks and the prompts. */
+   MosPrintf(MIL_TEXT("\n---------------------- Start-up trace ----------------------\n\n"));
+   for (size_t i = 0; i < Trace.Events.size(); i++)
+      {
+      const TraceEventStruct& Event = Trace.Events[i];
+      if (Event.Phase == 'X')
+         {
+         SpanCount++;
+         SpanTime += Event.Duration;
+         continue;
+         }
+      if (Event.Phase == 'i')
+         {
+         PhaseNames.push_back(Event.Name + MIL_TEXT(" reached at"));
+         PhaseDurations.push_back(Event.Time - PromptTime);
+         continue;
+         }
+      if (Event.ThreadIndex != 1)
+         continue;
+
+      if (Event.Phase == 'B')
+         {
+         OpenNames.push_back(Event.Name);
+         OpenTimes.push_back(Event.Time);
+         OpenPrompts.push_back(strcmp(Event.Category, STARTUP_TRACE_CATEGORY_PROMPT) == 0);
+         }
+      else if (Event.Phase == 'E' && !OpenNames.empty())
+         {
+         MIL_DOUBLE Duration = Event.Time - OpenTimes.back();
+         if (OpenPrompts.back())
+            PromptTime += Duration;
+         else if (OpenNames.size() == 1)
+            {
+            PhaseNames.push_back(OpenNames.back());
+            PhaseDurations.push_back(Duration);
+            }
+         OpenNames.pop_back();
+         OpenTimes.pop_back();
+         OpenPrompts.pop_back();
+         }
+      }
+
+   for (size_t i = 0; i < PhaseNames.size(); i++)
+      MosPrintf(MIL_TEXT("%36s: %9.1f ms\n"), PhaseNames[i].c_str(), PhaseDurations[i]/1000.0);
+   MosPrintf(MIL_TEXT("%36s: %9.1f ms (%llu accesses)\n"), MIL_TEXT("Feature accesses"), SpanTime/1000.0,
+             (unsigned long long)SpanCount);
+   MosPrintf(MIL_TEXT("%36s: %9.1f ms\n"), MIL_TEXT("Waiting for the user"), PromptTime/1000.0);
+   MosPrintf(MIL_TEXT("%36s: %9.1f ms\n"), MIL_TEXT("Traced time excluding prompts"), (EndTime - PromptTime)/1000.0);
+   if (File)
+      MosPrintf(MIL_TEXT("\nTrace written to %s.\n"), Trace.FileName.c_str());
+   else
+      MosPrintf(MIL_TEXT("\n%s could not be created.\n"), Trace.FileName.c_str());
+
+   Trace.Events.clear();
+   }
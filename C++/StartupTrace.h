@@ -0,0 +1,51 @@
+﻿/********************************************************************************/
+/*
+* File name: StartupTrace.h
+*
+* Synopsis:  Timeline of the program start-up, from MappAllocDefault to the
+*            first grabbed frame, written as a Chrome trace event file that
+*            can be opened in Perfetto (ui.perfetto.dev) or chrome://tracing.
+*
+*            Phases are recorded with StartupTraceBegin()/StartupTraceEnd()
+*            pairs, which may be nested. Feature accesses made while the trace
+*            is active are recorded as individual spans by the interposition
+*            layer in FeatureAccess.h, with the calling function as argument.
+*            All times are taken from a monotonic clock that does not depend
+*            on MIL, so the allocation of the MIL application itself can be
+*            timed.
+*
+*            Recording is off until StartupTraceStart() is called; the other
+*            functions then cost a single test.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+#ifndef STARTUP_TRACE_H
+#define STARTUP_TRACE_H
+
+#include <mil.h>
+
+/* Category of the spans spent waiting for the user. They are reported */
+/* separately and excluded from the start-up time.                     */
+#define STARTUP_TRACE_CATEGORY_PROMPT  "prompt"
+
+/* Starts recording. The trace is written to FileName by StartupTraceStop(). */
+void StartupTraceStart(const MIL_TEXT_CHAR* FileName);
+bool StartupTraceIsActive();
+
+/* Microseconds since StartupTraceStart(). */
+MIL_DOUBLE StartupTraceTime();
+
+/* Phases and events of the calling thread. */
+void StartupTraceBegin(const MIL_TEXT_CHAR* Name, const char* Category);
+void StartupTraceEnd();
+void StartupTraceInstant(const MIL_TEXT_CHAR* Name);
+
+/* Completed span; used by the feature access layer. Caller may be M_NULL. */
+void StartupTraceSpan(const MIL_TEXT_CHAR* Name, const char* Category, MIL_DOUBLE StartTime, MIL_DOUBLE EndTime,
+                      const char* Caller);
+
+/* Stops recording, writes the trace file and prints a summary of the phases. */
+void StartupTraceStop();
+
+#endif
@@ -0,0 +1,533 @@
+﻿/********************************************************************************/
+/*
+* File name: StreamCapture.cpp
+*
+* Synopsis:  Implementation of the stream capture and replay. See StreamCapture.h.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. */
+#include "StreamCapture.h"
+#include <string.h>
+#include <chrono>
+
+using namespace std;
+
+/* pcap file format constants. */
+#define PCAP_MAGIC                  0xA1B2C3D4U
+#define PCAP_MAGIC_SWAPPED          0xD4C3B2A1U
+#define PCAP_VERSION_MAJOR          2
+#define PCAP_VERSION_MINOR          4
+#define PCAP_SNAPLEN                65535
+#define PCAP_LINKTYPE_USER0         147
+#define PCAP_FILE_HEADER_SIZE       24
+#define PCAP_RECORD_HEADER_SIZE     16
+#define PSEUDO_HEADER_SIZE          4
+
+/* Largest frame accepted by the replay. */
+#define REPLAY_FRAME_SIZE_MAX       ((MIL_INT64)1 << 28)
+
+/* GVSP constants (GigE Vision 1.x standard packet layout). */
+#define GVSP_HEADER_SIZE            8
+#define GVSP_FORMAT_LEADER          1
+#define GVSP_FORMAT_TRAILER         2
+#define GVSP_FORMAT_PAYLOAD         3
+#define GVSP_PAYLOAD_TYPE_IMAGE     0x0001
+#define GVSP_LEADER_SIZE            (GVSP_HEADER_SIZE + 36)
+#define GVSP_TRAILER_SIZE           (GVSP_HEADER_SIZE + 8)
+
+/* Bytes of IP, UDP and GVSP headers inside a stream channel packet. */
+#define GVSP_PACKET_OVERHEAD        (20 + 8 + GVSP_HEADER_SIZE)
+#define DEFAULT_STREAM_PACKET_SIZE  1500
+
+/* PFNC pixel formats used for the grab buffers of this example. */
+#define PFNC_MONO8                  0x01080001U
+#define PFNC_MONO16                 0x01100007U
+#define PFNC_RGB8_PLANAR            0x02180021U
+
+static void PutBE16(MIL_UINT8* Ptr, MIL_UINT32 Value)
+   {
+   Ptr[0] = (MIL_UINT8)(Value >> 8);
+   Ptr[1] = (MIL_UINT8)(Value);
+   }
+
+static void PutBE32(MIL_UINT8* Ptr, MIL_UINT32 Value)
+   {
+   Ptr[0] = (MIL_UINT8)(Value >> 24);
+   Ptr[1] = (MIL_UINT8)(Value >> 16);
+   Ptr[2] = (MIL_UINT8)(Value >> 8);
+   Ptr[3] = (MIL_UINT8)(Value);
+   }
+
+static MIL_UINT32 GetBE16(const MIL_UINT8* Ptr)
+   {
+   return ((MIL_UINT32)Ptr[0] << 8) | Ptr[1];
+   }
+
+static MIL_UINT32 GetBE32(const MIL_UINT8* Ptr)
+   {
+   return ((MIL_UINT32)Ptr[0] << 24) | ((MIL_UINT32)Ptr[1] << 16) | ((MIL_UINT32)Ptr[2] << 8) | Ptr[3];
+   }
+
+static MIL_UINT32 Swap32(MIL_UINT32 Value)
+   {
+   return (Value >> 24) | ((Value >> 8) & 0xFF00) | ((Value << 8) & 0xFF0000) | (Value << 24);
+   }
+
+static FILE* OpenFile(const MIL_TEXT_CHAR* FileName, bool Write)
+   {
+   FILE* File = NULL;
+#if M_MIL_USE_WINDOWS
+   _wfopen_s(&File, FileName, Write ? L"wb" : L"rb");
+#else
+   File = fopen(FileName, Write ? "wb" : "rb");
+#endif
+   return File;
+   }
+
+/* Fills the 8-byte GVSP header. Block ID 0 is reserved by the standard. */
+static void PutGvspHeader(MIL_UINT8* Ptr, MIL_UINT64 BlockId, MIL_UINT32 Format, MIL_UINT32 PacketId)
+   {
+   PutBE16(Ptr, 0);
+   PutBE16(Ptr + 2, (MIL_UINT32)((BlockId - 1) % 0xFFFF) + 1);
+   Ptr[4] = (MIL_UINT8)(Format & 0x0F);
+   Ptr[5] = (MIL_UINT8)(PacketId >> 16);
+   Ptr[6] = (MIL_UINT8)(PacketId >> 8);
+   Ptr[7] = (MIL_UINT8)(PacketId);
+   }
+
+/* Returns the character as ASCII, '?' if it is not. */
+static MIL_UINT8 AsciiByte(MIL_TEXT_CHAR Char)
+   {
+   return ((MIL_UINT32)Char < 0x80) ? (MIL_UINT8)Char : (MIL_UINT8)'?';
+   }
+
+/* Writes one pcap record made of the pseudo-header followed by Size bytes of Data. */
+/* The record time is the wall-clock time of TimeStamp, a MappTimer() reading.    */
+static void WriteRecord(StreamCaptureStruct* Capture, MIL_DOUBLE TimeStamp, MIL_UINT8 Kind,
+                        const MIL_UINT8* Data, MIL_INT64 Size)
+   {
+   MIL_DOUBLE Elapsed = TimeStamp - Capture->StartTime;
+   MIL_INT64 WallTimeUs;
+   MIL_UINT32 RecordHeader[4];
+   MIL_UINT8 PseudoHeader[PSEUDO_HEADER_SIZE] = {Kind, 0, 0, 0};
+
+   if (Elapsed < 0)
+      Elapsed = 0;
+   WallTimeUs = Capture->StartWallTimeUs + (MIL_INT64)(Elapsed*1000000.0);
+
+   RecordHeader[0] = (MIL_UINT32)(WallTimeUs/1000000);
+   RecordHeader[1] = (MIL_UINT32)(WallTimeUs%1000000);
+   RecordHeader[2] = (MIL_UINT32)(Size + PSEUDO_HEADER_SIZE);
+   RecordHeader[3] = RecordHeader[2];
+
+   if (fwrite(RecordHeader, sizeof(RecordHeader), 1, Capture->File) != 1 ||
+       fwrite(PseudoHeader, sizeof(PseudoHeader), 1, Capture->File) != 1 ||
+       fwrite(Data, (size_t)Size, 1, Capture->File) != 1)
+      Capture->WriteError = true;
+   Capture->BytesWritten += PCAP_RECORD_HEADER_SIZE + PSEUDO_HEADER_SIZE + Size;
+   }
+
+/* Regenerates and writes the leader, payload and trailer packets of a queued block. */
+static void WriteFrame(StreamCaptureStruct* Capture, const StreamCaptureSlotStruct* Slot)
+   {
+   MIL_INT64 DataSize = (MIL_INT64)Slot->Data.size();
+   MIL_UINT64 TimeStampNs = (MIL_UINT64)((Slot->TimeStamp - Capture->StartTime)*1e9);
+   MIL_UINT32 PacketId = 0;
+   MIL_UINT8 Leader[GVSP_LEADER_SIZE];
+   MIL_UINT8 Trailer[GVSP_TRAILER_SIZE];
+   MIL_UINT8* Packet = &Capture->Packet[0];
+
+   /* Leader. */
+   memset(Leader, 0, sizeof(Leader));
+   PutGvspHeader(Leader, Slot->BlockId, GVSP_FORMAT_LEADER, PacketId++);
+   PutBE16(Leader + GVSP_HEADER_SIZE + 2, GVSP_PAYLOAD_TYPE_IMAGE);
+   PutBE32(Leader + GVSP_HEADER_SIZE + 4, (MIL_UINT32)(TimeStampNs >> 32));
+   PutBE32(Leader + GVSP_HEADER_SIZE + 8, (MIL_UINT32)(TimeStampNs));
+   PutBE32(Leader + GVSP_HEADER_SIZE + 12, Slot->PixelFormat);
+   PutBE32(Leader + GVSP_HEADER_SIZE + 16, (MIL_UINT32)Slot->SizeX);
+   PutBE32(Leader + GVSP_HEADER_SIZE + 20, (MIL_UINT32)Slot->SizeY);
+   WriteRecord(Capture, Slot->TimeStamp, STREAM_RECORD_GVSP, Leader, sizeof(Leader));
+
+   /* Payload. */
+   for (MIL_INT64 Offset = 0; Offset < DataSize; Offset += Capture->PayloadPacketSizeByte)
+      {
+      MIL_INT64 Size = DataSize - Offset;
+      if (Size > Capture->PayloadPacketSizeByte)
+         Size = Capture->PayloadPacketSizeByte;
+
+      PutGvspHeader(Packet, Slot->BlockId, GVSP_FORMAT_PAYLOAD, PacketId++);
+      memcpy(Packet + GVSP_HEADER_SIZE, &Slot->Data[(size_t)Offset], (size_t)Size);
+      WriteRecord(Capture, Slot->TimeStamp, STREAM_RECORD_GVSP, Packet, GVSP_HEADER_SIZE + Size);
+      }
+
+   /* Trailer. */
+   memset(Trailer, 0, sizeof(Trailer));
+   PutGvspHeader(Trailer, Slot->BlockId, GVSP_FORMAT_TRAILER, PacketId++);
+   PutBE16(Trailer + GVSP_HEADER_SIZE + 2, GVSP_PAYLOAD_TYPE_IMAGE);
+   PutBE32(Trailer + GVSP_HEADER_SIZE + 4, (MIL_UINT32)Slot->SizeY);
+   WriteRecord(Capture, Slot->TimeStamp, STREAM_RECORD_GVSP, Trailer, sizeof(Trailer));
+
+   Capture->PacketsWritten += PacketId;
+   Capture->FramesWritten++;
+   }
+
+/* Writes the queued records, in queue order, until the capture is closed. */
+static MIL_UINT32 MFTYPE WriterThread(void* ThreadContext)
+   {
+   StreamCaptureStruct* Capture = (StreamCaptureStruct*)ThreadContext;
+
+   for (;;)
+      {
+      StreamCaptureSlotStruct* Slot;
+         {
+         unique_lock<mutex> Guard(Capture->SlotLock);
+         for (;;)
+            {
+            Slot = &Capture->Slots[Capture->WrittenCount % Capture->SlotCount];
+            if (Capture->WrittenCount != Capture->QueuedCount && Slot->Ready.load())
+               break;
+            if (Capture->Stopping && Capture->WrittenCount == Capture->QueuedCount)
+               return 0;
+            Capture->Wake.wait(Guard);
+            }
+         }
+
+      if (Slot->Kind == STREAM_RECORD_GVSP)
+         WriteFrame(Capture, Slot);
+      else
+         {
+         WriteRecord(Capture, Slot->TimeStamp, Slot->Kind, &Slot->Data[0], (MIL_INT64)Slot->Data.size());
+         Capture->ControlsWritten++;
+         }
+      Slot->Ready.store(false);
+
+         {
+         lock_guard<mutex> Guard(Capture->SlotLock);
+         Capture->WrittenCount++;
+         }
+      Capture->Space.notify_all();
+      }
+   }
+
+/* Reserves the next slot, waiting for the writer if Wait, and returns it; */
+/* returns NULL if the slots are all in use and Wait is false.             */
+static StreamCaptureSlotStruct* ReserveSlot(StreamCaptureStruct* Capture, bool Wait)
+   {
+   unique_lock<mutex> Guard(Capture->SlotLock);
+
+   while (Capture->QueuedCount - Capture->WrittenCount >= (MIL_UINT64)Capture->SlotCount)
+      {
+      if (!Wait)
+         {
+         Capture->DroppedCount++;
+         return NULL;
+         }
+      Capture->Space.wait(Guard);
+      }
+   return &Capture->Slots[Capture->QueuedCount++ % Capture->SlotCount];
+   }
+
+/* Hands a filled slot to the writer thread. */
+static void QueueSlot(StreamCaptureStruct* Capture, StreamCaptureSlotStruct* Slot)
+   {
+      {
+      lock_guard<mutex> Guard(Capture->SlotLock);
+      Slot->Ready.store(true);
+      }
+   Capture->Wake.notify_one();
+   }
+
+/* Creates the capture file and starts its writer thread. */
+bool StreamCaptureOpen(MIL_ID MilSystem, const MIL_TEXT_CHAR* FileName, MIL_INT64 StreamPacketSizeByte,
+                       MIL_INT64 FrameSizeByte, MIL_INT SlotCount, StreamCaptureStruct* Capture)
+   {
+   MIL_UINT32 FileHeader[6];
+
+   Capture->Slots = NULL;
+   Capture->MilThread = M_NULL;
+   Capture->File = NULL;
+   if (SlotCount <= 0)
+      return false;
+
+   Capture->File = OpenFile(FileName, true);
+   if (Capture->File == NULL)
+      return false;
+
+   /* Large stdio buffer so that a frame is written in a few system calls. */
+   setvbuf(Capture->File, NULL, _IOFBF, 4*1024*1024);
+
+   if (StreamPacketSizeByte <= GVSP_PACKET_OVERHEAD)
+      StreamPacketSizeByte = DEFAULT_STREAM_PACKET_SIZE;
+
+   Capture->StartTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+   Capture->StartWallTimeUs = (MIL_INT64)chrono::duration_cast<chrono::microseconds>(
+                                 chrono::system_clock::now().time_since_epoch()).count();
+   Capture->PayloadPacketSizeByte = StreamPacketSizeByte - GVSP_PACKET_OVERHEAD;
+   Capture->Packet.assign((size_t)(GVSP_HEADER_SIZE + Capture->PayloadPacketSizeByte), 0);
+   Capture->FramesWritten = 0;
+   Capture->PacketsWritten = 0;
+   Capture->ControlsWritten = 0;
+   Capture->BytesWritten = 0;
+   Capture->WriteError = false;
+
+   FileHeader[0] = PCAP_MAGIC;
+   FileHeader[1] = PCAP_VERSION_MAJOR | (PCAP_VERSION_MINOR << 16);
+   FileHeader[2] = 0;
+   FileHeader[3] = 0;
+   FileHeader[4] = PCAP_SNAPLEN;
+   FileHeader[5] = PCAP_LINKTYPE_USER0;
+   Capture->WriteError = (fwrite(FileHeader, sizeof(FileHeader), 1, Capture->File) != 1);
+   Capture->BytesWritten = PCAP_FILE_HEADER_SIZE;
+
+   /* Slots sized for a frame, so that the processing function does not allocate. */
+   Capture->Slots = new StreamCaptureSlotStruct[SlotCount];
+   Capture->SlotCount = SlotCount;
+   for (MIL_INT i = 0; i < SlotCount; i++)
+      {
+      Capture->Slots[i].Data.reserve((size_t)FrameSizeByte);
+      Capture->Slots[i].Ready.store(false);
+      }
+   Capture->QueuedCount = 0;
+   Capture->WrittenCount = 0;
+   Capture->DroppedCount = 0;
+   Capture->Stopping = false;
+
+   MthrAlloc(MilSystem, M_THREAD, M_DEFAULT, &WriterThread, Capture, &Capture->MilThread);
+   if (Capture->MilThread == M_NULL)
+      {
+      fclose(Capture->File);
+      Capture->File = NULL;
+      delete [] Capture->Slots;
+      Capture->Slots = NULL;
+      return false;
+      }
+   return true;
+   }
+
+/* Copies a grabbed block into a free slot for the writer thread. Returns false */
+/* if the frame was dropped.                                                    */
+bool StreamCaptureFrame(StreamCaptureStruct* Capture, MIL_ID MilBuffer, MIL_UINT64 BlockId, MIL_DOUBLE TimeStamp)
+   {
+   StreamCaptureSlotStruct* Slot;
+   MIL_INT64 SizeBit, SizeBand;
+
+   if (Capture->File == NULL || (Slot = ReserveSlot(Capture, false)) == NULL)
+      return false;
+
+   Slot->Kind = STREAM_RECORD_GVSP;
+   Slot->BlockId = BlockId;
+   Slot->TimeStamp = TimeStamp;
+   Slot->SizeX = MbufInquire(MilBuffer, M_SIZE_X, M_NULL);
+   Slot->SizeY = MbufInquire(MilBuffer, M_SIZE_Y, M_NULL);
+   SizeBit = MbufInquire(MilBuffer, M_SIZE_BIT, M_NULL);
+   SizeBand = MbufInquire(MilBuffer, M_SIZE_BAND, M_NULL);
+
+   if (SizeBand == 3)
+      Slot->PixelFormat = PFNC_RGB8_PLANAR;
+   else
+      Slot->PixelFormat = (SizeBit > 8) ? PFNC_MONO16 : PFNC_MONO8;
+
+   Slot->Data.resize((size_t)(Slot->SizeX*Slot->SizeY*SizeBand*((SizeBit + 7)/8)));
+   MbufGet(MilBuffer, &Slot->Data[0]);
+   QueueSlot(Capture, Slot);
+   return true;
+   }
+
+/* Records a control transaction as "<Type><FeatureName>\0<Value>\0". */
+void StreamCaptureTransaction(void* DataPtr, MIL_TEXT_CHAR Type, const MIL_TEXT_CHAR* FeatureName,
+                              const MIL_TEXT_CHAR* Value, MIL_DOUBLE TimeStamp)
+   {
+   StreamCaptureStruct* Capture = (StreamCaptureStruct*)DataPtr;
+   StreamCaptureSlotStruct* Slot;
+
+   if (Capture->File == NULL)
+      return;
+
+   Slot = ReserveSlot(Capture, true);
+   Slot->Kind = STREAM_RECORD_CONTROL;
+   Slot->TimeStamp = TimeStamp;
+   Slot->Data.clear();
+   Slot->Data.push_back(AsciiByte(Type));
+   for (const MIL_TEXT_CHAR* Ptr = FeatureName; Ptr && *Ptr; Ptr++)
+      Slot->Data.push_back(AsciiByte(*Ptr));
+   Slot->Data.push_back(0);
+   for (const MIL_TEXT_CHAR* Ptr = Value; Ptr && *Ptr; Ptr++)
+      Slot->Data.push_back(AsciiByte(*Ptr));
+   Slot->Data.push_back(0);
+
+   /* Keep the record within the snapshot length of the file. */
+   if (Slot->Data.size() > PCAP_SNAPLEN - PSEUDO_HEADER_SIZE)
+      {
+      Slot->Data.resize(PCAP_SNAPLEN - PSEUDO_HEADER_SIZE);
+      Slot->Data.back() = 0;
+      }
+   QueueSlot(Capture, Slot);
+   }
+
+void StreamCaptureControl(StreamCaptureStruct* Capture, MIL_TEXT_CHAR Type, const MIL_TEXT_CHAR* FeatureName,
+                          const MIL_TEXT_CHAR* Value)
+   {
+   StreamCaptureTransaction(Capture, Type, FeatureName, Value, MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL));
+   }
+
+/* Writes the records still queued, closes the capture file and prints a summary. */
+void StreamCaptureClose(StreamCaptureStruct* Capture)
+   {
+   if (Capture->File == NULL)
+      return;
+
+   unique_lock<mutex> Guard(Capture->SlotLock);
+   Capture->Stopping = true;
+   Guard.unlock();
+   Capture->Wake.notify_all();
+   MthrWait(Capture->MilThread, M_THREAD_END_WAIT, M_NULL);
+   MthrFree(Capture->MilThread);
+   Capture->MilThread = M_NULL;
+
+   if (fclose(Capture->File) != 0)
+      Capture->WriteError = true;
+   Capture->File = NULL;
+   delete [] Capture->Slots;
+   Capture->Slots = NULL;
+
+   MosPrintf(MIL_TEXT("\n---------------------- Stream capture ----------------------\n\n"));
+   MosPrintf(MIL_TEXT("%30s %llu\n"), MIL_TEXT("Frames captured:"), (unsigned long long)Capture->FramesWritten);
+   MosPrintf(MIL_TEXT("%30s %llu\n"), MIL_TEXT("Frames dropped:"), (unsigned long long)Capture->DroppedCount);
+   MosPrintf(MIL_TEXT("%30s %llu\n"), MIL_TEXT("Stream packets:"), (unsigned long long)Capture->PacketsWritten);
+   MosPrintf(MIL_TEXT("%30s %llu\n"), MIL_TEXT("Control transactions:"), (unsigned long long)Capture->ControlsWritten);
+   MosPrintf(MIL_TEXT("%30s %.1f MB%s\n"), MIL_TEXT("File size:"), Capture->BytesWritten/(1024.0*1024.0),
+             Capture->WriteError ? MIL_TEXT(" (write error)") : MIL_TEXT(""));
+   }
+
+/* Opens a capture file and validates its header. */
+bool StreamReplayOpen(const MIL_TEXT_CHAR* FileName, StreamReplayStruct* Replay)
+   {
+   MIL_UINT32 FileHeader[6];
+
+   Replay->FirstRecordTime = -1.0;
+   Replay->FramesRead = 0;
+   Replay->IncompleteFrames = 0;
+   Replay->ControlsRead = 0;
+   Replay->File = OpenFile(FileName, false);
+   if (Replay->File == NULL)
+      return false;
+
+   setvbuf(Replay->File, NULL, _IOFBF, 4*1024*1024);
+
+   if (fread(FileHeader, sizeof(FileHeader), 1, Replay->File) != 1 ||
+       (FileHeader[0] != PCAP_MAGIC && FileHeader[0] != PCAP_MAGIC_SWAPPED))
+      {
+      StreamReplayClose(Replay);
+      return false;
+      }
+
+   Replay->Swapped = (FileHeader[0] == PCAP_MAGIC_SWAPPED);
+   if ((Replay->Swapped ? Swap32(FileHeader[5]) : FileHeader[5]) != PCAP_LINKTYPE_USER0)
+      {
+      StreamReplayClose(Replay);
+      return false;
+      }
+   return true;
+   }
+
+/* Reads records until the trailer of the next complete frame. Control */
+/* transactions encountered on the way are counted.                    */
+MIL_INT StreamReplayNextFrame(StreamReplayStruct* Replay, StreamReplayFrameStruct* Frame)
+   {
+   MIL_UINT32 RecordHeader[4];
+   bool InFrame = false;
+   MIL_INT64 Received = 0;
+   MIL_UINT32 CurrentBlock = 0;
+
+   if (Replay->File == NULL)
+      return STREAM_REPLAY_ERROR;
+
+   while (fread(RecordHeader, sizeof(RecordHeader), 1, Replay->File) == 1)
+      {
+      if (Replay->Swapped)
+         for (size_t i = 0; i < 4; i++)
+            RecordHeader[i] = Swap32(RecordHeader[i]);
+
+      MIL_UINT32 Size = RecordHeader[2];
+      if (Size < PSEUDO_HEADER_SIZE || Size > PCAP_SNAPLEN)
+         return STREAM_REPLAY_ERROR;
+      Replay->Record.resize(Size);
+      if (fread(&Replay->Record[0], Size, 1, Replay->File) != 1)
+         return STREAM_REPLAY_ERROR;
+
+      MIL_DOUBLE RecordTime = RecordHeader[0] + RecordHeader[1]/1000000.0;
+      if (Replay->FirstRecordTime < 0)
+         Replay->FirstRecordTime = RecordTime;
+
+      const MIL_UINT8* Data = &Replay->Record[PSEUDO_HEADER_SIZE];
+      MIL_INT64 DataSize = Size - PSEUDO_HEADER_SIZE;
+
+      if (Replay->Record[0] == STREAM_RECORD_CONTROL)
+         {
+         Replay->ControlsRead++;
+         continue;
+         }
+      if (Replay->Record[0] != STREAM_RECORD_GVSP || DataSize < GVSP_HEADER_SIZE)
+         continue;
+
+      MIL_UINT32 BlockId = GetBE16(Data + 2);
+      MIL_UINT32 Format = Data[4] & 0x0F;
+
+      if (Format == GVSP_FORMAT_LEADER && DataSize >= GVSP_LEADER_SIZE)
+         {
+         if (InFrame)
+            Replay->IncompleteFrames++;
+
+         InFrame = true;
+         Received = 0;
+         CurrentBlock = BlockId;
+         Frame->BlockId = BlockId;
+         Frame->PixelFormat = GetBE32(Data + GVSP_HEADER_SIZE + 12);
+         Frame->SizeX = GetBE32(Data + GVSP_HEADER_SIZE + 16);
+         Frame->SizeY = GetBE32(Data + GVSP_HEADER_SIZE + 20);
+         Frame->SizeBit = (Frame->PixelFormat == PFNC_MONO16) ? 16 : 8;
+         Frame->SizeBand = (Frame->PixelFormat == PFNC_RGB8_PLANAR) ? 3 : 1;
+         Frame->RecordTime = RecordTime - Replay->FirstRecordTime;
+
+         /* Sizes from a 32-bit field each; their product is bounded before use. */
+         if (Frame->SizeX > REPLAY_FRAME_SIZE_MAX || Frame->SizeY > REPLAY_FRAME_SIZE_MAX ||
+             Frame->SizeX*Frame->SizeY*Frame->SizeBand*(Frame->SizeBit/8) > REPLAY_FRAME_SIZE_MAX)
+            return STREAM_REPLAY_ERROR;
+         Frame->Data.resize((size_t)(Frame->SizeX*Frame->SizeY*Frame->SizeBand*(Frame->SizeBit/8)));
+         }
+      else if (Format == GVSP_FORMAT_PAYLOAD && InFrame && BlockId == CurrentBlock)
+         {
+         MIL_INT64 Copy = DataSize - GVSP_HEADER_SIZE;
+         if (Received + Copy > (MIL_INT64)Frame->Data.size())
+            Copy = (MIL_INT64)Frame->Data.size() - Received;
+         if (Copy > 0)
+            memcpy(&Frame->Data[(size_t)Received], Data + GVSP_HEADER_SIZE, (size_t)Copy);
+         Received += Copy;
+         }
+      else if (Format == GVSP_FORMAT_TRAILER && InFrame && BlockId == CurrentBlock)
+         {
+         InFrame = false;
+         if (Received == (MIL_INT64)Frame->Data.size())
+            {
+            Replay->FramesRead++;
+            return STREAM_REPLAY_FRAME;
+            }
+         Replay->IncompleteFrames++;
+         }
+      }
+
+   if (InFrame)
+      Replay->IncompleteFrames++;
+   return STREAM_REPLAY_END;
+   }
+
+/* Closes the capture file. */
+void StreamReplayClose(StreamReplayStruct* Replay)
+   {
+   if (Replay->File)
+      fclose(Replay->File);
+   Replay->File = NULL;
+   }
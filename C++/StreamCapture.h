@@ -0,0 +1,141 @@
+﻿/********************************************************************************/
+/*
+* File name: StreamCapture.h
+*
+* Synopsis:  Capture of the acquisition stream to a pcap-style file and replay
+*            of that file into the frame processing path.
+*
+*            The Matrox Driver for GigE Vision reassembles the GVSP packets of a
+*            block before handing the buffer to the application, so the capture
+*            regenerates them from the grabbed block: a GVSP leader, payload
+*            packets of the camera's stream channel packet size and a trailer.
+*            Control transactions issued by the application are recorded in the
+*            same file, interleaved in time order: every feature read, write
+*            and execute made through the feature access layer while the
+*            capture is its transaction recorder (StreamCaptureTransaction(),
+*            see FeatureAccess.h), and those passed to StreamCaptureControl().
+*            Every record carries the host
+*            wall-clock time at which it was seen, which the replay uses to
+*            reproduce the original timing.
+*
+*            The file uses the classic libpcap format with the LINKTYPE_USER0
+*            link type. Each record starts with a 4-byte pseudo-header whose
+*            first byte is the record kind (STREAM_RECORD_xxx).
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+#ifndef STREAM_CAPTURE_H
+#define STREAM_CAPTURE_H
+
+#include <mil.h>
+#include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+/* Record kinds. */
+#define STREAM_RECORD_GVSP          1
+#define STREAM_RECORD_CONTROL       2
+
+/* Control transaction types. */
+#define STREAM_CONTROL_READ         MIL_TEXT('R')
+#define STREAM_CONTROL_WRITE        MIL_TEXT('W')
+#define STREAM_CONTROL_EXECUTE      MIL_TEXT('X')
+
+/* Return values of StreamReplayNextFrame(). */
+#define STREAM_REPLAY_FRAME         0
+#define STREAM_REPLAY_END           1
+#define STREAM_REPLAY_ERROR         2
+
+/* Record queued for the writer thread: a grabbed block or a control transaction. */
+typedef struct
+   {
+   MIL_UINT8               Kind;         /* STREAM_RECORD_xxx. */
+   MIL_UINT64              BlockId;
+   MIL_DOUBLE              TimeStamp;
+   MIL_INT64               SizeX;
+   MIL_INT64               SizeY;
+   MIL_UINT32              PixelFormat;
+   std::vector<MIL_UINT8>  Data;         /* Block, or control payload. */
+   std::atomic<bool>       Ready;        /* Filled by its producer.    */
+   } StreamCaptureSlotStruct;
+
+/* Capture file being written. The processing function and the control */
+/* transactions only copy their data into a slot; a writer thread       */
+/* packetizes the blocks and writes the records in the order queued.    */
+typedef struct
+   {
+   FILE*                    File;
+   MIL_DOUBLE               StartTime;
+   MIL_INT64                StartWallTimeUs;  /* Microseconds since the epoch at StartTime. */
+   MIL_INT64                PayloadPacketSizeByte;
+   std::vector<MIL_UINT8>   Packet;
+
+   StreamCaptureSlotStruct* Slots;
+   MIL_INT                  SlotCount;
+   std::mutex               SlotLock;     /* Protects the counts and Stopping. */
+   std::condition_variable  Wake;         /* A slot is ready to be written.    */
+   std::condition_variable  Space;        /* A slot was written.               */
+   MIL_UINT64               QueuedCount;
+   MIL_UINT64               WrittenCount;
+   MIL_UINT64               DroppedCount;
+   bool                     Stopping;
+   MIL_ID                   MilThread;
+
+   /* Statistics, updated by the writer thread. */
+   MIL_UINT64               FramesWritten;
+   MIL_UINT64               PacketsWritten;
+   MIL_UINT64               ControlsWritten;
+   MIL_UINT64               BytesWritten;
+   bool                     WriteError;
+   } StreamCaptureStruct;
+
+/* Frame reassembled from a capture file. */
+typedef struct
+   {
+   MIL_UINT64              BlockId;
+   MIL_UINT32              PixelFormat;
+   MIL_INT64               SizeX;
+   MIL_INT64               SizeY;
+   MIL_INT64               SizeBit;
+   MIL_INT64               SizeBand;
+   MIL_DOUBLE              RecordTime;   /* Seconds since the start of the capture. */
+   std::vector<MIL_UINT8>  Data;
+   } StreamReplayFrameStruct;
+
+/* Capture file being read. */
+typedef struct
+   {
+   FILE*                   File;
+   bool                    Swapped;
+   MIL_DOUBLE              FirstRecordTime;
+   std::vector<MIL_UINT8>  Record;
+   MIL_UINT64              FramesRead;
+   MIL_UINT64              IncompleteFrames;
+   MIL_UINT64              ControlsRead;
+   } StreamReplayStruct;
+
+/* Capture. StreamPacketSizeByte is the camera's GevSCPSPacketSize; SlotCount */
+/* records of up to FrameSizeByte bytes are queued at most. When all the slots */
+/* are in use, StreamCaptureFrame() drops the frame and counts it, while       */
+/* StreamCaptureControl() waits for the writer.                                */
+bool StreamCaptureOpen(MIL_ID MilSystem, const MIL_TEXT_CHAR* FileName, MIL_INT64 StreamPacketSizeByte,
+                       MIL_INT64 FrameSizeByte, MIL_INT SlotCount, StreamCaptureStruct* Capture);
+bool StreamCaptureFrame(StreamCaptureStruct* Capture, MIL_ID MilBuffer, MIL_UINT64 BlockId, MIL_DOUBLE TimeStamp);
+void StreamCaptureControl(StreamCaptureStruct* Capture, MIL_TEXT_CHAR Type, const MIL_TEXT_CHAR* FeatureName,
+                          const MIL_TEXT_CHAR* Value);
+
+/* Transaction recorder of the feature access layer, with the capture as */
+/* DataPtr: records the transaction at TimeStamp and makes no MIL call.  */
+void StreamCaptureTransaction(void* DataPtr, MIL_TEXT_CHAR Type, const MIL_TEXT_CHAR* FeatureName,
+                              const MIL_TEXT_CHAR* Value, MIL_DOUBLE TimeStamp);
+void StreamCaptureClose(StreamCaptureStruct* Capture);
+
+/* Replay. */
+bool    StreamReplayOpen(const MIL_TEXT_CHAR* FileName, StreamReplayStruct* Replay);
+MIL_INT StreamReplayNextFrame(StreamReplayStruct* Replay, StreamReplayFrameStruct* Frame);
+void    StreamReplayClose(StreamReplayStruct* Replay);
+
+#endif
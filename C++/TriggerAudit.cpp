@@ -0,0 +1,404 @@
+﻿/********************************************************************************/
+/*
+* File name: TriggerAudit.cpp
+*
+* Synopsis:  Implementation of the missed-trigger diagnostics.
+*            See TriggerAudit.h.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. */
+#include "TriggerAudit.h"
+#include <functional>
+#include <vector>
+#include "FeatureAsync.h"
+#include "FeatureAccess.h"
+
+using namespace std;
+
+/* Event sources of the counters. */
+#define TRIGGER_AUDIT_EXPOSURE_SOURCE  MIL_TEXT("ExposureStart")
+
+static const MIL_TEXT_CHAR* const LossNames[TRIGGER_AUDIT_LOSS_COUNT] =
+   {
+   MIL_TEXT("Missed triggers"),
+   MIL_TEXT("Overtriggers"),
+   MIL_TEXT("Not exposed"),
+   MIL_TEXT("Transport drops"),
+   MIL_TEXT("Host misses"),
+   MIL_TEXT("Corrupted frames"),
+   };
+
+static const MIL_TEXT_CHAR* const CounterNames[TRIGGER_AUDIT_COUNTER_COUNT] =
+   {
+   MIL_TEXT("Triggers accepted"),
+   MIL_TEXT("Trigger line edges"),
+   MIL_TEXT("Exposures"),
+   MIL_TEXT("Triggers ignored"),
+   };
+
+/* Gives the selected camera counter back the settings it had. */
+static void RestoreCounter(MIL_ID MilDigitizer, const TriggerAuditCounterSettingsStruct& Previous)
+   {
+   if (!Previous.EventSource.empty())
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("CounterEventSource"), M_TYPE_STRING, Previous.EventSource);
+   if (!Previous.EventActivation.empty())
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("CounterEventActivation"), M_TYPE_STRING, Previous.EventActivation);
+   if (!Previous.ResetSource.empty())
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("CounterResetSource"), M_TYPE_STRING, Previous.ResetSource);
+   }
+
+/* Sets a camera counter to count Source and resets it, keeping the */
+/* settings it had in Previous.                                     */
+static bool ConfigureCounter(MIL_ID MilDigitizer, const MIL_STRING& Counter, const MIL_STRING& Source,
+                             const MIL_STRING& Activation, TriggerAuditCounterSettingsStruct* Previous)
+   {
+   Previous->EventSource.clear();
+   Previous->EventActivation.clear();
+   Previous->ResetSource.clear();
+
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("CounterSelector"), M_TYPE_STRING, Counter);
+   if (!FeatureAccessSucceeded())
+      return false;
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("CounterEventSource"), M_TYPE_STRING, Previous->EventSource);
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("CounterEventSource"), M_TYPE_STRING, Source);
+   if (!FeatureAccessSucceeded())
+      return false;
+
+   /* Optional: not every camera has them. */
+   if (!Activation.empty())
+      {
+      FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("CounterEventActivation"), M_TYPE_STRING, Previous->EventActivation);
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("CounterEventActivation"), M_TYPE_STRING, Activation);
+      }
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("CounterResetSource"), M_TYPE_STRING, Previous->ResetSource);
+   FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("CounterResetSource"), M_TYPE_STRING, MIL_TEXT("Off"));
+
+   FeatureAccessControl(MilDigitizer, M_FEATURE_EXECUTE, MIL_TEXT("CounterReset"), M_DEFAULT, M_NULL);
+   if (FeatureAccessSucceeded())
+      return true;
+   RestoreCounter(MilDigitizer, *Previous);
+   return false;
+   }
+
+/* Reads the host side, then the counters from the last stage of the trigger */
+/* path to the first, so that no stage can be read ahead of the next one.    */
+/* Runs on the strand of the digitizer.                                      */
+static void TakeReading(TriggerAuditStruct* Audit, TriggerAuditReadingStruct* Reading)
+   {
+   static const MIL_INT Order[TRIGGER_AUDIT_COUNTER_COUNT] =
+      { TRIGGER_AUDIT_EXPOSURE, TRIGGER_AUDIT_ACCEPTED, TRIGGER_AUDIT_IGNORED, TRIGGER_AUDIT_LINE };
+   MIL_INT HostMissed = 0;
+
+   Reading->Received = Audit->Received.load();
+   Reading->Corrupted = Audit->Corrupted.load();
+      {
+      lock_guard<mutex> Guard(Audit->Lock);
+      Reading->HostMissed = Audit->HostMissedBase;
+      if (Audit->ProcessActive)
+         {
+         FeatureAccessMdigInquire(Audit->MilDigitizer, M_PROCESS_FRAME_MISSED, &HostMissed);
+         if (FeatureAccessSucceeded())
+            Reading->HostMissed += (MIL_UINT64)HostMissed;
+         }
+      }
+
+   for (MIL_INT i = 0; i < TRIGGER_AUDIT_COUNTER_COUNT; i++)
+      {
+      MIL_INT c = Order[i];
+
+      Reading->Valid[c] = false;
+      Reading->Counters[c] = 0;
+      if (Audit->Counters[c].empty())
+         continue;
+      FeatureAccessControl(Audit->MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("CounterSelector"), M_TYPE_STRING, Audit->Counters[c]);
+      FeatureAccessInquire(Audit->MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("CounterValue"), M_TYPE_INT64, &Reading->Counters[c]);
+      Reading->Valid[c] = FeatureAccessSucceeded();
+      Audit->AccessCount += 2;
+      }
+   Reading->Time = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+   }
+
+/* Takes a reading and keeps it as the last one. Runs on the strand. */
+static void Read(TriggerAuditStruct* Audit, bool Periodic)
+   {
+   TriggerAuditReadingStruct Reading;
+   MIL_INT64 Losses[TRIGGER_AUDIT_LOSS_COUNT];
+   MIL_DOUBLE StartTime = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+   bool NewLosses = false;
+
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+   TakeReading(Audit, &Reading);
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+
+   lock_guard<mutex> Guard(Audit->Lock);
+   Audit->Last = Reading;
+   Audit->ReadingCount++;
+   Audit->ReadingTime += MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) - StartTime;
+   if (!Periodic)
+      return;
+
+   /* Report the losses that appeared since the last report. */
+   TriggerAuditLosses(Audit, Reading, Losses);
+   Losses[TRIGGER_AUDIT_TRANSPORT] -= TRIGGER_AUDIT_IN_FLIGHT;
+   for (MIL_INT c = 0; c < TRIGGER_AUDIT_LOSS_COUNT; c++)
+      NewLosses = NewLosses || (Losses[c] > Audit->Reported[c]);
+   if (!NewLosses)
+      return;
+
+   MosPrintf(MIL_TEXT("\nTrigger audit at %.1f s:"), Reading.Time - Audit->StartTime);
+   for (MIL_INT c = 0; c < TRIGGER_AUDIT_LOSS_COUNT; c++)
+      if (Losses[c] > Audit->Reported[c])
+         {
+         MosPrintf(MIL_TEXT(" %s +%lld"), LossNames[c], (long long)(Losses[c] - Audit->Reported[c]));
+         Audit->Reported[c] = Losses[c];
+         }
+   MosPrintf(MIL_TEXT("\n"));
+   }
+
+static void PeriodicRead(TriggerAuditStruct* Audit)
+   {
+   Read(Audit, true);
+   Audit->Reading.store(false);
+   }
+
+/* Timer thread: posts a reading every period, unless one is still pending. */
+static MIL_UINT32 MFTYPE TimerThread(void* ThreadContext)
+   {
+   TriggerAuditStruct* Audit = (TriggerAuditStruct*)ThreadContext;
+   MIL_INT PeriodMs = (MIL_INT)(1000.0*Audit->Period);
+
+   for (;;)
+      {
+      MthrWait(Audit->MilEvent, M_EVENT_WAIT + M_EVENT_TIMEOUT(PeriodMs), M_NULL);
+      if (Audit->StopRequested.load())
+         break;
+      if (Audit->Reading.exchange(true))
+         continue;
+      FeatureAsyncPostWork(Audit->MilDigitizer, bind(&PeriodicRead, Audit));
+      }
+   return 0;
+   }
+
+bool TriggerAuditStart(MIL_ID MilSystem, MIL_ID MilDigitizer, MIL_DOUBLE Period, TriggerAuditStruct* Audit)
+   {
+   MIL_STRING Sources[TRIGGER_AUDIT_COUNTER_COUNT];
+   MIL_STRING Activation;
+   vector<MIL_STRING> CameraCounters;
+   MIL_INT CounterCount = 0;
+   size_t Next = 0;
+
+   Audit->MilDigitizer = MilDigitizer;
+   Audit->Received.store(0);
+   Audit->Corrupted.store(0);
+   Audit->MilThread = M_NULL;
+   Audit->MilEvent = M_NULL;
+   Audit->StopRequested.store(false);
+   Audit->Reading.store(false);
+   Audit->Period = Period;
+   Audit->HostMissedBase = 0;
+   Audit->ProcessActive = false;
+   Audit->ReadingCount = Audit->AccessCount = 0;
+   Audit->ReadingTime = 0.0;
+   for (MIL_INT c = 0; c < TRIGGER_AUDIT_COUNTER_COUNT; c++)
+      {
+      Audit->Counters[c].clear();
+      Audit->Last.Valid[c] = false;
+      Audit->Last.Counters[c] = 0;
+      }
+   for (MIL_INT c = 0; c < TRIGGER_AUDIT_LOSS_COUNT; c++)
+      Audit->Reported[c] = 0;
+   Audit->Last.Received = Audit->Last.Corrupted = Audit->Last.HostMissed = 0;
+
+   /* The trigger, as set up for the acquisition. */
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerSelector"), M_TYPE_STRING, Audit->TriggerSelector);
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerSource"), M_TYPE_STRING, Audit->TriggerSource);
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("TriggerActivation"), M_TYPE_STRING, Activation);
+   if (Audit->TriggerSelector.empty())
+      return false;
+
+   Sources[TRIGGER_AUDIT_ACCEPTED] = Audit->TriggerSelector;
+   if (Audit->TriggerSource.compare(0, 4, MIL_TEXT("Line")) == 0)
+      Sources[TRIGGER_AUDIT_LINE] = Audit->TriggerSource;
+   if (Audit->TriggerSelector == MIL_TEXT("FrameStart"))
+      Sources[TRIGGER_AUDIT_EXPOSURE] = TRIGGER_AUDIT_EXPOSURE_SOURCE;
+   Sources[TRIGGER_AUDIT_IGNORED] = (Audit->TriggerSelector == MIL_TEXT("AcquisitionStart")) ?
+                                    MIL_TEXT("AcquisitionTriggerMissed") : MIL_TEXT("FrameTriggerMissed");
+
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_ENUM_ENTRY_COUNT, MIL_TEXT("CounterSelector"), M_TYPE_MIL_INT, &CounterCount);
+   if (!FeatureAccessSucceeded())
+      CounterCount = 0;
+   CameraCounters.assign((size_t)CounterCount, MIL_TEXT(""));
+   FeatureAccessInquire(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("CounterSelector"), M_TYPE_STRING, Audit->PreviousCounterSelector);
+   for (size_t i = 0; i < CameraCounters.size(); i++)
+      FeatureAccessInquire(MilDigitizer, M_FEATURE_ENUM_ENTRY_NAME + i, MIL_TEXT("CounterSelector"), M_TYPE_STRING, CameraCounters[i]);
+
+   /* Give the camera's counters to the counters in order; a counter whose */
+   /* source the camera does not have leaves its camera counter to the next. */
+   for (MIL_INT c = 0; c < TRIGGER_AUDIT_COUNTER_COUNT && Next < CameraCounters.size(); c++)
+      {
+      if (Sources[c].empty())
+         continue;
+      if (ConfigureCounter(MilDigitizer, CameraCounters[Next], Sources[c],
+                           (c == TRIGGER_AUDIT_LINE) ? Activation : MIL_STRING(), &Audit->PreviousSettings[c]))
+         Audit->Counters[c] = CameraCounters[Next++];
+      }
+   if (!Audit->PreviousCounterSelector.empty())
+      FeatureAccessControl(MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("CounterSelector"), M_TYPE_STRING, Audit->PreviousCounterSelector);
+   if (Next == 0)
+      return false;
+
+   Audit->StartTime = Audit->Last.Time = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+   MthrAlloc(MilSystem, M_EVENT, M_NOT_SIGNALED + M_AUTO_RESET, M_NULL, M_NULL, &Audit->MilEvent);
+   MthrAlloc(MilSystem, M_THREAD, M_DEFAULT, &TimerThread, Audit, &Audit->MilThread);
+   return true;
+   }
+
+void TriggerAuditFrame(TriggerAuditStruct* Audit, bool Corrupted)
+   {
+   Audit->Received.fetch_add(1, memory_order_relaxed);
+   if (Corrupted)
+      Audit->Corrupted.fetch_add(1, memory_order_relaxed);
+   }
+
+void TriggerAuditProcessStarted(TriggerAuditStruct* Audit)
+   {
+   lock_guard<mutex> Guard(Audit->Lock);
+   Audit->ProcessActive = true;
+   }
+
+/* Adds the host misses of the run to the base; the count MIL keeps for */
+/* the stopped run is no longer read.                                   */
+static bool KeepHostMissed(TriggerAuditStruct* Audit)
+   {
+   lock_guard<mutex> Guard(Audit->Lock);
+   MIL_INT HostMissed = 0;
+
+   if (!Audit->ProcessActive)
+      return true;
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+   FeatureAccessMdigInquire(Audit->MilDigitizer, M_PROCESS_FRAME_MISSED, &HostMissed);
+   if (FeatureAccessSucceeded())
+      Audit->HostMissedBase += (MIL_UINT64)HostMissed;
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+   Audit->ProcessActive = false;
+   return true;
+   }
+
+void TriggerAuditProcessStopped(TriggerAuditStruct* Audit)
+   {
+   FeatureAsyncPost<bool>(Audit->MilDigitizer, bind(&KeepHostMissed, Audit)).wait();
+   }
+
+static bool FinalRead(TriggerAuditStruct* Audit)
+   {
+   Read(Audit, false);
+
+   /* Give the camera's counters back their settings, then the selector. */
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_DISABLE);
+   for (MIL_INT c = 0; c < TRIGGER_AUDIT_COUNTER_COUNT; c++)
+      {
+      if (Audit->Counters[c].empty())
+         continue;
+      FeatureAccessControl(Audit->MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("CounterSelector"), M_TYPE_STRING, Audit->Counters[c]);
+      RestoreCounter(Audit->MilDigitizer, Audit->PreviousSettings[c]);
+      }
+   if (!Audit->PreviousCounterSelector.empty())
+      FeatureAccessControl(Audit->MilDigitizer, M_FEATURE_VALUE, MIL_TEXT("CounterSelector"), M_TYPE_STRING, Audit->PreviousCounterSelector);
+   MappControl(M_DEFAULT, M_ERROR, M_PRINT_ENABLE);
+   return true;
+   }
+
+void TriggerAuditStop(TriggerAuditStruct* Audit)
+   {
+   if (Audit->MilThread)
+      {
+      Audit->StopRequested.store(true);
+      MthrControl(Audit->MilEvent, M_EVENT_SET, M_SIGNALED);
+      MthrWait(Audit->MilThread, M_THREAD_END_WAIT, M_NULL);
+      MthrFree(Audit->MilThread);
+      MthrFree(Audit->MilEvent);
+      Audit->MilThread = Audit->MilEvent = M_NULL;
+      }
+
+   /* Queued behind the periodic reading still pending, if any. */
+   FeatureAsyncPost<bool>(Audit->MilDigitizer, bind(&FinalRead, Audit)).wait();
+   }
+
+void TriggerAuditLosses(const TriggerAuditStruct* Audit, const TriggerAuditReadingStruct& Reading,
+                        MIL_INT64 Losses[TRIGGER_AUDIT_LOSS_COUNT])
+   {
+   const bool* Valid = Reading.Valid;
+   const MIL_INT64* Counters = Reading.Counters;
+   MIL_INT64 Ignored = Valid[TRIGGER_AUDIT_IGNORED] ? Counters[TRIGGER_AUDIT_IGNORED] : 0;
+   MIL_INT64 Delivered = (MIL_INT64)(Reading.Received + Reading.HostMissed);
+   MIL_INT64 Produced = -1;
+
+   for (MIL_INT c = 0; c < TRIGGER_AUDIT_LOSS_COUNT; c++)
+      Losses[c] = 0;
+
+   if (Valid[TRIGGER_AUDIT_LINE] && Valid[TRIGGER_AUDIT_ACCEPTED])
+      Losses[TRIGGER_AUDIT_MISSED_TRIGGER] = Counters[TRIGGER_AUDIT_LINE] - Counters[TRIGGER_AUDIT_ACCEPTED] - Ignored;
+   Losses[TRIGGER_AUDIT_OVERTRIGGER] = Ignored;
+
+   /* Frames produced by the camera: its exposures, or its accepted frame */
+   /* triggers when it cannot count the exposures.                        */
+   if (Valid[TRIGGER_AUDIT_EXPOSURE])
+      {
+      Produced = Counters[TRIGGER_AUDIT_EXPOSURE];
+      if (Valid[TRIGGER_AUDIT_ACCEPTED])
+         Losses[TRIGGER_AUDIT_NOT_EXPOSED] = Counters[TRIGGER_AUDIT_ACCEPTED] - Produced;
+      }
+   else if (Valid[TRIGGER_AUDIT_ACCEPTED] && Audit->TriggerSelector == MIL_TEXT("FrameStart"))
+      Produced = Counters[TRIGGER_AUDIT_ACCEPTED];
+   if (Produced >= 0)
+      Losses[TRIGGER_AUDIT_TRANSPORT] = Produced - Delivered;
+
+   Losses[TRIGGER_AUDIT_HOST_MISSED] = (MIL_INT64)Reading.HostMissed;
+   Losses[TRIGGER_AUDIT_CORRUPTED] = (MIL_INT64)Reading.Corrupted;
+
+   for (MIL_INT c = 0; c < TRIGGER_AUDIT_LOSS_COUNT; c++)
+      if (Losses[c] < 0)
+         Losses[c] = 0;
+   }
+
+void TriggerAuditPrintStatistics(TriggerAuditStruct* Audit)
+   {
+   lock_guard<mutex> Guard(Audit->Lock);
+   const TriggerAuditReadingStruct& Reading = Audit->Last;
+   MIL_INT64 Losses[TRIGGER_AUDIT_LOSS_COUNT];
+   MIL_INT64 Triggers;
+   MIL_DOUBLE Elapsed = Reading.Time - Audit->StartTime;
+
+   TriggerAuditLosses(Audit, Reading, Losses);
+   if (Reading.Valid[TRIGGER_AUDIT_LINE])
+      Triggers = Reading.Counters[TRIGGER_AUDIT_LINE];
+   else
+      Triggers = (Reading.Valid[TRIGGER_AUDIT_ACCEPTED] ? Reading.Counters[TRIGGER_AUDIT_ACCEPTED] : 0) + Losses[TRIGGER_AUDIT_OVERTRIGGER];
+
+   MosPrintf(MIL_TEXT("\n---------------------- Trigger audit -----------------------\n\n"));
+   MosPrintf(MIL_TEXT("%30s %s on %s\n"), MIL_TEXT("Trigger:"), Audit->TriggerSelector.c_str(),
+             Audit->TriggerSource.empty() ? MIL_TEXT("N/A") : Audit->TriggerSource.c_str());
+   for (MIL_INT c = 0; c < TRIGGER_AUDIT_COUNTER_COUNT; c++)
+      {
+      MIL_TEXT_CHAR Title[64];
+
+      MosSprintf(Title, 64, MIL_TEXT("%s:"), CounterNames[c]);
+      if (Reading.Valid[c])
+         MosPrintf(MIL_TEXT("%30s %lld (%s)\n"), Title, (long long)Reading.Counters[c], Audit->Counters[c].c_str());
+      else
+         MosPrintf(MIL_TEXT("%30s N/A\n"), Title);
+      }
+   MosPrintf(MIL_TEXT("%30s %llu\n"), MIL_TEXT("Frames received:"), (unsigned long long)Reading.Received);
+
+   MosPrintf(MIL_TEXT("\n%30s %10s %10s %10s\n"), MIL_TEXT("Losses"), MIL_TEXT("count"), MIL_TEXT("% trig."), MIL_TEXT("per min"));
+   for (MIL_INT c = 0; c < TRIGGER_AUDIT_LOSS_COUNT; c++)
+      MosPrintf(MIL_TEXT("%30s %10lld %10.3f %10.2f\n"), LossNames[c], (long long)Losses[c],
+                Triggers ? 100.0*Losses[c]/Triggers : 0.0, (Elapsed > 0.0) ? 60.0*Losses[c]/Elapsed : 0.0);
+
+   if (Audit->ReadingCount && Elapsed > 0.0)
+      MosPrintf(MIL_TEXT("\n%30s %llu readings, %.1f accesses/s, %.2f ms per reading\n"), MIL_TEXT("Control channel:"),
+                (unsigned long long)Audit->ReadingCount, Audit->AccessCount/Elapsed, 1e3*Audit->ReadingTime/Audit->ReadingCount);
+   }
@@ -0,0 +1,162 @@
+﻿/********************************************************************************/
+/*
+* File name: TriggerAudit.h
+*
+* Synopsis:  Missed-trigger diagnostics of a triggered acquisition, from the
+*            counters of the camera (SFNC Counter and Timer Control).
+*
+*            One counter is configured per stage of the trigger path, as far
+*            as the camera has counters and event sources for them:
+*
+*            - the edges on the trigger line (CounterEventSource set to the
+*              TriggerSource line, with the TriggerActivation);
+*            - the triggers accepted (FrameStart or AcquisitionStart, as
+*              selected by the TriggerSelector);
+*            - the triggers ignored because the camera was busy
+*              (FrameTriggerMissed or AcquisitionTriggerMissed);
+*            - the exposures started (ExposureStart).
+*
+*            The counters are reset before the acquisition and read every
+*            Period seconds, whether frames arrive or not, in one job posted
+*            on the digitizer's strand of the asynchronous feature access (see
+*            FeatureAsync.h): one selector write and one value read per
+*            counter. The processing hook only counts the frames, so it never
+*            waits for the control channel. The readings are reconciled
+*            with the frames received by the hook, the frames MIL missed for
+*            lack of a grab buffer and the corrupted frames. Losses are
+*            reported by category:
+*
+*            - missed triggers: edges neither accepted nor reported ignored;
+*            - overtriggers: triggers ignored while the camera was busy;
+*            - not exposed: triggers accepted without exposure (FrameStart);
+*            - transport drops: exposures never received by the host;
+*            - host misses: frames MIL dropped for lack of a grab buffer;
+*            - corrupted: frames received incomplete.
+*
+*            The counters are read downstream first, so a periodic reading
+*            can only overstate the transport drops by the frames in flight;
+*            the reading taken once the acquisition is stopped is exact.
+*            The counter settings the audit writes (event source and
+*            activation, reset source) and the CounterSelector are restored
+*            when the audit stops.
+*
+*            MIL's host miss count covers the current MdigProcess() run only
+*            and keeps the last run's count once stopped; it is added to the
+*            misses of the previous runs only while a run is active. The
+*            readings run on the timer thread when the feature access is
+*            synchronous (FEATURE_ASYNC_THREADS 0), so the host miss count is
+*            kept under the lock of the audit.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+#ifndef TRIGGER_AUDIT_H
+#define TRIGGER_AUDIT_H
+
+#include <mil.h>
+#include <atomic>
+#include <mutex>
+
+/* Counters, in the order they are assigned to the camera's counters. */
+#define TRIGGER_AUDIT_ACCEPTED         0
+#define TRIGGER_AUDIT_LINE             1
+#define TRIGGER_AUDIT_EXPOSURE         2
+#define TRIGGER_AUDIT_IGNORED          3
+#define TRIGGER_AUDIT_COUNTER_COUNT    4
+
+/* Loss categories. */
+#define TRIGGER_AUDIT_MISSED_TRIGGER   0
+#define TRIGGER_AUDIT_OVERTRIGGER      1
+#define TRIGGER_AUDIT_NOT_EXPOSED      2
+#define TRIGGER_AUDIT_TRANSPORT        3
+#define TRIGGER_AUDIT_HOST_MISSED      4
+#define TRIGGER_AUDIT_CORRUPTED        5
+#define TRIGGER_AUDIT_LOSS_COUNT       6
+
+/* Frames that may be exposed but not yet received when a periodic reading */
+/* is taken; transport drops are reported as they happen beyond them.      */
+#define TRIGGER_AUDIT_IN_FLIGHT        2
+
+/* Settings of a camera counter before the audit; empty if not read. */
+typedef struct
+   {
+   MIL_STRING               EventSource;
+   MIL_STRING               EventActivation;
+   MIL_STRING               ResetSource;
+   } TriggerAuditCounterSettingsStruct;
+
+/* One reading of the counters and of the host side. */
+typedef struct
+   {
+   bool                     Valid[TRIGGER_AUDIT_COUNTER_COUNT];
+   MIL_INT64                Counters[TRIGGER_AUDIT_COUNTER_COUNT];
+   MIL_UINT64               Received;
+   MIL_UINT64               Corrupted;
+   MIL_UINT64               HostMissed;
+   MIL_DOUBLE               Time;
+   } TriggerAuditReadingStruct;
+
+typedef struct
+   {
+   MIL_ID                   MilDigitizer;
+   MIL_STRING               TriggerSelector;
+   MIL_STRING               TriggerSource;
+
+   /* Camera counter (CounterSelector entry) of each counter, empty if unused, */
+   /* and the settings it had before the audit.                                */
+   MIL_STRING               Counters[TRIGGER_AUDIT_COUNTER_COUNT];
+   TriggerAuditCounterSettingsStruct PreviousSettings[TRIGGER_AUDIT_COUNTER_COUNT];
+   MIL_STRING               PreviousCounterSelector;
+
+   /* Hook side. */
+   std::atomic<MIL_UINT64>  Received;
+   std::atomic<MIL_UINT64>  Corrupted;
+
+   /* Timer thread, posting a reading every Period seconds. */
+   MIL_ID                   MilThread;
+   MIL_ID                   MilEvent;
+   std::atomic<bool>        StopRequested;
+   std::atomic<bool>        Reading;       /* A periodic reading is posted. */
+   MIL_DOUBLE               Period;
+
+   /* Readings. */
+   std::mutex               Lock;          /* Protects the fields below. */
+
+   /* Host misses of the previous MdigProcess() runs, and whether a run is */
+   /* active, so that its own count is added. Without asynchronous feature */
+   /* access, the periodic reading runs on the timer thread, so these are  */
+   /* only used under the lock.                                            */
+   MIL_UINT64               HostMissedBase;
+   bool                     ProcessActive;
+   MIL_DOUBLE               StartTime;
+   TriggerAuditReadingStruct Last;
+   MIL_INT64                Reported[TRIGGER_AUDIT_LOSS_COUNT];
+   MIL_UINT64               ReadingCount;
+   MIL_UINT64               AccessCount;
+   MIL_DOUBLE               ReadingTime;
+   } TriggerAuditStruct;
+
+/* Configures and resets the counters for the trigger selected on         */
+/* MilDigitizer. Call with the error prints disabled, before the          */
+/* acquisition starts. Returns false if no counter could be configured.    */
+bool TriggerAuditStart(MIL_ID MilSystem, MIL_ID MilDigitizer, MIL_DOUBLE Period, TriggerAuditStruct* Audit);
+
+/* Processing hook: counts a received frame. Never blocks. */
+void TriggerAuditFrame(TriggerAuditStruct* Audit, bool Corrupted);
+
+/* Call after each MdigProcess() start, and after each stop so the host */
+/* misses of the run are kept.                                          */
+void TriggerAuditProcessStarted(TriggerAuditStruct* Audit);
+void TriggerAuditProcessStopped(TriggerAuditStruct* Audit);
+
+/* Takes the final reading and restores the counters. Call once the */
+/* acquisition is stopped.                                          */
+void TriggerAuditStop(TriggerAuditStruct* Audit);
+
+/* Losses of a reading, by category. */
+void TriggerAuditLosses(const TriggerAuditStruct* Audit, const TriggerAuditReadingStruct& Reading,
+                        MIL_INT64 Losses[TRIGGER_AUDIT_LOSS_COUNT]);
+
+void TriggerAuditPrintStatistics(TriggerAuditStruct* Audit);
+
+#endif
@@ -0,0 +1,203 @@
+﻿/********************************************************************************/
+/*
+* File name: WorkerPool.cpp
+*
+* Synopsis:  Implementation of the worker pool, slot queue and latency
+*            histogram. See WorkerPool.h.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. */
+#include "WorkerPool.h"
+#include <string.h>
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+/* Pool.                                                                    */
+/* -----------------------------------------------------------------------*/
+
+static MIL_UINT32 MFTYPE WorkerThread(void* ThreadContext)
+   {
+   WorkerPoolStruct* Pool = (WorkerPoolStruct*)ThreadContext;
+   unique_lock<mutex> Guard(Pool->Lock);
+
+   for (;;)
+      {
+      while (!Pool->Stopping && Pool->Jobs.empty())
+         Pool->Wake.wait(Guard);
+      if (Pool->Jobs.empty())
+         return 0;
+
+      WorkerPoolJobStruct Job = Pool->Jobs.front();
+      Pool->Jobs.pop_front();
+      Pool->Running.push_back(Job.DataPtr);
+      Guard.unlock();
+
+      Job.Function(Job.DataPtr, Job.Index);
+
+      Guard.lock();
+      Pool->Running.erase(find(Pool->Running.begin(), Pool->Running.end(), Job.DataPtr));
+      Pool->Idle.notify_all();
+      }
+   }
+
+bool WorkerPoolStart(WorkerPoolStruct* Pool, MIL_ID MilSystem, MIL_INT ThreadCount)
+   {
+   if (!Pool->MilThreads.empty())
+      return true;
+
+   if (ThreadCount <= 0)
+      ThreadCount = (MIL_INT)thread::hardware_concurrency() - 1;
+   if (ThreadCount <= 0)
+      ThreadCount = 1;
+
+   Pool->Stopping = false;
+   for (MIL_INT i = 0; i < ThreadCount; i++)
+      {
+      MIL_ID MilThread = M_NULL;
+      MthrAlloc(MilSystem, M_THREAD, M_DEFAULT, &WorkerThread, Pool, &MilThread);
+      if (MilThread == M_NULL)
+         break;
+      Pool->MilThreads.push_back(MilThread);
+      }
+   return !Pool->MilThreads.empty();
+   }
+
+void WorkerPoolStop(WorkerPoolStruct* Pool)
+   {
+      {
+      lock_guard<mutex> Guard(Pool->Lock);
+      Pool->Stopping = true;
+      }
+   Pool->Wake.notify_all();
+
+   for (size_t i = 0; i < Pool->MilThreads.size(); i++)
+      {
+      MthrWait(Pool->MilThreads[i], M_THREAD_END_WAIT, M_NULL);
+      MthrFree(Pool->MilThreads[i]);
+      }
+   Pool->MilThreads.clear();
+   }
+
+void WorkerPoolPost(WorkerPoolStruct* Pool, WorkerPoolFunction Function, void* DataPtr, MIL_INT Index, MIL_INT Count)
+   {
+      {
+      lock_guard<mutex> Guard(Pool->Lock);
+      for (MIL_INT i = 0; i < Count; i++)
+         {
+         WorkerPoolJobStruct Job = {Function, DataPtr, Index + i};
+         Pool->Jobs.push_back(Job);
+         }
+      }
+   if (Count == 1)
+      Pool->Wake.notify_one();
+   else
+      Pool->Wake.notify_all();
+   }
+
+void WorkerPoolCancel(WorkerPoolStruct* Pool, void* DataPtr)
+   {
+   unique_lock<mutex> Guard(Pool->Lock);
+
+   Pool->Jobs.erase(remove_if(Pool->Jobs.begin(), Pool->Jobs.end(),
+                              [DataPtr](const WorkerPoolJobStruct& Job) { return Job.DataPtr == DataPtr; }),
+                    Pool->Jobs.end());
+   while (find(Pool->Running.begin(), Pool->Running.end(), DataPtr) != Pool->Running.end())
+      Pool->Idle.wait(Guard);
+   }
+
+/* Slot queue.                                                              */
+/* -----------------------------------------------------------------------*/
+
+void WorkerQueueInit(WorkerQueueStruct* Queue, MIL_INT SlotCount)
+   {
+   Queue->SlotCount = SlotCount;
+   Queue->QueuedCount = 0;
+   Queue->DoneCount = 0;
+   Queue->DroppedCount = 0;
+   }
+
+bool WorkerQueueReserve(WorkerQueueStruct* Queue, MIL_UINT64* Index)
+   {
+   lock_guard<mutex> Guard(Queue->Lock);
+   if (Queue->QueuedCount - Queue->DoneCount >= (MIL_UINT64)Queue->SlotCount)
+      {
+      Queue->DroppedCount++;
+      return false;
+      }
+   *Index = Queue->QueuedCount;
+   return true;
+   }
+
+void WorkerQueuePush(WorkerQueueStruct* Queue)
+   {
+   lock_guard<mutex> Guard(Queue->Lock);
+   Queue->QueuedCount++;
+   }
+
+bool WorkerQueueFront(WorkerQueueStruct* Queue, MIL_UINT64* Index)
+   {
+   lock_guard<mutex> Guard(Queue->Lock);
+   if (Queue->DoneCount == Queue->QueuedCount)
+      return false;
+   *Index = Queue->DoneCount;
+   return true;
+   }
+
+void WorkerQueuePop(WorkerQueueStruct* Queue)
+   {
+   lock_guard<mutex> Guard(Queue->Lock);
+   Queue->DoneCount++;
+   }
+
+bool WorkerQueueEmpty(WorkerQueueStruct* Queue)
+   {
+   lock_guard<mutex> Guard(Queue->Lock);
+   return Queue->DoneCount == Queue->QueuedCount;
+   }
+
+/* Latency histogram.                                                       */
+/* -----------------------------------------------------------------------*/
+
+void WorkerLatencyInit(WorkerLatencyStruct* Latency)
+   {
+   Latency->Count = 0;
+   Latency->Min = 0.0;
+   Latency->Max = 0.0;
+   Latency->Total = 0.0;
+   memset(Latency->Histogram, 0, sizeof(Latency->Histogram));
+   }
+
+void WorkerLatencyAdd(WorkerLatencyStruct* Latency, MIL_DOUBLE Seconds)
+   {
+   MIL_INT Bucket = 0;
+
+   if (Latency->Count == 0 || Seconds < Latency->Min)
+      Latency->Min = Seconds;
+   if (Seconds > Latency->Max)
+      Latency->Max = Seconds;
+   Latency->Total += Seconds;
+   Latency->Count++;
+   while (Bucket < WORKER_LATENCY_HISTOGRAM_SIZE - 1 && Seconds*1e6 > (MIL_DOUBLE)(1ULL << Bucket))
+      Bucket++;
+   Latency->Histogram[Bucket]++;
+   }
+
+void WorkerLatencyPrint(const WorkerLatencyStruct* Latency)
+   {
+   MIL_UINT64 Count = 0;
+   MIL_INT P99 = 0;
+
+   if (Latency->Count == 0)
+      return;
+
+   while (P99 < WORKER_LATENCY_HISTOGRAM_SIZE - 1 &&
+          (Count += Latency->Histogram[P99]) < (Latency->Count*99 + 99)/100)
+      P99++;
+   MosPrintf(MIL_TEXT("%30s %.2f / %.2f / %.2f ms (p99 <= %.2f ms)\n"), MIL_TEXT("Added latency min/avg/max:"),
+             1e3*Latency->Min, 1e3*Latency->Total/Latency->Count, 1e3*Latency->Max, (1ULL << P99)/1e3);
+   }
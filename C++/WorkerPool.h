@@ -0,0 +1,104 @@
+﻿/********************************************************************************/
+/*
+* File name: WorkerPool.h
+*
+* Synopsis:  Pool of MIL threads running the jobs of the background modules
+*            (compressed stream decoding, frame archive compression and
+*            writing, asynchronous feature access), with the two pieces these
+*            modules share around it:
+*
+*            - an ordered slot queue: a ring of SlotCount frames that the
+*              acquisition queues in order, that the jobs complete in any
+*              order and that are handed on in queue order; a frame queued
+*              while all the slots are in use is dropped and counted;
+*            - an added latency histogram, from queuing to hand-on, whose
+*              bucket n counts latencies up to 2^n us, with the p99 taken as
+*              the bound of the bucket that reaches 99% of the frames.
+*
+*            A job is a function called with a data pointer and an index, so
+*            posting does not allocate. Jobs run in the order they were
+*            posted, on any thread of the pool.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <mil.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+/* Added latency histogram size: bucket n counts latencies up to 2^n us. */
+#define WORKER_LATENCY_HISTOGRAM_SIZE  24
+
+typedef void (*WorkerPoolFunction)(void* DataPtr, MIL_INT Index);
+
+typedef struct
+   {
+   WorkerPoolFunction       Function;
+   void*                    DataPtr;
+   MIL_INT                  Index;
+   } WorkerPoolJobStruct;
+
+typedef struct
+   {
+   std::vector<MIL_ID>              MilThreads;
+   std::mutex                       Lock;
+   std::condition_variable          Wake;
+   std::condition_variable          Idle;        /* Notified after each job. */
+   std::deque<WorkerPoolJobStruct>  Jobs;
+   std::vector<void*>               Running;     /* Data pointers of the jobs running. */
+   bool                             Stopping;
+   } WorkerPoolStruct;
+
+/* Frames queued, in queue order. */
+typedef struct
+   {
+   std::mutex               Lock;
+   MIL_INT                  SlotCount;
+   MIL_UINT64               QueuedCount;
+   MIL_UINT64               DoneCount;       /* Handed on, or skipped. */
+   MIL_UINT64               DroppedCount;
+   } WorkerQueueStruct;
+
+typedef struct
+   {
+   MIL_UINT64               Count;
+   MIL_DOUBLE               Min;
+   MIL_DOUBLE               Max;
+   MIL_DOUBLE               Total;
+   MIL_UINT64               Histogram[WORKER_LATENCY_HISTOGRAM_SIZE];
+   } WorkerLatencyStruct;
+
+/* Pool. ThreadCount 0 uses one thread per core but one. Stopping runs the */
+/* jobs still posted, and those they post, then ends the threads.          */
+bool WorkerPoolStart(WorkerPoolStruct* Pool, MIL_ID MilSystem, MIL_INT ThreadCount);
+void WorkerPoolStop(WorkerPoolStruct* Pool);
+
+/* Posts Count jobs, with the indexes from Index. */
+void WorkerPoolPost(WorkerPoolStruct* Pool, WorkerPoolFunction Function, void* DataPtr, MIL_INT Index, MIL_INT Count);
+
+/* Removes the jobs of DataPtr still posted and waits for those running. */
+void WorkerPoolCancel(WorkerPoolStruct* Pool, void* DataPtr);
+
+/* Slot queue. WorkerQueueReserve() gives the index of the next frame, or */
+/* counts it dropped if all the slots are in use; WorkerQueuePush() then  */
+/* queues it. WorkerQueueFront() gives the oldest frame not yet handed on */
+/* and WorkerQueuePop() removes it. Only one thread may reserve and push, */
+/* and one at a time may pop.                                             */
+void WorkerQueueInit(WorkerQueueStruct* Queue, MIL_INT SlotCount);
+bool WorkerQueueReserve(WorkerQueueStruct* Queue, MIL_UINT64* Index);
+void WorkerQueuePush(WorkerQueueStruct* Queue);
+bool WorkerQueueFront(WorkerQueueStruct* Queue, MIL_UINT64* Index);
+void WorkerQueuePop(WorkerQueueStruct* Queue);
+bool WorkerQueueEmpty(WorkerQueueStruct* Queue);
+
+/* Latency histogram, in seconds. */
+void WorkerLatencyInit(WorkerLatencyStruct* Latency);
+void WorkerLatencyAdd(WorkerLatencyStruct* Latency, MIL_DOUBLE Seconds);
+void WorkerLatencyPrint(const WorkerLatencyStruct* Latency);
+
+#endif
@@ -0,0 +1,504 @@
+﻿/********************************************************************************/
+/*
+* File name: Bench.cpp
+*
+* Synopsis:  Microbenchmark of the per-frame work of the MilGige example.
+*
+*            The processing hook and the frame kernels are timed on synthetic
+*            buffers of common sizes and pixel formats, against the MIL mock of
+*            this directory, so no camera or MIL runtime is needed. The results
+*            are written as JSON, in a fixed order and without timestamps, so
+*            that two runs can be compared with a plain diff or a script.
+*
+*            The frame bus case also checks the subscriber side: frames must
+*            come in increasing order, and a frame whose release reports it
+*            valid must be the frame published under its number. The archive
+*            read case checks that the frames written to an archive are read
+*            back unchanged. A failed check is reported on stderr and makes
+*            the exit code non-zero.
+*
+*            Usage: MilGigeBench [output.json] [repetitions]
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. */
+#include <mil.h>
+#include <math.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include "../FrameProcessing.h"
+
+using namespace std;
+
+/* Default number of timed repetitions, and untimed ones run before. */
+#define BENCH_REPETITIONS        200
+#define BENCH_WARMUP             10
+
+/* Frames queued per repetition of the archive cases, written to a file of */
+/* the temporary directory.                                                */
+#define BENCH_ARCHIVE_FRAMES     8
+#define BENCH_ARCHIVE_TILE_SIZE  65536
+
+/* Frames published per repetition of the frame bus case, on a ring small */
+/* enough for the subscriber to be overrun and to see torn frames.        */
+#define BENCH_BUS_FRAMES         16
+#define BENCH_BUS_SLOT_COUNT     4
+#define BENCH_BUS_NAME           MIL_TEXT("/MilGigeBenchBus")
+
+/* Same as the overlay of MilGige.cpp. */
+#define OVERLAY_POS_X            20
+#define OVERLAY_POS_Y            20
+
+typedef struct
+   {
+   const char* Name;
+   MIL_INT     SizeX;
+   MIL_INT     SizeY;
+   MIL_INT     SizeBit;
+   } BenchFormatStruct;
+
+static const BenchFormatStruct Formats[] =
+   {
+   { "640x480_mono8",    640,  480,  8 },
+   { "1920x1200_mono8",  1920, 1200, 8 },
+   { "2448x2048_mono8",  2448, 2048, 8 },
+   { "2448x2048_mono12", 2448, 2048, 12 },
+   };
+
+/* Publisher thread of the frame bus case. */
+typedef struct
+   {
+   FrameBusStruct*    Bus;
+   MIL_ID             MilBuffer;
+   MIL_INT            FrameCount;
+   vector<MIL_DOUBLE> Times;
+   atomic<bool>       Done;
+   } BenchPublisherStruct;
+
+/* Archive file of the archive cases, unique to the process. */
+static MIL_STRING ArchiveFileName;
+
+typedef struct
+   {
+   MIL_DOUBLE Median;
+   MIL_DOUBLE Min;
+   MIL_DOUBLE P90;
+   } BenchResultStruct;
+
+/* Fills a buffer with a deterministic gradient plus noise. */
+static void FillSynthetic(MIL_ID MilBuffer, MIL_INT SizeX, MIL_INT SizeY, MIL_INT SizeBit, MIL_UINT32 Seed)
+   {
+   MIL_INT SampleByte = (SizeBit + 7)/8;
+   MIL_UINT32 MaxValue = (1u << SizeBit) - 1;
+   vector<MIL_UINT8> Data((size_t)(SizeX*SizeY*SampleByte));
+
+   for (MIL_INT y = 0; y < SizeY; y++)
+      for (MIL_INT x = 0; x < SizeX; x++)
+         {
+         MIL_UINT32 Value;
+         Seed = Seed*1664525u + 1013904223u;
+         Value = (MIL_UINT32)(((x + y)*MaxValue)/(SizeX + SizeY)) + ((Seed >> 24) & 0x0F);
+         Value = min(Value, MaxValue);
+         if (SampleByte == 1)
+            Data[(size_t)(y*SizeX + x)] = (MIL_UINT8)Value;
+         else
+            ((MIL_UINT16*)&Data[0])[y*SizeX + x] = (MIL_UINT16)Value;
+         }
+   MbufPut2d(MilBuffer, 0, 0, SizeX, SizeY, &Data[0]);
+   }
+
+static BenchResultStruct Summarize(vector<MIL_DOUBLE>& Times)
+   {
+   BenchResultStruct Result;
+
+   sort(Times.begin(), Times.end());
+   Result.Min = Times.front();
+   Result.Median = Times[Times.size()/2];
+   Result.P90 = Times[(Times.size()*9)/10];
+   return Result;
+   }
+
+/* Times the processing function of MilGige.cpp on Repetitions frames, in */
+/* nanoseconds per frame, with the default options but the frame          */
+/* statistics. The display is refreshed on every frame, the worst case of */
+/* the overlay.                                                           */
+static BenchResultStruct BenchHook(MIL_ID MilGrab, MIL_ID MilDisp, bool ComputeFrameStats, MIL_INT Repetitions)
+   {
+   HookDataStruct HookData;
+   OverlayStruct Overlay;
+   vector<MIL_DOUBLE> Times;
+
+   OverlayInit(M_DEFAULT, OVERLAY_POS_X, OVERLAY_POS_Y, 0.0, &Overlay);
+   InitHookData(&HookData, M_NULL, MilDisp, ComputeFrameStats);
+   HookData.OverlayPtr = &Overlay;
+
+   for (MIL_INT i = 0; i < BENCH_WARMUP + Repetitions; i++)
+      {
+      MIL_DOUBLE Start = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+      ProcessingFunction(M_DEFAULT, MilGrab, &HookData);
+      if (i >= BENCH_WARMUP)
+         Times.push_back((MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) - Start)*1e9);
+      }
+   return Summarize(Times);
+   }
+
+static BenchResultStruct BenchFrameStats(MIL_ID MilGrab, MIL_INT Repetitions)
+   {
+   FrameStatsStruct Stats;
+   vector<MIL_DOUBLE> Times;
+
+   for (MIL_INT i = 0; i < BENCH_WARMUP + Repetitions; i++)
+      {
+      MIL_DOUBLE Start = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+      FrameStatsComputeBuffer(MilGrab, &Stats);
+      if (i >= BENCH_WARMUP)
+         Times.push_back((MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) - Start)*1e9);
+      }
+   return Summarize(Times);
+   }
+
+/* Signature and comparison of a frame with the settings of MilGige.cpp. */
+static BenchResultStruct BenchChangeDetect(MIL_ID MilGrab, MIL_INT Repetitions)
+   {
+   ChangeDetectStruct Detect;
+   vector<MIL_DOUBLE> Times;
+
+   ChangeDetectInit(16, 4, 0.03, 30, &Detect);
+   for (MIL_INT i = 0; i < BENCH_WARMUP + Repetitions; i++)
+      {
+      MIL_DOUBLE Start = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+      ChangeDetectFrame(&Detect, MilGrab);
+      if (i >= BENCH_WARMUP)
+         Times.push_back((MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) - Start)*1e9);
+      }
+   return Summarize(Times);
+   }
+
+/* Draws the four lines of the overlay of MilGige.cpp on the display. */
+static BenchResultStruct BenchOverlay(MIL_ID MilDisp, MIL_INT Repetitions)
+   {
+   static const MIL_TEXT_CHAR* const Lines[4] =
+      { MIL_TEXT("#123456 (set 2)"), MIL_TEXT("59.9 fps"), MIL_TEXT("t 2061.033 s"), MIL_TEXT("mean 127.5 min 0 max 255") };
+   OverlayStruct Overlay;
+   vector<MIL_DOUBLE> Times;
+
+   OverlayInit(M_DEFAULT, OVERLAY_POS_X, OVERLAY_POS_Y, 0.0, &Overlay);
+   for (MIL_INT i = 0; i < BENCH_WARMUP + Repetitions; i++)
+      {
+      MIL_DOUBLE Start = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+      OverlayDraw(&Overlay, MilDisp, Lines, 4);
+      if (i >= BENCH_WARMUP)
+         Times.push_back((MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) - Start)*1e9);
+      }
+   return Summarize(Times);
+   }
+
+/* Queues BENCH_ARCHIVE_FRAMES frames on one compression thread and waits */
+/* for them to be written; the time is per frame.                         */
+static BenchResultStruct BenchArchive(MIL_ID MilGrab, MIL_INT Repetitions)
+   {
+   vector<MIL_DOUBLE> Times;
+
+   Repetitions = max<MIL_INT>(Repetitions/BENCH_ARCHIVE_FRAMES, 3);
+   for (MIL_INT i = 0; i < 1 + Repetitions; i++)
+      {
+      FrameArchiveStruct Archive;
+      MIL_DOUBLE Start;
+
+      if (!FrameArchiveOpen(ArchiveFileName.c_str(), MilGrab, BENCH_ARCHIVE_FRAMES, BENCH_ARCHIVE_TILE_SIZE, &Archive))
+         break;
+      Start = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+      for (MIL_INT f = 0; f < BENCH_ARCHIVE_FRAMES; f++)
+         FrameArchiveFrame(&Archive, MilGrab, (MIL_UINT64)f + 1, Start);
+      FrameArchiveClose(&Archive);
+      if (i >= 1)
+         Times.push_back((MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) - Start)*1e9/BENCH_ARCHIVE_FRAMES);
+      }
+   remove(ArchiveFileName.c_str());
+
+   if (Times.empty())
+      Times.push_back(0);
+   return Summarize(Times);
+   }
+
+/* Writes BENCH_ARCHIVE_FRAMES frames and reads them back; the time is per */
+/* frame read. Each frame must come back with its number, time stamp and   */
+/* pixels, and the end of the file must follow the last frame.            */
+static BenchResultStruct BenchArchiveRead(MIL_ID MilGrab, const BenchFormatStruct* Format, MIL_INT Repetitions,
+                                          bool* Passed)
+   {
+   vector<MIL_DOUBLE> Times;
+   vector<MIL_UINT8> Expected((size_t)(Format->SizeX*Format->SizeY*((Format->SizeBit + 7)/8)));
+   vector<MIL_UINT8> Data;
+   FrameArchiveStruct Archive;
+
+   MbufGet(MilGrab, &Expected[0]);
+   *Passed = FrameArchiveOpen(ArchiveFileName.c_str(), MilGrab, BENCH_ARCHIVE_FRAMES, BENCH_ARCHIVE_TILE_SIZE, &Archive);
+   if (*Passed)
+      {
+      for (MIL_INT f = 0; f < BENCH_ARCHIVE_FRAMES; f++)
+         FrameArchiveFrame(&Archive, MilGrab, (MIL_UINT64)f + 1, f*0.001);
+      FrameArchiveClose(&Archive);
+      *Passed = (Archive.Queue.DoneCount == BENCH_ARCHIVE_FRAMES && !Archive.WriteError);
+      }
+   if (!*Passed)
+      fprintf(stderr, "archive_read %s: the archive could not be written.\n", Format->Name);
+
+   Repetitions = max<MIL_INT>(Repetitions/BENCH_ARCHIVE_FRAMES, 3);
+   for (MIL_INT i = 0; *Passed && i < 1 + Repetitions; i++)
+      {
+      FrameArchiveReaderStruct Reader;
+      MIL_UINT64 FrameNumber;
+      MIL_DOUBLE TimeStamp, Start;
+
+      if (!FrameArchiveReadOpen(ArchiveFileName.c_str(), &Reader))
+         {
+         fprintf(stderr, "archive_read %s: the archive could not be opened.\n", Format->Name);
+         *Passed = false;
+         break;
+         }
+      Start = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+      for (MIL_INT f = 0; f < BENCH_ARCHIVE_FRAMES; f++)
+         {
+         if (!FrameArchiveReadFrame(&Reader, &FrameNumber, &TimeStamp, Data) || FrameNumber != (MIL_UINT64)f + 1 ||
+             fabs(TimeStamp - f*0.001) > 1e-6 || Data != Expected)
+            {
+            fprintf(stderr, "archive_read %s: frame %lld read back wrong.\n", Format->Name, (long long)f + 1);
+            *Passed = false;
+            break;
+            }
+         }
+      if (i >= 1)
+         Times.push_back((MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) - Start)*1e9/BENCH_ARCHIVE_FRAMES);
+      if (*Passed && FrameArchiveReadFrame(&Reader, &FrameNumber, &TimeStamp, Data))
+         {
+         fprintf(stderr, "archive_read %s: a frame was read past the last one.\n", Format->Name);
+         *Passed = false;
+         }
+      FrameArchiveReadClose(&Reader);
+      }
+   remove(ArchiveFileName.c_str());
+
+   if (Times.empty())
+      Times.push_back(0);
+   return Summarize(Times);
+   }
+
+/* Value of every pixel of frame FrameNumber in the frame bus case. */
+static MIL_UINT32 BusPixelValue(MIL_UINT64 FrameNumber)
+   {
+   return (MIL_UINT32)(FrameNumber % 251) + 1;
+   }
+
+static MIL_UINT32 MFTYPE BenchPublisher(void* ThreadContext)
+   {
+   BenchPublisherStruct* Publisher = (BenchPublisherStruct*)ThreadContext;
+
+   for (MIL_INT i = 0; i < Publisher->FrameCount; i++)
+      {
+      MIL_UINT64 FrameNumber = (MIL_UINT64)i + 1;
+      MIL_DOUBLE Start;
+
+      MbufClear(Publisher->MilBuffer, (MIL_DOUBLE)BusPixelValue(FrameNumber));
+      Start = MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL);
+      FrameBusPublish(Publisher->Bus, Publisher->MilBuffer, FrameNumber, Start, NULL);
+      Publisher->Times.push_back((MappTimer(M_DEFAULT, M_TIMER_READ, M_NULL) - Start)*1e9);
+      }
+   Publisher->Done.store(true);
+   return 0;
+   }
+
+/* Returns true if every pixel of the frame has the value of its frame number. */
+static bool BusFrameIsIntact(const FrameBusFrameStruct& Frame)
+   {
+   MIL_UINT32 Expected = BusPixelValue(Frame.Info.FrameNumber);
+   MIL_INT64 PixelCount = Frame.Info.SizeX*Frame.Info.SizeY;
+
+   for (MIL_INT64 i = 0; i < PixelCount; i++)
+      {
+      MIL_UINT32 Value = (Frame.Info.SizeBit > 8) ? ((const MIL_UINT16*)Frame.Data)[i] : Frame.Data[i];
+      if (Value != Expected)
+         return false;
+      }
+   return true;
+   }
+
+/* Publishes frames from a thread while a subscriber reads them in place,  */
+/* and checks what the subscriber got; the time is that of the publication */
+/* of one frame. Returns false in Passed if a check failed.                */
+static BenchResultStruct BenchFrameBus(MIL_ID MilGrab, MIL_INT Repetitions, bool* Passed)
+   {
+   MIL_INT64 SlotSizeByte = MbufInquire(MilGrab, M_SIZE_X, M_NULL)*MbufInquire(MilGrab, M_SIZE_Y, M_NULL)*
+                            ((MbufInquire(MilGrab, M_SIZE_BIT, M_NULL) + 7)/8);
+   FrameBusStruct Bus, Second, Subscriber;
+   BenchPublisherStruct Publisher;
+   FrameBusSubscriberStatsStruct Stats;
+   MIL_UINT64 LastFrame = 0, Torn = 0;
+   MIL_ID MilThread;
+
+   *Passed = false;
+   Publisher.Times.push_back(0);
+   if (!FrameBusCreate(BENCH_BUS_NAME, BENCH_BUS_SLOT_COUNT, SlotSizeByte, &Bus))
+      {
+      fprintf(stderr, "frame_bus: cannot create the bus.\n");
+      return Summarize(Publisher.Times);
+      }
+   if (FrameBusCreate(BENCH_BUS_NAME, BENCH_BUS_SLOT_COUNT, SlotSizeByte, &Second))
+      {
+      fprintf(stderr, "frame_bus: a second publisher replaced a running one.\n");
+      FrameBusFree(&Second);
+      FrameBusFree(&Bus);
+      return Summarize(Publisher.Times);
+      }
+   if (!FrameBusSubscribe(BENCH_BUS_NAME, &Subscriber))
+      {
+      fprintf(stderr, "frame_bus: cannot subscribe.\n");
+      FrameBusFree(&Bus);
+      return Summarize(Publisher.Times);
+      }
+
+   *Passed = true;
+   Publisher.Bus = &Bus;
+   Publisher.MilBuffer = MilGrab;
+   Publisher.FrameCount = max<MIL_INT>(Repetitions/4, BENCH_BUS_FRAMES);
+   Publisher.Times.clear();
+   Publisher.Done.store(false);
+   MthrAlloc(M_DEFAULT, M_THREAD, M_DEFAULT, BenchPublisher, &Publisher, &MilThread);
+
+   for (;;)
+      {
+      bool Done = Publisher.Done.load();
+      FrameBusFrameStruct Frame;
+      MIL_INT Status = FrameBusAcquireFrame(&Subscriber, &Frame);
+
+      if (Status == FRAME_BUS_NO_FRAME)
+         {
+         if (Done)
+            break;
+         continue;
+         }
+      if (Status != FRAME_BUS_FRAME_READY)
+         {
+         fprintf(stderr, "frame_bus: acquire failed.\n");
+         *Passed = false;
+         break;
+         }
+      if (Frame.Info.FrameNumber <= LastFrame)
+         {
+         fprintf(stderr, "frame_bus: frame %llu after frame %llu.\n",
+                 (unsigned long long)Frame.Info.FrameNumber, (unsigned long long)LastFrame);
+         *Passed = false;
+         }
+      LastFrame = Frame.Info.FrameNumber;
+
+      bool Intact = BusFrameIsIntact(Frame);
+      if (FrameBusReleaseFrame(&Subscriber, &Frame))
+         {
+         if (!Intact)
+            {
+            fprintf(stderr, "frame_bus: torn frame %llu released as valid.\n", (unsigned long long)Frame.Info.FrameNumber);
+            *Passed = false;
+            }
+         }
+      else
+         Torn++;
+      }
+
+   MthrWait(MilThread, M_THREAD_END_WAIT, M_NULL);
+   MthrFree(MilThread);
+
+   /* Every frame published was either read or counted as an overrun. */
+   if (FrameBusGetSubscriberStats(&Bus, &Stats, 1) != 1 ||
+       Stats.FramesRead + Stats.Overruns != (MIL_UINT64)Publisher.FrameCount || Stats.Overruns < Torn)
+      {
+      fprintf(stderr, "frame_bus: the subscriber counters do not account for the frames published.\n");
+      *Passed = false;
+      }
+
+   FrameBusUnsubscribe(&Subscriber);
+   FrameBusFree(&Bus);
+   return Summarize(Publisher.Times);
+   }
+
+static void PrintResult(FILE* Output, const char* Case, const BenchFormatStruct* Format,
+                        const BenchResultStruct& Result, bool Last)
+   {
+   MIL_DOUBLE FrameByte = (MIL_DOUBLE)(Format->SizeX*Format->SizeY*((Format->SizeBit + 7)/8));
+   MIL_DOUBLE MBps = (Result.Median > 0) ? FrameByte*1e3/Result.Median : 0;
+
+   fprintf(Output, "    {\"case\": \"%s\", \"format\": \"%s\", \"size_x\": %lld, \"size_y\": %lld, \"size_bit\": %lld, "
+                   "\"ns_per_frame\": {\"median\": %.0f, \"min\": %.0f, \"p90\": %.0f}, \"mb_per_s\": %.1f}%s\n",
+           Case, Format->Name, (long long)Format->SizeX, (long long)Format->SizeY, (long long)Format->SizeBit,
+           Result.Median, Result.Min, Result.P90, MBps, Last ? "" : ",");
+   }
+
+int main(int argc, char* argv[])
+   {
+   MIL_INT Repetitions = (argc > 2) ? max(atoi(argv[2]), 1) : BENCH_REPETITIONS;
+   MIL_INT FormatCount = sizeof(Formats)/sizeof(Formats[0]);
+   FILE* Output = stdout;
+   bool Passed = true;
+
+   if (argc > 1)
+      {
+      Output = fopen(argv[1], "w");
+      if (Output == NULL)
+         {
+         fprintf(stderr, "Cannot open %s.\n", argv[1]);
+         return 1;
+         }
+      }
+
+   const char* TempDir = getenv("TMPDIR");
+   char FileName[512];
+   snprintf(FileName, sizeof(FileName), "%s/MilGigeBench-%d.mgfa", (TempDir && *TempDir) ? TempDir : "/tmp", (int)getpid());
+   ArchiveFileName = FileName;
+
+   if (!FrameArchiveStart(M_DEFAULT, 1))
+      {
+      fprintf(stderr, "Cannot start the frame archive thread.\n");
+      return 1;
+      }
+
+   fprintf(Output, "{\n  \"benchmark\": \"MilGige\",\n  \"repetitions\": %lld,\n  \"results\": [\n",
+           (long long)Repetitions);
+
+   for (MIL_INT f = 0; f < FormatCount; f++)
+      {
+      const BenchFormatStruct* Format = &Formats[f];
+      MIL_INT Type = Format->SizeBit > 8 ? 16 : 8;
+      MIL_ID MilGrab, MilDisp;
+
+      MbufAlloc2d(M_DEFAULT, Format->SizeX, Format->SizeY, Type+M_UNSIGNED, M_IMAGE+M_GRAB+M_PROC, &MilGrab);
+      MbufAlloc2d(M_DEFAULT, Format->SizeX, Format->SizeY, Type+M_UNSIGNED, M_IMAGE+M_DISP, &MilDisp);
+      FillSynthetic(MilGrab, Format->SizeX, Format->SizeY, Format->SizeBit, 12345u + (MIL_UINT32)f);
+
+      PrintResult(Output, "hook", Format, BenchHook(MilGrab, MilDisp, false, Repetitions), false);
+      PrintResult(Output, "hook_stats", Format, BenchHook(MilGrab, MilDisp, true, Repetitions), false);
+      PrintResult(Output, "frame_stats", Format, BenchFrameStats(MilGrab, Repetitions), false);
+      PrintResult(Output, "change_detect", Format, BenchChangeDetect(MilGrab, Repetitions), false);
+      PrintResult(Output, "overlay", Format, BenchOverlay(MilDisp, Repetitions), false);
+      PrintResult(Output, "archive", Format, BenchArchive(MilGrab, Repetitions), false);
+
+      bool ArchivePassed;
+      PrintResult(Output, "archive_read", Format, BenchArchiveRead(MilGrab, Format, Repetitions, &ArchivePassed), false);
+      Passed = Passed && ArchivePassed;
+
+      bool BusPassed;
+      PrintResult(Output, "frame_bus", Format, BenchFrameBus(MilGrab, Repetitions, &BusPassed), f == FormatCount - 1);
+      Passed = Passed && BusPassed;
+
+      MbufFree(MilDisp);
+      MbufFree(MilGrab);
+      }
+
+   fprintf(Output, "  ]\n}\n");
+   FrameArchiveStop();
+   if (Output != stdout)
+      fclose(Output);
+   return Passed ? 0 : 1;
+   }
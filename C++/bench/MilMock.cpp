@@ -0,0 +1,393 @@
+﻿/********************************************************************************/
+/*
+* File name: MilMock.cpp
+*
+* Synopsis:  Implementation of the MIL mock used by the processing benchmark.
+*            See mil.h.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+
+/* Headers. */
+#include <mil.h>
+#include <stdarg.h>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/* Character cell drawn by MgraText(). */
+#define CHAR_SIZE_X     8
+#define CHAR_SIZE_Y     16
+
+typedef struct
+   {
+   MIL_INT              SizeBand;
+   MIL_INT              SizeX;
+   MIL_INT              SizeY;
+   MIL_INT              SizeBit;
+   MIL_INT              PitchByte;
+   vector<MIL_UINT8>    Data;
+   } MockBufferStruct;
+
+typedef struct
+   {
+   mutex                Lock;
+   condition_variable   Changed;
+   bool                 Signaled;
+   bool                 AutoReset;
+   } MockEventStruct;
+
+static mutex                          ObjectLock;
+static map<MIL_ID, MockBufferStruct*> Buffers;
+static map<MIL_ID, thread*>           Threads;
+static map<MIL_ID, MockEventStruct*>  Events;
+static MIL_ID                         NextId = 1;
+
+/* Error of the last feature access or digitizer inquiry of the thread. */
+static thread_local MIL_INT           CurrentError = M_NULL_ERROR;
+#define MOCK_FEATURE_ERROR            1
+
+static MockBufferStruct* Buffer(MIL_ID BufId)
+   {
+   lock_guard<mutex> Guard(ObjectLock);
+   map<MIL_ID, MockBufferStruct*>::iterator It = Buffers.find(BufId);
+   return (It != Buffers.end()) ? It->second : NULL;
+   }
+
+/* The bands are stored one after the other. */
+MIL_ID MbufAllocColor(MIL_ID SystemId, MIL_INT SizeBand, MIL_INT SizeX, MIL_INT SizeY, MIL_INT Type, MIL_INT64 Attribute,
+                      MIL_ID* BufIdPtr)
+   {
+   MockBufferStruct* Buf = new MockBufferStruct;
+   MIL_ID BufId;
+
+   Buf->SizeBand = SizeBand;
+   Buf->SizeX = SizeX;
+   Buf->SizeY = SizeY;
+   Buf->SizeBit = Type & 0xFF;
+   Buf->PitchByte = SizeX*((Buf->SizeBit + 7)/8);
+   Buf->Data.assign((size_t)(Buf->PitchByte*SizeY*SizeBand), 0);
+
+   lock_guard<mutex> Guard(ObjectLock);
+   BufId = NextId++;
+   Buffers[BufId] = Buf;
+   if (BufIdPtr)
+      *BufIdPtr = BufId;
+   return BufId;
+   }
+
+MIL_ID MbufAlloc2d(MIL_ID SystemId, MIL_INT SizeX, MIL_INT SizeY, MIL_INT Type, MIL_INT64 Attribute, MIL_ID* BufIdPtr)
+   {
+   return MbufAllocColor(SystemId, 1, SizeX, SizeY, Type, Attribute, BufIdPtr);
+   }
+
+void MbufFree(MIL_ID BufId)
+   {
+   lock_guard<mutex> Guard(ObjectLock);
+   delete Buffers[BufId];
+   Buffers.erase(BufId);
+   }
+
+MIL_INT MbufInquire(MIL_ID BufId, MIL_INT InquireType, void* UserVarPtr)
+   {
+   MockBufferStruct* Buf = Buffer(BufId);
+   MIL_INT Value = 0;
+
+   if (Buf == NULL)
+      return 0;
+
+   switch (InquireType)
+      {
+      case M_SIZE_X:       Value = Buf->SizeX; break;
+      case M_SIZE_Y:       Value = Buf->SizeY; break;
+      case M_SIZE_BAND:    Value = Buf->SizeBand; break;
+      case M_SIZE_BIT:     Value = Buf->SizeBit; break;
+      case M_PITCH_BYTE:   Value = Buf->PitchByte; break;
+      case M_COMPRESSED_DATA_SIZE_BYTE: Value = (MIL_INT)Buf->Data.size(); break;
+      case M_HOST_ADDRESS:
+         if (UserVarPtr)
+            *(void**)UserVarPtr = &Buf->Data[0];
+         return (MIL_INT)&Buf->Data[0];
+      default:             break;
+      }
+   if (UserVarPtr)
+      *(MIL_INT*)UserVarPtr = Value;
+   return Value;
+   }
+
+void MbufGet(MIL_ID SrcBufId, void* UserArrayPtr)
+   {
+   MockBufferStruct* Buf = Buffer(SrcBufId);
+   if (Buf)
+      memcpy(UserArrayPtr, &Buf->Data[0], Buf->Data.size());
+   }
+
+void MbufPut2d(MIL_ID DestBufId, MIL_INT OffX, MIL_INT OffY, MIL_INT SizeX, MIL_INT SizeY, const void* UserArrayPtr)
+   {
+   MockBufferStruct* Buf = Buffer(DestBufId);
+   MIL_INT PixelByte, RowByte;
+
+   if (Buf == NULL || OffX < 0 || OffY < 0 || OffX + SizeX > Buf->SizeX || OffY + SizeY > Buf->SizeY)
+      return;
+   PixelByte = (Buf->SizeBit + 7)/8;
+   RowByte = SizeX*PixelByte;
+   for (MIL_INT y = 0; y < SizeY; y++)
+      memcpy(&Buf->Data[(size_t)((OffY + y)*Buf->PitchByte + OffX*PixelByte)],
+             (const MIL_UINT8*)UserArrayPtr + y*RowByte, (size_t)RowByte);
+   }
+
+void MbufCopy(MIL_ID SrcBufId, MIL_ID DestBufId)
+   {
+   MockBufferStruct* Src = Buffer(SrcBufId);
+   MockBufferStruct* Dst = Buffer(DestBufId);
+
+   if (Src && Dst && Src->Data.size() == Dst->Data.size())
+      memcpy(&Dst->Data[0], &Src->Data[0], Src->Data.size());
+   }
+
+void MbufClear(MIL_ID DestBufId, MIL_DOUBLE Color)
+   {
+   MockBufferStruct* Buf = Buffer(DestBufId);
+   MIL_INT PixelByte;
+
+   if (Buf == NULL)
+      return;
+   PixelByte = (Buf->SizeBit + 7)/8;
+   for (MIL_INT i = 0; i < Buf->SizeX*Buf->SizeY; i++)
+      {
+      if (PixelByte == 1)
+         Buf->Data[(size_t)i] = (MIL_UINT8)Color;
+      else
+         ((MIL_UINT16*)&Buf->Data[0])[i] = (MIL_UINT16)Color;
+      }
+   }
+
+/* Buffers are host memory; there is nothing to update. */
+void MbufControl(MIL_ID BufId, MIL_INT ControlType, MIL_DOUBLE ControlValue)
+   {
+   }
+
+/* Fills one cell per character with a pattern made from its code. */
+void MgraText(MIL_ID ContextGraId, MIL_ID DstImageBufOrListGraId, MIL_DOUBLE XStart, MIL_DOUBLE YStart,
+              const MIL_TEXT_CHAR* String)
+   {
+   MockBufferStruct* Buf = Buffer(DstImageBufOrListGraId);
+   MIL_INT PixelByte;
+
+   if (Buf == NULL)
+      return;
+   PixelByte = (Buf->SizeBit + 7)/8;
+   for (MIL_INT c = 0; String[c]; c++)
+      {
+      MIL_INT X0 = (MIL_INT)XStart + c*CHAR_SIZE_X;
+      for (MIL_INT y = (MIL_INT)YStart; y < (MIL_INT)YStart + CHAR_SIZE_Y && y < Buf->SizeY; y++)
+         for (MIL_INT x = X0; x < X0 + CHAR_SIZE_X && x < Buf->SizeX; x++)
+            if ((String[c] >> ((x + y) & 7)) & 1)
+               memset(&Buf->Data[(size_t)(y*Buf->PitchByte + x*PixelByte)], 0xFF, (size_t)PixelByte);
+      }
+   }
+
+/* The benchmark passes the grabbed buffer as the hook identifier. */
+MIL_INT MdigGetHookInfo(MIL_ID EventId, MIL_INT InfoType, void* UserVarPtr)
+   {
+   if (InfoType == M_MODIFIED_BUFFER+M_BUFFER_ID)
+      *(MIL_ID*)UserVarPtr = EventId;
+   else
+      *(MIL_INT*)UserVarPtr = 0;
+   return 0;
+   }
+
+/* The grab counters of the mock camera are 0; it has no stream packet counters. */
+MIL_INT MdigInquire(MIL_ID DigId, MIL_INT InquireType, void* UserVarPtr)
+   {
+   bool Transport = (InquireType == M_GC_TOTAL_PACKETS_RESENDS_NB || InquireType == M_GC_TOTAL_PACKETS_MISSED);
+
+   CurrentError = Transport ? MOCK_FEATURE_ERROR : M_NULL_ERROR;
+   if (UserVarPtr == NULL)
+      return 0;
+   if (InquireType == M_PROCESS_FRAME_RATE)
+      *(MIL_DOUBLE*)UserVarPtr = 0.0;
+   else if (!Transport)
+      *(MIL_INT*)UserVarPtr = 0;
+   return 0;
+   }
+
+MIL_INT MdigInquire(MIL_ID DigId, MIL_INT InquireType, MIL_STRING& UserVar)
+   {
+   CurrentError = M_NULL_ERROR;
+   UserVar.clear();
+   return 0;
+   }
+
+/* The mock camera never grabs; hooks are never called. */
+void MdigHookFunction(MIL_ID DigId, MIL_INT HookType, MIL_DIG_HOOK_FUNCTION_PTR HookHandlerPtr, void* UserDataPtr)
+   {
+   }
+
+/* The mock camera implements no feature. */
+void MdigInquireFeature(MIL_ID DigId, MIL_INT64 InquireType, const MIL_TEXT_CHAR* FeatureName, MIL_INT64 UserVarType,
+                        void* UserVarPtr)
+   {
+   CurrentError = MOCK_FEATURE_ERROR;
+   }
+
+void MdigInquireFeature(MIL_ID DigId, MIL_INT64 InquireType, const MIL_TEXT_CHAR* FeatureName, MIL_INT64 UserVarType,
+                        MIL_STRING& UserVar)
+   {
+   CurrentError = MOCK_FEATURE_ERROR;
+   }
+
+void MdigControlFeature(MIL_ID DigId, MIL_INT64 ControlType, const MIL_TEXT_CHAR* FeatureName, MIL_INT64 UserVarType,
+                        const void* UserVarPtr)
+   {
+   CurrentError = MOCK_FEATURE_ERROR;
+   }
+
+void MdigControlFeature(MIL_ID DigId, MIL_INT64 ControlType, const MIL_TEXT_CHAR* FeatureName, MIL_INT64 UserVarType,
+                        const MIL_STRING& UserVar)
+   {
+   CurrentError = MOCK_FEATURE_ERROR;
+   }
+
+/* Errors are never printed; the print setting of the thread is only kept. */
+static thread_local MIL_INT PrintState = M_PRINT_ENABLE;
+
+void MappControl(MIL_ID ContextAppId, MIL_INT64 ControlType, MIL_INT ControlValue)
+   {
+   if (ControlType == M_ERROR)
+      PrintState = ControlValue;
+   }
+
+MIL_INT MappInquire(MIL_ID ContextAppId, MIL_INT64 InquireType, void* UserVarPtr)
+   {
+   MIL_INT Value = (InquireType == M_ERROR) ? PrintState : 0;
+   if (UserVarPtr)
+      *(MIL_INT*)UserVarPtr = Value;
+   return Value;
+   }
+
+MIL_INT MappGetError(MIL_ID ContextAppId, MIL_INT64 ErrorType, void* ErrorPtr)
+   {
+   if (ErrorPtr)
+      *(MIL_INT*)ErrorPtr = CurrentError;
+   return CurrentError;
+   }
+
+MIL_DOUBLE MappTimer(MIL_INT64 ContextAppId, MIL_INT64 Mode, MIL_DOUBLE* TimePtr)
+   {
+   MIL_DOUBLE Time = chrono::duration<MIL_DOUBLE>(chrono::steady_clock::now().time_since_epoch()).count();
+   if (TimePtr)
+      *TimePtr = Time;
+   return Time;
+   }
+
+static MockEventStruct* Event(MIL_ID EventId)
+   {
+   lock_guard<mutex> Guard(ObjectLock);
+   map<MIL_ID, MockEventStruct*>::iterator It = Events.find(EventId);
+   return (It != Events.end()) ? It->second : NULL;
+   }
+
+MIL_ID MthrAlloc(MIL_ID SystemId, MIL_INT ObjectType, MIL_INT64 InitFlag, MIL_THREAD_FUNCTION_PTR ThreadFctPtr,
+                 void* UserDataPtr, MIL_ID* ThreadIdPtr)
+   {
+   lock_guard<mutex> Guard(ObjectLock);
+   MIL_ID ObjectId = NextId++;
+
+   if (ObjectType == M_EVENT)
+      {
+      MockEventStruct* Ev = new MockEventStruct;
+      Ev->Signaled = (InitFlag & M_SIGNALED) != 0;
+      Ev->AutoReset = (InitFlag & M_AUTO_RESET) != 0;
+      Events[ObjectId] = Ev;
+      }
+   else
+      Threads[ObjectId] = new thread(ThreadFctPtr, UserDataPtr);
+   if (ThreadIdPtr)
+      *ThreadIdPtr = ObjectId;
+   return ObjectId;
+   }
+
+/* Waits for the end of a thread, or for an event to be signaled, for at most */
+/* the M_EVENT_TIMEOUT of Mode if any. StatePtr receives M_SIGNALED, or       */
+/* M_NOT_SIGNALED on timeout.                                                 */
+void MthrWait(MIL_ID ThreadId, MIL_INT64 Mode, MIL_INT* StatePtr)
+   {
+   MockEventStruct* Ev = Event(ThreadId);
+   thread* Thread;
+
+   if (Ev)
+      {
+      MIL_INT64 TimeoutMs = Mode >> 16;
+      unique_lock<mutex> Guard(Ev->Lock);
+      if (TimeoutMs > 0)
+         Ev->Changed.wait_for(Guard, chrono::milliseconds(TimeoutMs), [Ev] { return Ev->Signaled; });
+      else
+         Ev->Changed.wait(Guard, [Ev] { return Ev->Signaled; });
+      if (StatePtr)
+         *StatePtr = Ev->Signaled ? M_SIGNALED : M_NOT_SIGNALED;
+      if (Ev->AutoReset)
+         Ev->Signaled = false;
+      return;
+      }
+
+      {
+      lock_guard<mutex> Guard(ObjectLock);
+      Thread = Threads[ThreadId];
+      }
+   if (Thread && Thread->joinable())
+      Thread->join();
+   }
+
+void MthrControl(MIL_ID EventId, MIL_INT64 ControlType, MIL_DOUBLE ControlValue)
+   {
+   MockEventStruct* Ev = Event(EventId);
+
+   if (Ev == NULL || ControlType != M_EVENT_SET)
+      return;
+   lock_guard<mutex> Guard(Ev->Lock);
+   Ev->Signaled = (ControlValue == M_SIGNALED);
+   Ev->Changed.notify_all();
+   }
+
+void MthrFree(MIL_ID ThreadId)
+   {
+   lock_guard<mutex> Guard(ObjectLock);
+   delete Threads[ThreadId];
+   Threads.erase(ThreadId);
+   delete Events[ThreadId];
+   Events.erase(ThreadId);
+   }
+
+int MosPrintf(const MIL_TEXT_CHAR* Format, ...)
+   {
+   va_list Args;
+   int Count;
+
+   va_start(Args, Format);
+   Count = vfprintf(stderr, Format, Args);
+   va_end(Args);
+   return Count;
+   }
+
+int MosSprintf(MIL_TEXT_CHAR* Buffer, MIL_INT Size, const MIL_TEXT_CHAR* Format, ...)
+   {
+   va_list Args;
+   int Count;
+
+   va_start(Args, Format);
+   Count = vsnprintf(Buffer, (size_t)Size, Format, Args);
+   va_end(Args);
+   return Count;
+   }
+
+void MosSleep(MIL_INT Milliseconds)
+   {
+   this_thread::sleep_for(chrono::milliseconds(Milliseconds));
+   }
@@ -0,0 +1,173 @@
+﻿/********************************************************************************/
+/*
+* File name: mil.h
+*
+* Synopsis:  Minimal mock of the MIL API for the processing benchmark.
+*
+*            Only the functions and constants used by the benchmarked code are
+*            declared. Buffers are plain host memory, MgraText() draws simple
+*            character cells and threads and events are standard threads and
+*            condition variables, so that the benchmark builds and runs without
+*            a MIL installation. The mock camera implements no GenICam feature:
+*            every feature access fails, as reported by MappGetError(). The
+*            console output goes to stderr, so that the results written on
+*            stdout stay valid JSON. This file must never be on the include
+*            path of the MilGige example itself.
+*
+* Copyright © Matrox Electronic Systems Ltd., 1992-YYYY.
+* All Rights Reserved
+*/
+#ifndef MIL_BENCH_MOCK_H
+#define MIL_BENCH_MOCK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#define M_MIL_USE_WINDOWS           0
+#define M_MIL_USE_LINUX             1
+#define MFTYPE
+
+typedef long long                   MIL_INT;
+typedef long long                   MIL_INT64;
+typedef unsigned long long          MIL_UINT64;
+typedef int                         MIL_INT32;
+typedef unsigned int                MIL_UINT32;
+typedef unsigned short              MIL_UINT16;
+typedef unsigned char               MIL_UINT8;
+typedef double                      MIL_DOUBLE;
+typedef long long                   MIL_ID;
+typedef char                        MIL_TEXT_CHAR;
+typedef std::string                 MIL_STRING;
+
+#define MIL_TEXT(Text)              Text
+#define M_NULL                      0
+#define M_DEFAULT                   0x10000000L
+#define M_YES                       1
+#define M_NO                        0
+#define M_TRUE                      1
+#define M_FALSE                     0
+
+/* Buffers. */
+#define M_UNSIGNED                  0x00000000L
+#define M_IMAGE                     0x00000004L
+#define M_GRAB                      0x00000080L
+#define M_PROC                      0x00000008L
+#define M_DISP                      0x00000010L
+#define M_SIZE_X                    1536L
+#define M_SIZE_Y                    1537L
+#define M_SIZE_BAND                 1005L
+#define M_SIZE_BIT                  1007L
+#define M_PITCH_BYTE                1028L
+#define M_OWNER_SYSTEM              1101L
+#define M_HOST_ADDRESS              1029L
+#define M_MODIFIED                  4096L
+#define M_COMPRESS                  0x00004000L
+#define M_JPEG_LOSSY                0x00010000L
+#define M_COMPRESSED_DATA_SIZE_BYTE 1601L
+
+/* Digitizer hooks. The hook identifier of the mock is the buffer itself. */
+#define M_MODIFIED_BUFFER           0x40000000L
+#define M_BUFFER_ID                 0x00160000L
+#define M_BUFFER_INDEX              0x00170000L
+
+#define M_CORRUPTED_FRAME           0x00200000L
+#define M_GRAB_FRAME_START          0x00210000L
+#define M_UNHOOK                    0x04000000L
+
+/* Digitizer inquiries. The mock camera has no network interface. */
+#define M_GC_LOCAL_IP_ADDRESS_STRING 0x00180000L
+#define M_GC_INTERFACE_NAME         0x00190000L
+#define M_GC_TOTAL_PACKETS_RESENDS_NB 0x001A0000L
+#define M_GC_TOTAL_PACKETS_MISSED   0x001B0000L
+#define M_PROCESS_FRAME_COUNT       0x001C0000L
+#define M_PROCESS_FRAME_MISSED      0x001D0000L
+#define M_PROCESS_FRAME_RATE        0x001E0000L
+#define M_PROCESS_PENDING_GRAB_NUM  0x001F0000L
+
+/* GenICam features. */
+#define M_FEATURE_VALUE             1L
+#define M_FEATURE_MIN               2L
+#define M_FEATURE_MAX               3L
+#define M_FEATURE_EXECUTE           4L
+#define M_FEATURE_ENUM_ENTRY_COUNT  5L
+#define M_FEATURE_ENUM_ENTRY_NAME   0x00100000L
+#define M_TYPE_STRING               1L
+#define M_TYPE_INT64                2L
+#define M_TYPE_MIL_INT              3L
+#define M_TYPE_MIL_DOUBLE           4L
+
+/* Application, threads, events and timer. */
+#define M_TIMER_READ                1L
+#define M_ERROR                     1L
+#define M_PRINT_DISABLE             0L
+#define M_PRINT_ENABLE              1L
+#define M_CURRENT                   2L
+#define M_NULL_ERROR                0L
+#define M_THREAD                    1L
+#define M_THREAD_END_WAIT           2L
+#define M_EVENT                     2L
+#define M_NOT_SIGNALED              0L
+#define M_SIGNALED                  1L
+#define M_AUTO_RESET                2L
+#define M_EVENT_SET                 3L
+#define M_EVENT_WAIT                4L
+#define M_EVENT_TIMEOUT(Ms)         (((MIL_INT64)(Ms)) << 16)
+
+typedef MIL_INT    (MFTYPE *MIL_DIG_HOOK_FUNCTION_PTR)(MIL_INT HookType, MIL_ID HookId, void* HookDataPtr);
+typedef MIL_UINT32 (MFTYPE *MIL_THREAD_FUNCTION_PTR)(void* ThreadContext);
+
+MIL_ID  MbufAlloc2d(MIL_ID SystemId, MIL_INT SizeX, MIL_INT SizeY, MIL_INT Type, MIL_INT64 Attribute, MIL_ID* BufIdPtr);
+MIL_ID  MbufAllocColor(MIL_ID SystemId, MIL_INT SizeBand, MIL_INT SizeX, MIL_INT SizeY, MIL_INT Type, MIL_INT64 Attribute,
+                       MIL_ID* BufIdPtr);
+void    MbufFree(MIL_ID BufId);
+MIL_INT MbufInquire(MIL_ID BufId, MIL_INT InquireType, void* UserVarPtr);
+void    MbufGet(MIL_ID SrcBufId, void* UserArrayPtr);
+void    MbufPut2d(MIL_ID DestBufId, MIL_INT OffX, MIL_INT OffY, MIL_INT SizeX, MIL_INT SizeY, const void* UserArrayPtr);
+void    MbufCopy(MIL_ID SrcBufId, MIL_ID DestBufId);
+void    MbufClear(MIL_ID DestBufId, MIL_DOUBLE Color);
+void    MbufControl(MIL_ID BufId, MIL_INT ControlType, MIL_DOUBLE ControlValue);
+void    MgraText(MIL_ID ContextGraId, MIL_ID DstImageBufOrListGraId, MIL_DOUBLE XStart, MIL_DOUBLE YStart,
+                 const MIL_TEXT_CHAR* String);
+MIL_INT MdigGetHookInfo(MIL_ID EventId, MIL_INT InfoType, void* UserVarPtr);
+MIL_INT MdigInquire(MIL_ID DigId, MIL_INT InquireType, void* UserVarPtr);
+MIL_INT MdigInquire(MIL_ID DigId, MIL_INT InquireType, MIL_STRING& UserVar);
+void    MdigHookFunction(MIL_ID DigId, MIL_INT HookType, MIL_DIG_HOOK_FUNCTION_PTR HookHandlerPtr, void* UserDataPtr);
+void    MdigInquireFeature(MIL_ID DigId, MIL_INT64 InquireType, const MIL_TEXT_CHAR* FeatureName, MIL_INT64 UserVarType,
+                           void* UserVarPtr);
+void    MdigInquireFeature(MIL_ID DigId, MIL_INT64 InquireType, const MIL_TEXT_CHAR* FeatureName, MIL_INT64 UserVarType,
+                           MIL_STRING& UserVar);
+void    MdigControlFeature(MIL_ID DigId, MIL_INT64 ControlType, const MIL_TEXT_CHAR* FeatureName, MIL_INT64 UserVarType,
+                           const void* UserVarPtr);
+void    MdigControlFeature(MIL_ID DigId, MIL_INT64 ControlType, const MIL_TEXT_CHAR* FeatureName, MIL_INT64 UserVarType,
+                           const MIL_STRING& UserVar);
+inline void MdigInquireFeature(MIL_ID DigId, MIL_INT64 InquireType, const MIL_STRING& FeatureName, MIL_INT64 UserVarType,
+                               void* UserVarPtr)
+   { MdigInquireFeature(DigId, InquireType, FeatureName.c_str(), UserVarType, UserVarPtr); }
+inline void MdigInquireFeature(MIL_ID DigId, MIL_INT64 InquireType, const MIL_STRING& FeatureName, MIL_INT64 UserVarType,
+                               MIL_STRING& UserVar)
+   { MdigInquireFeature(DigId, InquireType, FeatureName.c_str(), UserVarType, UserVar); }
+inline void MdigControlFeature(MIL_ID DigId, MIL_INT64 ControlType, const MIL_STRING& FeatureName, MIL_INT64 UserVarType,
+                               const void* UserVarPtr)
+   { MdigControlFeature(DigId, ControlType, FeatureName.c_str(), UserVarType, UserVarPtr); }
+inline void MdigControlFeature(MIL_ID DigId, MIL_INT64 ControlType, const MIL_STRING& FeatureName, MIL_INT64 UserVarType,
+                               const MIL_STRING& UserVar)
+   { MdigControlFeature(DigId, ControlType, FeatureName.c_str(), UserVarType, UserVar); }
+
+void    MappControl(MIL_ID ContextAppId, MIL_INT64 ControlType, MIL_INT ControlValue);
+MIL_INT MappInquire(MIL_ID ContextAppId, MIL_INT64 InquireType, void* UserVarPtr);
+MIL_INT MappGetError(MIL_ID ContextAppId, MIL_INT64 ErrorType, void* ErrorPtr);
+
+MIL_DOUBLE MappTimer(MIL_INT64 ContextAppId, MIL_INT64 Mode, MIL_DOUBLE* TimePtr);
+MIL_ID  MthrAlloc(MIL_ID SystemId, MIL_INT ObjectType, MIL_INT64 InitFlag, MIL_THREAD_FUNCTION_PTR ThreadFctPtr,
+                  void* UserDataPtr, MIL_ID* ThreadIdPtr);
+void    MthrWait(MIL_ID ThreadId, MIL_INT64 Mode, MIL_INT* StatePtr);
+void    MthrControl(MIL_ID EventId, MIL_INT64 ControlType, MIL_DOUBLE ControlValue);
+void    MthrFree(MIL_ID ThreadId);
+
+int     MosPrintf(const MIL_TEXT_CHAR* Format, ...);
+int     MosSprintf(MIL_TEXT_CHAR* Buffer, MIL_INT Size, const MIL_TEXT_CHAR* Format, ...);
+void    MosSleep(MIL_INT Milliseconds);
+
+#endif